@@ -0,0 +1,226 @@
+/**
+ * @file AdmissionController.cpp
+ * @brief Implementation of the AdmissionController class and the AdmissionGate middleware.
+ */
+
+#include "AdmissionController.h"
+#include "RequestKind.h"
+#include <cmath>
+#include <sstream>
+
+namespace {
+
+/**
+ * @brief Label of a priority in the metrics.
+ */
+const char *label(int priority)
+{
+    static const char *labels[] = {"critical", "normal", "bulk"};
+    return labels[priority];
+}
+
+} // namespace
+
+/**
+ * @brief Registers with every pool.
+ *
+ * @param pools The pools to watch.
+ * @param settings Tuning knobs.
+ */
+AdmissionController::AdmissionController(const std::vector<DbExecutor *> &pools, Settings settings)
+    : settings(settings)
+{
+    for (DbExecutor *pool : pools)
+        watched.push_back({pool});
+    for (size_t i = 0; i < watched.size(); i++)
+    {
+        watched[i].pool->setSojournListener([this, i](std::chrono::microseconds sojourn, size_t queued)
+                                            { observe(i, sojourn, queued); });
+    }
+}
+
+/**
+ * @brief Unregisters from every pool.
+ */
+AdmissionController::~AdmissionController()
+{
+    for (Watched &w : watched)
+        w.pool->setSojournListener(nullptr);
+}
+
+/**
+ * @brief Applies the CoDel state to a new request.
+ *
+ * @param priority Class of the request.
+ * @return true if admitted.
+ */
+bool AdmissionController::admit(Priority priority)
+{
+    int index = static_cast<int>(priority);
+    bool ok = true;
+    if (priority != Priority::Critical)
+    {
+        size_t inFlight = 0;
+        for (const Watched &w : watched)
+            inFlight += w.pool->inFlight();
+        Clock::time_point now = Clock::now();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (inFlight == 0)
+        {
+            // Nothing queued means nothing to report a delay, the overload is over
+            for (Watched &w : watched)
+            {
+                w.overloaded = false;
+                w.firstAboveTarget = {};
+            }
+        }
+        bool overloaded = dropping();
+        if (inFlight >= settings.maxInFlight)
+            ok = false;
+        else if (overloaded && priority == Priority::Bulk)
+            ok = false;
+        else if (overloaded && now >= dropNext)
+        {
+            // Control law: the gap between two sheds shrinks with sqrt(count)
+            ok = false;
+            dropCount++;
+            dropNext = now + std::chrono::duration_cast<Clock::duration>(settings.interval / std::sqrt(static_cast<double>(dropCount)));
+        }
+    }
+
+    (ok ? admitted : shed)[index]++;
+    return ok;
+}
+
+/**
+ * @brief True while the controller is shedding.
+ */
+bool AdmissionController::shedding() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return dropping();
+}
+
+/**
+ * @brief True if any watched pool is overloaded.
+ */
+bool AdmissionController::dropping() const
+{
+    for (const Watched &w : watched)
+    {
+        if (w.overloaded)
+            return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Updates the CoDel state of a pool with the delay of a job just picked up.
+ *
+ * @param index The pool.
+ * @param sojourn Time the job waited.
+ * @param queued Jobs still waiting in the pool.
+ */
+void AdmissionController::observe(size_t index, std::chrono::microseconds sojourn, size_t queued)
+{
+    Clock::time_point now = Clock::now();
+    std::lock_guard<std::mutex> lock(mutex);
+    Watched &w = watched[index];
+    lastSojourn = sojourn;
+
+    if (sojourn < settings.target || queued == 0)
+    {
+        w.firstAboveTarget = {};
+        w.overloaded = false;
+        return;
+    }
+    if (w.firstAboveTarget == Clock::time_point{})
+    {
+        w.firstAboveTarget = now + settings.interval;
+        return;
+    }
+    if (!w.overloaded && now >= w.firstAboveTarget)
+    {
+        if (!dropping())
+        {
+            // Overloaded again soon after the last episode: resume near the old shed rate
+            bool recent = now - dropNext < 16 * settings.interval;
+            dropCount = recent && dropCount > 2 ? dropCount - 2 : 1;
+            dropNext = now;
+        }
+        w.overloaded = true;
+    }
+}
+
+/**
+ * @brief Formats the counters and the state for /metrics.
+ *
+ * @return std::string Prometheus text lines.
+ */
+std::string AdmissionController::metrics() const
+{
+    std::ostringstream out;
+    out << "# HELP taskmaster_requests_admitted_total Requests let through by admission control.\n"
+        << "# TYPE taskmaster_requests_admitted_total counter\n";
+    for (int i = 0; i < 3; i++)
+        out << "taskmaster_requests_admitted_total{class=\"" << label(i) << "\"} " << admitted[i].load() << "\n";
+    out << "# HELP taskmaster_requests_shed_total Requests answered 503 by admission control.\n"
+        << "# TYPE taskmaster_requests_shed_total counter\n";
+    for (int i = 0; i < 3; i++)
+        out << "taskmaster_requests_shed_total{class=\"" << label(i) << "\"} " << shed[i].load() << "\n";
+
+    std::lock_guard<std::mutex> lock(mutex);
+    out << "# HELP taskmaster_admission_shedding 1 while requests are being shed.\n"
+        << "# TYPE taskmaster_admission_shedding gauge\n"
+        << "taskmaster_admission_shedding " << (dropping() ? 1 : 0) << "\n"
+        << "# HELP taskmaster_queue_sojourn_seconds Queueing delay of the last database job.\n"
+        << "# TYPE taskmaster_queue_sojourn_seconds gauge\n"
+        << "taskmaster_queue_sojourn_seconds " << lastSojourn.count() / 1e6 << "\n";
+    return out.str();
+}
+
+/**
+ * @brief Sheds the request with 503 and Retry-After if the controller says so.
+ *
+ * @param req The request.
+ * @param res The response, ended here when shed.
+ */
+void AdmissionGate::before_handle(crow::request &req, crow::response &res, context &)
+{
+    if (!controller || controller->admit(classify(req)))
+        return;
+    res = crow::response(503, "Server overloaded, try again later");
+    res.set_header("Retry-After", std::to_string(controller->retryAfter().count()));
+    res.end();
+}
+
+/**
+ * @brief Nothing to do once the route answered.
+ */
+void AdmissionGate::after_handle(crow::request &, crow::response &, context &) {}
+
+/**
+ * @brief Classifies a request.
+ *
+ * Critical: requests that never reach the database, login and admin pages. Bulk: whole
+ * table scans, project export and import, and the debug routes. Everything else is Normal.
+ *
+ * @param req The request.
+ * @return AdmissionController::Priority The class.
+ */
+AdmissionController::Priority AdmissionGate::classify(const crow::request &req)
+{
+    switch (requestKind(req))
+    {
+    case RequestKind::Free:
+    case RequestKind::Admin:
+    case RequestKind::Login:
+        return AdmissionController::Priority::Critical;
+    case RequestKind::Debug:
+    case RequestKind::Bulk:
+        return AdmissionController::Priority::Bulk;
+    default:
+        return AdmissionController::Priority::Normal;
+    }
+}
@@ -0,0 +1,174 @@
+/**
+ * @file AdmissionController.h
+ * @brief Declaration of the AdmissionController class and the AdmissionGate middleware.
+ *
+ * Under overload every request used to wait in the DbExecutor queues until it timed out,
+ * so all users were served slowly. The admission controller watches how long jobs wait
+ * in those queues and, once they keep waiting too long, turns requests away at the door
+ * with 503 and Retry-After, expensive ones first, so the rest are served quickly.
+ */
+
+#ifndef ADMISSIONCONTROLLER_H
+#define ADMISSIONCONTROLLER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "DbExecutor.h"
+#include "crow.h"
+
+/**
+ * @class AdmissionController
+ * @brief CoDel-style load shedding driven by the queueing delay of the database pools.
+ *
+ * Every job picked up by a pool reports its sojourn time (time spent queued). As in
+ * CoDel, a delay above the target is tolerated for one interval; if it stays above for
+ * the whole interval the controller starts shedding. Each pool is judged on its own
+ * delays, so a busy shard is not hidden by idle ones, and shedding goes on while any
+ * pool is overloaded. Bulk requests are then all shed,
+ * normal requests are shed at a rate that grows with the square root of the number
+ * shed so far, and critical requests always pass. A pool stops counting as overloaded
+ * as soon as one of its jobs is picked up with a short delay or its queue runs empty.
+ */
+class AdmissionController
+{
+public:
+    /**
+     * @brief Classes of requests, in the order they are kept under load.
+     */
+    enum class Priority
+    {
+        Critical,   /**< Login, health and metrics, never shed */
+        Normal,     /**< Filtered reads and writes */
+        Bulk        /**< Unfiltered list scans and reports, shed first */
+    };
+
+    /**
+     * @brief Tuning knobs.
+     */
+    struct Settings
+    {
+        std::chrono::milliseconds target{20};                /**< Acceptable queueing delay */
+        std::chrono::milliseconds interval{200};             /**< Time the delay may stay above target */
+        size_t maxInFlight = 2048;                           /**< Jobs queued or running above which Normal and Bulk are shed */
+        std::chrono::seconds retryAfter{1};                  /**< Value of the Retry-After header */
+    };
+
+    /**
+     * @brief Starts watching the queueing delay of the pools.
+     *
+     * @param pools The read and write pools of every shard, which must outlive the controller.
+     * @param settings Tuning knobs.
+     */
+    AdmissionController(const std::vector<DbExecutor *> &pools, Settings settings);
+
+    /**
+     * @brief Stops watching the pools.
+     */
+    ~AdmissionController();
+
+    AdmissionController(const AdmissionController &) = delete;
+    AdmissionController &operator=(const AdmissionController &) = delete;
+
+    /**
+     * @brief Decides whether a request may go on to its route.
+     *
+     * @param priority Class of the request.
+     * @return true to serve it, false to answer 503.
+     */
+    bool admit(Priority priority);
+
+    /**
+     * @brief True while requests are being shed.
+     */
+    bool shedding() const;
+
+    /**
+     * @brief Value for the Retry-After header of shed requests.
+     */
+    std::chrono::seconds retryAfter() const { return settings.retryAfter; }
+
+    /**
+     * @brief Admission counters and state in the Prometheus text format.
+     *
+     * @return std::string The metrics, one per line.
+     */
+    std::string metrics() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @brief A watched pool and its overload state.
+     */
+    struct Watched
+    {
+        DbExecutor *pool;                                    /**< The pool */
+        Clock::time_point firstAboveTarget{};                /**< When a delay above target becomes overload, unset if below */
+        bool overloaded = false;                             /**< Delays stayed above target for an interval */
+    };
+
+    /**
+     * @brief Records the queueing delay of a job, called by the pools.
+     *
+     * @param index Index of the pool in watched.
+     * @param sojourn Time the job waited.
+     * @param queued Jobs still waiting in that pool after it.
+     */
+    void observe(size_t index, std::chrono::microseconds sojourn, size_t queued);
+
+    /**
+     * @brief True if any pool is overloaded. Caller holds mutex.
+     */
+    bool dropping() const;
+
+    Settings settings;                                       /**< Tuning knobs */
+
+    mutable std::mutex mutex;                                /**< Guards the CoDel state below */
+    std::vector<Watched> watched;                            /**< The pools, fixed after construction */
+    Clock::time_point dropNext{};                            /**< When the next Normal request is shed */
+    uint32_t dropCount = 0;                                  /**< Normal requests shed in this overload */
+    std::chrono::microseconds lastSojourn{0};                /**< Delay of the last job picked up */
+
+    std::atomic<uint64_t> admitted[3] = {};                  /**< Requests admitted, by Priority */
+    std::atomic<uint64_t> shed[3] = {};                      /**< Requests shed, by Priority */
+};
+
+/**
+ * @struct AdmissionGate
+ * @brief Crow middleware that classifies requests and asks the AdmissionController.
+ *
+ * Runs after crow::CORSHandler, so shed responses still carry the CORS headers. Does
+ * nothing until controller is set.
+ */
+struct AdmissionGate
+{
+    struct context
+    {
+    };
+
+    AdmissionController *controller = nullptr;              /**< The controller, set by main() */
+
+    /**
+     * @brief Answers 503 with Retry-After when the request is not admitted.
+     */
+    void before_handle(crow::request &req, crow::response &res, context &ctx);
+
+    /**
+     * @brief Nothing to do after the route ran.
+     */
+    void after_handle(crow::request &req, crow::response &res, context &ctx);
+
+    /**
+     * @brief Class of a request, from its method, path and filters.
+     *
+     * @param req The request.
+     * @return AdmissionController::Priority The class.
+     */
+    static AdmissionController::Priority classify(const crow::request &req);
+};
+
+#endif // ADMISSIONCONTROLLER_H
@@ -0,0 +1,352 @@
+/**
+ * @file Backup.cpp
+ * @brief Implementation of the Backup class.
+ */
+
+#include "Backup.h"
+#include <algorithm>
+#include <ctime>
+#include <filesystem>
+#include <vector>
+
+namespace {
+
+/**
+ * @brief Current UTC time in the given strftime format.
+ *
+ * @param format The format.
+ * @return std::string The timestamp.
+ */
+std::string now(const char *format)
+{
+    time_t t = time(0);
+    char buffer[32];
+    strftime(buffer, sizeof(buffer), format, gmtime(&t));
+    return std::string(buffer);
+}
+
+/**
+ * @brief Runs a statement and returns the first column of its first row.
+ *
+ * @param db The connection.
+ * @param sql The statement.
+ * @return std::string The value, or the error message.
+ */
+std::string firstText(sqlite3 *db, const char *sql)
+{
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK)
+        return sqlite3_errmsg(db);
+    std::string value;
+    if (sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        const unsigned char *text = sqlite3_column_text(stmt, 0);
+        value = text ? reinterpret_cast<const char *>(text) : "";
+    }
+    else
+        value = sqlite3_errmsg(db);
+    sqlite3_finalize(stmt);
+    return value;
+}
+
+/**
+ * @brief True for the names of finished backups, "taskmaster-<timestamp>.db".
+ */
+bool isBackupName(const std::string &name)
+{
+    return name.rfind("taskmaster-", 0) == 0 && name.size() > 14 && name.compare(name.size() - 3, 3, ".db") == 0;
+}
+
+/**
+ * @brief Finished backups in a directory, oldest first.
+ *
+ * @param directory The backup directory.
+ * @return std::vector<std::filesystem::path> The files.
+ */
+std::vector<std::filesystem::path> backupFiles(const std::string &directory)
+{
+    std::vector<std::filesystem::path> files;
+    std::error_code error;
+    for (std::filesystem::directory_iterator it(directory, error), end; !error && it != end; it.increment(error))
+    {
+        if (it->is_regular_file() && isBackupName(it->path().filename().string()))
+            files.push_back(it->path());
+    }
+    // The timestamp in the name sorts by time
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+} // namespace
+
+/**
+ * @brief Creates the backup thread.
+ */
+Backup::Backup(std::string path, DbExecutor &writer, DbExecutor &readers, Settings settings)
+    : path(std::move(path)), writer(writer), readers(readers), settings(std::move(settings)) {}
+
+/**
+ * @brief Stops and joins the background thread. A running copy stops after its current step.
+ */
+Backup::~Backup()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    if (thread.joinable())
+        thread.join();
+}
+
+/**
+ * @brief Starts the background thread, which backs up every settings.interval and on request.
+ */
+void Backup::start()
+{
+    thread = std::thread([this]
+                         {
+        std::unique_lock<std::mutex> lock(mutex);
+        auto ready = [this] { return stopping || requested; };
+        while (!stopping)
+        {
+            if (settings.interval.count() > 0)
+                wake.wait_for(lock, settings.interval, ready);
+            else
+                wake.wait(lock, ready);
+            if (stopping)
+                break;
+            requested = false;
+            lock.unlock();
+            run();
+            lock.lock();
+        } });
+}
+
+/**
+ * @brief Wakes the thread for a backup.
+ *
+ * @return bool false if one is already running or requested.
+ */
+bool Backup::request()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (running || requested || stopping)
+            return false;
+        requested = true;
+    }
+    wake.notify_all();
+    return true;
+}
+
+/**
+ * @brief Reports the running backup, the last result and the backups on disk.
+ *
+ * @return crow::json::wvalue The status.
+ */
+crow::json::wvalue Backup::status() const
+{
+    crow::json::wvalue result;
+    std::vector<crow::json::wvalue> files;
+    std::error_code error;
+    for (const auto &file : backupFiles(settings.directory))
+    {
+        crow::json::wvalue entry;
+        entry["file"] = file.filename().string();
+        entry["size"] = static_cast<long long>(std::filesystem::file_size(file, error));
+        files.push_back(std::move(entry));
+    }
+    result["backups"] = std::move(files);
+    result["directory"] = settings.directory;
+    result["interval_hours"] = static_cast<long long>(settings.interval.count());
+
+    std::lock_guard<std::mutex> lock(mutex);
+    result["running"] = running || requested;
+    result["pages_done"] = pagesDone;
+    result["pages_total"] = pagesTotal;
+    result["progress"] = pagesTotal > 0 ? static_cast<double>(pagesDone) / pagesTotal : 0.0;
+    result["started"] = started;
+    result["last_file"] = lastFile;
+    result["last_finished"] = lastFinished;
+    result["last_seconds"] = lastSeconds;
+    result["last_error"] = lastError;
+    return result;
+}
+
+/**
+ * @brief Takes one backup into settings.directory, checks it and prunes old ones.
+ */
+void Backup::run()
+{
+    std::string name = "taskmaster-" + now("%Y%m%d-%H%M%S") + ".db";
+    std::string target = (std::filesystem::path(settings.directory) / name).string();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        running = true;
+        pagesDone = 0;
+        pagesTotal = 0;
+        started = now("%Y-%m-%d %H:%M:%S");
+    }
+
+    auto begin = std::chrono::steady_clock::now();
+    std::string error;
+    std::error_code fsError;
+    std::filesystem::create_directories(settings.directory, fsError);
+    bool ok = copy(target + ".part", error);
+    if (ok)
+    {
+        std::filesystem::rename(target + ".part", target, fsError);
+        if (fsError)
+        {
+            ok = false;
+            error = fsError.message();
+        }
+    }
+    if (!ok)
+        std::filesystem::remove(target + ".part", fsError);
+    else
+        prune();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    running = false;
+    lastError = error;
+    if (ok)
+    {
+        lastFile = name;
+        lastFinished = now("%Y-%m-%d %H:%M:%S");
+        lastSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    }
+}
+
+/**
+ * @brief Copies the database into target with the backup API, then checks the copy.
+ *
+ * @param target The file to write.
+ * @param error Receives the reason on failure.
+ * @return bool true if the copy is complete and passed PRAGMA quick_check.
+ */
+bool Backup::copy(const std::string &target, std::string &error)
+{
+    sqlite3 *source = nullptr;
+    sqlite3 *dest = nullptr;
+    if (sqlite3_open_v2(path.c_str(), &source, SQLITE_OPEN_READONLY, nullptr) != SQLITE_OK ||
+        sqlite3_open_v2(target.c_str(), &dest, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, nullptr) != SQLITE_OK)
+    {
+        sqlite3 *failed = dest ? dest : source;
+        error = failed ? sqlite3_errmsg(failed) : "out of memory";
+        sqlite3_close(source);
+        sqlite3_close(dest);
+        return false;
+    }
+    sqlite3_busy_timeout(source, 5000);
+
+    // A read transaction held for the whole copy pins one snapshot of the WAL, so
+    // commits from the server do not restart the backup
+    sqlite3_exec(source, "BEGIN; SELECT count(*) FROM sqlite_master;", nullptr, nullptr, nullptr);
+
+    sqlite3_backup *backup = sqlite3_backup_init(dest, "main", source, "main");
+    int rc = SQLITE_ERROR;
+    if (backup)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!stopping)
+        {
+            lock.unlock();
+            rc = sqlite3_backup_step(backup, settings.pagesPerStep);
+            int total = sqlite3_backup_pagecount(backup);
+            int remaining = sqlite3_backup_remaining(backup);
+            bool busy = readers.queued() > 0 || writer.queued() > 0;
+            lock.lock();
+            pagesTotal = total;
+            pagesDone = total - remaining;
+            if (rc != SQLITE_OK && rc != SQLITE_BUSY && rc != SQLITE_LOCKED)
+                break;
+
+            // Give the disk and the CPU back to the server between steps
+            wake.wait_for(lock, busy ? settings.busyPause : settings.pause, [this] { return stopping; });
+        }
+        if (stopping && rc != SQLITE_DONE)
+            error = "Server stopped during backup";
+        lock.unlock();
+        sqlite3_backup_finish(backup);
+    }
+    if (rc != SQLITE_DONE && error.empty())
+        error = sqlite3_errmsg(dest);
+    sqlite3_exec(source, "COMMIT;", nullptr, nullptr, nullptr);
+
+    if (rc == SQLITE_DONE)
+    {
+        // The copy inherits WAL mode, a backup is easier to move around as a single file
+        sqlite3_exec(dest, "PRAGMA journal_mode = DELETE;", nullptr, nullptr, nullptr);
+        std::string check = firstText(dest, "PRAGMA quick_check;");
+        if (check != "ok")
+        {
+            error = "Backup failed its check: " + check;
+            rc = SQLITE_CORRUPT;
+        }
+    }
+    sqlite3_close(source);
+    sqlite3_close(dest);
+    return rc == SQLITE_DONE;
+}
+
+/**
+ * @brief Deletes the oldest finished backups beyond settings.keep.
+ */
+void Backup::prune()
+{
+    std::vector<std::filesystem::path> files = backupFiles(settings.directory);
+    std::error_code error;
+    for (size_t i = 0; i + settings.keep < files.size(); i++)
+        std::filesystem::remove(files[i], error);
+}
+
+/**
+ * @brief Checks a backup, copies it over the database and checks the result.
+ *
+ * @param from The backup file.
+ * @param to The database file.
+ * @param error Receives the reason on failure.
+ * @return bool true if the database was restored.
+ */
+bool Backup::restore(const std::string &from, const std::string &to, std::string &error)
+{
+    sqlite3 *source = nullptr;
+    if (sqlite3_open_v2(from.c_str(), &source, SQLITE_OPEN_READONLY, nullptr) != SQLITE_OK)
+    {
+        error = source ? sqlite3_errmsg(source) : "out of memory";
+        sqlite3_close(source);
+        return false;
+    }
+    std::string check = firstText(source, "PRAGMA integrity_check;");
+    if (check != "ok")
+    {
+        error = "Backup failed its check: " + check;
+        sqlite3_close(source);
+        return false;
+    }
+
+    sqlite3 *dest = nullptr;
+    if (sqlite3_open(to.c_str(), &dest) != SQLITE_OK)
+    {
+        error = sqlite3_errmsg(dest);
+        sqlite3_close(source);
+        sqlite3_close(dest);
+        return false;
+    }
+    sqlite3_backup *backup = sqlite3_backup_init(dest, "main", source, "main");
+    int rc = backup ? sqlite3_backup_step(backup, -1) : SQLITE_ERROR;
+    if (backup)
+        sqlite3_backup_finish(backup);
+    if (rc != SQLITE_DONE)
+        error = sqlite3_errmsg(dest);
+    else if ((check = firstText(dest, "PRAGMA integrity_check;")) != "ok")
+    {
+        error = "Restored database failed its check: " + check;
+        rc = SQLITE_CORRUPT;
+    }
+    sqlite3_close(source);
+    sqlite3_close(dest);
+    return rc == SQLITE_DONE;
+}
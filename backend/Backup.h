@@ -0,0 +1,139 @@
+/**
+ * @file Backup.h
+ * @brief Declaration of the Backup class.
+ *
+ * Online backups of taskmaster.db. Copying the file while the server runs can give a
+ * torn copy, so backups are taken with the SQLite backup API instead, a few pages at a
+ * time on a background thread, while the server keeps serving requests.
+ */
+
+#ifndef BACKUP_H
+#define BACKUP_H
+
+#include <sqlite3.h>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "DbExecutor.h"
+#include "crow.h"
+
+/**
+ * @class Backup
+ * @brief Takes consistent copies of the database without stopping the server.
+ *
+ * The copy is read on its own connection inside one read transaction, so in WAL mode it
+ * is a snapshot of the moment the backup started: commits made meanwhile neither block
+ * it nor make it start over. Pages are copied settings.pagesPerStep at a time with a
+ * pause after every step, a longer one while the pools have work queued. The copy is
+ * written to a ".part" file, checked with PRAGMA quick_check and only then renamed, so
+ * every "taskmaster-*.db" file in the backup directory is complete. The newest
+ * settings.keep backups are kept.
+ */
+class Backup
+{
+public:
+    /**
+     * @brief Tuning knobs.
+     */
+    struct Settings
+    {
+        std::string directory = "backups";                  /**< Where backups are written */
+        int pagesPerStep = 256;                              /**< Pages copied per sqlite3_backup_step */
+        std::chrono::milliseconds pause{5};                  /**< Pause after each step */
+        std::chrono::milliseconds busyPause{50};             /**< Pause after each step while the pools are busy */
+        std::chrono::hours interval{24};                     /**< Time between scheduled backups, 0 for none */
+        int keep = 7;                                        /**< Backups kept, older ones are deleted */
+    };
+
+    /**
+     * @brief Creates the backup thread, call start() to run it.
+     *
+     * @param path Path of the database file.
+     * @param writer Write pool, watched to back off while it is busy.
+     * @param readers Read pool, watched to back off while it is busy.
+     * @param settings Tuning knobs.
+     */
+    Backup(std::string path, DbExecutor &writer, DbExecutor &readers, Settings settings);
+
+    /**
+     * @brief Stops the thread, abandoning a backup in progress.
+     */
+    ~Backup();
+
+    Backup(const Backup &) = delete;
+    Backup &operator=(const Backup &) = delete;
+
+    /**
+     * @brief Starts the background thread and the schedule.
+     */
+    void start();
+
+    /**
+     * @brief Asks the thread to take a backup now.
+     *
+     * @return bool false if a backup is already running or requested.
+     */
+    bool request();
+
+    /**
+     * @brief Progress of the running backup, the last result and the backups on disk.
+     *
+     * @return crow::json::wvalue The status.
+     */
+    crow::json::wvalue status() const;
+
+    /**
+     * @brief Replaces a database with a backup, once the backup passed an integrity check.
+     *
+     * Must run before anything else opens the database.
+     *
+     * @param from The backup file.
+     * @param to The database file.
+     * @param error Receives the reason on failure.
+     * @return bool true if the database was restored and checked.
+     */
+    static bool restore(const std::string &from, const std::string &to, std::string &error);
+
+private:
+    /**
+     * @brief Takes one backup, on the background thread.
+     */
+    void run();
+
+    /**
+     * @brief Copies the database to a file, step by step.
+     *
+     * @param target The file to write.
+     * @param error Receives the reason on failure.
+     * @return bool true if the copy finished.
+     */
+    bool copy(const std::string &target, std::string &error);
+
+    /**
+     * @brief Deletes the oldest backups beyond settings.keep.
+     */
+    void prune();
+
+    std::string path;                                        /**< Database file */
+    DbExecutor &writer;                                      /**< Watched for load */
+    DbExecutor &readers;                                     /**< Watched for load */
+    Settings settings;                                       /**< Tuning knobs */
+
+    mutable std::mutex mutex;                                /**< Guards the fields below */
+    std::condition_variable wake;                            /**< Wakes the thread on request or shutdown */
+    bool stopping = false;                                   /**< Set by the destructor */
+    bool requested = false;                                  /**< A backup was asked for */
+    bool running = false;                                    /**< A backup is in progress */
+    int pagesDone = 0;                                       /**< Pages copied by the running backup */
+    int pagesTotal = 0;                                      /**< Pages of the running backup */
+    std::string started;                                     /**< Start of the running or last backup */
+    std::string lastFile;                                    /**< Last backup written */
+    std::string lastFinished;                                /**< End of the last successful backup */
+    double lastSeconds = 0;                                  /**< Duration of the last successful backup */
+    std::string lastError;                                   /**< Why the last backup failed, empty if it did not */
+    std::thread thread;                                      /**< The background loop */
+};
+
+#endif // BACKUP_H
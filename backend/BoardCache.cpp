@@ -0,0 +1,547 @@
+/**
+ * @file BoardCache.cpp
+ * @brief Implementation of the Board and BoardCache classes.
+ *
+ * Task statuses used by the frontend are mapped to TodoList categories: backlog to
+ * Backlog, inProgress to Doing, review to Review and completed to Done. Any other
+ * status is kept as stored and the task is filed under Backlog.
+ */
+
+#include "BoardCache.h"
+#include <algorithm>
+#include <cstdlib>
+#include <utility>
+
+namespace {
+
+/**
+ * @brief Columns read for a task, in the order readTask() expects them.
+ */
+constexpr const char *TASK_SELECT = "SELECT id, title, description, due_date, priority, status, project_id, "
+                                    "comment_count, last_activity, rank FROM tasks ";
+
+/**
+ * @brief Reads a text column, mapping NULL to an empty string.
+ */
+const char *text(sqlite3_stmt *stmt, int col)
+{
+    const char *value = (const char *)sqlite3_column_text(stmt, col);
+    return value ? value : "";
+}
+
+/**
+ * @brief TodoList category of a stored status.
+ *
+ * @param status The status column.
+ * @return const char* The category, Backlog for unknown statuses.
+ */
+const char *categoryOf(const std::string &status)
+{
+    if (status == "inProgress") return "Doing";
+    if (status == "review") return "Review";
+    if (status == "completed") return "Done";
+    return "Backlog";
+}
+
+/**
+ * @brief Heap memory of a string beyond the small string buffer.
+ */
+size_t heapBytes(const std::string &s)
+{
+    return s.capacity() > 15 ? s.capacity() + 1 : 0;
+}
+
+/**
+ * @brief Approximate memory charged for a task and its stats.
+ */
+size_t estimate(const Task &task, const Board::TaskMeta &meta)
+{
+    // Node and bucket of the meta map come on top of the Task in its vector
+    return sizeof(Task) + sizeof(Board::TaskMeta) + 48 +
+           heapBytes(task.getTaskName()) + heapBytes(task.getTaskDate()) +
+           heapBytes(task.getTaskStatus()) + heapBytes(task.getTaskDesc()) +
+           heapBytes(task.getTaskPriority()) + heapBytes(meta.status) + heapBytes(meta.lastActivity) +
+           heapBytes(meta.rank);
+}
+
+/**
+ * @brief Converts a row selected with TASK_SELECT to a Task and its stats.
+ */
+std::pair<Task, Board::TaskMeta> readTask(sqlite3_stmt *stmt)
+{
+    Board::TaskMeta meta;
+    meta.status = text(stmt, 5);
+    meta.commentCount = sqlite3_column_int(stmt, 7);
+    meta.lastActivity = text(stmt, 8);
+    meta.rank = text(stmt, 9);
+    Task task(sqlite3_column_int(stmt, 0), text(stmt, 1), text(stmt, 3), categoryOf(meta.status),
+              std::to_string(sqlite3_column_int(stmt, 4)), text(stmt, 2));
+    meta.bytes = estimate(task, meta);
+    return {std::move(task), std::move(meta)};
+}
+
+} // namespace
+
+/**
+ * @brief Creates a board for a project.
+ */
+Board::Board(int projectID, Project project)
+    : projectID(projectID), project(std::move(project)), bytes(sizeof(Board)) {}
+
+/**
+ * @brief Converts the tasks matching the filters to JSON.
+ *
+ * @param status Only tasks with this status, or all if empty.
+ * @param priority Only tasks with this priority, or all if empty.
+ * @return crow::json::wvalue::list The tasks.
+ */
+crow::json::wvalue::list Board::listTasks(const std::string &status, const std::string &priority) const
+{
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    crow::json::wvalue::list tasks;
+    for (const Match &match : matching(status, priority))
+        tasks.push_back(taskJSON(*match.second));
+    return tasks;
+}
+
+/**
+ * @brief Writes the tasks matching the filters as an array of maps with the JSON fields.
+ *
+ * @param out The writer.
+ * @param status Only tasks with this status, or all if empty.
+ * @param priority Only tasks with this priority, or all if empty.
+ */
+void Board::writeTasks(MsgPackWriter &out, const std::string &status, const std::string &priority) const
+{
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    std::vector<Match> matches = matching(status, priority);
+    out.arrayHeader(static_cast<uint32_t>(matches.size()));
+    for (const Match &match : matches)
+    {
+        const TaskMeta &stats = *match.first;
+        const Task &task = *match.second;
+        out.mapHeader(10);
+        out.string("id");
+        out.integer(task.getTaskID());
+        out.string("title");
+        out.string(task.getTaskName());
+        out.string("description");
+        out.string(task.getTaskDesc());
+        out.string("due_date");
+        out.string(task.getTaskDate());
+        out.string("priority");
+        out.integer(std::atoi(task.getTaskPriority().c_str()));
+        out.string("status");
+        out.string(stats.status);
+        out.string("project_id");
+        out.integer(projectID);
+        out.string("comment_count");
+        out.integer(stats.commentCount);
+        out.string("last_activity");
+        if (stats.lastActivity.empty())
+            out.nil();
+        else
+            out.string(stats.lastActivity);
+        out.string("rank");
+        if (stats.rank.empty())
+            out.nil();
+        else
+            out.string(stats.rank);
+    }
+}
+
+/**
+ * @brief Collects the tasks matching the filters.
+ *
+ * Sorted like the SQL route with idx_tasks_column: by status, then rank, then ID.
+ *
+ * @param status Only tasks with this status, or all if empty.
+ * @param priority Only tasks with this priority, or all if empty.
+ * @return std::vector<Board::Match> The tasks and their stats.
+ */
+std::vector<Board::Match> Board::matching(const std::string &status, const std::string &priority) const
+{
+    TaskQuery query;
+    if (!status.empty())
+        query.categories.push_back(categoryOf(status));
+    if (!priority.empty())
+        query.priorities.push_back(std::to_string(std::atoi(priority.c_str())));
+
+    std::vector<Match> matches;
+    for (const Task &task : project.getTodoList().query(query))
+    {
+        // Backlog also holds tasks with statuses that are not categories
+        const TaskMeta &stats = meta.at(task.getTaskID());
+        if (!status.empty() && stats.status != status)
+            continue;
+        matches.emplace_back(&stats, &task);
+    }
+    std::sort(matches.begin(), matches.end(), [](const auto &a, const auto &b)
+              {
+        if (a.first->status != b.first->status) return a.first->status < b.first->status;
+        if (a.first->rank != b.first->rank) return a.first->rank < b.first->rank;
+        return a.second->getTaskID() < b.second->getTaskID(); });
+    return matches;
+}
+
+/**
+ * @brief Adds or replaces a task and its stats.
+ *
+ * @param task The task.
+ * @param taskMeta Its stats.
+ * @return size_t The new memory estimate.
+ */
+size_t Board::store(Task task, TaskMeta taskMeta)
+{
+    auto it = meta.find(task.getTaskID());
+    if (it != meta.end())
+        bytes -= it->second.bytes;
+    bytes += taskMeta.bytes;
+    meta[task.getTaskID()] = std::move(taskMeta);
+    project.getTodoList().storeTask(std::move(task));
+    return bytes;
+}
+
+/**
+ * @brief Removes a task if present.
+ *
+ * @param taskID The task ID.
+ * @return size_t The new memory estimate.
+ */
+size_t Board::remove(int taskID)
+{
+    auto it = meta.find(taskID);
+    if (it == meta.end())
+        return bytes;
+    bytes -= it->second.bytes;
+    meta.erase(it);
+    project.getTodoList().deleteTask(taskID);
+    return bytes;
+}
+
+/**
+ * @brief Converts a task to the same JSON as the SQL backed task routes.
+ *
+ * @param task The task.
+ * @return crow::json::wvalue The task as JSON.
+ */
+crow::json::wvalue Board::taskJSON(const Task &task) const
+{
+    const TaskMeta &stats = meta.at(task.getTaskID());
+    crow::json::wvalue json;
+    json["id"] = task.getTaskID();
+    json["title"] = task.getTaskName();
+    json["description"] = task.getTaskDesc();
+    json["due_date"] = task.getTaskDate();
+    json["priority"] = std::atoi(task.getTaskPriority().c_str());
+    json["status"] = stats.status;
+    json["project_id"] = projectID;
+    json["comment_count"] = stats.commentCount;
+    if (stats.lastActivity.empty())
+        json["last_activity"] = nullptr;
+    else
+        json["last_activity"] = stats.lastActivity;
+    if (stats.rank.empty())
+        json["rank"] = nullptr;
+    else
+        json["rank"] = stats.rank;
+    return json;
+}
+
+/**
+ * @brief Creates an empty cache.
+ *
+ * @param budgetBytes Memory budget of all resident boards together.
+ */
+BoardCache::BoardCache(size_t budgetBytes) : budget(budgetBytes) {}
+
+/**
+ * @brief Returns a resident board and moves it to the front of the LRU list.
+ *
+ * @param projectID The project ID.
+ * @return std::shared_ptr<Board> The board, or nullptr if not resident.
+ */
+std::shared_ptr<Board> BoardCache::find(int projectID)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = boards.find(projectID);
+    if (it == boards.end())
+        return nullptr;
+    hits++;
+    lru.splice(lru.begin(), lru, it->second.lruPosition);
+    return it->second.board;
+}
+
+/**
+ * @brief Returns a board, reading it from the database on a miss.
+ *
+ * The read runs without the cache lock. A write committed to the project meanwhile
+ * bumps its epoch, and the board read is then returned but not cached, as it may
+ * predate the write.
+ *
+ * @param db Connection used to read the board.
+ * @param projectID The project ID.
+ * @return std::shared_ptr<Board> The board, or nullptr if the project does not exist.
+ */
+std::shared_ptr<Board> BoardCache::load(sqlite3 *db, int projectID)
+{
+    if (auto board = find(projectID))
+        return board;
+
+    uint64_t epoch, startGeneration;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        misses++;
+        epoch = epochs[projectID];
+        startGeneration = generation;
+    }
+
+    std::shared_ptr<Board> board = read(db, projectID);
+    if (!board)
+        return nullptr;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (epochs[projectID] != epoch || generation != startGeneration)
+        return board;
+
+    auto it = boards.find(projectID);
+    if (it != boards.end())
+    {
+        // Another reader loaded it first
+        lru.splice(lru.begin(), lru, it->second.lruPosition);
+        return it->second.board;
+    }
+
+    lru.push_front(projectID);
+    boards[projectID] = {board, lru.begin(), board->bytes};
+    used += board->bytes;
+    for (const auto &entry : board->meta)
+        taskProjects[entry.first] = projectID;
+    evict();
+    return board;
+}
+
+/**
+ * @brief Re-reads a task and applies the committed version to the resident boards.
+ *
+ * @param db Connection that committed the change.
+ * @param taskID The task ID.
+ * @param previousProject Project of the task before the change, 0 if unknown or new.
+ */
+void BoardCache::refreshTask(sqlite3 *db, int taskID, int previousProject)
+{
+    sqlite3_stmt *stmt;
+    std::string sql = std::string(TASK_SELECT) + "WHERE id = ?;";
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK)
+        return;
+    sqlite3_bind_int(stmt, 1, taskID);
+
+    int currentProject = 0;
+    std::pair<Task, Board::TaskMeta> row{Task(taskID, "", "", "", ""), Board::TaskMeta()};
+    if (sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        currentProject = sqlite3_column_int(stmt, 6);
+        row = readTask(stmt);
+    }
+    sqlite3_finalize(stmt);
+
+    std::shared_ptr<Board> oldBoard, newBoard;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto resident = taskProjects.find(taskID);
+        int residentProject = resident == taskProjects.end() ? 0 : resident->second;
+
+        for (int project : {previousProject, residentProject, currentProject})
+            if (project)
+                epochs[project]++;
+
+        auto oldEntry = boards.find(residentProject);
+        if (residentProject != currentProject && oldEntry != boards.end())
+            oldBoard = oldEntry->second.board;
+        auto newEntry = boards.find(currentProject);
+        if (currentProject && newEntry != boards.end())
+            newBoard = newEntry->second.board;
+
+        if (newBoard)
+            taskProjects[taskID] = currentProject;
+        else
+            taskProjects.erase(taskID);
+    }
+
+    // Apply outside the cache lock so lookups of other boards are not held up
+    auto charge = [this](const std::shared_ptr<Board> &board, size_t bytes)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = boards.find(board->projectID);
+        if (it == boards.end() || it->second.board != board)
+            return;
+        used = used - it->second.bytes + bytes;
+        it->second.bytes = bytes;
+        evict();
+    };
+
+    if (oldBoard)
+    {
+        size_t bytes;
+        {
+            std::unique_lock<std::shared_mutex> lock(oldBoard->mutex);
+            bytes = oldBoard->remove(taskID);
+        }
+        charge(oldBoard, bytes);
+    }
+    if (newBoard)
+    {
+        size_t bytes;
+        {
+            std::unique_lock<std::shared_mutex> lock(newBoard->mutex);
+            bytes = newBoard->store(std::move(row.first), std::move(row.second));
+        }
+        charge(newBoard, bytes);
+    }
+}
+
+/**
+ * @brief Reads the project of a task.
+ *
+ * @param db The connection.
+ * @param taskID The task ID.
+ * @return int The project ID, 0 if the task does not exist.
+ */
+int BoardCache::projectOf(sqlite3 *db, int taskID)
+{
+    sqlite3_stmt *stmt;
+    int project = 0;
+    if (sqlite3_prepare_v2(db, "SELECT project_id FROM tasks WHERE id = ?;", -1, &stmt, nullptr) == SQLITE_OK)
+    {
+        sqlite3_bind_int(stmt, 1, taskID);
+        if (sqlite3_step(stmt) == SQLITE_ROW)
+            project = sqlite3_column_int(stmt, 0);
+        sqlite3_finalize(stmt);
+    }
+    return project;
+}
+
+/**
+ * @brief Drops a project's board.
+ *
+ * @param projectID The project ID.
+ */
+void BoardCache::forget(int projectID)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    epochs[projectID]++;
+    drop(projectID);
+}
+
+/**
+ * @brief Drops every board.
+ */
+void BoardCache::clear()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    generation++;
+    boards.clear();
+    lru.clear();
+    taskProjects.clear();
+    used = 0;
+}
+
+/**
+ * @brief Reports resident boards, memory use and hit rate.
+ *
+ * @return crow::json::wvalue The statistics.
+ */
+crow::json::wvalue BoardCache::stats() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    crow::json::wvalue result;
+    result["boards"] = boards.size();
+    result["tasks"] = taskProjects.size();
+    result["bytes"] = used;
+    result["budget_bytes"] = budget;
+    result["hits"] = hits;
+    result["misses"] = misses;
+    result["evictions"] = evictions;
+    return result;
+}
+
+/**
+ * @brief Reads a project and all its tasks.
+ *
+ * @param db The connection.
+ * @param projectID The project ID.
+ * @return std::shared_ptr<Board> The board, or nullptr if the project does not exist.
+ */
+std::shared_ptr<Board> BoardCache::read(sqlite3 *db, int projectID)
+{
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(db, "SELECT deadline, completion_status FROM projects WHERE id = ?;", -1, &stmt, nullptr) != SQLITE_OK)
+        return nullptr;
+    sqlite3_bind_int(stmt, 1, projectID);
+    if (sqlite3_step(stmt) != SQLITE_ROW)
+    {
+        sqlite3_finalize(stmt);
+        return nullptr;
+    }
+    std::string deadline = text(stmt, 0);
+    bool completed = sqlite3_column_int(stmt, 1) != 0;
+    sqlite3_finalize(stmt);
+
+    std::string sql = std::string(TASK_SELECT) + "WHERE project_id = ? ORDER BY id;";
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK)
+        return nullptr;
+    sqlite3_bind_int(stmt, 1, projectID);
+
+    TodoList list;
+    std::unordered_map<int, Board::TaskMeta> meta;
+    size_t bytes = 0;
+    while (sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        auto row = readTask(stmt);
+        bytes += row.second.bytes;
+        meta.emplace(row.first.getTaskID(), std::move(row.second));
+        list.restoreTask(std::move(row.first));
+    }
+    sqlite3_finalize(stmt);
+
+    auto board = std::make_shared<Board>(projectID, Project(std::move(list), std::move(deadline), completed));
+    board->meta = std::move(meta);
+    board->bytes += bytes;
+    return board;
+}
+
+/**
+ * @brief Evicts least recently used boards until the budget is met.
+ */
+void BoardCache::evict()
+{
+    while (used > budget && !lru.empty())
+    {
+        drop(lru.back());
+        evictions++;
+    }
+}
+
+/**
+ * @brief Removes a board and its task index entries.
+ *
+ * @param projectID The project ID.
+ */
+void BoardCache::drop(int projectID)
+{
+    auto it = boards.find(projectID);
+    if (it == boards.end())
+        return;
+    {
+        std::shared_lock<std::shared_mutex> lock(it->second.board->mutex);
+        for (const auto &entry : it->second.board->meta)
+        {
+            auto owner = taskProjects.find(entry.first);
+            if (owner != taskProjects.end() && owner->second == projectID)
+                taskProjects.erase(owner);
+        }
+    }
+    used -= it->second.bytes;
+    lru.erase(it->second.lruPosition);
+    boards.erase(it);
+}
@@ -0,0 +1,229 @@
+/**
+ * @file BoardCache.h
+ * @brief Declaration of the Board and BoardCache classes.
+ *
+ * When the server runs with --board-cache-mb, each project's board lives in memory as a
+ * Project with its TodoList. Boards are loaded from SQLite on first access and evicted
+ * least-recently-used first once the memory budget is exceeded. SQLite stays the source
+ * of truth: every mutation is committed by the write pool first and then applied to the
+ * resident board, in commit order.
+ */
+
+#ifndef BOARDCACHE_H
+#define BOARDCACHE_H
+
+#include <sqlite3.h>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "MsgPack.h"
+#include "Project.h"
+#include "crow.h"
+
+/**
+ * @class Board
+ * @brief A resident project board: the Project, its tasks and per-task comment stats.
+ */
+class Board
+{
+public:
+    /**
+     * @brief Comment stats of a task, which Task itself does not track.
+     */
+    struct TaskMeta
+    {
+        std::string status;                    /**< Status as stored, the Task holds its category */
+        int commentCount = 0;                  /**< Active comments on the task */
+        std::string lastActivity;              /**< Last comment activity, empty if none */
+        std::string rank;                      /**< Position in its column, empty if unranked */
+        size_t bytes = 0;                      /**< Memory charged for the task */
+    };
+
+    /**
+     * @brief Creates a board for a project.
+     *
+     * @param projectID The project ID.
+     * @param project The project, with its TodoList filled.
+     */
+    Board(int projectID, Project project);
+
+    /**
+     * @brief Converts the tasks to the JSON returned by GET /tasks, sorted by status then rank.
+     *
+     * @param status Only tasks with this status, or all if empty.
+     * @param priority Only tasks with this priority, or all if empty.
+     * @return crow::json::wvalue::list The tasks.
+     */
+    crow::json::wvalue::list listTasks(const std::string &status, const std::string &priority) const;
+
+    /**
+     * @brief Writes the same tasks as listTasks() as a MessagePack array.
+     *
+     * @param out The writer.
+     * @param status Only tasks with this status, or all if empty.
+     * @param priority Only tasks with this priority, or all if empty.
+     */
+    void writeTasks(MsgPackWriter &out, const std::string &status, const std::string &priority) const;
+
+private:
+    friend class BoardCache;
+
+    /**
+     * @brief A task and its stats.
+     */
+    using Match = std::pair<const TaskMeta *, const Task *>;
+
+    /**
+     * @brief The tasks matching the filters, in list order. Caller holds mutex.
+     */
+    std::vector<Match> matching(const std::string &status, const std::string &priority) const;
+
+    /**
+     * @brief Adds or replaces a task. Caller holds mutex exclusively.
+     *
+     * @param task The task, its status set to its TodoList category.
+     * @param taskMeta Stats and stored status of the task.
+     * @return size_t The new memory estimate of the board.
+     */
+    size_t store(Task task, TaskMeta taskMeta);
+
+    /**
+     * @brief Removes a task if present. Caller holds mutex exclusively.
+     *
+     * @param taskID The task ID.
+     * @return size_t The new memory estimate of the board.
+     */
+    size_t remove(int taskID);
+
+    /**
+     * @brief Converts a task to the JSON returned by the task routes.
+     */
+    crow::json::wvalue taskJSON(const Task &task) const;
+
+    int projectID;                                       /**< The project ID */
+    Project project;                                     /**< Project and its TodoList */
+    std::unordered_map<int, TaskMeta> meta;              /**< Stats and stored status by task ID */
+    size_t bytes;                                        /**< Approximate memory used by the board */
+    mutable std::shared_mutex mutex;                     /**< Readers share, the writer is exclusive */
+};
+
+/**
+ * @class BoardCache
+ * @brief LRU cache of resident boards under a memory budget.
+ *
+ * Readers call find() (resident only) or load() (loads on a miss). The write pool calls
+ * refreshTask() after committing a task change, and forget()/clear() after changes too
+ * broad to apply row by row.
+ */
+class BoardCache
+{
+public:
+    /**
+     * @brief Creates an empty cache.
+     *
+     * @param budgetBytes Memory budget of all resident boards together.
+     */
+    explicit BoardCache(size_t budgetBytes);
+
+    /**
+     * @brief Returns a resident board and marks it recently used.
+     *
+     * @param projectID The project ID.
+     * @return The board, or nullptr if it is not resident.
+     */
+    std::shared_ptr<Board> find(int projectID);
+
+    /**
+     * @brief Returns a board, loading it from the database on a miss.
+     *
+     * @param db Connection used to load the board.
+     * @param projectID The project ID.
+     * @return The board, or nullptr if the project does not exist.
+     */
+    std::shared_ptr<Board> load(sqlite3 *db, int projectID);
+
+    /**
+     * @brief Re-reads a task after a committed change and applies it to resident boards.
+     *
+     * Handles inserts, updates, deletes and moves between projects. The project a task
+     * was in before the change must be passed for updates and deletes, so that a board
+     * being loaded concurrently is not cached with the old version of the task.
+     *
+     * @param db Connection that committed the change.
+     * @param taskID The task ID.
+     * @param previousProject Project of the task before the change, 0 if unknown or new.
+     */
+    void refreshTask(sqlite3 *db, int taskID, int previousProject = 0);
+
+    /**
+     * @brief Reads the project of a task, called by writers before they change it.
+     *
+     * @param db The connection.
+     * @param taskID The task ID.
+     * @return int The project ID, 0 if the task does not exist.
+     */
+    static int projectOf(sqlite3 *db, int taskID);
+
+    /**
+     * @brief Drops a project's board, it is reloaded on next access.
+     *
+     * @param projectID The project ID.
+     */
+    void forget(int projectID);
+
+    /**
+     * @brief Drops every board.
+     */
+    void clear();
+
+    /**
+     * @brief Reports resident boards, memory use and hit rate.
+     */
+    crow::json::wvalue stats() const;
+
+private:
+    /**
+     * @brief Reads a project and its tasks from the database.
+     */
+    static std::shared_ptr<Board> read(sqlite3 *db, int projectID);
+
+    /**
+     * @brief Evicts least recently used boards until the budget is met. Caller holds mutex.
+     */
+    void evict();
+
+    /**
+     * @brief Removes a board from the cache. Caller holds mutex.
+     */
+    void drop(int projectID);
+
+    /**
+     * @brief A resident board and its place in the LRU list.
+     */
+    struct Entry
+    {
+        std::shared_ptr<Board> board;                    /**< The board */
+        std::list<int>::iterator lruPosition;            /**< Position in lru */
+        size_t bytes;                                    /**< Memory charged to the budget */
+    };
+
+    size_t budget;                                       /**< Memory budget in bytes */
+    size_t used = 0;                                     /**< Memory charged by resident boards */
+    mutable std::mutex mutex;                            /**< Guards everything below */
+    std::unordered_map<int, Entry> boards;               /**< Resident boards by project ID */
+    std::list<int> lru;                                  /**< Project IDs, most recently used first */
+    std::unordered_map<int, int> taskProjects;           /**< Project of each resident task */
+    std::unordered_map<int, uint64_t> epochs;            /**< Change counter per project, guards loads */
+    uint64_t generation = 0;                             /**< Bumped by clear(), guards loads */
+    uint64_t hits = 0;                                   /**< Lookups served from memory */
+    uint64_t misses = 0;                                 /**< Lookups that loaded from the database */
+    uint64_t evictions = 0;                              /**< Boards evicted for the budget */
+};
+
+#endif // BOARDCACHE_H
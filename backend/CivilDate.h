@@ -0,0 +1,61 @@
+/**
+ * @file CivilDate.h
+ * @brief Proleptic Gregorian calendar arithmetic, shared by the server and the tools.
+ *
+ * Dates are plain year, month and day numbers, so no time zone or locale is involved.
+ */
+
+#ifndef CIVILDATE_H
+#define CIVILDATE_H
+
+#include <cstdint>
+
+/**
+ * @brief Whether a year has a 29 February.
+ */
+constexpr bool isLeapYear(int year)
+{
+    return year % 4 == 0 && (year % 100 != 0 || year % 400 == 0);
+}
+
+/**
+ * @brief Number of days in a month.
+ *
+ * @param year The year.
+ * @param month The month, 1 to 12.
+ * @return int 28 to 31.
+ */
+constexpr int daysInMonth(int year, int month)
+{
+    return month == 2 ? (isLeapYear(year) ? 29 : 28) : (month == 4 || month == 6 || month == 9 || month == 11) ? 30 : 31;
+}
+
+/**
+ * @brief Whether a year, month and day name a real date.
+ */
+constexpr bool isValidDate(int year, int month, int day)
+{
+    return month >= 1 && month <= 12 && day >= 1 && day <= daysInMonth(year, month);
+}
+
+/**
+ * @brief Days since 1970-01-01 of a valid date.
+ *
+ * The days-from-civil algorithm, see http://howardhinnant.github.io/date_algorithms.html
+ *
+ * @param year The year.
+ * @param month The month, 1 to 12.
+ * @param day The day of the month.
+ * @return int64_t The day number, negative before 1970.
+ */
+constexpr int64_t daysFromCivil(int year, int month, int day)
+{
+    year -= month <= 2;
+    int64_t era = (year >= 0 ? year : year - 399) / 400;
+    int64_t yearOfEra = year - era * 400;
+    int64_t dayOfYear = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    int64_t dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + dayOfEra - 719468;
+}
+
+#endif // CIVILDATE_H
@@ -21,10 +21,10 @@
  * @param commentStatus Current status of the comment (e.g., active, deleted).
  * @param commentUser ID of the user who posted the comment.
  */
-Comment::Comment(int commentID, const std::string& commentBody, const std::string& commentDate,
-                 const std::string& commentStatus, int commentUser)
-    : commentID(commentID), commentBody(commentBody), commentDate(commentDate),
-      commentStatus(commentStatus), commentUser(commentUser) {}
+Comment::Comment(int commentID, std::string commentBody, std::string commentDate,
+                 std::string commentStatus, int commentUser)
+    : commentID(commentID), commentBody(std::move(commentBody)), commentDate(std::move(commentDate)),
+      commentStatus(std::move(commentStatus)), commentUser(commentUser) {}
 
 // ========================
 // Getters
@@ -40,23 +40,23 @@ int Comment::getCommentID() const { return commentID; }
 /**
  * @brief Get the body text of the comment.
  *
- * @return std::string The content of the comment.
+ * @return const std::string& The content of the comment.
  */
-std::string Comment::getCommentBody() const { return commentBody; }
+const std::string& Comment::getCommentBody() const { return commentBody; }
 
 /**
  * @brief Get the date the comment was posted.
  *
- * @return std::string The date of the comment.
+ * @return const std::string& The date of the comment.
  */
-std::string Comment::getCommentDate() const { return commentDate; }
+const std::string& Comment::getCommentDate() const { return commentDate; }
 
 /**
  * @brief Get the status of the comment.
  *
- * @return std::string The status (e.g., "active", "deleted").
+ * @return const std::string& The status (e.g., "active", "deleted").
  */
-std::string Comment::getCommentStatus() const { return commentStatus; }
+const std::string& Comment::getCommentStatus() const { return commentStatus; }
 
 /**
  * @brief Get the user ID associated with the comment.
@@ -74,8 +74,8 @@ int Comment::getCommentUser() const { return commentUser; }
  *
  * @param newBody The new body text for the comment.
  */
-void Comment::editCommentBody(const std::string& newBody) {
-    commentBody = newBody;
+void Comment::editCommentBody(std::string newBody) {
+    commentBody = std::move(newBody);
 }
 
 /**
@@ -83,8 +83,8 @@ void Comment::editCommentBody(const std::string& newBody) {
  *
  * @param newDate The new date for the comment.
  */
-void Comment::editCommentDate(const std::string& newDate) {
-    commentDate = newDate;
+void Comment::editCommentDate(std::string newDate) {
+    commentDate = std::move(newDate);
 }
 
 /**
@@ -92,8 +92,8 @@ void Comment::editCommentDate(const std::string& newDate) {
  *
  * @param newStatus The new status (e.g., "active", "deleted").
  */
-void Comment::editCommentStatus(const std::string& newStatus) {
-    commentStatus = newStatus;
+void Comment::editCommentStatus(std::string newStatus) {
+    commentStatus = std::move(newStatus);
 }
 
 // ========================
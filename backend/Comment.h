@@ -2,7 +2,8 @@
  * @file Comment.h
  * @brief Declaration of the Comment class.
  *
- * This file defines the Comment class, but we didn't use it as long as I know
+ * This file defines the Comment class. The comment routes in server.cpp use it to
+ * apply the soft delete rule.
  *
  * @author Robin
  */
@@ -14,7 +15,9 @@
 
 /**
  * @class Comment
- * did not get used so fine to skip. I did add commnents just in case, but it is not used at all
+ * @brief Represents a comment posted on a task.
+ *
+ * Comments are never removed right away, deleteComment() only marks them as deleted.
  */
 class Comment {
 private:
@@ -36,8 +39,8 @@ public:
      * @param commentStatus Status of the comment.
      * @param commentUser ID of the user who made the comment.
      */
-    Comment(int commentID, const std::string& commentBody, const std::string& commentDate,
-            const std::string& commentStatus, int commentUser);
+    Comment(int commentID, std::string commentBody, std::string commentDate,
+            std::string commentStatus, int commentUser);
 
     /**
      * @brief Get the ID of the comment.
@@ -47,21 +50,21 @@ public:
 
     /**
      * @brief Get the content/body of the comment.
-     * @return The comment body as a string.
+     * @return Reference to the comment body.
      */
-    std::string getCommentBody() const;
+    const std::string& getCommentBody() const;
 
     /**
      * @brief Get the date of the comment.
-     * @return The comment date as a string.
+     * @return Reference to the comment date.
      */
-    std::string getCommentDate() const;
+    const std::string& getCommentDate() const;
 
     /**
      * @brief Get the current status of the comment.
-     * @return The comment status as a string.
+     * @return Reference to the comment status.
      */
-    std::string getCommentStatus() const;
+    const std::string& getCommentStatus() const;
 
     /**
      * @brief Get the user ID of the comment's author.
@@ -73,19 +76,19 @@ public:
      * @brief Edit the comment body.
      * @param newBody The new text to replace the current body.
      */
-    void editCommentBody(const std::string& newBody);
+    void editCommentBody(std::string newBody);
 
     /**
      * @brief Edit the comment date.
      * @param newDate The new date string.
      */
-    void editCommentDate(const std::string& newDate);
+    void editCommentDate(std::string newDate);
 
     /**
      * @brief Edit the comment status.
      * @param newStatus The new status string (e.g., "active", "deleted").
      */
-    void editCommentStatus(const std::string& newStatus);
+    void editCommentStatus(std::string newStatus);
 
     /**
      * @brief Perform a soft delete on the comment.
@@ -0,0 +1,168 @@
+/**
+ * @file ConcurrentTodoList.cpp
+ * @brief Implementation of the ConcurrentTodoList class.
+ */
+
+#include "ConcurrentTodoList.h"
+
+namespace {
+
+/**
+ * @brief Source of the IDs that tell lists apart in the per-thread caches.
+ *
+ * Addresses are not used because a new list can reuse the address of a destroyed one.
+ */
+std::atomic<uint64_t> nextListID{1};
+
+/**
+ * @brief Source of the per-thread read counter stripes.
+ */
+std::atomic<size_t> nextStripe{0};
+
+/**
+ * @brief Last snapshot read by this thread.
+ */
+struct CachedSnapshot
+{
+    uint64_t list = 0;                           /**< ID of the list it came from */
+    uint64_t version = 0;                        /**< Version of the list when it was read */
+    std::weak_ptr<const TodoList> snapshot;      /**< The snapshot, not kept alive by the cache */
+};
+
+thread_local CachedSnapshot cached;
+thread_local size_t stripe = nextStripe.fetch_add(1, std::memory_order_relaxed);
+
+} // namespace
+
+/**
+ * @brief Creates an empty list.
+ */
+ConcurrentTodoList::ConcurrentTodoList() : ConcurrentTodoList(TodoList()) {}
+
+/**
+ * @brief Creates a list holding the given tasks.
+ *
+ * @param initial The tasks, moved in.
+ */
+ConcurrentTodoList::ConcurrentTodoList(TodoList initial)
+    : current(std::make_shared<const TodoList>(std::move(initial))),
+      id(nextListID.fetch_add(1, std::memory_order_relaxed)) {}
+
+/**
+ * @brief Returns the current snapshot, from this thread's cache when no write happened since.
+ *
+ * The version is read before the pointer. A write published in between leaves the
+ * cache with a newer snapshot than its version says, which only costs one extra load.
+ * A hit only takes a reference on the snapshot, without the lock of the atomic load.
+ *
+ * @return Snapshot The list as of the last published write.
+ */
+ConcurrentTodoList::Snapshot ConcurrentTodoList::snapshot() const
+{
+    ReadCounter &counter = readCounters[stripe % READ_STRIPES];
+    counter.reads.fetch_add(1, std::memory_order_relaxed);
+
+    uint64_t now = version.load(std::memory_order_acquire);
+    if (cached.list == id && cached.version == now)
+    {
+        if (Snapshot hit = cached.snapshot.lock())
+            return hit;
+    }
+
+    counter.loads.fetch_add(1, std::memory_order_relaxed);
+    Snapshot loaded = std::atomic_load(&current);
+    cached.snapshot = loaded;
+    cached.list = id;
+    cached.version = now;
+    return loaded;
+}
+
+/**
+ * @brief Get all tasks from a category of the current snapshot.
+ *
+ * @param category The category name ("Backlog", "Doing", "Review", "Done").
+ * @return A vector of tasks in the category.
+ */
+std::vector<Task> ConcurrentTodoList::filterTask(const std::string &category) const
+{
+    return snapshot()->filterTask(category);
+}
+
+/**
+ * @brief Get all tasks of the current snapshot that match a priority.
+ *
+ * @param priority The priority to filter by.
+ * @return A vector of tasks with the priority.
+ */
+std::vector<Task> ConcurrentTodoList::filterByPriority(const std::string &priority) const
+{
+    return snapshot()->filterByPriority(priority);
+}
+
+/**
+ * @brief Add a task to the backlog.
+ *
+ * @param task The task, moved into the list.
+ */
+void ConcurrentTodoList::createTask(Task task)
+{
+    modify([&](TodoList &list)
+           {
+        list.createTask(std::move(task));
+        return true; });
+}
+
+/**
+ * @brief Move a task to another category.
+ *
+ * @param taskID The ID of the task.
+ * @param newStatus The new category.
+ * @return true if the task was moved.
+ */
+bool ConcurrentTodoList::updateStatus(int taskID, const std::string &newStatus)
+{
+    return modify([&](TodoList &list)
+                  { return list.updateStatus(taskID, newStatus); });
+}
+
+/**
+ * @brief Delete a task by ID.
+ *
+ * @param taskID The ID of the task.
+ * @return true if the task was deleted.
+ */
+bool ConcurrentTodoList::deleteTask(int taskID)
+{
+    return modify([&](TodoList &list)
+                  { return list.deleteTask(taskID); });
+}
+
+/**
+ * @brief Sums the contention counters.
+ *
+ * @return Stats The counters.
+ */
+ConcurrentTodoList::Stats ConcurrentTodoList::stats() const
+{
+    Stats result;
+    for (const ReadCounter &counter : readCounters)
+    {
+        result.reads += counter.reads.load(std::memory_order_relaxed);
+        result.snapshotLoads += counter.loads.load(std::memory_order_relaxed);
+    }
+    result.writes = writes.load(std::memory_order_relaxed);
+    result.contendedWrites = contendedWrites.load(std::memory_order_relaxed);
+    return result;
+}
+
+/**
+ * @brief Publishes a new version, then bumps the version so readers drop their cache.
+ *
+ * @param next The new list.
+ */
+void ConcurrentTodoList::publish(std::shared_ptr<TodoList> next)
+{
+    std::atomic_store(&current, Snapshot(std::move(next)));
+    version.fetch_add(1, std::memory_order_release);
+    writes.fetch_add(1, std::memory_order_relaxed);
+}
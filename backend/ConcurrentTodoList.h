@@ -0,0 +1,178 @@
+/**
+ * @file ConcurrentTodoList.h
+ * @brief Declaration of the ConcurrentTodoList class.
+ *
+ * A TodoList that can be shared between Crow's worker threads. Readers work on an
+ * immutable snapshot and never wait for a lock, writers copy the list, change the copy
+ * and publish it.
+ */
+
+#ifndef CONCURRENTTODOLIST_H
+#define CONCURRENTTODOLIST_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "TodoList.h"
+
+/**
+ * @class ConcurrentTodoList
+ * @brief Thread-safe TodoList with copy-on-write snapshots.
+ *
+ * The current list is held in a shared_ptr to a const TodoList. A read works on that
+ * snapshot, which stays valid and unchanged for as long as it is held. Writers are
+ * serialized by a mutex, copy the current list, apply their change and publish the
+ * copy, so a write costs a copy of the board but never blocks a reader.
+ *
+ * Every thread remembers the last snapshot it read as a weak reference, together with
+ * the list's version. While no write happens, snapshot() copies the reference from
+ * there instead of loading the shared pointer, whose atomic load takes a lock. The
+ * weak reference does not keep an old version alive once the list has moved on.
+ */
+class ConcurrentTodoList
+{
+public:
+    /**
+     * @brief A read-only view of the list at one point in time.
+     */
+    using Snapshot = std::shared_ptr<const TodoList>;
+
+    /**
+     * @brief Contention counters, see stats().
+     */
+    struct Stats
+    {
+        uint64_t reads = 0;             /**< Snapshots handed to readers */
+        uint64_t snapshotLoads = 0;     /**< Reads that missed the thread's cached snapshot */
+        uint64_t writes = 0;            /**< Published changes */
+        uint64_t contendedWrites = 0;   /**< Writes that had to wait for another writer */
+    };
+
+    /**
+     * @brief Creates an empty list.
+     */
+    ConcurrentTodoList();
+
+    /**
+     * @brief Creates a list holding the given tasks.
+     *
+     * @param initial The tasks, moved in.
+     */
+    explicit ConcurrentTodoList(TodoList initial);
+
+    ConcurrentTodoList(const ConcurrentTodoList &) = delete;
+    ConcurrentTodoList &operator=(const ConcurrentTodoList &) = delete;
+
+    /**
+     * @brief Returns the current snapshot.
+     *
+     * The snapshot stays valid and unchanged for as long as it is held, whatever is
+     * read or written meanwhile.
+     *
+     * @return Snapshot The list as of the last published write.
+     */
+    Snapshot snapshot() const;
+
+    /**
+     * @brief Filter tasks by category, see TodoList::filterTask().
+     *
+     * @param category One of "Backlog", "Doing", "Review", or "Done".
+     * @return A copy of the tasks in the category.
+     */
+    std::vector<Task> filterTask(const std::string &category) const;
+
+    /**
+     * @brief Filter tasks by priority, see TodoList::filterByPriority().
+     *
+     * @param priority The priority level to filter by.
+     * @return A copy of the tasks with that priority.
+     */
+    std::vector<Task> filterByPriority(const std::string &priority) const;
+
+    /**
+     * @brief Add a new task to the backlog.
+     *
+     * @param task The task to add, moved into the list.
+     */
+    void createTask(Task task);
+
+    /**
+     * @brief Move a task to another category, see TodoList::updateStatus().
+     *
+     * @param taskID The ID of the task to update.
+     * @param newStatus The category to move the task to.
+     * @return true if the task was moved, false if not found or newStatus is not a category.
+     */
+    bool updateStatus(int taskID, const std::string &newStatus);
+
+    /**
+     * @brief Delete a task by ID.
+     *
+     * @param taskID The ID of the task to delete.
+     * @return true if the task was deleted, false if not found.
+     */
+    bool deleteTask(int taskID);
+
+    /**
+     * @brief Applies any change to a copy of the list and publishes it.
+     *
+     * The change runs while holding the writer lock, readers keep using the previous
+     * snapshot until it is published. Nothing is published if the change returns false.
+     *
+     * @param change Called with a TodoList& to modify, returns true to publish.
+     * @return bool The value returned by change.
+     */
+    template <typename Change>
+    bool modify(Change &&change)
+    {
+        std::unique_lock<std::mutex> lock(writer, std::try_to_lock);
+        if (!lock.owns_lock())
+        {
+            contendedWrites.fetch_add(1, std::memory_order_relaxed);
+            lock.lock();
+        }
+
+        auto next = std::make_shared<TodoList>(*std::atomic_load(&current));
+        if (!change(*next))
+            return false;
+        publish(std::move(next));
+        return true;
+    }
+
+    /**
+     * @brief Returns the contention counters.
+     *
+     * @return Stats The counters since the list was created.
+     */
+    Stats stats() const;
+
+private:
+    /**
+     * @brief Makes a new version of the list visible to readers. Caller holds writer.
+     */
+    void publish(std::shared_ptr<TodoList> next);
+
+    /**
+     * @brief One cache line of the striped read counters.
+     */
+    struct alignas(64) ReadCounter
+    {
+        std::atomic<uint64_t> reads{0};          /**< Snapshots handed out */
+        std::atomic<uint64_t> loads{0};          /**< Cache misses */
+    };
+
+    static constexpr size_t READ_STRIPES = 16;   /**< Read counters, spread over threads */
+
+    Snapshot current;                            /**< Latest snapshot, accessed with std::atomic_load/store */
+    std::atomic<uint64_t> version{0};            /**< Bumped after every publish */
+    const uint64_t id;                           /**< Identifies this list in the per-thread caches */
+    std::mutex writer;                           /**< Serializes writers */
+    std::atomic<uint64_t> writes{0};             /**< Published changes */
+    std::atomic<uint64_t> contendedWrites{0};    /**< Writers that found the lock taken */
+    mutable ReadCounter readCounters[READ_STRIPES]; /**< Striped so readers do not share a line */
+};
+
+#endif // CONCURRENTTODOLIST_H
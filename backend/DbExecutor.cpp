@@ -0,0 +1,261 @@
+/**
+ * @file DbExecutor.cpp
+ * @brief Implementation of the DbExecutor class.
+ *
+ * Each worker opens its own connection to the database file, so reads run in parallel
+ * (the database is in WAL mode) and a writer waiting on the lock only stalls its own worker.
+ */
+
+#include "DbExecutor.h"
+#include <iostream>
+
+namespace {
+/**
+ * @brief Set when the job running on this thread hit its deadline, read by evaluate().
+ */
+thread_local bool currentJobInterrupted = false;
+
+/**
+ * @brief Number of SQLite virtual machine instructions between two deadline checks.
+ */
+constexpr int PROGRESS_INTERVAL = 1000;
+}
+
+/**
+ * @brief Opens the worker connections and starts the worker threads.
+ *
+ * @param path Path of the SQLite database file.
+ * @param threads Number of workers.
+ * @param queueCapacity Maximum number of queued jobs.
+ * @param timeout Default deadline of a job.
+ */
+DbExecutor::DbExecutor(const std::string &path, unsigned threads, size_t queueCapacity, std::chrono::milliseconds timeout)
+    : capacity(queueCapacity), defaultTimeout(timeout)
+{
+    for (unsigned i = 0; i < std::max(1u, threads); i++)
+    {
+        auto worker = std::make_unique<Worker>();
+        if (sqlite3_open_v2(path.c_str(), &worker->db, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_NOMUTEX, nullptr) != SQLITE_OK)
+        {
+            std::cerr << "Can't open DB for worker: " << sqlite3_errmsg(worker->db) << std::endl;
+        }
+        sqlite3_exec(worker->db, "PRAGMA foreign_keys = ON;", nullptr, nullptr, nullptr);
+        sqlite3_busy_timeout(worker->db, static_cast<int>(timeout.count()));
+        sqlite3_progress_handler(worker->db, PROGRESS_INTERVAL, &DbExecutor::checkDeadline, worker.get());
+        workers.push_back(std::move(worker));
+    }
+
+    for (auto &worker : workers)
+    {
+        Worker *w = worker.get();
+        w->thread = std::thread([this, w] { run(*w); });
+    }
+}
+
+/**
+ * @brief Lets the workers finish the queued jobs, then joins them and closes the connections.
+ */
+DbExecutor::~DbExecutor()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    ready.notify_all();
+    room.notify_all();
+
+    for (auto &worker : workers)
+    {
+        if (worker->thread.joinable())
+            worker->thread.join();
+        sqlite3_close(worker->db);
+    }
+}
+
+/**
+ * @brief Queues a job unless the queue is full.
+ *
+ * @param job The work to run.
+ * @param timeout The job's deadline, zero for the default.
+ * @return true if queued, false if rejected.
+ */
+bool DbExecutor::post(Job job, std::chrono::milliseconds timeout)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (stopping || jobs.size() >= capacity)
+        {
+            rejectedCount++;
+            return false;
+        }
+        jobs.push_back({std::move(job), timeout.count() > 0 ? timeout : defaultTimeout, std::chrono::steady_clock::now()});
+        inFlightCount++;
+    }
+    lastPostTicks = std::chrono::steady_clock::now().time_since_epoch().count();
+    ready.notify_one();
+    return true;
+}
+
+/**
+ * @brief Queues a job once the queue has room.
+ *
+ * @param job The work to run.
+ * @return true if queued, false if the executor is stopping.
+ */
+bool DbExecutor::postWhenRoom(Job job)
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        room.wait(lock, [this] { return stopping || jobs.size() < capacity; });
+        if (stopping)
+            return false;
+        jobs.push_back({std::move(job), defaultTimeout, std::chrono::steady_clock::now()});
+        inFlightCount++;
+    }
+    lastPostTicks = std::chrono::steady_clock::now().time_since_epoch().count();
+    ready.notify_one();
+    return true;
+}
+
+/**
+ * @brief Runs a query on a worker and completes the response when it returns.
+ *
+ * @param res The pending response.
+ * @param query The query producing the response.
+ * @param timeout How long the query may run, zero for the default.
+ */
+void DbExecutor::respond(crow::response &res, Query query, std::chrono::milliseconds timeout)
+{
+    bool queuedOk = evaluate(std::move(query), [&res](crow::response result)
+                             {
+        res = std::move(result);
+        res.end(); }, timeout);
+
+    if (!queuedOk)
+    {
+        res = crow::response(503, "Server busy, try again later");
+        res.add_header("Retry-After", "1");
+        res.end();
+    }
+}
+
+/**
+ * @brief Runs a query on a worker and passes its response, or a 500 or 504, to done.
+ *
+ * @param query The query producing the response.
+ * @param done Receives the response on the worker.
+ * @param timeout How long the query may run, zero for the default.
+ * @return true if the query was queued.
+ */
+bool DbExecutor::evaluate(Query query, Done done, std::chrono::milliseconds timeout)
+{
+    return post([this, query = std::move(query), done = std::move(done)](sqlite3 *db)
+                {
+        crow::response result;
+        try
+        {
+            result = query(db);
+        }
+        catch (const std::exception &e)
+        {
+            // Same as Crow does for a synchronous handler that throws
+            std::cerr << "Route failed: " << e.what() << std::endl;
+            result = crow::response(500);
+        }
+        if (currentJobInterrupted)
+        {
+            timedOutCount++;
+            result = crow::response(504, "Query timed out");
+        }
+        done(std::move(result)); }, timeout);
+}
+
+/**
+ * @brief Number of jobs waiting for a worker.
+ *
+ * @return size_t The queue length.
+ */
+size_t DbExecutor::queued() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return jobs.size();
+}
+
+/**
+ * @brief Sets the queueing delay callback.
+ *
+ * @param listener The callback, or nullptr.
+ */
+void DbExecutor::setSojournListener(SojournListener listener)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    sojournListener = std::move(listener);
+}
+
+/**
+ * @brief Time since the last job was submitted.
+ *
+ * @return std::chrono::milliseconds The idle time.
+ */
+std::chrono::milliseconds DbExecutor::sinceLastPost() const
+{
+    std::chrono::steady_clock::duration last(lastPostTicks.load());
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch() - last);
+}
+
+/**
+ * @brief Worker loop, runs queued jobs until the executor is stopping and the queue is empty.
+ *
+ * @param worker The worker this thread belongs to.
+ */
+void DbExecutor::run(Worker &worker)
+{
+    for (;;)
+    {
+        Pending pending;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            ready.wait(lock, [this] { return stopping || !jobs.empty(); });
+            if (jobs.empty())
+                return;
+            pending = std::move(jobs.front());
+            jobs.pop_front();
+            if (sojournListener)
+                sojournListener(std::chrono::duration_cast<std::chrono::microseconds>(
+                                    std::chrono::steady_clock::now() - pending.enqueued),
+                                jobs.size());
+        }
+        room.notify_one();
+
+        worker.deadline = std::chrono::steady_clock::now() + pending.timeout;
+        currentJobInterrupted = false;
+        try
+        {
+            pending.job(worker.db);
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << "DB job failed: " << e.what() << std::endl;
+        }
+        // A job that returns with an open transaction would block every other writer
+        if (!sqlite3_get_autocommit(worker.db))
+            sqlite3_exec(worker.db, "ROLLBACK;", nullptr, nullptr, nullptr);
+        inFlightCount--;
+    }
+}
+
+/**
+ * @brief Progress callback that interrupts the running statement once its deadline passed.
+ *
+ * @param arg The Worker running the statement.
+ * @return int Non-zero to interrupt the statement.
+ */
+int DbExecutor::checkDeadline(void *arg)
+{
+    Worker *worker = static_cast<Worker *>(arg);
+    if (std::chrono::steady_clock::now() < worker->deadline)
+        return 0;
+    currentJobInterrupted = true;
+    return 1;
+}
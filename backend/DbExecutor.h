@@ -0,0 +1,187 @@
+/**
+ * @file DbExecutor.h
+ * @brief Declaration of the DbExecutor class.
+ *
+ * The DbExecutor runs SQLite work on its own pool of threads so Crow's I/O threads
+ * never block inside sqlite3_step. Route handlers submit a query and the executor
+ * completes the crow::response when the query is done.
+ */
+
+#ifndef DBEXECUTOR_H
+#define DBEXECUTOR_H
+
+#include <sqlite3.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "crow.h"
+
+/**
+ * @class DbExecutor
+ * @brief A bounded thread pool where each worker owns its own SQLite connection.
+ *
+ * Jobs are queued in FIFO order and picked up by the first idle worker, so one slow
+ * query only ties up one worker instead of an I/O thread and every connection on it.
+ * The queue has a fixed capacity; when it is full, submissions are rejected right away
+ * instead of piling up. Every job runs with a deadline that is enforced through
+ * sqlite3_progress_handler, so a runaway query is interrupted with SQLITE_INTERRUPT.
+ */
+class DbExecutor
+{
+public:
+    using Job = std::function<void(sqlite3 *db)>;                /**< Raw work on a connection */
+    using Query = std::function<crow::response(sqlite3 *db)>;    /**< Work that produces a response */
+    using Done = std::function<void(crow::response result)>;     /**< Receives the response of a query */
+    using SojournListener = std::function<void(std::chrono::microseconds sojourn, size_t queued)>; /**< Queueing delay observer */
+
+    /**
+     * @brief Opens one connection per worker and starts the workers.
+     *
+     * @param path Path of the SQLite database file.
+     * @param threads Number of workers (and connections).
+     * @param queueCapacity Maximum number of jobs waiting for a worker.
+     * @param timeout Default time a job may run before it is interrupted.
+     */
+    DbExecutor(const std::string &path, unsigned threads, size_t queueCapacity, std::chrono::milliseconds timeout);
+
+    /**
+     * @brief Stops accepting jobs, drains the queue and closes every connection.
+     */
+    ~DbExecutor();
+
+    DbExecutor(const DbExecutor &) = delete;
+    DbExecutor &operator=(const DbExecutor &) = delete;
+
+    /**
+     * @brief Queues a job for the next idle worker.
+     *
+     * @param job The work to run on a worker connection.
+     * @param timeout How long the job may run, zero for the executor's default.
+     * @return true if the job was queued, false if the queue is full or shutting down.
+     */
+    bool post(Job job, std::chrono::milliseconds timeout = std::chrono::milliseconds(0));
+
+    /**
+     * @brief Queues a job, waiting for room if the queue is full.
+     *
+     * For writes that must not be lost. The caller's thread blocks until a worker takes
+     * a job, so it must not be one of this executor's workers.
+     *
+     * @param job The work to run on a worker connection.
+     * @return true if the job was queued, false if the executor is shutting down.
+     */
+    bool postWhenRoom(Job job);
+
+    /**
+     * @brief Runs a query on a worker and completes the response with its result.
+     *
+     * Answers 503 immediately if the queue is full and 504 if the query ran past its deadline.
+     *
+     * @param res The pending response of the route handler.
+     * @param query The query producing the response.
+     * @param timeout How long the query may run, zero for the executor's default.
+     */
+    void respond(crow::response &res, Query query, std::chrono::milliseconds timeout = std::chrono::milliseconds(0));
+
+    /**
+     * @brief Runs a query on a worker and hands its response to a callback.
+     *
+     * Like respond(), with a 504 if the query ran past its deadline, but the result goes
+     * to done on the worker instead of completing a response.
+     *
+     * @param query The query producing the response.
+     * @param done Receives the response.
+     * @param timeout How long the query may run, zero for the executor's default.
+     * @return true if the query was queued, false if the queue is full (done is not called).
+     */
+    bool evaluate(Query query, Done done, std::chrono::milliseconds timeout = std::chrono::milliseconds(0));
+
+    /**
+     * @brief Number of jobs waiting for a worker.
+     */
+    size_t queued() const;
+
+    /**
+     * @brief Number of jobs queued or running.
+     */
+    size_t inFlight() const { return inFlightCount.load(); }
+
+    /**
+     * @brief Time since a job was last submitted, used to find quiet periods.
+     */
+    std::chrono::milliseconds sinceLastPost() const;
+
+    /**
+     * @brief Total number of jobs rejected because the queue was full.
+     */
+    uint64_t rejected() const { return rejectedCount.load(); }
+
+    /**
+     * @brief Total number of jobs interrupted because they ran past their deadline.
+     */
+    uint64_t timedOut() const { return timedOutCount.load(); }
+
+    /**
+     * @brief Sets a callback told how long each job waited in the queue.
+     *
+     * It runs on the worker that picked up the job, under the queue lock, with the number
+     * of jobs still waiting, so it must be quick and must not call back into the executor.
+     *
+     * @param listener The callback, or nullptr to remove it.
+     */
+    void setSojournListener(SojournListener listener);
+
+private:
+    /**
+     * @brief A queued job with its deadline budget.
+     */
+    struct Pending
+    {
+        Job job;                                             /**< The work to run */
+        std::chrono::milliseconds timeout;                   /**< Time budget once started */
+        std::chrono::steady_clock::time_point enqueued;      /**< When the job was queued */
+    };
+
+    /**
+     * @brief A worker thread and the connection it owns.
+     */
+    struct Worker
+    {
+        sqlite3 *db = nullptr;                               /**< Connection owned by this worker */
+        std::chrono::steady_clock::time_point deadline;      /**< Deadline of the running job */
+        std::thread thread;                                  /**< The worker thread */
+    };
+
+    /**
+     * @brief Main loop of a worker: take a job, run it with a deadline, repeat.
+     */
+    void run(Worker &worker);
+
+    /**
+     * @brief sqlite3_progress_handler callback, interrupts the job once its deadline passed.
+     */
+    static int checkDeadline(void *worker);
+
+    std::vector<std::unique_ptr<Worker>> workers;            /**< Workers and their connections */
+    std::deque<Pending> jobs;                                /**< Jobs waiting for a worker */
+    size_t capacity;                                         /**< Maximum size of the job queue */
+    std::chrono::milliseconds defaultTimeout;                /**< Deadline used when a job gives none */
+    mutable std::mutex mutex;                                /**< Guards jobs and stopping */
+    std::condition_variable ready;                           /**< Signalled when a job is queued */
+    std::condition_variable room;                            /**< Signalled when a job leaves the queue */
+    bool stopping = false;                                   /**< Set by the destructor */
+    SojournListener sojournListener;                         /**< Told each job's queueing delay, guarded by mutex */
+    std::atomic<uint64_t> rejectedCount{0};                  /**< Jobs rejected on a full queue */
+    std::atomic<uint64_t> timedOutCount{0};                  /**< Jobs interrupted at their deadline */
+    std::atomic<size_t> inFlightCount{0};                    /**< Jobs queued or running */
+    std::atomic<std::chrono::steady_clock::rep> lastPostTicks{0}; /**< steady_clock time of the last post */
+};
+
+#endif // DBEXECUTOR_H
@@ -0,0 +1,305 @@
+/**
+ * @file DeadlineScheduler.cpp
+ * @brief Implementation of the DeadlineScheduler class.
+ */
+
+#include "DeadlineScheduler.h"
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <string>
+#include <string_view>
+#include "TaskTable.h"
+
+namespace {
+
+constexpr int64_t MINUTES_PER_DAY = 24 * 60;
+
+/**
+ * @brief Reads a text column, mapping NULL to an empty string.
+ */
+std::string_view text(sqlite3_stmt *stmt, int col)
+{
+    const char *value = (const char *)sqlite3_column_text(stmt, col);
+    return std::string_view(value ? value : "", sqlite3_column_bytes(stmt, col));
+}
+
+/**
+ * @brief Flags a task overdue if it still is, by the same test as the triggers in Schema.h.
+ */
+constexpr const char *FLAG_OVERDUE_SQL = R"(
+        UPDATE tasks SET overdue = 1
+        WHERE id = ?1 AND overdue = 0 AND status IS NOT 'completed'
+              AND due_date GLOB '[0-9][0-9][0-9][0-9]-[0-9][0-9]-[0-9][0-9]*' AND due_date < date('now');
+    )";
+
+/**
+ * @brief Queues the overdue event of a flagged task, also when a trigger flagged it.
+ */
+constexpr const char *QUEUE_OVERDUE_SQL = R"(
+        INSERT OR IGNORE INTO outbox (event, task_id, project_id, due_date, created_at)
+        SELECT 'overdue', id, project_id, due_date, datetime('now') FROM tasks WHERE id = ?1 AND overdue = 1;
+    )";
+
+/**
+ * @brief Queues the reminder of an open task whose due day ends within the lead time ?2.
+ */
+constexpr const char *QUEUE_DUE_SOON_SQL = R"(
+        INSERT OR IGNORE INTO outbox (event, task_id, project_id, due_date, created_at)
+        SELECT 'due_soon', id, project_id, due_date, datetime('now') FROM tasks
+        WHERE id = ?1 AND overdue = 0 AND status IS NOT 'completed'
+              AND due_date GLOB '[0-9][0-9][0-9][0-9]-[0-9][0-9]-[0-9][0-9]*'
+              AND datetime(substr(due_date, 1, 10), '+1 day', ?2) <= datetime('now');
+    )";
+
+} // namespace
+
+/**
+ * @brief Creates a scheduler whose wheel starts at the current minute.
+ *
+ * @param writerOf Write pool of a task's shard.
+ * @param settings Tuning knobs.
+ */
+DeadlineScheduler::DeadlineScheduler(WriterOf writerOf, Settings settings)
+    : writerOf(std::move(writerOf)), settings(settings), wheel(minuteNow())
+{
+}
+
+/**
+ * @brief Wakes the background thread and waits for it to exit.
+ *
+ * Batches already handed to the write pools still run, they do not refer to the scheduler.
+ */
+DeadlineScheduler::~DeadlineScheduler()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    if (thread.joinable())
+        thread.join();
+}
+
+/**
+ * @brief Timer key of a task's event: the task ID and the event in the lowest bit.
+ *
+ * @param taskId The task ID.
+ * @param event The event.
+ * @return TimerWheel::Key The key.
+ */
+TimerWheel::Key DeadlineScheduler::keyOf(int taskId, Event event)
+{
+    return TimerWheel::Key(taskId) * 2 + (event == Event::Overdue);
+}
+
+/**
+ * @brief Minutes since 1970-01-01 UTC.
+ *
+ * @return int64_t The current minute.
+ */
+int64_t DeadlineScheduler::minuteNow()
+{
+    return std::chrono::duration_cast<std::chrono::minutes>(
+               std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief Sets the overdue timer at the end of the due day, and the reminder before it.
+ *
+ * A task whose due day has ended is flagged on the next tick. A reminder whose time has
+ * passed fires on the next tick too, as long as the task is not overdue yet.
+ *
+ * @param taskId The task ID.
+ * @param dueDay The due day, see TaskTable::dayNumber().
+ */
+void DeadlineScheduler::plan(int taskId, int32_t dueDay)
+{
+    int64_t overdueAt = (int64_t(dueDay) + 1) * MINUTES_PER_DAY;
+    wheel.schedule(keyOf(taskId, Event::Overdue), overdueAt);
+    if (settings.reminderLead.count() > 0 && overdueAt > wheel.current())
+        wheel.schedule(keyOf(taskId, Event::DueSoon), overdueAt - settings.reminderLead.count());
+    else
+        wheel.cancel(keyOf(taskId, Event::DueSoon));
+}
+
+/**
+ * @brief Reads the open tasks that are not flagged overdue and sets their timers.
+ *
+ * Flagged tasks have nothing left to fire until they are changed again.
+ *
+ * @param db A connection to one shard.
+ * @return bool false if the query failed.
+ */
+bool DeadlineScheduler::load(sqlite3 *db)
+{
+    sqlite3_stmt *stmt;
+    const char *sql = "SELECT id, due_date FROM tasks WHERE overdue = 0 AND status IS NOT 'completed' AND due_date IS NOT NULL;";
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK)
+        return false;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    while (sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        int32_t due = TaskTable::dayNumber(text(stmt, 1));
+        if (due != TaskTable::NO_DUE_DATE)
+            plan(sqlite3_column_int(stmt, 0), due);
+    }
+    sqlite3_finalize(stmt);
+    return true;
+}
+
+/**
+ * @brief Re-reads a task and sets its timers, or drops them if it is completed, has no
+ * valid due date or is gone.
+ *
+ * An overdue task keeps its overdue timer, so its event is queued even when a trigger
+ * flagged it at the write.
+ *
+ * @param db Connection that committed the change.
+ * @param taskId The task ID.
+ */
+void DeadlineScheduler::refreshTask(sqlite3 *db, int taskId)
+{
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(db, "SELECT due_date, status FROM tasks WHERE id = ?;", -1, &stmt, nullptr) != SQLITE_OK)
+        return;
+    sqlite3_bind_int(stmt, 1, taskId);
+
+    int32_t due = TaskTable::NO_DUE_DATE;
+    if (sqlite3_step(stmt) == SQLITE_ROW && text(stmt, 1) != "completed")
+        due = TaskTable::dayNumber(text(stmt, 0));
+    sqlite3_finalize(stmt);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (due != TaskTable::NO_DUE_DATE)
+        plan(taskId, due);
+    else
+    {
+        wheel.cancel(keyOf(taskId, Event::Overdue));
+        wheel.cancel(keyOf(taskId, Event::DueSoon));
+    }
+}
+
+/**
+ * @brief Starts the loop: sleep to the next minute, advance the wheel, dispatch what fired.
+ */
+void DeadlineScheduler::start()
+{
+    thread = std::thread([this]
+                         {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true)
+        {
+            std::chrono::system_clock::time_point next{std::chrono::minutes(wheel.current() + 1)};
+            if (wake.wait_until(lock, next, [this] { return stopping; }))
+                break;
+
+            std::vector<TimerWheel::Key> expired;
+            wheel.advance(minuteNow(), expired);
+            lock.unlock();
+            fired += expired.size();
+            dispatch(expired);
+            lock.lock();
+        } });
+}
+
+/**
+ * @brief Groups fired timers by write pool and posts them in batches of settings.batch.
+ *
+ * When a pool is full, the batch is scheduled again for the next tick, unless a task
+ * change has set a new timer for the key meanwhile.
+ *
+ * @param keys The fired timers.
+ */
+void DeadlineScheduler::dispatch(const std::vector<TimerWheel::Key> &keys)
+{
+    std::map<DbExecutor *, std::vector<TimerWheel::Key>> byWriter;
+    for (TimerWheel::Key key : keys)
+        byWriter[&writerOf(static_cast<int>(key / 2))].push_back(key);
+
+    for (const auto &writer : byWriter)
+    {
+        for (size_t i = 0; i < writer.second.size(); i += settings.batch)
+        {
+            std::vector<TimerWheel::Key> batch(writer.second.begin() + i,
+                                               writer.second.begin() + std::min(i + settings.batch, writer.second.size()));
+            std::chrono::minutes lead = settings.reminderLead;
+            if (writer.first->post([batch, lead](sqlite3 *db) { apply(db, batch, lead); }))
+                continue;
+
+            std::lock_guard<std::mutex> lock(mutex);
+            for (TimerWheel::Key key : batch)
+            {
+                if (!wheel.contains(key))
+                    wheel.schedule(key, wheel.current() + 1);
+            }
+            deferred += batch.size();
+        }
+    }
+}
+
+/**
+ * @brief Flags overdue tasks and queues their events, all fired timers in one transaction.
+ *
+ * @param db The connection, of the write pool of the tasks' shard.
+ * @param keys Timer keys.
+ * @param reminderLead Reminder time before the end of the due day.
+ * @return bool false if the transaction was rolled back.
+ */
+bool DeadlineScheduler::apply(sqlite3 *db, const std::vector<TimerWheel::Key> &keys, std::chrono::minutes reminderLead)
+{
+    sqlite3_stmt *flag = nullptr, *overdue = nullptr, *dueSoon = nullptr;
+    bool ok = sqlite3_exec(db, "BEGIN IMMEDIATE;", nullptr, nullptr, nullptr) == SQLITE_OK &&
+              sqlite3_prepare_v2(db, FLAG_OVERDUE_SQL, -1, &flag, nullptr) == SQLITE_OK &&
+              sqlite3_prepare_v2(db, QUEUE_OVERDUE_SQL, -1, &overdue, nullptr) == SQLITE_OK &&
+              sqlite3_prepare_v2(db, QUEUE_DUE_SOON_SQL, -1, &dueSoon, nullptr) == SQLITE_OK;
+
+    auto run = [](sqlite3_stmt *stmt, int taskId) {
+        sqlite3_bind_int(stmt, 1, taskId);
+        bool done = sqlite3_step(stmt) == SQLITE_DONE;
+        sqlite3_reset(stmt);
+        return done;
+    };
+    std::string lead = "-" + std::to_string(reminderLead.count()) + " minutes";
+    if (ok)
+        sqlite3_bind_text(dueSoon, 2, lead.c_str(), -1, SQLITE_TRANSIENT);
+    for (size_t i = 0; ok && i < keys.size(); i++)
+    {
+        int taskId = static_cast<int>(keys[i] / 2);
+        if (keys[i] % 2 == 1)
+            ok = run(flag, taskId) && run(overdue, taskId);
+        else
+            ok = run(dueSoon, taskId);
+    }
+    sqlite3_finalize(flag);
+    sqlite3_finalize(overdue);
+    sqlite3_finalize(dueSoon);
+
+    if (ok)
+        ok = sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr) == SQLITE_OK;
+    if (!ok)
+    {
+        std::cerr << "Can't apply due date timers: " << sqlite3_errmsg(db) << std::endl;
+        sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
+    }
+    return ok;
+}
+
+/**
+ * @brief Builds the scheduler counters.
+ *
+ * @return crow::json::wvalue {"pending", "fired", "deferred", "reminder_lead_minutes"}
+ */
+crow::json::wvalue DeadlineScheduler::stats() const
+{
+    crow::json::wvalue stats;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stats["pending"] = wheel.size();
+    }
+    stats["fired"] = fired.load();
+    stats["deferred"] = deferred.load();
+    stats["reminder_lead_minutes"] = settings.reminderLead.count();
+    return stats;
+}
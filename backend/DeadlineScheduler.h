@@ -0,0 +1,151 @@
+/**
+ * @file DeadlineScheduler.h
+ * @brief Declaration of the DeadlineScheduler class.
+ *
+ * Holds a timer for every open task with a due date, on a TimerWheel ticking once a
+ * minute. When a due date passes, the task is flagged overdue (see tasks.overdue in
+ * Schema.h), and shortly before it does, a reminder is due. Both are recorded as events in
+ * the outbox table of the task's shard, for a notifier to pick up with GET /admin/outbox.
+ * Nothing scans the tasks for dates once the timers are loaded at startup.
+ */
+
+#ifndef DEADLINESCHEDULER_H
+#define DEADLINESCHEDULER_H
+
+#include <sqlite3.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "crow.h"
+#include "DbExecutor.h"
+#include "TimerWheel.h"
+
+/**
+ * @class DeadlineScheduler
+ * @brief Fires the due date timers of the open tasks and applies them on the write pools.
+ *
+ * Each task has up to two timers: the reminder, settings.reminderLead before the end of
+ * its due day, and the overdue timer at the end of its due day (UTC, like date('now')).
+ * The write pools keep the timers up to date by calling refreshTask() after each committed
+ * task change. Fired timers are applied in batches on the write pool of their task's
+ * shard; each statement checks the task again, so a timer that raced with a change does
+ * nothing, and the outbox keeps a single event per task, event and due date.
+ */
+class DeadlineScheduler
+{
+public:
+    /**
+     * @brief What a timer does when it fires.
+     */
+    enum class Event
+    {
+        DueSoon,        /**< Queues a due_soon reminder */
+        Overdue         /**< Flags the task overdue and queues an overdue event */
+    };
+
+    /**
+     * @brief Tuning knobs of the scheduler.
+     */
+    struct Settings
+    {
+        std::chrono::minutes reminderLead{24 * 60};     /**< Reminder time before the end of the due day, 0 for none */
+        size_t batch = 500;                             /**< Fired timers applied per write transaction */
+    };
+
+    /**
+     * @brief Picks the write pool of a task's shard.
+     */
+    using WriterOf = std::function<DbExecutor &(int taskId)>;
+
+    /**
+     * @brief Creates a scheduler without timers, fill it with load() and call start().
+     *
+     * @param writerOf Write pool of a task's shard.
+     * @param settings Tuning knobs.
+     */
+    DeadlineScheduler(WriterOf writerOf, Settings settings);
+
+    /**
+     * @brief Stops the background thread.
+     */
+    ~DeadlineScheduler();
+
+    /**
+     * @brief Adds the timers of every open task of a database file that is not overdue yet.
+     *
+     * @param db A connection to one shard, called once per shard.
+     * @return bool false if the query failed.
+     */
+    bool load(sqlite3 *db);
+
+    /**
+     * @brief Re-reads a task after a committed change and sets or drops its timers.
+     *
+     * @param db Connection that committed the change.
+     * @param taskId The task ID.
+     */
+    void refreshTask(sqlite3 *db, int taskId);
+
+    /**
+     * @brief Starts the background thread, which advances the wheel every minute.
+     */
+    void start();
+
+    /**
+     * @brief Pending timers and how many fired, for GET /admin/outbox.
+     *
+     * @return crow::json::wvalue {"pending", "fired", "deferred", "reminder_lead_minutes"}
+     */
+    crow::json::wvalue stats() const;
+
+    /**
+     * @brief Applies fired timers in one transaction. Called on the write pool of their shard.
+     *
+     * @param db The connection.
+     * @param keys Timer keys, see keyOf().
+     * @param reminderLead Reminder time before the end of the due day.
+     * @return bool false if the transaction was rolled back.
+     */
+    static bool apply(sqlite3 *db, const std::vector<TimerWheel::Key> &keys, std::chrono::minutes reminderLead);
+
+private:
+    /**
+     * @brief Timer key of a task's event.
+     */
+    static TimerWheel::Key keyOf(int taskId, Event event);
+
+    /**
+     * @brief The current minute since 1970-01-01 UTC, the tick of the wheel.
+     */
+    static int64_t minuteNow();
+
+    /**
+     * @brief Sets the timers of a task due on a day. The mutex must be held.
+     */
+    void plan(int taskId, int32_t dueDay);
+
+    /**
+     * @brief Hands fired timers to the write pools of their shards.
+     *
+     * A batch a full write pool rejects fires again on the next tick.
+     */
+    void dispatch(const std::vector<TimerWheel::Key> &keys);
+
+    WriterOf writerOf;                          /**< Write pool of a task's shard */
+    Settings settings;                          /**< Tuning knobs */
+
+    mutable std::mutex mutex;                   /**< Guards wheel and stopping */
+    TimerWheel wheel;                           /**< The timers, a tick per minute */
+    std::condition_variable wake;               /**< Wakes the loop early on shutdown */
+    bool stopping = false;                      /**< Set by the destructor */
+    std::thread thread;                         /**< The background loop */
+    std::atomic<long long> fired{0};            /**< Timers fired since start */
+    std::atomic<long long> deferred{0};         /**< Timers put back because a write pool was full */
+};
+
+#endif // DEADLINESCHEDULER_H
@@ -0,0 +1,322 @@
+/**
+ * @file DeleteJob.cpp
+ * @brief Implementation of the DeleteJob and DeleteJobs classes.
+ */
+
+#include "DeleteJob.h"
+#include <algorithm>
+
+/**
+ * @brief Creates a job that has not deleted anything yet.
+ *
+ * @param id Job ID.
+ * @param target What to delete.
+ * @param targetId ID of the project or user.
+ * @param shards Shards to visit, in order.
+ */
+DeleteJob::DeleteJob(int id, Target target, int targetId, std::vector<int> shards)
+    : jobId(id), kind(target), entity(targetId), shards(std::move(shards)),
+      started(std::chrono::steady_clock::now())
+{
+}
+
+/**
+ * @brief The delete statements of each target, children before parents.
+ *
+ * Every statement deletes at most ?2 rows through the indexes on the parent column, so a
+ * batch costs the same however large the project is. The last statement of a target
+ * deletes a single row and ignores ?2. Checks come first.
+ *
+ * @param target The target.
+ * @return const std::vector<Stage>& The stages.
+ */
+const std::vector<DeleteJob::Stage> &DeleteJob::stagesOf(Target target)
+{
+    static const std::vector<Stage> project = {
+        {"comments", R"(DELETE FROM comments WHERE id IN (
+                            SELECT c.id FROM tasks t JOIN comments c ON c.task_id = t.id
+                            WHERE t.project_id = ?1 LIMIT ?2);)"},
+        {"comments_archive", R"(DELETE FROM comments_archive WHERE id IN (
+                                    SELECT c.id FROM tasks_archive t JOIN comments_archive c ON c.task_id = t.id
+                                    WHERE t.project_id = ?1 LIMIT ?2);)"},
+        {"tasks", "DELETE FROM tasks WHERE id IN (SELECT id FROM tasks WHERE project_id = ?1 LIMIT ?2);"},
+        {"tasks_archive", "DELETE FROM tasks_archive WHERE id IN (SELECT id FROM tasks_archive WHERE project_id = ?1 LIMIT ?2);"},
+        {"user_projects", "DELETE FROM user_projects WHERE rowid IN (SELECT rowid FROM user_projects WHERE project_id = ?1 LIMIT ?2);"},
+        {"projects", "DELETE FROM projects WHERE id = ?1;"}};
+    static const std::vector<Stage> user = {
+        {"comments", R"(SELECT 1 FROM comments WHERE user_id = ?1
+                        UNION ALL SELECT 1 FROM comments_archive WHERE user_id = ?1 LIMIT 1;)",
+         "The user still has comments"},
+        {"user_projects", "DELETE FROM user_projects WHERE rowid IN (SELECT rowid FROM user_projects WHERE user_id = ?1 LIMIT ?2);"},
+        {"users", "DELETE FROM users WHERE id = ?1;"}};
+    static const std::vector<Stage> allTasks = {
+        {"comments", "DELETE FROM comments WHERE id IN (SELECT id FROM comments LIMIT ?2);"},
+        {"comments_archive", "DELETE FROM comments_archive WHERE id IN (SELECT id FROM comments_archive LIMIT ?2);"},
+        {"tasks", "DELETE FROM tasks WHERE id IN (SELECT id FROM tasks LIMIT ?2);"},
+        {"tasks_archive", "DELETE FROM tasks_archive WHERE id IN (SELECT id FROM tasks_archive LIMIT ?2);"}};
+    static const std::vector<Stage> allProjects = {
+        {"comments", R"(DELETE FROM comments WHERE id IN (
+                            SELECT c.id FROM tasks t JOIN comments c ON c.task_id = t.id
+                            WHERE t.project_id IS NOT NULL LIMIT ?2);)"},
+        {"comments_archive", R"(DELETE FROM comments_archive WHERE id IN (
+                                    SELECT c.id FROM tasks_archive t JOIN comments_archive c ON c.task_id = t.id
+                                    WHERE t.project_id IS NOT NULL LIMIT ?2);)"},
+        {"tasks", "DELETE FROM tasks WHERE id IN (SELECT id FROM tasks WHERE project_id IS NOT NULL LIMIT ?2);"},
+        {"tasks_archive", "DELETE FROM tasks_archive WHERE id IN (SELECT id FROM tasks_archive WHERE project_id IS NOT NULL LIMIT ?2);"},
+        {"user_projects", "DELETE FROM user_projects WHERE rowid IN (SELECT rowid FROM user_projects LIMIT ?2);"},
+        {"projects", "DELETE FROM projects WHERE id IN (SELECT id FROM projects LIMIT ?2);"}};
+
+    switch (target)
+    {
+    case Target::Project:
+        return project;
+    case Target::User:
+        return user;
+    case Target::AllTasks:
+        return allTasks;
+    default:
+        return allProjects;
+    }
+}
+
+/**
+ * @brief Name of a target in the status.
+ *
+ * @param target The target.
+ * @return const char* The name.
+ */
+const char *DeleteJob::nameOf(Target target)
+{
+    switch (target)
+    {
+    case Target::Project:
+        return "project";
+    case Target::User:
+        return "user";
+    case Target::AllTasks:
+        return "all_tasks";
+    default:
+        return "all_projects";
+    }
+}
+
+/**
+ * @brief The shard of the next step.
+ *
+ * @return int The shard, the last one once the job finished.
+ */
+int DeleteJob::shard() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return shards[std::min(shardPosition, shards.size() - 1)];
+}
+
+/**
+ * @brief Runs one batch of the current stage in its own transaction.
+ *
+ * A stage is done once a batch deletes fewer than maxRows rows. A failed statement,
+ * e.g. a user who still has comments, fails the job with the SQLite message.
+ *
+ * @param db Connection of the write pool of shard().
+ * @param maxRows Rows per batch.
+ * @return bool true if the current shard has rows left.
+ */
+bool DeleteJob::step(sqlite3 *db, int maxRows)
+{
+    const std::vector<Stage> &stages = stagesOf(kind);
+    size_t checks = 0;
+    while (checks < stages.size() && stages[checks].refusal)
+        checks++;
+
+    size_t current;
+    bool check;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!error.empty() || shardPosition >= shards.size())
+            return false;
+        if (checking && checks == 0)
+            checking = false;
+        if (!checking && stage < checks)
+            stage = checks;
+        current = stage;
+        check = checking;
+    }
+
+    if (check)
+    {
+        // Read only, so no transaction: one step runs every check of the shard
+        for (size_t i = 0; i < checks; i++)
+        {
+            sqlite3_stmt *stmt;
+            if (sqlite3_prepare_v2(db, stages[i].sql, -1, &stmt, nullptr) != SQLITE_OK)
+            {
+                fail(std::string("Can't check ") + stages[i].table + ": " + sqlite3_errmsg(db));
+                return false;
+            }
+            sqlite3_bind_int(stmt, 1, entity);
+            int rc = sqlite3_step(stmt);
+            sqlite3_finalize(stmt);
+            if (rc != SQLITE_DONE)
+            {
+                fail(rc == SQLITE_ROW ? stages[i].refusal : sqlite3_errmsg(db));
+                return false;
+            }
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        if (++shardPosition == shards.size())
+        {
+            checking = false;
+            shardPosition = 0;
+        }
+        return false;
+    }
+    const Stage &next = stages[current];
+
+    sqlite3_stmt *stmt = nullptr;
+    int changes = 0;
+    bool ok = sqlite3_exec(db, "BEGIN IMMEDIATE;", nullptr, nullptr, nullptr) == SQLITE_OK;
+    if (ok && (ok = sqlite3_prepare_v2(db, next.sql, -1, &stmt, nullptr) == SQLITE_OK))
+    {
+        sqlite3_bind_int(stmt, 1, entity);
+        sqlite3_bind_int(stmt, 2, maxRows);
+        ok = sqlite3_step(stmt) == SQLITE_DONE;
+        changes = sqlite3_changes(db);
+    }
+    std::string message = ok ? "" : sqlite3_errmsg(db);
+    sqlite3_finalize(stmt);
+    if (ok)
+        ok = sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr) == SQLITE_OK;
+    if (!ok)
+    {
+        if (message.empty())
+            message = sqlite3_errmsg(db);
+        sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
+        fail(std::string("Can't delete from ") + next.table + ": " + message);
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    deleted[next.table] += changes;
+    batches++;
+    if (changes < maxRows && ++stage == stages.size())
+    {
+        stage = checks;
+        if (++shardPosition == shards.size())
+            ended = std::chrono::steady_clock::now();
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Whether the job has nothing left to do.
+ *
+ * @return bool true once every shard was visited or the job failed.
+ */
+bool DeleteJob::finished() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return !error.empty() || shardPosition >= shards.size();
+}
+
+/**
+ * @brief Whether the job stopped with an error.
+ *
+ * @return bool true if fail() was called.
+ */
+bool DeleteJob::failed() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return !error.empty();
+}
+
+/**
+ * @brief Stops the job, the rows deleted so far stay deleted.
+ *
+ * @param reason Why the job stopped.
+ */
+void DeleteJob::fail(const std::string &reason)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!error.empty())
+        return;
+    error = reason;
+    ended = std::chrono::steady_clock::now();
+}
+
+/**
+ * @brief Builds the status of the job.
+ *
+ * @return crow::json::wvalue {"id", "target", "target_id", "state", "deleted", "batches", "seconds", "error"}
+ */
+crow::json::wvalue DeleteJob::status() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    crow::json::wvalue status;
+    status["id"] = jobId;
+    status["target"] = nameOf(kind);
+    if (kind == Target::Project || kind == Target::User)
+        status["target_id"] = entity;
+
+    bool done = shardPosition >= shards.size();
+    status["state"] = !error.empty() ? "failed" : done ? "done" : batches > 0 ? "running" : "queued";
+    if (!error.empty())
+        status["error"] = error;
+    for (const auto &table : deleted)
+        status["deleted"][table.first] = table.second;
+    status["batches"] = batches;
+
+    auto end = !error.empty() || done ? ended : std::chrono::steady_clock::now();
+    status["seconds"] = std::chrono::duration<double>(end - started).count();
+    return status;
+}
+
+/**
+ * @brief Registers a job under the next ID, forgetting finished jobs older than an hour.
+ *
+ * @param target What to delete.
+ * @param targetId ID of the project or user.
+ * @param shards Shards to visit.
+ * @return std::shared_ptr<DeleteJob> The job.
+ */
+std::shared_ptr<DeleteJob> DeleteJobs::create(DeleteJob::Target target, int targetId, std::vector<int> shards)
+{
+    auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto it = jobs.begin(); it != jobs.end();)
+    {
+        if (now - it->second.created > std::chrono::hours(1) && it->second.job->finished())
+            it = jobs.erase(it);
+        else
+            ++it;
+    }
+
+    int id = nextId++;
+    auto job = std::make_shared<DeleteJob>(id, target, targetId, std::move(shards));
+    jobs[id] = {job, now};
+    return job;
+}
+
+/**
+ * @brief Looks a job up by ID.
+ *
+ * @param id The job ID.
+ * @return std::shared_ptr<DeleteJob> The job, or nullptr.
+ */
+std::shared_ptr<DeleteJob> DeleteJobs::find(int id)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = jobs.find(id);
+    return it == jobs.end() ? nullptr : it->second.job;
+}
+
+/**
+ * @brief Forgets a job.
+ *
+ * @param id The job ID.
+ */
+void DeleteJobs::remove(int id)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    jobs.erase(id);
+}
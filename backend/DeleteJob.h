@@ -0,0 +1,200 @@
+/**
+ * @file DeleteJob.h
+ * @brief Declaration of the DeleteJob and DeleteJobs classes.
+ *
+ * Deleting a project, a user or every task used to be one cascading DELETE that held
+ * the write lock until the last comment was gone. A DeleteJob removes the same rows in
+ * batches instead, children before parents, each batch in its own transaction and its
+ * own write pool job, so other writes run in between. The route answers 202 with the
+ * job, and GET /jobs/<id> reports its progress.
+ */
+
+#ifndef DELETEJOB_H
+#define DELETEJOB_H
+
+#include <sqlite3.h>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "crow.h"
+
+/**
+ * @class DeleteJob
+ * @brief Deletes an entity and everything that depends on it, a batch at a time.
+ *
+ * The rows are deleted table by table in an order that never leaves a row whose parent
+ * is gone: comments before tasks, tasks before their project, the project or user row
+ * last. A job can cover several shards; they are visited in the order given, each one
+ * to the end before the next. Checks that could refuse the delete, such as a user who
+ * still has comments, run on every shard before the first row is deleted.
+ */
+class DeleteJob
+{
+public:
+    /**
+     * @brief What a job deletes.
+     */
+    enum class Target
+    {
+        Project,        /**< A project with its members, tasks and comments */
+        User,           /**< A user with their memberships */
+        AllTasks,       /**< Every task and comment, debug route */
+        AllProjects     /**< Every project with all that depends on it, debug route */
+    };
+
+    /**
+     * @brief Creates a job, run it with step() on the write pool of each shard.
+     *
+     * @param id Job ID, as given to clients.
+     * @param target What to delete.
+     * @param targetId ID of the project or user, unused for the debug targets.
+     * @param shards Shards to visit, in order.
+     */
+    DeleteJob(int id, Target target, int targetId, std::vector<int> shards);
+
+    /**
+     * @brief Job ID.
+     */
+    int id() const { return jobId; }
+
+    /**
+     * @brief What the job deletes.
+     */
+    Target target() const { return kind; }
+
+    /**
+     * @brief ID of the project or user.
+     */
+    int targetId() const { return entity; }
+
+    /**
+     * @brief Shard the next step() has to run on.
+     */
+    int shard() const;
+
+    /**
+     * @brief Deletes up to maxRows rows of the current table in one transaction.
+     *
+     * When the current shard has no rows left, the job moves on to the next one. On the
+     * first visit of each shard, the step runs the checks of the target instead.
+     *
+     * @param db Connection of the write pool of shard().
+     * @param maxRows Rows per batch.
+     * @return bool true if the same shard has rows left for another step.
+     */
+    bool step(sqlite3 *db, int maxRows);
+
+    /**
+     * @brief True once every shard was visited or the job failed.
+     */
+    bool finished() const;
+
+    /**
+     * @brief True if the job stopped with an error.
+     */
+    bool failed() const;
+
+    /**
+     * @brief Stops the job with an error, e.g. when a write pool stays full.
+     *
+     * @param reason Why the job stopped.
+     */
+    void fail(const std::string &reason);
+
+    /**
+     * @brief State, rows deleted per table and timing, for GET /jobs/<id>.
+     *
+     * @return crow::json::wvalue The status.
+     */
+    crow::json::wvalue status() const;
+
+private:
+    /**
+     * @brief One table to empty of the rows of the target.
+     */
+    struct Stage
+    {
+        const char *table;              /**< Table the rows are deleted from, as reported */
+        const char *sql;                /**< Deletes up to ?2 rows, ?1 is the target ID */
+        const char *refusal = nullptr;  /**< Set for a check: sql is a query, a row fails the job with this */
+    };
+
+    /**
+     * @brief The tables to empty for a target, in order.
+     */
+    static const std::vector<Stage> &stagesOf(Target target);
+
+    /**
+     * @brief Name of a target in the status.
+     */
+    static const char *nameOf(Target target);
+
+    int jobId;                                          /**< Job ID */
+    Target kind;                                        /**< What the job deletes */
+    int entity;                                         /**< Project or user ID */
+    std::vector<int> shards;                            /**< Shards to visit, in order */
+
+    mutable std::mutex mutex;                           /**< Guards the progress below */
+    bool checking = true;                               /**< Running the checks, before any delete */
+    size_t shardPosition = 0;                           /**< Index into shards of the current shard */
+    size_t stage = 0;                                   /**< Current table on the current shard */
+    std::map<std::string, long long> deleted;           /**< Rows deleted per table */
+    long long batches = 0;                              /**< Transactions committed */
+    std::string error;                                  /**< Why the job failed, empty if it did not */
+    std::chrono::steady_clock::time_point started;      /**< Creation time */
+    std::chrono::steady_clock::time_point ended;        /**< Time the job finished or failed */
+};
+
+/**
+ * @class DeleteJobs
+ * @brief The delete jobs of the server, by ID.
+ *
+ * Finished jobs are kept for an hour, so clients can still read their outcome.
+ */
+class DeleteJobs
+{
+public:
+    /**
+     * @brief Registers a new job.
+     *
+     * @param target What to delete.
+     * @param targetId ID of the project or user.
+     * @param shards Shards to visit, in order.
+     * @return std::shared_ptr<DeleteJob> The job.
+     */
+    std::shared_ptr<DeleteJob> create(DeleteJob::Target target, int targetId, std::vector<int> shards);
+
+    /**
+     * @brief A job by ID.
+     *
+     * @param id The job ID.
+     * @return std::shared_ptr<DeleteJob> The job, or nullptr if there is none or it expired.
+     */
+    std::shared_ptr<DeleteJob> find(int id);
+
+    /**
+     * @brief Forgets a job that could not be started.
+     *
+     * @param id The job ID.
+     */
+    void remove(int id);
+
+private:
+    /**
+     * @brief A job and the time it was created.
+     */
+    struct Entry
+    {
+        std::shared_ptr<DeleteJob> job;                 /**< The job */
+        std::chrono::steady_clock::time_point created;  /**< When it was registered */
+    };
+
+    std::mutex mutex;                                   /**< Guards jobs and nextId */
+    std::map<int, Entry> jobs;                          /**< Jobs by ID */
+    int nextId = 1;                                     /**< ID of the next job */
+};
+
+#endif // DELETEJOB_H
@@ -0,0 +1,233 @@
+/**
+ * @file IdempotencyStore.cpp
+ * @brief Implementation of the IdempotencyStore class.
+ */
+
+#include "IdempotencyStore.h"
+#include <algorithm>
+#include <functional>
+#include <sstream>
+
+/**
+ * @brief Creates an empty store.
+ *
+ * @param settings Tuning knobs.
+ */
+IdempotencyStore::IdempotencyStore(Settings settings) : settings(settings)
+{
+}
+
+/**
+ * @brief Claims, replays or joins a key.
+ *
+ * @param claim The scoped key, which gets a new id when claimed.
+ * @param body The request body.
+ * @param res The pending response.
+ * @return Outcome What the route must do next.
+ */
+IdempotencyStore::Outcome IdempotencyStore::begin(Claim &claim, const std::string &body, crow::response &res)
+{
+    size_t fingerprint = std::hash<std::string>()(body);
+    Stripe &stripe = stripeOf(claim.key);
+    std::vector<crow::response *> abandoned;
+    Outcome outcome = Outcome::Run;
+    {
+        std::lock_guard<std::mutex> lock(stripe.mutex);
+        Clock::time_point now = Clock::now();
+        evict(stripe, now, abandoned);
+
+        auto it = stripe.entries.find(claim.key);
+        if (it == stripe.entries.end())
+        {
+            claim.id = ++claims;
+            Entry &entry = stripe.entries[claim.key];
+            entry.fingerprint = fingerprint;
+            entry.claim = claim.id;
+            entry.started = now;
+            entry.waiting.push_back(&res);
+            entry.running = stripe.running.insert(stripe.running.end(), claim.key);
+        }
+        else
+            outcome = repeat(it->second, fingerprint, res);
+    }
+    giveUp(abandoned);
+    return outcome;
+}
+
+/**
+ * @brief Replays, joins or refuses a repeat of a claimed key. Caller holds the lock.
+ *
+ * @param entry The entry of the key.
+ * @param fingerprint Hash of the repeat's body.
+ * @param res The pending response of the repeat.
+ * @return Outcome What the route must do next.
+ */
+IdempotencyStore::Outcome IdempotencyStore::repeat(Entry &entry, size_t fingerprint, crow::response &res)
+{
+    if (entry.fingerprint != fingerprint)
+    {
+        mismatched++;
+        res = crow::response(422, "Idempotency-Key was already used with a different request body");
+        return Outcome::Mismatch;
+    }
+    if (!entry.done)
+    {
+        joined++;
+        entry.waiting.push_back(&res);
+        return Outcome::Joined;
+    }
+    replayed++;
+    fill(res, entry.response);
+    res.set_header("Idempotent-Replayed", "true");
+    return Outcome::Replayed;
+}
+
+/**
+ * @brief Stores the response unless it is an error, then answers every waiting request.
+ *
+ * The requests are answered after the lock is released, they may be on any thread.
+ *
+ * @param claim The claim made by begin().
+ * @param result The response of the write.
+ */
+void IdempotencyStore::complete(const Claim &claim, crow::response &result)
+{
+    Stored stored;
+    stored.code = result.code;
+    stored.body = result.body;
+    stored.headers = result.headers;
+
+    std::vector<crow::response *> waiting;
+    std::vector<crow::response *> abandoned;
+    {
+        Stripe &stripe = stripeOf(claim.key);
+        std::lock_guard<std::mutex> lock(stripe.mutex);
+        auto it = stripe.entries.find(claim.key);
+        // Gone, or claimed again, if the write ran past the pending timeout; its requests got a 504
+        if (it == stripe.entries.end() || it->second.done || it->second.claim != claim.id)
+            return;
+        waiting.swap(it->second.waiting);
+        stripe.running.erase(it->second.running);
+        if (stored.code >= 500)
+            stripe.entries.erase(it);
+        else
+        {
+            Clock::time_point expires = Clock::now() + settings.ttl;
+            it->second.done = true;
+            it->second.response = stored;
+            it->second.expires = expires;
+            stripe.order.emplace_back(expires, claim.key);
+            evict(stripe, Clock::now(), abandoned);
+        }
+    }
+    giveUp(abandoned);
+
+    for (crow::response *res : waiting)
+    {
+        fill(*res, stored);
+        res->end();
+    }
+}
+
+/**
+ * @brief Counters of replayed, joined and mismatched requests.
+ *
+ * @return std::string Prometheus text.
+ */
+std::string IdempotencyStore::metrics() const
+{
+    std::ostringstream out;
+    out << "# HELP taskmaster_idempotent_replayed_total Writes answered from a stored Idempotency-Key response.\n"
+        << "# TYPE taskmaster_idempotent_replayed_total counter\n"
+        << "taskmaster_idempotent_replayed_total " << replayed.load() << "\n"
+        << "# HELP taskmaster_idempotent_joined_total Writes that waited for the running write with the same key.\n"
+        << "# TYPE taskmaster_idempotent_joined_total counter\n"
+        << "taskmaster_idempotent_joined_total " << joined.load() << "\n"
+        << "# HELP taskmaster_idempotent_mismatched_total Idempotency-Keys reused with a different body.\n"
+        << "# TYPE taskmaster_idempotent_mismatched_total counter\n"
+        << "taskmaster_idempotent_mismatched_total " << mismatched.load() << "\n"
+        << "# HELP taskmaster_idempotent_abandoned_total Keyed writes given up after the pending timeout.\n"
+        << "# TYPE taskmaster_idempotent_abandoned_total counter\n"
+        << "taskmaster_idempotent_abandoned_total " << gaveUp.load() << "\n";
+    return out.str();
+}
+
+/**
+ * @brief Picks the stripe of a key from its hash.
+ *
+ * @param key The key.
+ * @return Stripe& The stripe.
+ */
+IdempotencyStore::Stripe &IdempotencyStore::stripeOf(const std::string &key)
+{
+    return stripes[std::hash<std::string>()(key) % STRIPES];
+}
+
+/**
+ * @brief Pops expired done keys and overdue running keys, then the oldest done keys
+ *        while over capacity, and only then the oldest running keys.
+ *
+ * Keys are appended as they complete, or are claimed, and all share the same timeout, so
+ * the front is always the next to expire. A done key whose entry was replaced since has
+ * a different expiry and is skipped; a running key leaves its list when it completes.
+ *
+ * @param stripe The stripe, locked by the caller.
+ * @param now The current time.
+ * @param abandoned Receives the requests of the writes given up.
+ */
+void IdempotencyStore::evict(Stripe &stripe, Clock::time_point now, std::vector<crow::response *> &abandoned)
+{
+    size_t limit = std::max<size_t>(1, settings.capacity / STRIPES);
+    auto dropDone = [&]()
+    {
+        auto it = stripe.entries.find(stripe.order.front().second);
+        if (it != stripe.entries.end() && it->second.done && it->second.expires == stripe.order.front().first)
+            stripe.entries.erase(it);
+        stripe.order.pop_front();
+    };
+    auto dropRunning = [&]()
+    {
+        auto it = stripe.entries.find(stripe.running.front());
+        abandoned.insert(abandoned.end(), it->second.waiting.begin(), it->second.waiting.end());
+        stripe.entries.erase(it);
+        stripe.running.pop_front();
+        gaveUp++;
+    };
+
+    while (!stripe.order.empty() && stripe.order.front().first <= now)
+        dropDone();
+    while (!stripe.running.empty() && stripe.entries.at(stripe.running.front()).started + settings.pending <= now)
+        dropRunning();
+
+    // Over capacity, stored responses go before writes that are still running
+    while (!stripe.order.empty() && stripe.entries.size() > limit)
+        dropDone();
+    while (!stripe.running.empty() && stripe.entries.size() > limit)
+        dropRunning();
+}
+
+/**
+ * @brief Answers the requests of given up writes.
+ *
+ * @param abandoned The requests.
+ */
+void IdempotencyStore::giveUp(const std::vector<crow::response *> &abandoned)
+{
+    for (crow::response *res : abandoned)
+    {
+        *res = crow::response(504, "Gave up waiting for the write with this Idempotency-Key");
+        res->end();
+    }
+}
+
+/**
+ * @brief Copies code, body and headers into a pending response.
+ *
+ * @param res The response.
+ * @param stored The stored response.
+ */
+void IdempotencyStore::fill(crow::response &res, const Stored &stored)
+{
+    res = crow::response(stored.code, stored.body);
+    res.headers = stored.headers;
+}
@@ -0,0 +1,186 @@
+/**
+ * @file IdempotencyStore.h
+ * @brief Declaration of the IdempotencyStore class.
+ *
+ * Clients retry writes that took too long. A write sent with an Idempotency-Key header
+ * runs once; repeats of it get the stored response back, and repeats that arrive while it
+ * is still running wait for it instead of running again.
+ */
+
+#ifndef IDEMPOTENCYSTORE_H
+#define IDEMPOTENCYSTORE_H
+
+#include "crow.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @class IdempotencyStore
+ * @brief Responses of keyed writes, kept for a while, in locked stripes.
+ *
+ * A key is first claimed with begin(). The claiming request runs the write and hands its
+ * response to complete(), which answers it and every request that joined the key in the
+ * meantime, then keeps the response until the TTL has passed. Each stripe holds at most
+ * capacity / STRIPES responses; past that the oldest are dropped.
+ *
+ * Responses 500 and above are not kept, so a retry after a failure or a 503 runs again.
+ * A write that has not completed after the pending timeout is given up: its waiting
+ * requests get 504 and the key is free again, so a lost completion can't block a key.
+ * Keys live in memory only and are lost on restart.
+ */
+class IdempotencyStore
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @brief Tuning knobs.
+     */
+    struct Settings
+    {
+        std::chrono::seconds ttl{std::chrono::hours(24)};   /**< How long a response is replayed */
+        size_t capacity = 100000;                           /**< Most responses kept */
+        std::chrono::seconds pending{std::chrono::minutes(5)}; /**< Longest wait for a running write */
+    };
+
+    /**
+     * @brief What begin() did with a request.
+     */
+    enum class Outcome
+    {
+        Run,        /**< Key claimed, run the write and call complete() */
+        Replayed,   /**< res holds the stored response, end it */
+        Joined,     /**< The write is running, complete() will answer res */
+        Mismatch    /**< The key was used with another body, res holds a 422, end it */
+    };
+
+    static constexpr size_t STRIPES = 16;   /**< Independently locked parts of the table */
+
+    /**
+     * @brief A key as claimed by one request. A write given up and claimed again gets a
+     *        new id, so the late completion of the first one is ignored.
+     */
+    struct Claim
+    {
+        std::string key;        /**< The key scoped to client, method and path, empty for a request without one */
+        uint64_t id = 0;        /**< Which claim of the key */
+
+        bool empty() const { return key.empty(); }
+    };
+
+    /**
+     * @brief Creates an empty store.
+     *
+     * @param settings Tuning knobs.
+     */
+    explicit IdempotencyStore(Settings settings);
+
+    /**
+     * @brief Claims a key, replays its response or waits for it.
+     *
+     * @param claim The key, scoped to the client, method and path of the request; its id is set on Run.
+     * @param body The request body, which repeats must send unchanged.
+     * @param res The pending response of the route handler.
+     * @return Outcome What the route must do next.
+     */
+    Outcome begin(Claim &claim, const std::string &body, crow::response &res);
+
+    /**
+     * @brief Answers every request waiting on a key and keeps the response.
+     *
+     * @param claim The claim made by begin().
+     * @param result The response of the write.
+     */
+    void complete(const Claim &claim, crow::response &result);
+
+    /**
+     * @brief Prometheus text for GET /metrics.
+     */
+    std::string metrics() const;
+
+private:
+    /**
+     * @brief A response as kept for replay.
+     */
+    struct Stored
+    {
+        int code = 0;                       /**< Status code */
+        std::string body;                   /**< Body */
+        crow::ci_map headers;               /**< Headers set by the route */
+    };
+
+    /**
+     * @brief A key, running or done.
+     */
+    struct Entry
+    {
+        size_t fingerprint = 0;                     /**< Hash of the request body */
+        uint64_t claim = 0;                         /**< Id of the claim running the write */
+        bool done = false;                          /**< The response is stored */
+        Stored response;                            /**< The response, once done */
+        Clock::time_point started{};                /**< When the key was claimed */
+        Clock::time_point expires{};                /**< When the response is dropped, once done */
+        std::vector<crow::response *> waiting;      /**< Requests to answer, while running */
+        std::list<std::string>::iterator running;   /**< Place in the stripe's running list, while running */
+    };
+
+    /**
+     * @brief A part of the table with its own lock.
+     */
+    struct Stripe
+    {
+        std::mutex mutex;                                                  /**< Guards the members below */
+        std::unordered_map<std::string, Entry> entries;                    /**< Keys, running or done */
+        std::deque<std::pair<Clock::time_point, std::string>> order;       /**< Done keys, oldest first */
+        std::list<std::string> running;                                    /**< Keys still running, oldest first */
+    };
+
+    /**
+     * @brief The stripe of a key.
+     */
+    Stripe &stripeOf(const std::string &key);
+
+    /**
+     * @brief Drops expired responses and the writes running for longer than the pending
+     *        timeout, then makes room beyond the stripe capacity, stored responses first.
+     *        Caller holds the lock.
+     *
+     * @param stripe The stripe.
+     * @param now The current time.
+     * @param abandoned Receives the requests of the writes given up, to answer once unlocked.
+     */
+    void evict(Stripe &stripe, Clock::time_point now, std::vector<crow::response *> &abandoned);
+
+    /**
+     * @brief Replays, joins or refuses a repeat of a claimed key. Caller holds the lock.
+     */
+    Outcome repeat(Entry &entry, size_t fingerprint, crow::response &res);
+
+    /**
+     * @brief Answers the requests of given up writes with 504.
+     */
+    static void giveUp(const std::vector<crow::response *> &abandoned);
+
+    /**
+     * @brief Copies a stored response into a pending one.
+     */
+    static void fill(crow::response &res, const Stored &stored);
+
+    Settings settings;                              /**< Tuning knobs */
+    std::array<Stripe, STRIPES> stripes;            /**< The table */
+    std::atomic<uint64_t> replayed{0};              /**< Requests answered from a stored response */
+    std::atomic<uint64_t> joined{0};                /**< Requests that waited for a running write */
+    std::atomic<uint64_t> mismatched{0};            /**< Keys reused with another body */
+    std::atomic<uint64_t> gaveUp{0};                /**< Writes given up after the pending timeout */
+    std::atomic<uint64_t> claims{0};                /**< Last claim id handed out */
+};
+
+#endif // IDEMPOTENCYSTORE_H
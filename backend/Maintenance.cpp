@@ -0,0 +1,428 @@
+/**
+ * @file Maintenance.cpp
+ * @brief Implementation of the Maintenance class.
+ */
+
+#include "Maintenance.h"
+#include "Rank.h"
+#include <ctime>
+#include <exception>
+#include <future>
+#include <iostream>
+#include <sys/stat.h>
+#include <vector>
+
+namespace {
+
+/**
+ * @brief Current UTC time formatted like SQLite's datetime('now').
+ *
+ * @return std::string The timestamp.
+ */
+std::string now()
+{
+    time_t t = time(0);
+    char buffer[20];
+    strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", gmtime(&t));
+    return std::string(buffer);
+}
+
+/**
+ * @brief Reads a single integer PRAGMA.
+ *
+ * @param db The connection.
+ * @param pragma The PRAGMA statement.
+ * @return long long The value, or -1 on error.
+ */
+long long pragmaValue(sqlite3 *db, const char *pragma)
+{
+    sqlite3_stmt *stmt;
+    long long value = -1;
+    if (sqlite3_prepare_v2(db, pragma, -1, &stmt, nullptr) == SQLITE_OK)
+    {
+        if (sqlite3_step(stmt) == SQLITE_ROW)
+            value = sqlite3_column_int64(stmt, 0);
+        sqlite3_finalize(stmt);
+    }
+    return value;
+}
+
+/**
+ * @brief Size of a file on disk.
+ *
+ * @param path The file.
+ * @return long long The size in bytes, 0 if it does not exist.
+ */
+long long fileSize(const std::string &path)
+{
+    struct stat info;
+    return stat(path.c_str(), &info) == 0 ? static_cast<long long>(info.st_size) : 0;
+}
+
+} // namespace
+
+/**
+ * @brief Creates the maintenance loop.
+ */
+Maintenance::Maintenance(std::string path, DbExecutor &writer, DbExecutor &readers, Settings settings)
+    : path(std::move(path)), writer(writer), readers(readers), settings(settings) {}
+
+/**
+ * @brief Stops and joins the background thread.
+ */
+Maintenance::~Maintenance()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    if (thread.joinable())
+        thread.join();
+}
+
+/**
+ * @brief Sets the callback run after a column was re-ranked.
+ *
+ * @param listener Receives the project ID.
+ */
+void Maintenance::onRanksRebalanced(std::function<void(int)> listener)
+{
+    ranksRebalanced = std::move(listener);
+}
+
+/**
+ * @brief Sets the callback run for each archived task.
+ *
+ * @param listener Receives the connection, the task ID and its project ID.
+ */
+void Maintenance::onTaskArchived(std::function<void(sqlite3 *, int, int)> listener)
+{
+    taskArchived = std::move(listener);
+}
+
+/**
+ * @brief Starts the background thread, which runs a round every settings.interval.
+ */
+void Maintenance::start()
+{
+    thread = std::thread([this]
+                         {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!wake.wait_for(lock, settings.interval, [this] { return stopping; }))
+        {
+            lock.unlock();
+            runOnce();
+            lock.lock();
+        } });
+}
+
+/**
+ * @brief One maintenance round: purge, archive, rebalance, vacuum, then checkpoint if the server is quiet.
+ */
+void Maintenance::runOnce()
+{
+    bool wasQuiet = quiet();
+    // Read before the jobs below, which reset the writer's idle time
+    bool longIdle = wasQuiet &&
+                    readers.sinceLastPost() > settings.quietPeriod * 10 &&
+                    writer.sinceLastPost() > settings.quietPeriod * 10;
+    purgeDeletedComments();
+    archiveCompletedTasks();
+    rebalanceRanks();
+    incrementalVacuum();
+    if (wasQuiet)
+        checkpoint(longIdle);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    lastRun = now();
+}
+
+/**
+ * @brief Purges old soft-deleted comments in chunks of settings.purgeChunk rows.
+ *
+ * Each chunk is its own job and transaction, so user writes queued meanwhile run in between.
+ */
+void Maintenance::purgeDeletedComments()
+{
+    std::string window = "-" + std::to_string(settings.commentRetentionDays) + " days";
+    int deleted = settings.purgeChunk;
+
+    while (deleted == settings.purgeChunk)
+    {
+        deleted = 0;
+        bool ran = runOnWriter([&](sqlite3 *db)
+                               {
+            sqlite3_stmt *stmt;
+            const char *sql = R"(
+                DELETE FROM comments WHERE id IN (
+                    SELECT id FROM comments
+                    WHERE status = 'deleted' AND deleted_at < datetime('now', ?)
+                    LIMIT ?);
+            )";
+            if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK)
+                return;
+            sqlite3_bind_text(stmt, 1, window.c_str(), -1, SQLITE_TRANSIENT);
+            sqlite3_bind_int(stmt, 2, settings.purgeChunk);
+            if (sqlite3_step(stmt) == SQLITE_DONE)
+                deleted = sqlite3_changes(db);
+            sqlite3_finalize(stmt); });
+
+        if (!ran)
+            return;
+        std::lock_guard<std::mutex> lock(mutex);
+        purgedComments += deleted;
+        if (stopping)
+            return;
+    }
+}
+
+/**
+ * @brief Moves old completed tasks and their comments to the archive tables in chunks
+ * of settings.archiveChunk tasks.
+ *
+ * The due tasks are found through the partial idx_tasks_completed. Each chunk copies
+ * them to tasks_archive and comments_archive and deletes them from tasks, which
+ * cascades to their comments, in one transaction, so a task is always in exactly one
+ * of the two tables.
+ */
+void Maintenance::archiveCompletedTasks()
+{
+    if (settings.archiveAfterDays <= 0)
+        return;
+    std::string window = "-" + std::to_string(settings.archiveAfterDays) + " days";
+    int moved = settings.archiveChunk;
+
+    while (moved == settings.archiveChunk)
+    {
+        moved = 0;
+        bool ran = runOnWriter([&](sqlite3 *db)
+                               {
+            std::vector<std::pair<int, int>> tasks;
+            sqlite3_stmt *stmt;
+            const char *select = R"(
+                SELECT id, IFNULL(project_id, 0) FROM tasks INDEXED BY idx_tasks_completed
+                WHERE completed_at IS NOT NULL AND completed_at < datetime('now', ?) AND status = 'completed'
+                ORDER BY completed_at LIMIT ?;
+            )";
+            if (sqlite3_prepare_v2(db, select, -1, &stmt, nullptr) != SQLITE_OK)
+                return;
+            sqlite3_bind_text(stmt, 1, window.c_str(), -1, SQLITE_TRANSIENT);
+            sqlite3_bind_int(stmt, 2, settings.archiveChunk);
+            while (sqlite3_step(stmt) == SQLITE_ROW)
+                tasks.emplace_back(sqlite3_column_int(stmt, 0), sqlite3_column_int(stmt, 1));
+            sqlite3_finalize(stmt);
+            if (tasks.empty())
+                return;
+
+            const char *move[] = {
+                R"(INSERT INTO tasks_archive (id, title, description, due_date, priority, status, project_id,
+                                              comment_count, last_activity, rank, completed_at, archived_at)
+                   SELECT id, title, description, due_date, priority, status, project_id,
+                          comment_count, last_activity, rank, completed_at, datetime('now')
+                   FROM tasks WHERE id = ?;)",
+                R"(INSERT INTO comments_archive (id, body, date, status, user_id, task_id, deleted_at)
+                   SELECT id, body, date, status, user_id, task_id, deleted_at FROM comments WHERE task_id = ?;)",
+                "DELETE FROM tasks WHERE id = ?;"};
+            sqlite3_stmt *steps[3] = {};
+            bool ok = sqlite3_exec(db, "BEGIN IMMEDIATE;", nullptr, nullptr, nullptr) == SQLITE_OK;
+            for (int i = 0; ok && i < 3; i++)
+                ok = sqlite3_prepare_v2(db, move[i], -1, &steps[i], nullptr) == SQLITE_OK;
+            for (size_t t = 0; ok && t < tasks.size(); t++)
+            {
+                for (int i = 0; ok && i < 3; i++)
+                {
+                    sqlite3_bind_int(steps[i], 1, tasks[t].first);
+                    ok = sqlite3_step(steps[i]) == SQLITE_DONE;
+                    sqlite3_reset(steps[i]);
+                }
+            }
+            for (sqlite3_stmt *step : steps)
+                sqlite3_finalize(step);
+            if (!ok || sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr) != SQLITE_OK)
+            {
+                std::cerr << "Archiving tasks failed: " << sqlite3_errmsg(db) << std::endl;
+                sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
+                return;
+            }
+
+            moved = static_cast<int>(tasks.size());
+            if (taskArchived)
+            {
+                for (const auto &task : tasks)
+                    taskArchived(db, task.first, task.second);
+            } });
+
+        if (!ran)
+            return;
+        std::lock_guard<std::mutex> lock(mutex);
+        archivedTasks += moved;
+        if (stopping)
+            return;
+    }
+}
+
+/**
+ * @brief Re-ranks the board columns found through idx_tasks_rank_rebalance.
+ *
+ * Each column is its own job and transaction. A column that cannot be fixed stops the
+ * round, so it is retried next round instead of spinning.
+ */
+void Maintenance::rebalanceRanks()
+{
+    bool found = true;
+    while (found)
+    {
+        found = false;
+        bool ran = runOnWriter([&](sqlite3 *db)
+                               {
+            // Same condition as the partial index, so only its few entries are read
+            sqlite3_stmt *stmt;
+            const char *sql = R"(
+                SELECT project_id, status FROM tasks INDEXED BY idx_tasks_rank_rebalance
+                WHERE (rank IS NULL OR length(rank) > 24) AND project_id IS NOT NULL AND status IS NOT NULL
+                LIMIT 1;
+            )";
+            if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK)
+                return;
+            int projectID = 0;
+            std::string status;
+            if (sqlite3_step(stmt) == SQLITE_ROW)
+            {
+                found = true;
+                projectID = sqlite3_column_int(stmt, 0);
+                status = (const char *)sqlite3_column_text(stmt, 1);
+            }
+            sqlite3_finalize(stmt);
+            if (found)
+                found = ::rebalanceRanks(db, projectID, status) > 0;
+            if (found && ranksRebalanced)
+                ranksRebalanced(projectID); });
+
+        if (!ran)
+            return;
+        std::lock_guard<std::mutex> lock(mutex);
+        rebalancedColumns += found;
+        if (stopping)
+            return;
+    }
+}
+
+/**
+ * @brief Releases free pages in chunks of settings.vacuumChunk pages.
+ */
+void Maintenance::incrementalVacuum()
+{
+    long long freePages = 1;
+    while (freePages > 0)
+    {
+        long long released = 0;
+        bool ran = runOnWriter([&](sqlite3 *db)
+                               {
+            long long before = pragmaValue(db, "PRAGMA freelist_count;");
+            std::string sql = "PRAGMA incremental_vacuum(" + std::to_string(settings.vacuumChunk) + ");";
+            sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr);
+            freePages = pragmaValue(db, "PRAGMA freelist_count;");
+            released = before - freePages; });
+
+        // Nothing released means auto_vacuum is not INCREMENTAL, stop instead of spinning
+        if (!ran || released <= 0)
+            return;
+        std::lock_guard<std::mutex> lock(mutex);
+        vacuumedPages += released;
+        if (stopping)
+            return;
+    }
+}
+
+/**
+ * @brief Copies WAL frames back into the database file.
+ *
+ * A PASSIVE checkpoint never waits on readers or writers. After a long idle period the
+ * WAL is also truncated so it does not keep its high-water size on disk.
+ *
+ * @param longIdle true if both pools were idle for ten quiet periods before the round.
+ */
+void Maintenance::checkpoint(bool longIdle)
+{
+    int log = 0;
+    int done = 0;
+    bool ran = runOnWriter([&](sqlite3 *db)
+                           { sqlite3_wal_checkpoint_v2(db, nullptr, longIdle ? SQLITE_CHECKPOINT_TRUNCATE : SQLITE_CHECKPOINT_PASSIVE, &log, &done); });
+    if (!ran)
+        return;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    walFrames = log;
+    checkpointedFrames = done;
+    lastCheckpoint = now();
+}
+
+/**
+ * @brief True when no job was submitted to either pool for the quiet period.
+ */
+bool Maintenance::quiet() const
+{
+    return readers.inFlight() == 0 && writer.inFlight() == 0 &&
+           readers.sinceLastPost() > settings.quietPeriod &&
+           writer.sinceLastPost() > settings.quietPeriod;
+}
+
+/**
+ * @brief Runs a job on the write pool and blocks until it finished.
+ *
+ * The promise is set even when the job throws, so the maintenance thread is never left
+ * waiting on it.
+ *
+ * @param job The job to run.
+ * @return true if the job ran, false if the pool rejected it or the job threw.
+ */
+bool Maintenance::runOnWriter(const DbExecutor::Job &job)
+{
+    auto done = std::make_shared<std::promise<bool>>();
+    std::future<bool> finished = done->get_future();
+    if (!writer.post([&job, done](sqlite3 *db)
+                     {
+            try
+            {
+                job(db);
+            }
+            catch (const std::exception &e)
+            {
+                std::cerr << "Maintenance job failed: " << e.what() << std::endl;
+                done->set_value(false);
+                return;
+            }
+            done->set_value(true); }))
+        return false;
+    return finished.get();
+}
+
+/**
+ * @brief Reports the database size, free pages, WAL state and maintenance totals.
+ *
+ * @param db A connection to read the statistics from.
+ * @return crow::json::wvalue The report.
+ */
+crow::json::wvalue Maintenance::report(sqlite3 *db) const
+{
+    long long pageSize = pragmaValue(db, "PRAGMA page_size;");
+    crow::json::wvalue result;
+    result["file_size"] = fileSize(path);
+    result["wal_size"] = fileSize(path + "-wal");
+    result["page_size"] = pageSize;
+    result["page_count"] = pragmaValue(db, "PRAGMA page_count;");
+    result["free_pages"] = pragmaValue(db, "PRAGMA freelist_count;");
+    result["auto_vacuum"] = pragmaValue(db, "PRAGMA auto_vacuum;") == 2 ? "incremental" : "off";
+
+    std::lock_guard<std::mutex> lock(mutex);
+    result["wal_frames"] = walFrames;
+    result["checkpoint_lag_frames"] = walFrames - checkpointedFrames;
+    result["last_checkpoint"] = lastCheckpoint;
+    result["purged_comments"] = purgedComments;
+    result["archived_tasks"] = archivedTasks;
+    result["vacuumed_pages"] = vacuumedPages;
+    result["rebalanced_columns"] = rebalancedColumns;
+    result["last_run"] = lastRun;
+    return result;
+}
@@ -0,0 +1,159 @@
+/**
+ * @file Maintenance.h
+ * @brief Declaration of the Maintenance class.
+ *
+ * Background upkeep of taskmaster.db: purging old soft-deleted comments, moving long
+ * completed tasks to the archive tables, respacing card ranks that grew too long, giving
+ * free pages back to the file system and checkpointing the WAL while the server is quiet.
+ */
+
+#ifndef MAINTENANCE_H
+#define MAINTENANCE_H
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "DbExecutor.h"
+
+/**
+ * @class Maintenance
+ * @brief Runs small database maintenance jobs on a background thread.
+ *
+ * All work goes through the write pool in small jobs (a few hundred rows or pages each),
+ * so user writes are queued in between and no job holds the write lock for long. The
+ * database must use auto_vacuum=INCREMENTAL for the vacuum step to shrink the file.
+ */
+class Maintenance
+{
+public:
+    /**
+     * @brief Tuning knobs of the maintenance loop.
+     */
+    struct Settings
+    {
+        int commentRetentionDays = 30;                       /**< Age after which soft-deleted comments are purged */
+        int purgeChunk = 500;                                /**< Comments purged per transaction */
+        int archiveAfterDays = 90;                           /**< Days a task stays completed before it is archived, 0 never */
+        int archiveChunk = 200;                              /**< Tasks archived per transaction */
+        int vacuumChunk = 256;                               /**< Pages freed per incremental_vacuum step */
+        std::chrono::seconds interval{60};                   /**< Time between two maintenance rounds */
+        std::chrono::milliseconds quietPeriod{2000};         /**< Idle time before a round may checkpoint */
+    };
+
+    /**
+     * @brief Creates the maintenance loop, call start() to run it.
+     *
+     * @param path Path of the database file, used for size reporting.
+     * @param writer Pool that runs the maintenance jobs.
+     * @param readers Pool watched together with writer to detect quiet periods.
+     * @param settings Tuning knobs.
+     */
+    Maintenance(std::string path, DbExecutor &writer, DbExecutor &readers, Settings settings);
+
+    /**
+     * @brief Stops the background thread.
+     */
+    ~Maintenance();
+
+    /**
+     * @brief Sets a callback run on the write pool after a project's column got new ranks.
+     *
+     * Must be called before start().
+     *
+     * @param listener Receives the project ID.
+     */
+    void onRanksRebalanced(std::function<void(int)> listener);
+
+    /**
+     * @brief Sets a callback run on the write pool for each task moved to tasks_archive.
+     *
+     * Must be called before start().
+     *
+     * @param listener Receives the connection that archived it, the task ID and its project ID.
+     */
+    void onTaskArchived(std::function<void(sqlite3 *, int, int)> listener);
+
+    /**
+     * @brief Starts the background thread.
+     */
+    void start();
+
+    /**
+     * @brief Runs one maintenance round right away, on the calling thread.
+     */
+    void runOnce();
+
+    /**
+     * @brief Reports file size, free pages, WAL checkpoint lag and purge totals.
+     *
+     * @param db A connection to read the database statistics from.
+     * @return crow::json::wvalue The report.
+     */
+    crow::json::wvalue report(sqlite3 *db) const;
+
+private:
+    /**
+     * @brief Deletes soft-deleted comments past the retention window, one chunk per job.
+     */
+    void purgeDeletedComments();
+
+    /**
+     * @brief Moves tasks completed longer than the archive window to tasks_archive, one chunk per job.
+     */
+    void archiveCompletedTasks();
+
+    /**
+     * @brief Gives new rank keys to board columns with long or missing ranks, one column per job.
+     */
+    void rebalanceRanks();
+
+    /**
+     * @brief Gives free pages back to the file system, one chunk per job.
+     */
+    void incrementalVacuum();
+
+    /**
+     * @brief Checkpoints the WAL, truncating it when the server has been idle long enough.
+     *
+     * @param longIdle true to truncate the WAL.
+     */
+    void checkpoint(bool longIdle);
+
+    /**
+     * @brief True when neither pool has seen a job for the quiet period.
+     */
+    bool quiet() const;
+
+    /**
+     * @brief Runs a job on the write pool and waits for it.
+     *
+     * @param job The job to run.
+     * @return true if the job ran, false if the pool rejected it or the job threw.
+     */
+    bool runOnWriter(const DbExecutor::Job &job);
+
+    std::string path;                                        /**< Database file */
+    DbExecutor &writer;                                      /**< Pool running the jobs */
+    DbExecutor &readers;                                     /**< Pool watched for activity */
+    Settings settings;                                       /**< Tuning knobs */
+    std::function<void(int)> ranksRebalanced;                /**< Called with each re-ranked project */
+    std::function<void(sqlite3 *, int, int)> taskArchived;   /**< Called with each archived task and its project */
+
+    mutable std::mutex mutex;                                /**< Guards the fields below */
+    std::condition_variable wake;                            /**< Wakes the loop early on shutdown */
+    bool stopping = false;                                   /**< Set by the destructor */
+    std::thread thread;                                      /**< The background loop */
+    long long purgedComments = 0;                            /**< Comments purged since start */
+    long long archivedTasks = 0;                             /**< Tasks archived since start */
+    long long vacuumedPages = 0;                             /**< Pages released since start */
+    long long rebalancedColumns = 0;                         /**< Board columns re-ranked since start */
+    int walFrames = 0;                                       /**< WAL frames at the last checkpoint */
+    int checkpointedFrames = 0;                              /**< Frames copied back at the last checkpoint */
+    std::string lastRun;                                     /**< Time of the last finished round */
+    std::string lastCheckpoint;                              /**< Time of the last checkpoint */
+};
+
+#endif // MAINTENANCE_H
@@ -0,0 +1,151 @@
+/**
+ * @file MembershipIndex.cpp
+ * @brief Implementation of the MembershipIndex class.
+ */
+
+#include "MembershipIndex.h"
+#include <algorithm>
+#include <mutex>
+
+/**
+ * @brief Reads all memberships.
+ *
+ * @param db The connection.
+ * @param replace false to keep what was loaded from other shards.
+ * @return bool false if the query failed.
+ */
+bool MembershipIndex::load(sqlite3 *db, bool replace)
+{
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(db, "SELECT user_id, project_id FROM user_projects;", -1, &stmt, nullptr) != SQLITE_OK)
+        return false;
+
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    if (replace)
+    {
+        userProjects.clear();
+        projectUsers.clear();
+    }
+    while (sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        userProjects[sqlite3_column_int(stmt, 0)].insert(sqlite3_column_int(stmt, 1));
+        projectUsers[sqlite3_column_int(stmt, 1)].insert(sqlite3_column_int(stmt, 0));
+    }
+    sqlite3_finalize(stmt);
+    return true;
+}
+
+/**
+ * @brief Records that a user joined a project.
+ *
+ * @param userID The user ID.
+ * @param projectID The project ID.
+ */
+void MembershipIndex::add(int userID, int projectID)
+{
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    userProjects[userID].insert(projectID);
+    projectUsers[projectID].insert(userID);
+}
+
+/**
+ * @brief Drops a user's memberships.
+ *
+ * @param userID The user ID.
+ */
+void MembershipIndex::removeUser(int userID)
+{
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    auto it = userProjects.find(userID);
+    if (it == userProjects.end())
+        return;
+    for (int projectID : it->second)
+    {
+        auto members = projectUsers.find(projectID);
+        if (members != projectUsers.end() && members->second.erase(userID) && members->second.empty())
+            projectUsers.erase(members);
+    }
+    userProjects.erase(it);
+}
+
+/**
+ * @brief Drops a project's memberships.
+ *
+ * @param projectID The project ID.
+ */
+void MembershipIndex::removeProject(int projectID)
+{
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    auto it = projectUsers.find(projectID);
+    if (it == projectUsers.end())
+        return;
+    for (int userID : it->second)
+    {
+        auto projects = userProjects.find(userID);
+        if (projects != userProjects.end() && projects->second.erase(projectID) && projects->second.empty())
+            userProjects.erase(projects);
+    }
+    projectUsers.erase(it);
+}
+
+/**
+ * @brief Drops every membership.
+ */
+void MembershipIndex::clear()
+{
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    userProjects.clear();
+    projectUsers.clear();
+}
+
+/**
+ * @brief Looks a membership up in the user's set.
+ *
+ * @param userID The user ID.
+ * @param projectID The project ID.
+ * @return bool true if the user is a member of the project.
+ */
+bool MembershipIndex::isMember(int userID, int projectID) const
+{
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    auto it = userProjects.find(userID);
+    return it != userProjects.end() && it->second.count(projectID) > 0;
+}
+
+/**
+ * @brief Copies a user's projects out of the index.
+ *
+ * @param userID The user ID.
+ * @return std::vector<int> Project IDs in ascending order.
+ */
+std::vector<int> MembershipIndex::projectsOf(int userID) const
+{
+    std::vector<int> ids;
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        auto it = userProjects.find(userID);
+        if (it != userProjects.end())
+            ids.assign(it->second.begin(), it->second.end());
+    }
+    std::sort(ids.begin(), ids.end());
+    return ids;
+}
+
+/**
+ * @brief Copies a project's members out of the index.
+ *
+ * @param projectID The project ID.
+ * @return std::vector<int> User IDs in ascending order.
+ */
+std::vector<int> MembershipIndex::membersOf(int projectID) const
+{
+    std::vector<int> ids;
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        auto it = projectUsers.find(projectID);
+        if (it != projectUsers.end())
+            ids.assign(it->second.begin(), it->second.end());
+    }
+    std::sort(ids.begin(), ids.end());
+    return ids;
+}
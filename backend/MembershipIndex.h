@@ -0,0 +1,86 @@
+/**
+ * @file MembershipIndex.h
+ * @brief Declaration of the MembershipIndex class.
+ *
+ * Keeps the user_projects table in memory in both directions, so "which projects is
+ * this user in", "who works on this project" and "may this user touch this project"
+ * are answered without a join.
+ */
+
+#ifndef MEMBERSHIPINDEX_H
+#define MEMBERSHIPINDEX_H
+
+#include <sqlite3.h>
+#include <shared_mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+/**
+ * @class MembershipIndex
+ * @brief The projects of every user and the members of every project.
+ *
+ * Built once with load(), from every shard, then kept up to date by the write pools:
+ * add() after a committed membership, removeUser() and removeProject() once a delete
+ * has gone through. Checks and lookups take a shared lock and cost O(1) per entry.
+ */
+class MembershipIndex
+{
+public:
+    /**
+     * @brief Reads all memberships of a database file.
+     *
+     * @param db The connection.
+     * @param replace false to add to the current contents, for the second and later shards.
+     * @return bool false if the query failed.
+     */
+    bool load(sqlite3 *db, bool replace = true);
+
+    /**
+     * @brief Records that a user joined a project.
+     */
+    void add(int userID, int projectID);
+
+    /**
+     * @brief Drops a deleted user's memberships.
+     */
+    void removeUser(int userID);
+
+    /**
+     * @brief Drops a deleted project's memberships.
+     */
+    void removeProject(int projectID);
+
+    /**
+     * @brief Drops every membership.
+     */
+    void clear();
+
+    /**
+     * @brief Whether a user is a member of a project.
+     */
+    bool isMember(int userID, int projectID) const;
+
+    /**
+     * @brief The projects of a user.
+     *
+     * @param userID The user ID.
+     * @return std::vector<int> Project IDs in ascending order.
+     */
+    std::vector<int> projectsOf(int userID) const;
+
+    /**
+     * @brief The members of a project.
+     *
+     * @param projectID The project ID.
+     * @return std::vector<int> User IDs in ascending order.
+     */
+    std::vector<int> membersOf(int projectID) const;
+
+private:
+    std::unordered_map<int, std::unordered_set<int>> userProjects;    /**< Projects of each user */
+    std::unordered_map<int, std::unordered_set<int>> projectUsers;    /**< Members of each project */
+    mutable std::shared_mutex mutex;                                  /**< Readers share, writers are exclusive */
+};
+
+#endif // MEMBERSHIPINDEX_H
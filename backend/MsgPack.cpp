@@ -0,0 +1,227 @@
+/**
+ * @file MsgPack.cpp
+ * @brief Implementation of the MsgPackWriter class.
+ */
+
+#include "MsgPack.h"
+#include <utility>
+
+/**
+ * @brief Writes nil.
+ */
+void MsgPackWriter::nil()
+{
+    buffer.push_back(static_cast<char>(0xc0));
+}
+
+/**
+ * @brief Writes true or false.
+ *
+ * @param value The value.
+ */
+void MsgPackWriter::boolean(bool value)
+{
+    buffer.push_back(static_cast<char>(value ? 0xc3 : 0xc2));
+}
+
+/**
+ * @brief Writes an integer as a fixint or the narrowest int/uint type.
+ *
+ * @param value The value.
+ */
+void MsgPackWriter::integer(int64_t value)
+{
+    if (value >= 0)
+    {
+        if (value < 128) buffer.push_back(static_cast<char>(value));
+        else if (value <= UINT8_MAX) typed(0xcc, value, 1);
+        else if (value <= UINT16_MAX) typed(0xcd, value, 2);
+        else if (value <= UINT32_MAX) typed(0xce, value, 4);
+        else typed(0xcf, value, 8);
+    }
+    else
+    {
+        if (value >= -32) buffer.push_back(static_cast<char>(value));
+        else if (value >= INT8_MIN) typed(0xd0, static_cast<uint8_t>(value), 1);
+        else if (value >= INT16_MIN) typed(0xd1, static_cast<uint16_t>(value), 2);
+        else if (value >= INT32_MIN) typed(0xd2, static_cast<uint32_t>(value), 4);
+        else typed(0xd3, static_cast<uint64_t>(value), 8);
+    }
+}
+
+/**
+ * @brief Writes a UTF-8 string.
+ *
+ * @param value The string.
+ */
+void MsgPackWriter::string(std::string_view value)
+{
+    size_t n = value.size();
+    if (n < 32) buffer.push_back(static_cast<char>(0xa0 | n));
+    else if (n <= UINT8_MAX) typed(0xd9, n, 1);
+    else if (n <= UINT16_MAX) typed(0xda, n, 2);
+    else typed(0xdb, n, 4);
+    buffer.append(value.data(), n);
+}
+
+/**
+ * @brief Writes a map header.
+ *
+ * @param n Number of key/value pairs.
+ */
+void MsgPackWriter::mapHeader(uint32_t n)
+{
+    if (n < 16) buffer.push_back(static_cast<char>(0x80 | n));
+    else if (n <= UINT16_MAX) typed(0xde, n, 2);
+    else typed(0xdf, n, 4);
+}
+
+/**
+ * @brief Writes an array header.
+ *
+ * @param n Number of values.
+ */
+void MsgPackWriter::arrayHeader(uint32_t n)
+{
+    if (n < 16) buffer.push_back(static_cast<char>(0x90 | n));
+    else if (n <= UINT16_MAX) typed(0xdc, n, 2);
+    else typed(0xdd, n, 4);
+}
+
+/**
+ * @brief Opens an array of unknown length with a 32-bit header patched by endArray().
+ *
+ * @return size_t Position of the header.
+ */
+size_t MsgPackWriter::beginArray()
+{
+    size_t at = buffer.size();
+    typed(0xdd, 0, 4);
+    return at;
+}
+
+/**
+ * @brief Stores the final length in the header written by beginArray().
+ *
+ * @param at Position of the header.
+ * @param n Number of values.
+ */
+void MsgPackWriter::endArray(size_t at, uint32_t n)
+{
+    for (int i = 0; i < 4; i++)
+        buffer[at + 1 + i] = static_cast<char>(n >> (24 - 8 * i));
+}
+
+/**
+ * @brief Writes a row as a map from field names to column values.
+ *
+ * @param stmt The statement positioned on a row.
+ * @param fields One field per column.
+ * @param count Number of fields.
+ */
+void MsgPackWriter::row(sqlite3_stmt *stmt, const Field *fields, size_t count)
+{
+    mapHeader(static_cast<uint32_t>(count));
+    for (size_t col = 0; col < count; col++)
+    {
+        string(fields[col].name);
+        int i = static_cast<int>(col);
+        bool isNull = sqlite3_column_type(stmt, i) == SQLITE_NULL;
+        switch (fields[col].kind)
+        {
+        case Kind::Integer:
+            integer(sqlite3_column_int64(stmt, i));
+            break;
+        case Kind::NullableText:
+            if (isNull)
+            {
+                nil();
+                break;
+            }
+            [[fallthrough]];
+        case Kind::Text:
+        {
+            const char *text = reinterpret_cast<const char *>(sqlite3_column_text(stmt, i));
+            string(std::string_view(text ? text : "", text ? sqlite3_column_bytes(stmt, i) : 0));
+            break;
+        }
+        }
+    }
+}
+
+/**
+ * @brief Appends encoded values as they are.
+ *
+ * @param bytes The encoded values.
+ */
+void MsgPackWriter::raw(std::string_view bytes)
+{
+    buffer.append(bytes.data(), bytes.size());
+}
+
+/**
+ * @brief Decodes a fixarray, array 16 or array 32 header.
+ *
+ * @param data The document.
+ * @param n Receives the number of values.
+ * @param size Receives the header length.
+ * @return bool false if data does not start with an array header.
+ */
+bool MsgPackWriter::readArrayHeader(std::string_view data, uint32_t &n, size_t &size)
+{
+    if (data.empty())
+        return false;
+    uint8_t type = static_cast<uint8_t>(data[0]);
+    if ((type & 0xf0) == 0x90)
+    {
+        n = type & 0x0f;
+        size = 1;
+        return true;
+    }
+    size_t width = type == 0xdc ? 2 : type == 0xdd ? 4 : 0;
+    if (width == 0 || data.size() < 1 + width)
+        return false;
+    n = 0;
+    for (size_t i = 1; i <= width; i++)
+        n = (n << 8) | static_cast<uint8_t>(data[i]);
+    size = 1 + width;
+    return true;
+}
+
+/**
+ * @brief The encoded bytes.
+ */
+const std::string &MsgPackWriter::data() const
+{
+    return buffer;
+}
+
+/**
+ * @brief Moves the encoded bytes out.
+ */
+std::string MsgPackWriter::take()
+{
+    return std::exchange(buffer, std::string());
+}
+
+/**
+ * @brief Empties the buffer without freeing it.
+ */
+void MsgPackWriter::clear()
+{
+    buffer.clear();
+}
+
+/**
+ * @brief Appends a type byte and a big-endian value.
+ *
+ * @param type The type byte.
+ * @param value The value.
+ * @param bytes Width of the value, 1, 2, 4 or 8.
+ */
+void MsgPackWriter::typed(uint8_t type, uint64_t value, int bytes)
+{
+    buffer.push_back(static_cast<char>(type));
+    for (int i = bytes - 1; i >= 0; i--)
+        buffer.push_back(static_cast<char>(value >> (8 * i)));
+}
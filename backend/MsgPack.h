@@ -0,0 +1,148 @@
+/**
+ * @file MsgPack.h
+ * @brief Declaration of the MsgPackWriter class.
+ *
+ * A MessagePack encoder for the list routes. Clients that send
+ * "Accept: application/msgpack" get the same documents as the JSON routes, encoded
+ * straight from the SQLite rows without building a crow::json::wvalue first.
+ */
+
+#ifndef MSGPACK_H
+#define MSGPACK_H
+
+#include <sqlite3.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/**
+ * @brief Content type of MessagePack responses.
+ */
+constexpr const char *MSGPACK_CONTENT_TYPE = "application/msgpack";
+
+/**
+ * @class MsgPackWriter
+ * @brief Appends MessagePack values to a byte buffer.
+ *
+ * Every value uses the smallest encoding that holds it. Arrays whose length is only
+ * known at the end are opened with beginArray() and closed with endArray().
+ */
+class MsgPackWriter
+{
+public:
+    /**
+     * @brief How a column is encoded, matching the JSON the routes return for it.
+     */
+    enum class Kind
+    {
+        Integer,        /**< sqlite3_column_int64 */
+        Text,           /**< A string, NULL becomes "" */
+        NullableText    /**< A string, NULL becomes nil */
+    };
+
+    /**
+     * @brief A column of a row and the key it is written under.
+     */
+    struct Field
+    {
+        const char *name;   /**< Key in the map */
+        Kind kind;          /**< Encoding of the value */
+    };
+
+    /**
+     * @brief Writes nil.
+     */
+    void nil();
+
+    /**
+     * @brief Writes a boolean.
+     */
+    void boolean(bool value);
+
+    /**
+     * @brief Writes an integer.
+     */
+    void integer(int64_t value);
+
+    /**
+     * @brief Writes a string.
+     */
+    void string(std::string_view value);
+
+    /**
+     * @brief Writes the header of a map with n key/value pairs, which must follow.
+     */
+    void mapHeader(uint32_t n);
+
+    /**
+     * @brief Writes the header of an array with n values, which must follow.
+     */
+    void arrayHeader(uint32_t n);
+
+    /**
+     * @brief Opens an array whose length is not known yet.
+     *
+     * @return size_t Position to pass to endArray().
+     */
+    size_t beginArray();
+
+    /**
+     * @brief Closes an array opened with beginArray().
+     *
+     * @param at The position returned by beginArray().
+     * @param n Number of values written since.
+     */
+    void endArray(size_t at, uint32_t n);
+
+    /**
+     * @brief Writes the current row of a statement as a map.
+     *
+     * @param stmt The statement positioned on a row.
+     * @param fields One field per column, in column order.
+     * @param count Number of fields.
+     */
+    void row(sqlite3_stmt *stmt, const Field *fields, size_t count);
+
+    /**
+     * @brief Appends values that are already encoded.
+     *
+     * @param bytes The encoded values.
+     */
+    void raw(std::string_view bytes);
+
+    /**
+     * @brief Reads the array header at the start of a document.
+     *
+     * @param data The document.
+     * @param n Receives the number of values.
+     * @param size Receives the length of the header in bytes.
+     * @return bool false if the document does not start with an array.
+     */
+    static bool readArrayHeader(std::string_view data, uint32_t &n, size_t &size);
+
+    /**
+     * @brief The encoded bytes.
+     */
+    const std::string &data() const;
+
+    /**
+     * @brief Moves the encoded bytes out, leaving the writer empty.
+     */
+    std::string take();
+
+    /**
+     * @brief Empties the writer, keeping its memory for the next document.
+     */
+    void clear();
+
+private:
+    /**
+     * @brief Appends a type byte followed by a big-endian value of the given width.
+     */
+    void typed(uint8_t type, uint64_t value, int bytes);
+
+    std::string buffer;     /**< The encoded bytes */
+};
+
+#endif // MSGPACK_H
@@ -42,9 +42,7 @@ std::string getCurrentDate()
  * @param completionStatus Boolean indicating whether the project is complete.
  */
 Project::Project(TodoList list, std::string deadline, bool completionStatus)
-    : list(list), deadline(deadline), completionStatus(completionStatus) {
-    date = getCurrentDate();
-}
+    : list(std::move(list)), date(getCurrentDate()), deadline(std::move(deadline)), completionStatus(completionStatus) {}
 
 /**
  * @brief Adds a new task to the project's to-do list.
@@ -56,8 +54,7 @@ Project::Project(TodoList list, std::string deadline, bool completionStatus)
  */
 void Project::addTask(std::string name)
 {
-    Task newTask(rand(), name, getCurrentDate(), "Backlog", "Medium");
-    list.createTask(newTask);
+    list.createTask(Task(rand(), std::move(name), getCurrentDate(), "Backlog", "Medium"));
 }
 
 /**
@@ -79,7 +76,7 @@ void Project::addUser(User* user) {
  * @param newDeadline The new deadline in YYYY-MM-DD format.
  */
 void Project::changeDeadline(std::string newDeadline) {
-    deadline = newDeadline;
+    deadline = std::move(newDeadline);
 }
 
 /**
@@ -100,16 +97,16 @@ void Project::markComplete(bool status) {
 /**
  * @brief Gets the creation date of the project.
  *
- * @return std::string The creation date in YYYY-MM-DD format.
+ * @return const std::string& The creation date in YYYY-MM-DD format.
  */
-std::string Project::getDate() const { return date; }
+const std::string& Project::getDate() const { return date; }
 
 /**
  * @brief Gets the project's deadline.
  *
- * @return std::string The deadline in YYYY-MM-DD format.
+ * @return const std::string& The deadline in YYYY-MM-DD format.
  */
-std::string Project::getDeadline() const { return deadline; }
+const std::string& Project::getDeadline() const { return deadline; }
 
 /**
  * @brief Checks if the project is complete.
@@ -121,8 +118,26 @@ bool Project::isComplete() const { return completionStatus; }
 /**
  * @brief Retrieves the list of users associated with the project.
  *
- * @return std::vector<User*> A vector of pointers to User objects.
+ * @return const std::vector<User*>& The pointers to the User objects.
  */
-std::vector<User*> Project::getUsers() const {
+const std::vector<User*>& Project::getUsers() const {
     return userList;
+}
+
+/**
+ * @brief Retrieves the project's to-do list.
+ *
+ * @return const TodoList& The list of the project.
+ */
+const TodoList& Project::getTodoList() const {
+    return list;
+}
+
+/**
+ * @brief Retrieves the project's to-do list for modification.
+ *
+ * @return TodoList& The list of the project.
+ */
+TodoList& Project::getTodoList() {
+    return list;
 }
\ No newline at end of file
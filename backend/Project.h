@@ -43,6 +43,9 @@ public:
      * Initializes a project with a to-do list, a deadline, and an optional completion status.
      * The creation date is automatically set to the current date at instantiation.
      * 
+     * Both the list and the deadline are moved in, pass them with std::move to avoid
+     * copying a whole board.
+     *
      * @param list The TodoList associated with this project.
      * @param deadline Deadline date in YYYY-MM-DD format.
      * @param completionStatus Initial completion status (default is false).
@@ -82,14 +85,14 @@ public:
      * 
      * @return A string representing the creation date in YYYY-MM-DD format.
      */
-    std::string getDate() const;
+    const std::string& getDate() const;
 
     /**
      * @brief Retrieves the project's deadline.
      * 
      * @return A string representing the deadline in YYYY-MM-DD format.
      */
-    std::string getDeadline() const;
+    const std::string& getDeadline() const;
 
     /**
      * @brief Checks whether the project is complete.
@@ -101,9 +104,23 @@ public:
     /**
      * @brief Gets the list of users assigned to the project.
      * 
-     * @return A vector of User pointers.
+     * @return Reference to the vector of User pointers.
      */
-    std::vector<User*> getUsers() const;
+    const std::vector<User*>& getUsers() const;
+
+    /**
+     * @brief Gets the project's to-do list.
+     *
+     * @return Reference to the TodoList of the project.
+     */
+    const TodoList& getTodoList() const;
+
+    /**
+     * @brief Gets the project's to-do list for modification.
+     *
+     * @return Reference to the TodoList of the project.
+     */
+    TodoList& getTodoList();
 
     /**
      * @brief Equality operator.
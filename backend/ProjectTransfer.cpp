@@ -0,0 +1,507 @@
+/**
+ * @file ProjectTransfer.cpp
+ * @brief Implementation of exportProject() and the ProjectImport class.
+ */
+
+#include "ProjectTransfer.h"
+#include "Rank.h"
+#include <exception>
+#include <initializer_list>
+#include <string_view>
+
+namespace {
+
+/**
+ * @brief Version of the export format, written on the project line.
+ */
+const int EXPORT_FORMAT = 1;
+
+/**
+ * @brief A text column as a JSON value, null for NULL.
+ *
+ * @param stmt The statement positioned on a row.
+ * @param col The column index.
+ * @return crow::json::wvalue The value.
+ */
+crow::json::wvalue textOrNull(sqlite3_stmt *stmt, int col)
+{
+    const unsigned char *text = sqlite3_column_text(stmt, col);
+    if (!text)
+        return crow::json::wvalue(nullptr);
+    return crow::json::wvalue(std::string(reinterpret_cast<const char *>(text)));
+}
+
+/**
+ * @brief Writes one NDJSON line.
+ *
+ * @return bool false if the list refused it.
+ */
+bool writeLine(SpooledList &out, const crow::json::wvalue &line)
+{
+    return out.append(line.dump());
+}
+
+/**
+ * @brief True if a key is present and not null.
+ */
+bool present(const crow::json::rvalue &line, const char *key)
+{
+    return line.has(key) && line[key].t() != crow::json::type::Null;
+}
+
+/**
+ * @brief The first key whose value is present but neither text nor a number as expected.
+ *
+ * @param line The JSON object.
+ * @param texts Keys that must hold strings.
+ * @param numbers Keys that must hold numbers.
+ * @return const char* The key, nullptr if every value fits.
+ */
+const char *mistyped(const crow::json::rvalue &line, std::initializer_list<const char *> texts,
+                     std::initializer_list<const char *> numbers)
+{
+    for (const char *key : texts)
+    {
+        if (present(line, key) && line[key].t() != crow::json::type::String)
+            return key;
+    }
+    for (const char *key : numbers)
+    {
+        if (present(line, key) && line[key].t() != crow::json::type::Number)
+            return key;
+    }
+    return nullptr;
+}
+
+/**
+ * @brief Binds a text value, or NULL if it is missing or null.
+ */
+void bindText(sqlite3_stmt *stmt, int index, const crow::json::rvalue &line, const char *key)
+{
+    if (present(line, key))
+    {
+        std::string value = line[key].s();
+        sqlite3_bind_text(stmt, index, value.c_str(), static_cast<int>(value.size()), SQLITE_TRANSIENT);
+    }
+    else
+        sqlite3_bind_null(stmt, index);
+}
+
+/**
+ * @brief Looks up a user by email.
+ *
+ * @param stmt The prepared lookup.
+ * @param line The line holding the email.
+ * @param key The key of the email.
+ * @return int The user ID, 0 if there is no such user.
+ */
+int userByEmail(sqlite3_stmt *stmt, const crow::json::rvalue &line, const char *key)
+{
+    if (!present(line, key))
+        return 0;
+    sqlite3_reset(stmt);
+    bindText(stmt, 1, line, key);
+    return sqlite3_step(stmt) == SQLITE_ROW ? sqlite3_column_int(stmt, 0) : 0;
+}
+
+/**
+ * @brief Runs a prepared insert and resets it.
+ *
+ * @return bool true if the row was inserted.
+ */
+bool insert(sqlite3_stmt *stmt)
+{
+    bool ok = sqlite3_step(stmt) == SQLITE_DONE;
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+    return ok;
+}
+
+} // namespace
+
+/**
+ * @brief Streams the project line, the member lines, then each task line followed by its comments.
+ *
+ * Tasks are read in board order from idx_tasks_column and comments per task from
+ * idx_comments_task. Archived tasks and their comments are exported as well, merged in
+ * from the archive tables, and come back as ordinary completed tasks on import.
+ *
+ * @param db The connection.
+ * @param projectId The project ID.
+ * @param out Receives the lines.
+ * @return int SQLITE_OK, SQLITE_NOTFOUND, SQLITE_IOERR or the SQLite error code.
+ */
+int exportProject(sqlite3 *db, int projectId, SpooledList &out)
+{
+    bool written = true;
+    sqlite3_stmt *project = nullptr;
+    sqlite3_stmt *members = nullptr;
+    sqlite3_stmt *tasks = nullptr;
+    sqlite3_stmt *comments = nullptr;
+    int rc = sqlite3_exec(db, "BEGIN;", nullptr, nullptr, nullptr);
+    if (rc == SQLITE_OK)
+        rc = sqlite3_prepare_v2(db, "SELECT id, deadline, date, completion_status FROM projects WHERE id = ?;", -1, &project, nullptr);
+    if (rc == SQLITE_OK)
+        rc = sqlite3_prepare_v2(db,
+                                "SELECT users.id, users.email, users.name FROM user_projects "
+                                "JOIN users ON users.id = user_projects.user_id WHERE user_projects.project_id = ?;",
+                                -1, &members, nullptr);
+    if (rc == SQLITE_OK)
+        rc = sqlite3_prepare_v2(db,
+                                "SELECT id, title, description, due_date, priority, status, rank FROM tasks WHERE project_id = ?1 "
+                                "UNION ALL SELECT id, title, description, due_date, priority, status, rank FROM tasks_archive "
+                                "WHERE project_id = ?1 ORDER BY status, rank, id;",
+                                -1, &tasks, nullptr);
+    if (rc == SQLITE_OK)
+        rc = sqlite3_prepare_v2(db,
+                                "SELECT comments.id, comments.body, comments.date, comments.status, users.email, comments.deleted_at "
+                                "FROM comments LEFT JOIN users ON users.id = comments.user_id WHERE comments.task_id = ?1 "
+                                "UNION ALL SELECT comments_archive.id, comments_archive.body, comments_archive.date, comments_archive.status, "
+                                "users.email, comments_archive.deleted_at "
+                                "FROM comments_archive LEFT JOIN users ON users.id = comments_archive.user_id "
+                                "WHERE comments_archive.task_id = ?1 ORDER BY 1;",
+                                -1, &comments, nullptr);
+
+    if (rc == SQLITE_OK)
+    {
+        sqlite3_bind_int(project, 1, projectId);
+        rc = sqlite3_step(project);
+        if (rc == SQLITE_ROW)
+        {
+            crow::json::wvalue line;
+            line["type"] = "project";
+            line["format"] = EXPORT_FORMAT;
+            line["id"] = sqlite3_column_int(project, 0);
+            line["deadline"] = textOrNull(project, 1);
+            line["date"] = textOrNull(project, 2);
+            line["completion_status"] = sqlite3_column_int(project, 3);
+            written = writeLine(out, line);
+            rc = SQLITE_DONE;
+        }
+        else if (rc == SQLITE_DONE)
+            rc = SQLITE_NOTFOUND;
+    }
+
+    if (rc == SQLITE_DONE)
+    {
+        sqlite3_bind_int(members, 1, projectId);
+        while (written && (rc = sqlite3_step(members)) == SQLITE_ROW)
+        {
+            crow::json::wvalue line;
+            line["type"] = "member";
+            line["user_id"] = sqlite3_column_int(members, 0);
+            line["email"] = textOrNull(members, 1);
+            line["name"] = textOrNull(members, 2);
+            written = writeLine(out, line);
+        }
+    }
+
+    if (rc == SQLITE_DONE)
+    {
+        sqlite3_bind_int(tasks, 1, projectId);
+        while (written && rc == SQLITE_DONE && (rc = sqlite3_step(tasks)) == SQLITE_ROW)
+        {
+            int taskId = sqlite3_column_int(tasks, 0);
+            crow::json::wvalue line;
+            line["type"] = "task";
+            line["id"] = taskId;
+            line["title"] = textOrNull(tasks, 1);
+            line["description"] = textOrNull(tasks, 2);
+            line["due_date"] = textOrNull(tasks, 3);
+            line["priority"] = sqlite3_column_int(tasks, 4);
+            line["status"] = textOrNull(tasks, 5);
+            line["rank"] = textOrNull(tasks, 6);
+            written = writeLine(out, line);
+
+            sqlite3_reset(comments);
+            sqlite3_bind_int(comments, 1, taskId);
+            while (written && (rc = sqlite3_step(comments)) == SQLITE_ROW)
+            {
+                crow::json::wvalue comment;
+                comment["type"] = "comment";
+                comment["id"] = sqlite3_column_int(comments, 0);
+                comment["task_id"] = taskId;
+                comment["body"] = textOrNull(comments, 1);
+                comment["date"] = textOrNull(comments, 2);
+                comment["status"] = textOrNull(comments, 3);
+                comment["user_email"] = textOrNull(comments, 4);
+                comment["deleted_at"] = textOrNull(comments, 5);
+                written = writeLine(out, comment);
+            }
+        }
+    }
+
+    sqlite3_finalize(project);
+    sqlite3_finalize(members);
+    sqlite3_finalize(tasks);
+    sqlite3_finalize(comments);
+    sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
+    if (!written)
+        return SQLITE_IOERR;
+    if (rc == SQLITE_DONE)
+        return SQLITE_OK;
+    return rc;
+}
+
+/**
+ * @brief Takes the document to import.
+ *
+ * @param document The NDJSON export.
+ */
+ProjectImport::ProjectImport(std::string document) : document(std::move(document)) {}
+
+/**
+ * @brief Applies the next batch of lines in one transaction.
+ *
+ * @param db The connection.
+ * @param maxLines Lines per batch.
+ * @param taskCreated Called with each new task once the batch is committed.
+ * @param memberAdded Called with each new member once the batch is committed.
+ * @return bool true if another step is needed.
+ */
+bool ProjectImport::step(sqlite3 *db, size_t maxLines, const std::function<void(int)> &taskCreated,
+                         const std::function<void(int)> &memberAdded)
+{
+    if (failed())
+        return false;
+
+    Statements sql;
+    bool prepared =
+        sqlite3_prepare_v2(db, "INSERT INTO projects (deadline, date, completion_status) VALUES (?, ?, ?);", -1, &sql.project, nullptr) == SQLITE_OK &&
+        sqlite3_prepare_v2(db, "SELECT id FROM users WHERE email = ?;", -1, &sql.user, nullptr) == SQLITE_OK &&
+        sqlite3_prepare_v2(db, "INSERT OR IGNORE INTO user_projects (user_id, project_id) VALUES (?, ?);", -1, &sql.member, nullptr) == SQLITE_OK &&
+        sqlite3_prepare_v2(db,
+                           "INSERT INTO tasks (title, description, due_date, priority, status, project_id, rank) "
+                           "VALUES (?, ?, ?, ?, ?, ?, ?);",
+                           -1, &sql.task, nullptr) == SQLITE_OK &&
+        sqlite3_prepare_v2(db,
+                           "INSERT INTO comments (body, date, status, user_id, task_id, deleted_at) VALUES (?, ?, ?, ?, ?, ?);",
+                           -1, &sql.comment, nullptr) == SQLITE_OK;
+
+    batchTasks.clear();
+    batchMembers.clear();
+    bool ok = prepared ? sqlite3_exec(db, "BEGIN;", nullptr, nullptr, nullptr) == SQLITE_OK : false;
+    if (!ok)
+        fail(sqlite3_errmsg(db));
+
+    for (size_t n = 0; ok && n < maxLines && offset < document.size(); n++)
+    {
+        size_t end = document.find('\n', offset);
+        if (end == std::string::npos)
+            end = document.size();
+        std::string_view text(document.data() + offset, end - offset);
+        offset = end + 1;
+        lineNumber++;
+        if (!text.empty() && text.back() == '\r')
+            text.remove_suffix(1);
+        if (text.empty())
+            continue;
+
+        crow::json::rvalue line = crow::json::load(text.data(), text.size());
+        try
+        {
+            ok = line ? apply(db, sql, line) : fail("invalid JSON");
+        }
+        catch (const std::exception &e)
+        {
+            // Crow throws on a value read as the wrong type, keep the batch's rollback below
+            ok = fail(e.what());
+        }
+    }
+
+    if (ok && offset >= document.size() && newProjectId == 0)
+        ok = fail("no project line");
+    if (ok && sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr) != SQLITE_OK)
+        ok = fail(sqlite3_errmsg(db));
+    if (!ok && prepared)
+        sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
+
+    sqlite3_finalize(sql.project);
+    sqlite3_finalize(sql.user);
+    sqlite3_finalize(sql.member);
+    sqlite3_finalize(sql.task);
+    sqlite3_finalize(sql.comment);
+
+    if (!ok)
+        return false;
+    for (int userId : batchMembers)
+        memberAdded(userId);
+    for (int taskId : batchTasks)
+        taskCreated(taskId);
+    return offset < document.size();
+}
+
+/**
+ * @brief Applies one line: the project, a member, a task or a comment.
+ *
+ * @param db The connection.
+ * @param sql The prepared statements.
+ * @param line The JSON object.
+ * @return bool false if the line is invalid.
+ */
+bool ProjectImport::apply(sqlite3 *db, Statements &sql, const crow::json::rvalue &line)
+{
+    if (line.t() != crow::json::type::Object)
+        return fail("not an object");
+    if (!present(line, "type") || line["type"].t() != crow::json::type::String)
+        return fail("missing \"type\"");
+    std::string type = line["type"].s();
+
+    const char *wrong = nullptr;
+    if (type == "project")
+        wrong = mistyped(line, {"deadline", "date"}, {"format"});
+    else if (type == "member")
+        wrong = mistyped(line, {"email"}, {});
+    else if (type == "task")
+        wrong = mistyped(line, {"title", "description", "due_date", "status", "rank"}, {"priority", "id"});
+    else if (type == "comment")
+        wrong = mistyped(line, {"body", "date", "status", "user_email", "deleted_at"}, {"task_id"});
+    if (wrong)
+        return fail(std::string("\"") + wrong + "\" has the wrong type");
+
+    if (type == "project")
+    {
+        if (newProjectId != 0)
+            return fail("second project line");
+        if (present(line, "format") && line["format"].i() > EXPORT_FORMAT)
+            return fail("unsupported format " + std::to_string(line["format"].i()));
+        if (!present(line, "deadline"))
+            return fail("project without deadline");
+        bindText(sql.project, 1, line, "deadline");
+        bindText(sql.project, 2, line, "date");
+        bool completed = false;
+        if (present(line, "completion_status"))
+        {
+            crow::json::type status = line["completion_status"].t();
+            if (status != crow::json::type::Number && status != crow::json::type::True && status != crow::json::type::False)
+                return fail("\"completion_status\" has the wrong type");
+            completed = status == crow::json::type::True || (status == crow::json::type::Number && line["completion_status"].i());
+        }
+        sqlite3_bind_int(sql.project, 3, completed ? 1 : 0);
+        if (!insert(sql.project))
+            return fail(sqlite3_errmsg(db));
+        newProjectId = static_cast<int>(sqlite3_last_insert_rowid(db));
+        return true;
+    }
+    if (newProjectId == 0)
+        return fail("the first line must be the project");
+
+    if (type == "member")
+    {
+        int userId = userByEmail(sql.user, line, "email");
+        if (userId == 0)
+        {
+            skippedMembers++;
+            return true;
+        }
+        sqlite3_bind_int(sql.member, 1, userId);
+        sqlite3_bind_int(sql.member, 2, newProjectId);
+        if (!insert(sql.member))
+            return fail(sqlite3_errmsg(db));
+        if (sqlite3_changes(db) > 0)
+        {
+            batchMembers.push_back(userId);
+            members++;
+        }
+        return true;
+    }
+
+    if (type == "task")
+    {
+        if (!present(line, "title"))
+            return fail("task without title");
+        bindText(sql.task, 1, line, "title");
+        bindText(sql.task, 2, line, "description");
+        bindText(sql.task, 3, line, "due_date");
+        sqlite3_bind_int(sql.task, 4, present(line, "priority") ? static_cast<int>(line["priority"].i()) : 1);
+        if (present(line, "status"))
+            bindText(sql.task, 5, line, "status");
+        else
+            sqlite3_bind_text(sql.task, 5, "pending", -1, SQLITE_STATIC);
+        sqlite3_bind_int(sql.task, 6, newProjectId);
+        // Keys from an export made before ranks had an integer part are left to maintenance
+        if (present(line, "rank") && isRankKey(line["rank"].s()))
+            bindText(sql.task, 7, line, "rank");
+        if (!insert(sql.task))
+            return fail(sqlite3_errmsg(db));
+        currentOldTask = present(line, "id") ? line["id"].i() : 0;
+        currentNewTask = static_cast<int>(sqlite3_last_insert_rowid(db));
+        batchTasks.push_back(currentNewTask);
+        tasks++;
+        return true;
+    }
+
+    if (type == "comment")
+    {
+        if (currentNewTask == 0 || !present(line, "task_id") || line["task_id"].i() != currentOldTask)
+            return fail("comment does not follow its task");
+        if (!present(line, "body"))
+            return fail("comment without body");
+        int userId = userByEmail(sql.user, line, "user_email");
+        bindText(sql.comment, 1, line, "body");
+        bindText(sql.comment, 2, line, "date");
+        if (present(line, "status"))
+            bindText(sql.comment, 3, line, "status");
+        else
+            sqlite3_bind_text(sql.comment, 3, "active", -1, SQLITE_STATIC);
+        if (userId != 0)
+            sqlite3_bind_int(sql.comment, 4, userId);
+        else
+            sqlite3_bind_null(sql.comment, 4);
+        sqlite3_bind_int(sql.comment, 5, currentNewTask);
+        bindText(sql.comment, 6, line, "deleted_at");
+        if (!insert(sql.comment))
+            return fail(sqlite3_errmsg(db));
+        comments++;
+        return true;
+    }
+
+    return fail("unknown type \"" + type + "\"");
+}
+
+/**
+ * @brief Records the reason of a failure at the current line.
+ *
+ * @param reason The reason.
+ * @return bool Always false.
+ */
+bool ProjectImport::fail(const std::string &reason)
+{
+    error = "Line " + std::to_string(lineNumber) + ": " + reason;
+    return false;
+}
+
+/**
+ * @brief Deletes the project created by earlier batches; its rows go with it by cascade.
+ *
+ * @param db The connection.
+ */
+void ProjectImport::abandon(sqlite3 *db)
+{
+    if (newProjectId == 0)
+        return;
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(db, "DELETE FROM projects WHERE id = ?;", -1, &stmt, nullptr) == SQLITE_OK)
+    {
+        sqlite3_bind_int(stmt, 1, newProjectId);
+        sqlite3_step(stmt);
+        sqlite3_finalize(stmt);
+    }
+}
+
+/**
+ * @brief Summary of a finished import.
+ *
+ * @return crow::json::wvalue The new project ID and the counts.
+ */
+crow::json::wvalue ProjectImport::summary() const
+{
+    crow::json::wvalue result;
+    result["project_id"] = newProjectId;
+    result["members"] = members;
+    result["skipped_members"] = skippedMembers;
+    result["tasks"] = tasks;
+    result["comments"] = comments;
+    result["lines"] = lineNumber;
+    return result;
+}
@@ -0,0 +1,148 @@
+/**
+ * @file ProjectTransfer.h
+ * @brief Declaration of exportProject() and the ProjectImport class.
+ *
+ * A project moves between databases as NDJSON, one JSON object per line, each with a
+ * "type": first the project, then its members, then every task followed by its
+ * comments. Users are not exported; members and comment authors are matched by email
+ * on import.
+ *
+ * {"type":"project","format":1,"id":3,"deadline":"2025-06-01","date":"...","completion_status":0}
+ * {"type":"member","user_id":7,"email":"a@b.c","name":"Ann"}
+ * {"type":"task","id":12,"title":"...","description":null,"due_date":"...","priority":2,"status":"todo","rank":"V"}
+ * {"type":"comment","id":40,"task_id":12,"body":"...","date":"...","status":"active","user_email":"a@b.c","deleted_at":null}
+ */
+
+#ifndef PROJECTTRANSFER_H
+#define PROJECTTRANSFER_H
+
+#include <sqlite3.h>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include "crow.h"
+#include "SpooledList.h"
+
+/**
+ * @brief Writes a project with its members, tasks and comments as NDJSON.
+ *
+ * Rows are written as they are read, one line at a time, so memory use does not depend
+ * on the size of the project; a large export spills to the spool, which is reserved a
+ * chunk at a time. Runs in one read transaction, so the export is consistent.
+ *
+ * @param db The connection.
+ * @param projectId The project ID.
+ * @param out Receives the lines, a list in SpooledList::Format::Lines.
+ * @return int SQLITE_OK, SQLITE_NOTFOUND if there is no such project, SQLITE_IOERR if
+ *         out refused a line (see SpooledList::finish()), or another SQLite error code.
+ */
+int exportProject(sqlite3 *db, int projectId, SpooledList &out);
+
+/**
+ * @class ProjectImport
+ * @brief Creates a project from an export, a batch of lines at a time.
+ *
+ * Each call to step() applies the next lines in one transaction with prepared
+ * statements, so the write pool can run other writes between batches. The project and
+ * every task get new IDs; a comment belongs to the task line before it, so only the ID
+ * of the current task has to be remembered. If a line is invalid, the batch is rolled
+ * back and abandon() deletes what earlier batches created.
+ */
+class ProjectImport
+{
+public:
+    /**
+     * @brief Takes the NDJSON document to import.
+     *
+     * @param document The export.
+     */
+    explicit ProjectImport(std::string document);
+
+    /**
+     * @brief Applies up to maxLines lines in one transaction.
+     *
+     * @param db The connection of the write pool.
+     * @param maxLines Lines per batch.
+     * @param taskCreated Called with each new task ID once the batch is committed.
+     * @param memberAdded Called with each user added to the project once the batch is committed.
+     * @return bool true if lines are left for another step.
+     */
+    bool step(sqlite3 *db, size_t maxLines, const std::function<void(int)> &taskCreated,
+              const std::function<void(int)> &memberAdded);
+
+    /**
+     * @brief True once a line could not be imported.
+     */
+    bool failed() const { return !error.empty(); }
+
+    /**
+     * @brief Why the import failed, with the line number.
+     */
+    const std::string &failure() const { return error; }
+
+    /**
+     * @brief ID of the created project, 0 before the project line was applied.
+     */
+    int projectId() const { return newProjectId; }
+
+    /**
+     * @brief Deletes the partly imported project after a failure.
+     *
+     * @param db The connection of the write pool.
+     */
+    void abandon(sqlite3 *db);
+
+    /**
+     * @brief The new project ID and the number of rows created and skipped.
+     *
+     * @return crow::json::wvalue The summary.
+     */
+    crow::json::wvalue summary() const;
+
+private:
+    /**
+     * @brief The inserts of one batch, prepared once per step().
+     */
+    struct Statements
+    {
+        sqlite3_stmt *project = nullptr;    /**< INSERT INTO projects */
+        sqlite3_stmt *user = nullptr;       /**< User ID by email */
+        sqlite3_stmt *member = nullptr;     /**< INSERT INTO user_projects */
+        sqlite3_stmt *task = nullptr;       /**< INSERT INTO tasks */
+        sqlite3_stmt *comment = nullptr;    /**< INSERT INTO comments */
+    };
+
+    /**
+     * @brief Applies one line.
+     *
+     * @param db The connection.
+     * @param sql The prepared statements.
+     * @param line The JSON object.
+     * @return bool false if the line is invalid, error is set.
+     */
+    bool apply(sqlite3 *db, Statements &sql, const crow::json::rvalue &line);
+
+    /**
+     * @brief Records a failure at the current line.
+     */
+    bool fail(const std::string &reason);
+
+    std::string document;                   /**< The NDJSON to import */
+    size_t offset = 0;                      /**< Start of the next line */
+    int lineNumber = 0;                     /**< Lines read so far */
+    std::string error;                      /**< Why the import failed, empty if it did not */
+
+    int newProjectId = 0;                   /**< Created project */
+    int64_t currentOldTask = 0;             /**< Exported ID of the last task line */
+    int currentNewTask = 0;                 /**< New ID of the last task line */
+    std::vector<int> batchTasks;            /**< Tasks created by the running step */
+    std::vector<int> batchMembers;          /**< Users added by the running step */
+
+    int members = 0;                        /**< Memberships created */
+    int skippedMembers = 0;                 /**< Members with no user of that email */
+    int tasks = 0;                          /**< Tasks created */
+    int comments = 0;                       /**< Comments created */
+};
+
+#endif // PROJECTTRANSFER_H
@@ -0,0 +1,429 @@
+/**
+ * @file Rank.cpp
+ * @brief Implementation of the rank key functions.
+ */
+
+#include "Rank.h"
+#include <iostream>
+
+namespace {
+
+/**
+ * @brief The digits of a key, in ascending order.
+ */
+constexpr const char DIGITS[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
+
+/**
+ * @brief Number of digits.
+ */
+constexpr int BASE = 62;
+
+/**
+ * @brief Value of a digit.
+ *
+ * @param c The character.
+ * @return int The value, -1 if c is not a digit.
+ */
+int digitValue(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'A' && c <= 'Z') return c - 'A' + 10;
+    if (c >= 'a' && c <= 'z') return c - 'a' + 36;
+    return -1;
+}
+
+/**
+ * @brief Midpoint of two fractions, the upper one possibly empty for 1.0.
+ *
+ * Missing digits of before count as 0. The result never ends in 0, so there is room
+ * below every key it returns.
+ *
+ * @param before The lower key.
+ * @param after The upper key, or empty for 1.0.
+ * @return std::string A key strictly between the two.
+ */
+std::string midpoint(const std::string &before, const std::string &after)
+{
+    // Copy the common prefix, the keys only differ after it
+    size_t n = 0;
+    while (n < after.size() && (n < before.size() ? before[n] : '0') == after[n])
+        n++;
+    std::string prefix = after.substr(0, n);
+    std::string low = n < before.size() ? before.substr(n) : "";
+    std::string high = after.substr(n);
+
+    int lowDigit = low.empty() ? 0 : digitValue(low[0]);
+    int highDigit = high.empty() ? BASE : digitValue(high[0]);
+    if (highDigit - lowDigit > 1)
+        return prefix + DIGITS[(lowDigit + highDigit) / 2];
+
+    // Adjacent digits: the upper digit alone still sorts below a longer upper key,
+    // otherwise keep the lower digit and split the rest of the lower key up to 1.0
+    if (high.size() > 1)
+        return prefix + high[0];
+    return prefix + DIGITS[lowDigit] + midpoint(low.empty() ? "" : low.substr(1), "");
+}
+
+/**
+ * @brief Runs a query returning at most one rank.
+ *
+ * @param stmt The prepared statement, finalized here.
+ * @param rank Receives the rank, empty if it is NULL.
+ * @return bool true if a row was found.
+ */
+bool stepRank(sqlite3_stmt *stmt, std::string &rank)
+{
+    bool found = sqlite3_step(stmt) == SQLITE_ROW;
+    if (found && sqlite3_column_type(stmt, 0) != SQLITE_NULL)
+        rank = (const char *)sqlite3_column_text(stmt, 0);
+    sqlite3_finalize(stmt);
+    return found;
+}
+
+/**
+ * @brief Number of characters of an integer, its head included.
+ *
+ * @param head The first character of the integer.
+ * @return size_t The length, 0 if head does not start an integer.
+ */
+size_t integerLength(char head)
+{
+    if (head >= 'a' && head <= 'z') return head - 'a' + 2;
+    if (head >= 'A' && head <= 'Z') return 'Z' - head + 2;
+    return 0;
+}
+
+/**
+ * @brief The lowest integer, which has no integer below it to move to.
+ */
+const std::string SMALLEST_INTEGER = "A" + std::string(26, '0');
+
+/**
+ * @brief Splits a key into its integer and fraction.
+ *
+ * @param key The key.
+ * @param integer Receives the integer, head included.
+ * @param fraction Receives the fraction, possibly empty.
+ * @return bool false if key is not a well-formed rank key.
+ */
+bool splitKey(const std::string &key, std::string &integer, std::string &fraction)
+{
+    size_t length = key.empty() ? 0 : integerLength(key[0]);
+    if (length == 0 || key.size() < length)
+        return false;
+    for (size_t i = 1; i < key.size(); i++)
+        if (digitValue(key[i]) < 0)
+            return false;
+    integer = key.substr(0, length);
+    fraction = key.substr(length);
+    // Room must be left below every key and before the lowest integer
+    return (fraction.empty() || fraction.back() != '0') && key != SMALLEST_INTEGER;
+}
+
+/**
+ * @brief The next integer up, one digit longer when the digits run out.
+ *
+ * @param integer The integer, head included.
+ * @return std::string The next integer, empty past the largest one.
+ */
+std::string incrementInteger(const std::string &integer)
+{
+    char head = integer[0];
+    std::string digits = integer.substr(1);
+    for (size_t i = digits.size(); i-- > 0;)
+    {
+        int value = digitValue(digits[i]) + 1;
+        if (value < BASE)
+        {
+            digits[i] = DIGITS[value];
+            return head + digits;
+        }
+        digits[i] = '0';
+    }
+    // Every digit carried, the integer changes length
+    if (head == 'Z')
+        return "a0";
+    if (head == 'z')
+        return "";
+    head++;
+    if (head > 'a')
+        digits.push_back('0');
+    else
+        digits.pop_back();
+    return head + digits;
+}
+
+/**
+ * @brief The next integer down, one digit longer when the digits run out.
+ *
+ * @param integer The integer, head included.
+ * @return std::string The next integer, empty below the smallest one.
+ */
+std::string decrementInteger(const std::string &integer)
+{
+    char head = integer[0];
+    std::string digits = integer.substr(1);
+    for (size_t i = digits.size(); i-- > 0;)
+    {
+        int value = digitValue(digits[i]) - 1;
+        if (value >= 0)
+        {
+            digits[i] = DIGITS[value];
+            return head + digits;
+        }
+        digits[i] = 'z';
+    }
+    // Every digit borrowed, the integer changes length
+    if (head == 'a')
+        return "Zz";
+    if (head == 'A')
+        return "";
+    head--;
+    if (head < 'Z')
+        digits.push_back('z');
+    else
+        digits.pop_back();
+    return head + digits;
+}
+
+} // namespace
+
+/**
+ * @brief Checks that a string is a well-formed rank key.
+ *
+ * @param key The string.
+ * @return bool true if it is a key.
+ */
+bool isRankKey(const std::string &key)
+{
+    std::string integer, fraction;
+    return splitKey(key, integer, fraction);
+}
+
+/**
+ * @brief Computes a key strictly between two keys.
+ *
+ * At either end of the column the next integer is taken, so appending or prepending
+ * cards only lengthens keys logarithmically. Between two keys the fraction is split.
+ *
+ * @param before The key to sort after, or empty for the start of the column.
+ * @param after The key to sort before, or empty for the end of the column.
+ * @return std::string The new key, or empty if there is no room between the keys.
+ */
+std::string rankBetween(const std::string &before, const std::string &after)
+{
+    std::string lowInteger, lowFraction, highInteger, highFraction;
+    if ((!before.empty() && !splitKey(before, lowInteger, lowFraction)) ||
+        (!after.empty() && !splitKey(after, highInteger, highFraction)) ||
+        (!before.empty() && !after.empty() && before >= after))
+        return "";
+
+    if (before.empty() && after.empty())
+        return "a0";
+    if (before.empty())
+    {
+        // A key with a fraction sorts above its bare integer
+        if (highInteger == SMALLEST_INTEGER)
+            return highInteger + midpoint("", highFraction);
+        if (!highFraction.empty())
+            return highInteger;
+        std::string next = decrementInteger(highInteger);
+        return next == SMALLEST_INTEGER ? "" : next;
+    }
+    if (after.empty())
+    {
+        std::string next = incrementInteger(lowInteger);
+        return next.empty() ? lowInteger + midpoint(lowFraction, "") : next;
+    }
+
+    if (lowInteger == highInteger)
+        return lowInteger + midpoint(lowFraction, highFraction);
+    // A whole integer in between is shorter than splitting the fraction
+    std::string next = incrementInteger(lowInteger);
+    if (!next.empty() && next < after)
+        return next;
+    return lowInteger + midpoint(lowFraction, "");
+}
+
+/**
+ * @brief Computes n integer keys of equal length spread evenly.
+ *
+ * The length leaves about four free integers per gap.
+ *
+ * @param n Number of keys.
+ * @return std::vector<std::string> The keys, in ascending order.
+ */
+std::vector<std::string> evenRanks(size_t n)
+{
+    size_t length = 1;
+    unsigned long long space = BASE;
+    while (space < 4 * (n + 1))
+    {
+        space *= BASE;
+        length++;
+    }
+
+    std::vector<std::string> keys;
+    keys.reserve(n);
+    for (size_t i = 1; i <= n; i++)
+    {
+        unsigned long long value = space / (n + 1) * i;
+        std::string key(length + 1, '0');
+        key[0] = static_cast<char>('a' + length - 1);
+        for (size_t d = length; d > 0; d--, value /= BASE)
+            key[d] = DIGITS[value % BASE];
+        keys.push_back(std::move(key));
+    }
+    return keys;
+}
+
+/**
+ * @brief Reads the highest rank of a column, optionally ignoring one task.
+ *
+ * @param db The connection.
+ * @param projectID The project ID.
+ * @param status The status naming the column.
+ * @param excludeID Task to ignore, or 0.
+ * @return std::string The rank, empty if there is none.
+ */
+std::string lastRank(sqlite3 *db, int projectID, const std::string &status, int excludeID)
+{
+    const char *sql = "SELECT rank FROM tasks WHERE project_id = ? AND status = ? AND rank IS NOT NULL "
+                      "AND id != ? ORDER BY rank DESC LIMIT 1;";
+    sqlite3_stmt *stmt;
+    std::string rank;
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK)
+        return rank;
+    sqlite3_bind_int(stmt, 1, projectID);
+    sqlite3_bind_text(stmt, 2, status.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int(stmt, 3, excludeID);
+    stepRank(stmt, rank);
+    return rank;
+}
+
+/**
+ * @brief Computes the rank of a task dropped next to other cards of a column.
+ *
+ * Given one neighbour, the other one is the next card on the far side of it. Given
+ * both, they must be next to each other.
+ *
+ * @param db The connection.
+ * @param taskID The task being placed.
+ * @param projectID Project of the target column.
+ * @param status Status naming the target column.
+ * @param afterID Card the task goes right after, or 0.
+ * @param beforeID Card the task goes right before, or 0.
+ * @param valid Set to false if a neighbour is not in the column.
+ * @return std::string The rank, empty if invalid or if there is no room.
+ */
+std::string rankForPlacement(sqlite3 *db, int taskID, int projectID, const std::string &status,
+                             int afterID, int beforeID, bool &valid)
+{
+    valid = true;
+    if (!afterID && !beforeID)
+        return rankBetween(lastRank(db, projectID, status, taskID), "");
+
+    // Rank of a card of the column, not the task itself
+    auto rankOf = [&](int cardID, std::string &rank)
+    {
+        sqlite3_stmt *stmt;
+        const char *sql = "SELECT rank FROM tasks WHERE id = ? AND project_id = ? AND status = ? AND id != ?;";
+        if (cardID == taskID || sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK)
+            return false;
+        sqlite3_bind_int(stmt, 1, cardID);
+        sqlite3_bind_int(stmt, 2, projectID);
+        sqlite3_bind_text(stmt, 3, status.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_int(stmt, 4, taskID);
+        return stepRank(stmt, rank);
+    };
+
+    // Nearest rank past a rank, upwards or downwards
+    auto nextRank = [&](const std::string &from, bool down)
+    {
+        sqlite3_stmt *stmt;
+        std::string rank;
+        const char *sql = down ? "SELECT rank FROM tasks WHERE project_id = ? AND status = ? AND rank > ? "
+                                 "AND id != ? ORDER BY rank LIMIT 1;"
+                               : "SELECT rank FROM tasks WHERE project_id = ? AND status = ? AND rank < ? "
+                                 "AND id != ? ORDER BY rank DESC LIMIT 1;";
+        if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK)
+            return rank;
+        sqlite3_bind_int(stmt, 1, projectID);
+        sqlite3_bind_text(stmt, 2, status.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(stmt, 3, from.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_int(stmt, 4, taskID);
+        stepRank(stmt, rank);
+        return rank;
+    };
+
+    std::string low, high;
+    if ((afterID && !rankOf(afterID, low)) || (beforeID && !rankOf(beforeID, high)))
+    {
+        valid = false;
+        return "";
+    }
+    // A neighbour without rank cannot be placed against
+    if ((afterID && low.empty()) || (beforeID && high.empty()))
+        return "";
+    if (!beforeID)
+        high = nextRank(low, true);
+    else if (!afterID)
+        low = nextRank(high, false);
+    else if (nextRank(low, true) != high)
+    {
+        // Not next to each other, the client's view of the column is stale
+        valid = false;
+        return "";
+    }
+    return rankBetween(low, high);
+}
+
+/**
+ * @brief Rewrites the keys of a column with evenRanks(), keeping the current order.
+ *
+ * @param db The connection, on the write pool.
+ * @param projectID The project ID.
+ * @param status The status naming the column.
+ * @return int Number of tasks ranked, or -1 on error.
+ */
+int rebalanceRanks(sqlite3 *db, int projectID, const std::string &status)
+{
+    if (sqlite3_exec(db, "BEGIN;", nullptr, nullptr, nullptr) != SQLITE_OK)
+        return -1;
+
+    std::vector<int> ids;
+    sqlite3_stmt *stmt;
+    const char *select = "SELECT id FROM tasks WHERE project_id = ? AND status = ? "
+                         "ORDER BY rank IS NULL, rank, id;";
+    bool ok = sqlite3_prepare_v2(db, select, -1, &stmt, nullptr) == SQLITE_OK;
+    if (ok)
+    {
+        sqlite3_bind_int(stmt, 1, projectID);
+        sqlite3_bind_text(stmt, 2, status.c_str(), -1, SQLITE_TRANSIENT);
+        while (sqlite3_step(stmt) == SQLITE_ROW)
+            ids.push_back(sqlite3_column_int(stmt, 0));
+        sqlite3_finalize(stmt);
+    }
+
+    std::vector<std::string> ranks = evenRanks(ids.size());
+    ok = ok && sqlite3_prepare_v2(db, "UPDATE tasks SET rank = ? WHERE id = ?;", -1, &stmt, nullptr) == SQLITE_OK;
+    if (ok)
+    {
+        for (size_t i = 0; ok && i < ids.size(); i++)
+        {
+            sqlite3_bind_text(stmt, 1, ranks[i].c_str(), -1, SQLITE_STATIC);
+            sqlite3_bind_int(stmt, 2, ids[i]);
+            ok = sqlite3_step(stmt) == SQLITE_DONE;
+            sqlite3_reset(stmt);
+        }
+        sqlite3_finalize(stmt);
+    }
+
+    if (!ok || sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr) != SQLITE_OK)
+    {
+        std::cerr << "Rank rebalance failed: " << sqlite3_errmsg(db) << std::endl;
+        sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
+        return -1;
+    }
+    return static_cast<int>(ids.size());
+}
@@ -0,0 +1,106 @@
+/**
+ * @file Rank.h
+ * @brief Fractional rank keys that order the cards of a Kanban column.
+ *
+ * A rank is an integer followed by a fraction, both in base-62 digits (0-9, A-Z, a-z,
+ * in ASCII order). The first character of the integer tells its length: 'a' to 'z' start
+ * integers of 1 to 26 digits counting up from 0, 'Z' down to 'A' start integers of 1 to
+ * 26 digits counting down below 0. The fraction, possibly empty, never ends in 0. Plain
+ * string comparison, which is how SQLite sorts TEXT, then orders cards, and there is
+ * always a key between two different keys, so moving a card rewrites only that card's row.
+ *
+ * Cards added at either end of a column take the next integer, so those keys grow by a
+ * digit every 62^n cards. Only a card dropped between two cards splits the fraction,
+ * which grows by about a digit each time the same gap is split; the maintenance loop
+ * gives long keys back a short, even spread.
+ */
+
+#ifndef RANK_H
+#define RANK_H
+
+#include <sqlite3.h>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Key length above which a column is rebalanced.
+ *
+ * The partial index idx_tasks_rank_rebalance in Schema.h uses the same value.
+ */
+constexpr size_t RANK_REBALANCE_LENGTH = 24;
+
+/**
+ * @brief Checks that a string is a well-formed rank key.
+ *
+ * @param key The string.
+ * @return bool true if it is a key rankBetween() can place against.
+ */
+bool isRankKey(const std::string &key);
+
+/**
+ * @brief Computes a key that sorts strictly between two keys.
+ *
+ * Past the last or before the first key this is the next integer; between two keys
+ * with the same integer the fraction is split.
+ *
+ * @param before The key to sort after, or empty for the start of the column.
+ * @param after The key to sort before, or empty for the end of the column.
+ * @return std::string The new key, or an empty string if there is no room between the two
+ *         keys (they are equal, out of order or not rank keys) and the column needs a rebalance.
+ */
+std::string rankBetween(const std::string &before, const std::string &after);
+
+/**
+ * @brief Computes n short integer keys of equal length, spread evenly.
+ *
+ * @param n Number of keys.
+ * @return std::vector<std::string> The keys, in ascending order.
+ */
+std::vector<std::string> evenRanks(size_t n);
+
+/**
+ * @brief Reads the highest rank of a column.
+ *
+ * Served by idx_tasks_column as a single index seek.
+ *
+ * @param db The connection.
+ * @param projectID The project ID.
+ * @param status The status naming the column.
+ * @param excludeID Task to ignore, such as the one being moved, or 0.
+ * @return std::string The rank, empty if the column has no ranked task.
+ */
+std::string lastRank(sqlite3 *db, int projectID, const std::string &status, int excludeID = 0);
+
+/**
+ * @brief Computes the rank of a task dropped into a column next to other cards.
+ *
+ * Reads at most two ranks through idx_tasks_column; the task itself is ignored as a
+ * neighbour, so it can be moved within its own column.
+ *
+ * @param db The connection.
+ * @param taskID The task being placed.
+ * @param projectID Project of the target column.
+ * @param status Status naming the target column.
+ * @param afterID Card the task goes right after, or 0.
+ * @param beforeID Card the task goes right before, or 0. With neither, the task goes last.
+ * @param valid Set to false if afterID or beforeID is not a card of the column, or if
+ *              both are given and they are not next to each other.
+ * @return std::string The rank, empty if invalid or if the column has no room there
+ *         (for example next to a card without rank) and needs rebalanceRanks() first.
+ */
+std::string rankForPlacement(sqlite3 *db, int taskID, int projectID, const std::string &status,
+                             int afterID, int beforeID, bool &valid);
+
+/**
+ * @brief Gives every task of a column a new key from evenRanks(), keeping their order.
+ *
+ * Tasks without a rank go last, in ID order. Runs in one transaction.
+ *
+ * @param db The connection, on the write pool.
+ * @param projectID The project ID.
+ * @param status The status naming the column.
+ * @return int Number of tasks ranked, or -1 on error.
+ */
+int rebalanceRanks(sqlite3 *db, int projectID, const std::string &status);
+
+#endif // RANK_H
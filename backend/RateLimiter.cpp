@@ -0,0 +1,235 @@
+/**
+ * @file RateLimiter.cpp
+ * @brief Implementation of the RateLimiter class and the RateLimitGate middleware.
+ */
+
+#include "RateLimiter.h"
+#include "RequestKind.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <sstream>
+
+namespace {
+
+/**
+ * @brief Names of the route classes, as used on the command line.
+ */
+const char *CLASS_NAMES[] = {"read", "write", "bulk", "login", "debug"};
+
+/**
+ * @brief Seconds until a bucket gains the given number of tokens, rounded up.
+ *
+ * @param tokens Tokens missing.
+ * @param rate Tokens per second.
+ * @return int The seconds, an hour if the bucket never refills.
+ */
+int secondsFor(double tokens, double rate)
+{
+    if (tokens <= 0)
+        return 0;
+    if (rate <= 0)
+        return 3600;
+    return static_cast<int>(std::ceil(tokens / rate));
+}
+
+} // namespace
+
+/**
+ * @brief Creates the limiter.
+ *
+ * @param settings The limits.
+ */
+RateLimiter::RateLimiter(Settings settings) : settings(settings) {}
+
+/**
+ * @brief Refills the client's bucket for the time since its last use and takes a token.
+ *
+ * @param client Client key.
+ * @param routeClass The route class.
+ * @return Decision The outcome and the header values.
+ */
+RateLimiter::Decision RateLimiter::take(const std::string &client, RouteClass routeClass)
+{
+    const Limit &limit = settings.limits[routeClass];
+    std::string key = CLASS_NAMES[routeClass];
+    key += ' ';
+    key += client;
+    Shard &shard = shards[std::hash<std::string>()(key) % SHARDS];
+    Clock::time_point now = Clock::now();
+
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if (++shard.takes >= SWEEP_EVERY)
+    {
+        shard.takes = 0;
+        sweep(shard, now);
+    }
+
+    Bucket &bucket = shard.buckets.try_emplace(key, Bucket{limit.burst, now, routeClass}).first->second;
+    double elapsed = std::chrono::duration<double>(now - bucket.updated).count();
+    bucket.tokens = std::min(limit.burst, bucket.tokens + elapsed * limit.rate);
+    bucket.updated = now;
+
+    Decision decision{};
+    decision.limit = static_cast<int>(limit.burst);
+    decision.allowed = bucket.tokens >= 1;
+    if (decision.allowed)
+        bucket.tokens -= 1;
+    else
+    {
+        decision.retryAfterSeconds = secondsFor(1 - bucket.tokens, limit.rate);
+        limitedCount++;
+    }
+    decision.remaining = static_cast<int>(bucket.tokens);
+    decision.resetSeconds = secondsFor(limit.burst - bucket.tokens, limit.rate);
+    return decision;
+}
+
+/**
+ * @brief Number of buckets in all shards.
+ */
+size_t RateLimiter::buckets() const
+{
+    size_t total = 0;
+    for (const Shard &shard : shards)
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        total += shard.buckets.size();
+    }
+    return total;
+}
+
+/**
+ * @brief Formats the counters for /metrics.
+ *
+ * @return std::string Prometheus text lines.
+ */
+std::string RateLimiter::metrics() const
+{
+    std::ostringstream out;
+    out << "# HELP taskmaster_rate_limited_total Requests answered 429 by the rate limiter.\n"
+        << "# TYPE taskmaster_rate_limited_total counter\n"
+        << "taskmaster_rate_limited_total " << limitedCount.load() << "\n"
+        << "# HELP taskmaster_rate_limit_buckets Client buckets held by the rate limiter.\n"
+        << "# TYPE taskmaster_rate_limit_buckets gauge\n"
+        << "taskmaster_rate_limit_buckets " << buckets() << "\n";
+    return out.str();
+}
+
+/**
+ * @brief Parses "class=rate/burst", e.g. "bulk=2/5".
+ *
+ * @param spec The limit.
+ * @param settings The settings to update.
+ * @return bool false if spec is not valid.
+ */
+bool RateLimiter::parseLimit(const std::string &spec, Settings &settings)
+{
+    size_t equals = spec.find('=');
+    size_t slash = spec.find('/', equals);
+    if (equals == std::string::npos || slash == std::string::npos)
+        return false;
+
+    std::string name = spec.substr(0, equals);
+    double rate = std::atof(spec.substr(equals + 1, slash - equals - 1).c_str());
+    double burst = std::atof(spec.substr(slash + 1).c_str());
+    if (rate < 0 || burst < 1)
+        return false;
+
+    for (int i = 0; i < ROUTE_CLASSES; i++)
+    {
+        if (name == CLASS_NAMES[i])
+        {
+            settings.limits[i] = {rate, burst};
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Drops buckets that have refilled completely, they hold no state.
+ *
+ * @param shard The shard, locked by the caller.
+ * @param now The current time.
+ */
+void RateLimiter::sweep(Shard &shard, Clock::time_point now)
+{
+    for (auto it = shard.buckets.begin(); it != shard.buckets.end();)
+    {
+        const Limit &limit = settings.limits[it->second.routeClass];
+        double elapsed = std::chrono::duration<double>(now - it->second.updated).count();
+        if (it->second.tokens + elapsed * limit.rate >= limit.burst)
+            it = shard.buckets.erase(it);
+        else
+            ++it;
+    }
+}
+
+/**
+ * @brief Answers 429 when the client's bucket for the route class is empty.
+ *
+ * @param req The request.
+ * @param res The response, ended here when limited.
+ * @param ctx Receives the decision for after_handle().
+ */
+void RateLimitGate::before_handle(crow::request &req, crow::response &res, context &ctx)
+{
+    int routeClass = classify(req);
+    if (!limiter || routeClass == RateLimiter::ROUTE_CLASSES)
+        return;
+
+    ctx.limited = true;
+    ctx.decision = limiter->take(requestClient(req, trustForwardedFor), static_cast<RateLimiter::RouteClass>(routeClass));
+    if (ctx.decision.allowed)
+        return;
+    res = crow::response(429, "Too many requests, slow down");
+    res.set_header("Retry-After", std::to_string(ctx.decision.retryAfterSeconds));
+    res.end();
+}
+
+/**
+ * @brief Adds X-RateLimit-Limit, X-RateLimit-Remaining and X-RateLimit-Reset.
+ *
+ * @param res The response.
+ * @param ctx The decision taken in before_handle().
+ */
+void RateLimitGate::after_handle(crow::request &, crow::response &res, context &ctx)
+{
+    if (!ctx.limited)
+        return;
+    res.set_header("X-RateLimit-Limit", std::to_string(ctx.decision.limit));
+    res.set_header("X-RateLimit-Remaining", std::to_string(ctx.decision.remaining));
+    res.set_header("X-RateLimit-Reset", std::to_string(ctx.decision.resetSeconds));
+}
+
+/**
+ * @brief Route class of a request.
+ *
+ * Requests that do no database work are not limited. Admin pages count as reads or
+ * writes by their method.
+ *
+ * @param req The request.
+ * @return int The RateLimiter::RouteClass, or ROUTE_CLASSES if not limited.
+ */
+int RateLimitGate::classify(const crow::request &req)
+{
+    switch (requestKind(req))
+    {
+    case RequestKind::Free:
+        return RateLimiter::ROUTE_CLASSES;
+    case RequestKind::Debug:
+        return RateLimiter::DEBUG;
+    case RequestKind::Bulk:
+        return RateLimiter::BULK;
+    case RequestKind::Login:
+        return RateLimiter::LOGIN;
+    case RequestKind::Write:
+        return RateLimiter::WRITE;
+    case RequestKind::Admin:
+        return req.method == crow::HTTPMethod::Get ? RateLimiter::READ : RateLimiter::WRITE;
+    default:
+        return RateLimiter::READ;
+    }
+}
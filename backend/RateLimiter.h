@@ -0,0 +1,201 @@
+/**
+ * @file RateLimiter.h
+ * @brief Declaration of the RateLimiter class and the RateLimitGate middleware.
+ *
+ * Per-client token buckets, so one client stuck in a request loop is answered 429 after
+ * its burst instead of eating the capacity every other user shares.
+ */
+
+#ifndef RATELIMITER_H
+#define RATELIMITER_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "crow.h"
+
+/**
+ * @class RateLimiter
+ * @brief Token buckets per client and route class, in a sharded hash map.
+ *
+ * A bucket holds up to burst tokens and gains rate tokens per second; every request
+ * takes one. Buckets are refilled lazily when used, so there is no timer. A bucket that
+ * has been idle long enough to be full again is the same as no bucket, so idle buckets
+ * are dropped during a periodic sweep of their shard.
+ */
+class RateLimiter
+{
+public:
+    /**
+     * @brief Classes of routes, each with its own limit.
+     */
+    enum RouteClass
+    {
+        READ,       /**< Filtered GET routes */
+        WRITE,      /**< POST, PUT and DELETE routes */
+        BULK,       /**< GET routes scanning a whole table, reports, project export and import */
+        LOGIN,      /**< POST /auth/login */
+        DEBUG,      /**< The /debug routes */
+        ROUTE_CLASSES
+    };
+
+    /**
+     * @brief Sustained rate and burst of a route class.
+     */
+    struct Limit
+    {
+        double rate;        /**< Tokens added per second */
+        double burst;       /**< Bucket size */
+    };
+
+    /**
+     * @brief Limits of every route class.
+     */
+    struct Settings
+    {
+        std::array<Limit, ROUTE_CLASSES> limits{{
+            {50, 100},      // READ
+            {20, 40},       // WRITE
+            {2, 5},         // BULK
+            {1, 5},         // LOGIN
+            {0.1, 2},       // DEBUG
+        }};
+    };
+
+    /**
+     * @brief Outcome of a request against its bucket.
+     */
+    struct Decision
+    {
+        bool allowed;                   /**< The request may go on */
+        int limit;                      /**< Bucket size */
+        int remaining;                  /**< Whole tokens left */
+        int resetSeconds;               /**< Seconds until the bucket is full again */
+        int retryAfterSeconds;          /**< Seconds until the next token, 0 if allowed */
+    };
+
+    /**
+     * @brief Creates the limiter.
+     *
+     * @param settings The limits.
+     */
+    explicit RateLimiter(Settings settings);
+
+    /**
+     * @brief Takes a token from a client's bucket for a route class.
+     *
+     * @param client Client key, such as the peer address.
+     * @param routeClass The route class.
+     * @return Decision Whether the request is allowed, with the header values.
+     */
+    Decision take(const std::string &client, RouteClass routeClass);
+
+    /**
+     * @brief Number of buckets currently held.
+     */
+    size_t buckets() const;
+
+    /**
+     * @brief Total number of requests refused.
+     */
+    uint64_t limited() const { return limitedCount.load(); }
+
+    /**
+     * @brief Rate limiter counters in the Prometheus text format.
+     *
+     * @return std::string The metrics, one per line.
+     */
+    std::string metrics() const;
+
+    /**
+     * @brief Parses a limit given on the command line, such as "bulk=2/5".
+     *
+     * @param spec Route class name, "=", rate per second, "/", burst.
+     * @param settings The settings to update.
+     * @return bool false if spec is not valid.
+     */
+    static bool parseLimit(const std::string &spec, Settings &settings);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @brief Tokens of one client for one route class.
+     */
+    struct Bucket
+    {
+        double tokens;                  /**< Tokens at the last update */
+        Clock::time_point updated;      /**< Time of the last update */
+        RouteClass routeClass;          /**< Class whose limit applies */
+    };
+
+    /**
+     * @brief A slice of the buckets with its own lock.
+     */
+    struct alignas(64) Shard
+    {
+        mutable std::mutex mutex;                           /**< Guards buckets and takes */
+        std::unordered_map<std::string, Bucket> buckets;    /**< Buckets by class and client */
+        uint32_t takes = 0;                                 /**< Requests since the last sweep */
+    };
+
+    /**
+     * @brief Drops the buckets of a shard that are full again. Caller holds its lock.
+     */
+    void sweep(Shard &shard, Clock::time_point now);
+
+    static constexpr size_t SHARDS = 64;                    /**< Number of shards */
+    static constexpr uint32_t SWEEP_EVERY = 4096;           /**< Requests per shard between sweeps */
+
+    Settings settings;                                      /**< The limits */
+    std::array<Shard, SHARDS> shards;                       /**< The buckets */
+    std::atomic<uint64_t> limitedCount{0};                  /**< Requests refused */
+};
+
+/**
+ * @struct RateLimitGate
+ * @brief Crow middleware that applies the RateLimiter to every request.
+ *
+ * Sits next to crow::CORSHandler. Clients are keyed on the peer address, or on the first
+ * X-Forwarded-For address when the server runs behind a trusted proxy. Allowed responses
+ * carry X-RateLimit-Limit, X-RateLimit-Remaining and X-RateLimit-Reset; refused ones are
+ * 429 with Retry-After as well. Does nothing until limiter is set.
+ */
+struct RateLimitGate
+{
+    /**
+     * @brief Decision of the request, written as headers once the route answered.
+     */
+    struct context
+    {
+        bool limited = false;                               /**< A bucket was consulted */
+        RateLimiter::Decision decision{};                   /**< Its outcome */
+    };
+
+    RateLimiter *limiter = nullptr;                         /**< The limiter, set by main() */
+    bool trustForwardedFor = false;                         /**< Key clients on X-Forwarded-For */
+
+    /**
+     * @brief Takes a token, answering 429 if there is none.
+     */
+    void before_handle(crow::request &req, crow::response &res, context &ctx);
+
+    /**
+     * @brief Adds the rate limit headers to the route's response.
+     */
+    void after_handle(crow::request &req, crow::response &res, context &ctx);
+
+    /**
+     * @brief Route class of a request, or ROUTE_CLASSES for requests that are not limited.
+     *
+     * @param req The request.
+     * @return int The RateLimiter::RouteClass.
+     */
+    static int classify(const crow::request &req);
+};
+
+#endif // RATELIMITER_H
@@ -0,0 +1,56 @@
+/**
+ * @file RequestKind.cpp
+ * @brief Implementation of requestKind() and requestClient().
+ */
+
+#include "RequestKind.h"
+
+/**
+ * @brief Kind of a request.
+ *
+ * Unfiltered GET /tasks, GET /users, GET /projects and /reports/tasks scan a whole
+ * table, so they count as bulk with project export and import.
+ *
+ * @param req The request.
+ * @return RequestKind The kind.
+ */
+RequestKind requestKind(const crow::request &req)
+{
+    const std::string &url = req.url;
+    if (req.method == crow::HTTPMethod::Options || url == "/" || url == "/favicon.ico" || url == "/metrics" ||
+        url.rfind("/static/", 0) == 0)
+        return RequestKind::Free;
+    if (url.rfind("/admin/", 0) == 0)
+        return RequestKind::Admin;
+    if (url.rfind("/debug/", 0) == 0)
+        return RequestKind::Debug;
+    if (url == "/projects/import" || (url.size() > 7 && url.compare(url.size() - 7, 7, "/export") == 0))
+        return RequestKind::Bulk;
+    if (url == "/auth/login")
+        return RequestKind::Login;
+    if (req.method != crow::HTTPMethod::Get)
+        return RequestKind::Write;
+
+    bool filtered = req.url_params.get("project_id") || req.url_params.get("status") || req.url_params.get("priority");
+    if ((url == "/tasks" && !filtered) || url == "/users" || url == "/projects" || url == "/reports/tasks")
+        return RequestKind::Bulk;
+    return RequestKind::Read;
+}
+
+/**
+ * @brief The remote address of a request, or the client a trusted proxy forwarded it for.
+ *
+ * @param req The request.
+ * @param trustForwardedFor Use X-Forwarded-For when present.
+ * @return std::string The address.
+ */
+std::string requestClient(const crow::request &req, bool trustForwardedFor)
+{
+    if (trustForwardedFor)
+    {
+        const std::string &forwarded = req.get_header_value("X-Forwarded-For");
+        if (!forwarded.empty())
+            return forwarded.substr(0, forwarded.find(','));
+    }
+    return req.remote_ip_address;
+}
@@ -0,0 +1,45 @@
+/**
+ * @file RequestKind.h
+ * @brief Declaration of requestKind() and requestClient(), shared by the middlewares.
+ *
+ * The rate limiter and admission control treat a request by its kind, and the rate
+ * limiter and idempotency keys tell clients apart, so both are worked out here once.
+ */
+
+#ifndef REQUESTKIND_H
+#define REQUESTKIND_H
+
+#include "crow.h"
+
+/**
+ * @brief What a request does, from its method, path and filters.
+ */
+enum class RequestKind
+{
+    Free,       /**< CORS preflights, the health check, /metrics and frontend files, no database work */
+    Admin,      /**< The /admin/ pages */
+    Login,      /**< POST /auth/login */
+    Debug,      /**< The /debug/ routes */
+    Bulk,       /**< GET routes scanning a whole table, reports, project export and import */
+    Write,      /**< Other POST, PUT and DELETE routes */
+    Read        /**< Other GET routes */
+};
+
+/**
+ * @brief Kind of a request.
+ *
+ * @param req The request.
+ * @return RequestKind The kind.
+ */
+RequestKind requestKind(const crow::request &req);
+
+/**
+ * @brief Who sent a request.
+ *
+ * @param req The request.
+ * @param trustForwardedFor Use the first X-Forwarded-For address, for servers behind a proxy.
+ * @return std::string The client's address.
+ */
+std::string requestClient(const crow::request &req, bool trustForwardedFor);
+
+#endif // REQUESTKIND_H
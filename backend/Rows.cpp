@@ -0,0 +1,65 @@
+/**
+ * @file Rows.cpp
+ * @brief JSON forms of task and comment rows.
+ */
+
+#include "Rows.h"
+
+/**
+ * @brief Reads a text column, mapping NULL to an empty string.
+ *
+ * @param stmt The statement positioned on a row.
+ * @param col The column index.
+ * @return const char* The column text.
+ */
+const char *columnText(sqlite3_stmt *stmt, int col)
+{
+    const char *text = (const char *)sqlite3_column_text(stmt, col);
+    return text ? text : "";
+}
+
+/**
+ * @brief Converts a row selected with TASK_COLUMNS to JSON.
+ *
+ * @param stmt The statement positioned on a task row.
+ * @return crow::json::wvalue The task as JSON.
+ */
+crow::json::wvalue taskFromRow(sqlite3_stmt *stmt)
+{
+    crow::json::wvalue task;
+    task["id"] = sqlite3_column_int(stmt, 0);
+    task["title"] = columnText(stmt, 1);
+    task["description"] = columnText(stmt, 2);
+    task["due_date"] = columnText(stmt, 3);
+    task["priority"] = sqlite3_column_int(stmt, 4);
+    task["status"] = columnText(stmt, 5);
+    task["project_id"] = sqlite3_column_int(stmt, 6);
+    task["comment_count"] = sqlite3_column_int(stmt, 7);
+    if (sqlite3_column_type(stmt, 8) == SQLITE_NULL)
+        task["last_activity"] = nullptr;
+    else
+        task["last_activity"] = columnText(stmt, 8);
+    if (sqlite3_column_type(stmt, 9) == SQLITE_NULL)
+        task["rank"] = nullptr;
+    else
+        task["rank"] = columnText(stmt, 9);
+    return task;
+}
+
+/**
+ * @brief Converts a row selected with COMMENT_COLUMNS to JSON.
+ *
+ * @param stmt The statement positioned on a comment row.
+ * @return crow::json::wvalue The comment as JSON.
+ */
+crow::json::wvalue commentFromRow(sqlite3_stmt *stmt)
+{
+    crow::json::wvalue comment;
+    comment["id"] = sqlite3_column_int(stmt, 0);
+    comment["body"] = columnText(stmt, 1);
+    comment["date"] = columnText(stmt, 2);
+    comment["status"] = columnText(stmt, 3);
+    comment["user_id"] = sqlite3_column_int(stmt, 4);
+    comment["task_id"] = sqlite3_column_int(stmt, 5);
+    return comment;
+}
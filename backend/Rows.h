@@ -0,0 +1,72 @@
+/**
+ * @file Rows.h
+ * @brief Columns of the task and comment queries and how a row is encoded.
+ *
+ * A row is returned as JSON by taskFromRow() and commentFromRow(), or written straight
+ * to MessagePack with MsgPackWriter::row() and the fields below. Both encodings are
+ * defined here, next to each other, so they are changed together; the
+ * tools/check_msgpack_rows program checks that they agree.
+ */
+
+#ifndef ROWS_H
+#define ROWS_H
+
+#include "crow.h"
+#include <sqlite3.h>
+#include "MsgPack.h"
+
+/**
+ * @brief Columns selected by every task query, in the order taskFromRow() reads them.
+ */
+inline constexpr const char *TASK_COLUMNS = "tasks.id, tasks.title, tasks.description, tasks.due_date, tasks.priority, "
+                                            "tasks.status, tasks.project_id, tasks.comment_count, tasks.last_activity, tasks.rank";
+
+/**
+ * @brief Keys and encodings of TASK_COLUMNS for MessagePack, the same as taskFromRow().
+ */
+inline constexpr MsgPackWriter::Field TASK_FIELDS[] = {
+    {"id", MsgPackWriter::Kind::Integer}, {"title", MsgPackWriter::Kind::Text},
+    {"description", MsgPackWriter::Kind::Text}, {"due_date", MsgPackWriter::Kind::Text},
+    {"priority", MsgPackWriter::Kind::Integer}, {"status", MsgPackWriter::Kind::Text},
+    {"project_id", MsgPackWriter::Kind::Integer}, {"comment_count", MsgPackWriter::Kind::Integer},
+    {"last_activity", MsgPackWriter::Kind::NullableText}, {"rank", MsgPackWriter::Kind::NullableText}};
+
+/**
+ * @brief Columns selected by every comment query, in the order commentFromRow() reads them.
+ */
+inline constexpr const char *COMMENT_COLUMNS = "id, body, date, status, user_id, task_id";
+
+/**
+ * @brief Keys and encodings of COMMENT_COLUMNS for MessagePack, the same as commentFromRow().
+ */
+inline constexpr MsgPackWriter::Field COMMENT_FIELDS[] = {
+    {"id", MsgPackWriter::Kind::Integer}, {"body", MsgPackWriter::Kind::Text},
+    {"date", MsgPackWriter::Kind::Text}, {"status", MsgPackWriter::Kind::Text},
+    {"user_id", MsgPackWriter::Kind::Integer}, {"task_id", MsgPackWriter::Kind::Integer}};
+
+/**
+ * @brief Reads a text column, mapping NULL to an empty string.
+ *
+ * @param stmt The statement positioned on a row.
+ * @param col The column index.
+ * @return const char* The column text.
+ */
+const char *columnText(sqlite3_stmt *stmt, int col);
+
+/**
+ * @brief Converts a row selected with TASK_COLUMNS to JSON.
+ *
+ * @param stmt The statement positioned on a task row.
+ * @return crow::json::wvalue The task as JSON.
+ */
+crow::json::wvalue taskFromRow(sqlite3_stmt *stmt);
+
+/**
+ * @brief Converts a row selected with COMMENT_COLUMNS to JSON.
+ *
+ * @param stmt The statement positioned on a comment row.
+ * @return crow::json::wvalue The comment as JSON.
+ */
+crow::json::wvalue commentFromRow(sqlite3_stmt *stmt);
+
+#endif // ROWS_H
@@ -0,0 +1,222 @@
+/**
+ * @file Schema.cpp
+ * @brief Migrations for databases created by older versions of the server.
+ *
+ * Each step checks whether it is needed, so migrateSchema() can run on every start.
+ */
+
+#include "Schema.h"
+#include <iostream>
+#include <string>
+
+namespace {
+
+/**
+ * @brief Runs SQL and logs errors, like executeSQL in server.cpp.
+ *
+ * @param db The connection.
+ * @param sql The SQL to run.
+ * @return int SQLITE_OK if successful, or another SQLite error code.
+ */
+int run(sqlite3 *db, const char *sql)
+{
+    char *errMsg = nullptr;
+    int rc = sqlite3_exec(db, sql, nullptr, nullptr, &errMsg);
+    if (rc != SQLITE_OK)
+    {
+        std::cerr << "Migration error: " << errMsg << std::endl;
+        sqlite3_free(errMsg);
+    }
+    return rc;
+}
+
+/**
+ * @brief Checks whether a table has a column.
+ *
+ * @param db The connection.
+ * @param table The table name.
+ * @param column The column name.
+ * @return true if the column exists.
+ */
+bool hasColumn(sqlite3 *db, const std::string &table, const std::string &column)
+{
+    sqlite3_stmt *stmt;
+    std::string sql = "PRAGMA table_info(" + table + ");";
+    bool found = false;
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) == SQLITE_OK)
+    {
+        while (!found && sqlite3_step(stmt) == SQLITE_ROW)
+            found = column == (const char *)sqlite3_column_text(stmt, 1);
+        sqlite3_finalize(stmt);
+    }
+    return found;
+}
+
+/**
+ * @brief Checks whether a foreign key column of a table cascades on delete.
+ *
+ * @param db The connection.
+ * @param table The table holding the foreign key.
+ * @param column The foreign key column.
+ * @return true if the foreign key is ON DELETE CASCADE.
+ */
+bool cascadesOnDelete(sqlite3 *db, const std::string &table, const std::string &column)
+{
+    sqlite3_stmt *stmt;
+    std::string sql = "PRAGMA foreign_key_list(" + table + ");";
+    bool cascade = false;
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) == SQLITE_OK)
+    {
+        while (sqlite3_step(stmt) == SQLITE_ROW)
+        {
+            if (column == (const char *)sqlite3_column_text(stmt, 3))
+                cascade = std::string((const char *)sqlite3_column_text(stmt, 6)) == "CASCADE";
+        }
+        sqlite3_finalize(stmt);
+    }
+    return cascade;
+}
+
+/**
+ * @brief Reads PRAGMA user_version.
+ *
+ * @param db The connection.
+ * @return int The version, 0 for databases that never set one.
+ */
+int userVersion(sqlite3 *db)
+{
+    sqlite3_stmt *stmt;
+    int version = 0;
+    if (sqlite3_prepare_v2(db, "PRAGMA user_version;", -1, &stmt, nullptr) == SQLITE_OK)
+    {
+        if (sqlite3_step(stmt) == SQLITE_ROW)
+            version = sqlite3_column_int(stmt, 0);
+        sqlite3_finalize(stmt);
+    }
+    return version;
+}
+
+} // namespace
+
+/**
+ * @brief Brings an older database up to date.
+ *
+ * @param db The connection to migrate, with foreign keys disabled.
+ * @return int SQLITE_OK if successful, or another SQLite error code.
+ */
+int migrateSchema(sqlite3 *db)
+{
+    // Denormalized comment stats on tasks
+    if (!hasColumn(db, "tasks", "comment_count"))
+    {
+        int rc = run(db, R"(
+            BEGIN;
+            ALTER TABLE tasks ADD COLUMN comment_count INTEGER NOT NULL DEFAULT 0;
+            ALTER TABLE tasks ADD COLUMN last_activity TEXT;
+            COMMIT;
+        )");
+        if (rc != SQLITE_OK)
+        {
+            run(db, "ROLLBACK;");
+            return rc;
+        }
+        if ((rc = run(db, BACKFILL_COMMENT_STATS_SQL)) != SQLITE_OK)
+            return rc;
+    }
+
+    // comments.task_id used to be created without ON DELETE CASCADE, which SQLite
+    // cannot alter, so the table is rebuilt once
+    if (!cascadesOnDelete(db, "comments", "task_id"))
+    {
+        int rc = run(db, R"(
+            BEGIN;
+            CREATE TABLE comments_migrated (
+                id INTEGER PRIMARY KEY AUTOINCREMENT,
+                body TEXT NOT NULL,
+                date TEXT,
+                status TEXT DEFAULT 'active',
+                user_id INTEGER,
+                task_id INTEGER,
+                FOREIGN KEY (user_id) REFERENCES users(id),
+                FOREIGN KEY (task_id) REFERENCES tasks(id) ON DELETE CASCADE
+            );
+            INSERT INTO comments_migrated (id, body, date, status, user_id, task_id)
+                SELECT id, body, date, status, user_id, task_id FROM comments;
+            DROP TABLE comments;
+            ALTER TABLE comments_migrated RENAME TO comments;
+            COMMIT;
+        )");
+        if (rc != SQLITE_OK)
+        {
+            run(db, "ROLLBACK;");
+            return rc;
+        }
+    }
+
+    // Soft deletes record when they happened so they can be purged later
+    if (!hasColumn(db, "comments", "deleted_at"))
+    {
+        // Comments deleted before this existed start their retention window now
+        int rc = run(db, R"(
+            BEGIN;
+            ALTER TABLE comments ADD COLUMN deleted_at TEXT;
+            UPDATE comments SET deleted_at = datetime('now') WHERE status = 'deleted';
+            COMMIT;
+        )");
+        if (rc != SQLITE_OK)
+        {
+            run(db, "ROLLBACK;");
+            return rc;
+        }
+    }
+
+    // Manual card order within a board column
+    if (!hasColumn(db, "tasks", "rank"))
+    {
+        int rc = run(db, "ALTER TABLE tasks ADD COLUMN rank TEXT;");
+        if (rc != SQLITE_OK)
+            return rc;
+        if ((rc = run(db, BACKFILL_RANKS_SQL)) != SQLITE_OK)
+            return rc;
+    }
+    else if (userVersion(db) < 1)
+    {
+        // Keys used to be bare fractions, which become fractions of the integer "a0";
+        // trailing zeros go as they leave no room below a key
+        int rc = run(db, R"(
+            BEGIN;
+            UPDATE tasks SET rank = 'a0' || rtrim(rank, '0') WHERE rank IS NOT NULL;
+            UPDATE tasks_archive SET rank = 'a0' || rtrim(rank, '0') WHERE rank IS NOT NULL;
+            COMMIT;
+        )");
+        if (rc != SQLITE_OK)
+        {
+            run(db, "ROLLBACK;");
+            return rc;
+        }
+    }
+
+    // When a task was completed, so it can be archived once it is old enough
+    if (!hasColumn(db, "tasks", "completed_at"))
+    {
+        int rc = run(db, "ALTER TABLE tasks ADD COLUMN completed_at TEXT;");
+        if (rc != SQLITE_OK)
+            return rc;
+        if ((rc = run(db, BACKFILL_COMPLETED_AT_SQL)) != SQLITE_OK)
+            return rc;
+    }
+
+    // Overdue flag of open tasks past their due date, the outbox table is created by SCHEMA_SQL
+    if (!hasColumn(db, "tasks", "overdue"))
+    {
+        int rc = run(db, "ALTER TABLE tasks ADD COLUMN overdue INTEGER NOT NULL DEFAULT 0;");
+        if (rc != SQLITE_OK)
+            return rc;
+        if ((rc = run(db, BACKFILL_OVERDUE_SQL)) != SQLITE_OK)
+            return rc;
+    }
+
+    if (userVersion(db) < SCHEMA_VERSION)
+        return run(db, ("PRAGMA user_version = " + std::to_string(SCHEMA_VERSION) + ";").c_str());
+    return SQLITE_OK;
+}
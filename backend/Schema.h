@@ -0,0 +1,260 @@
+/**
+ * @file Schema.h
+ * @brief SQL schema of taskmaster.db.
+ *
+ * The schema is shared between the server and the offline tools in backend/tools
+ * so that every database they create has exactly the tables the server expects.
+ *
+ * It comes in two parts: SCHEMA_SQL creates the tables, and SCHEMA_INDEXES_SQL creates
+ * the indexes and triggers. Databases created by older versions of the server are
+ * brought up to date by migrateSchema() in between, before anything refers to the new
+ * columns. Bulk loaders can also create the indexes after loading, which is much faster.
+ */
+
+#ifndef SCHEMA_H
+#define SCHEMA_H
+
+#include <sqlite3.h>
+
+/**
+ * @brief Statements that create every table of the database if it does not exist yet.
+ */
+inline constexpr const char *SCHEMA_SQL = R"(
+        CREATE TABLE IF NOT EXISTS users (
+            id INTEGER PRIMARY KEY AUTOINCREMENT,
+            name TEXT NOT NULL,
+            email TEXT UNIQUE NOT NULL,
+            password TEXT NOT NULL
+        );
+
+        CREATE TABLE IF NOT EXISTS projects (
+            id INTEGER PRIMARY KEY AUTOINCREMENT,
+            deadline TEXT NOT NULL,
+            date TEXT,
+            completion_status BOOLEAN DEFAULT 0
+        );
+
+        CREATE TABLE IF NOT EXISTS user_projects (
+            user_id INTEGER,
+            project_id INTEGER,
+            PRIMARY KEY (user_id, project_id),
+            FOREIGN KEY (user_id) REFERENCES users(id) ON DELETE CASCADE,
+            FOREIGN KEY (project_id) REFERENCES projects(id) ON DELETE CASCADE
+        );
+
+        CREATE TABLE IF NOT EXISTS tasks (
+            id INTEGER PRIMARY KEY AUTOINCREMENT,
+            title TEXT NOT NULL,
+            description TEXT,
+            due_date TEXT,
+            priority INTEGER DEFAULT 1,
+            status TEXT DEFAULT 'pending',
+            project_id INTEGER,
+            comment_count INTEGER NOT NULL DEFAULT 0,
+            last_activity TEXT,
+            rank TEXT,
+            completed_at TEXT,
+            overdue INTEGER NOT NULL DEFAULT 0,
+            FOREIGN KEY (project_id) REFERENCES projects(id) ON DELETE CASCADE
+        );
+
+        CREATE TABLE IF NOT EXISTS comments (
+            id INTEGER PRIMARY KEY AUTOINCREMENT,
+            body TEXT NOT NULL,
+            date TEXT,
+            status TEXT DEFAULT 'active',
+            user_id INTEGER,
+            task_id INTEGER,
+            deleted_at TEXT,
+            FOREIGN KEY (user_id) REFERENCES users(id),
+            FOREIGN KEY (task_id) REFERENCES tasks(id) ON DELETE CASCADE
+        );
+
+        CREATE TABLE IF NOT EXISTS tasks_archive (
+            id INTEGER PRIMARY KEY,
+            title TEXT NOT NULL,
+            description TEXT,
+            due_date TEXT,
+            priority INTEGER DEFAULT 1,
+            status TEXT DEFAULT 'pending',
+            project_id INTEGER,
+            comment_count INTEGER NOT NULL DEFAULT 0,
+            last_activity TEXT,
+            rank TEXT,
+            completed_at TEXT,
+            archived_at TEXT NOT NULL,
+            FOREIGN KEY (project_id) REFERENCES projects(id) ON DELETE CASCADE
+        );
+
+        CREATE TABLE IF NOT EXISTS comments_archive (
+            id INTEGER PRIMARY KEY,
+            body TEXT NOT NULL,
+            date TEXT,
+            status TEXT DEFAULT 'active',
+            user_id INTEGER,
+            task_id INTEGER,
+            deleted_at TEXT,
+            FOREIGN KEY (user_id) REFERENCES users(id),
+            FOREIGN KEY (task_id) REFERENCES tasks_archive(id) ON DELETE CASCADE
+        );
+
+        CREATE TABLE IF NOT EXISTS outbox (
+            id INTEGER PRIMARY KEY AUTOINCREMENT,
+            event TEXT NOT NULL,
+            task_id INTEGER NOT NULL,
+            project_id INTEGER,
+            due_date TEXT NOT NULL,
+            created_at TEXT NOT NULL,
+            UNIQUE (task_id, event, due_date)
+        );
+    )";
+
+/**
+ * @brief Statements that create the indexes and triggers, run after the tables exist.
+ *
+ * The comment triggers keep tasks.comment_count (active comments only) and
+ * tasks.last_activity up to date, so task lists never need a per-task subquery.
+ * idx_tasks_column returns a board column already sorted by rank, and the partial
+ * idx_tasks_rank_rebalance holds only tasks whose column needs new rank keys (see Rank.h).
+ *
+ * tasks.completed_at is set by trigger when a task becomes completed and cleared when it
+ * is reopened; the partial idx_tasks_completed holds only completed tasks, in the order
+ * Maintenance moves them to tasks_archive.
+ *
+ * tasks.overdue is 1 for open tasks whose due date has passed. The triggers set it when a
+ * task is written with a past due date and clear it when the task is completed or its due
+ * date moves on; DeadlineScheduler sets it when a due date passes. The partial
+ * idx_tasks_overdue holds only overdue tasks, so overdue lists never compare dates.
+ */
+inline constexpr const char *SCHEMA_INDEXES_SQL = R"(
+        CREATE INDEX IF NOT EXISTS idx_comments_task ON comments(task_id, id);
+        DROP INDEX IF EXISTS idx_tasks_project;
+        CREATE INDEX IF NOT EXISTS idx_tasks_column ON tasks(project_id, status, rank);
+        CREATE INDEX IF NOT EXISTS idx_tasks_rank_rebalance ON tasks(project_id, status)
+            WHERE rank IS NULL OR length(rank) > 24;
+        CREATE INDEX IF NOT EXISTS idx_comments_deleted ON comments(deleted_at) WHERE status = 'deleted';
+        CREATE INDEX IF NOT EXISTS idx_tasks_completed ON tasks(completed_at) WHERE completed_at IS NOT NULL;
+        CREATE INDEX IF NOT EXISTS idx_tasks_archive_column ON tasks_archive(project_id, status, rank);
+        CREATE INDEX IF NOT EXISTS idx_comments_archive_task ON comments_archive(task_id, id);
+        CREATE INDEX IF NOT EXISTS idx_tasks_overdue ON tasks(project_id, due_date) WHERE overdue = 1;
+
+        CREATE TRIGGER IF NOT EXISTS tasks_completed_insert AFTER INSERT ON tasks
+        WHEN NEW.status = 'completed' AND NEW.completed_at IS NULL
+        BEGIN
+            UPDATE tasks SET completed_at = datetime('now') WHERE id = NEW.id;
+        END;
+
+        CREATE TRIGGER IF NOT EXISTS tasks_completed_update AFTER UPDATE OF status ON tasks
+        WHEN NEW.status IS NOT OLD.status
+        BEGIN
+            UPDATE tasks SET completed_at = CASE WHEN NEW.status = 'completed' THEN datetime('now') END
+            WHERE id = NEW.id;
+        END;
+
+        CREATE TRIGGER IF NOT EXISTS tasks_overdue_insert AFTER INSERT ON tasks
+        WHEN NEW.status IS NOT 'completed' AND NEW.due_date GLOB '[0-9][0-9][0-9][0-9]-[0-9][0-9]-[0-9][0-9]*'
+             AND NEW.due_date < date('now')
+        BEGIN
+            UPDATE tasks SET overdue = 1 WHERE id = NEW.id;
+        END;
+
+        CREATE TRIGGER IF NOT EXISTS tasks_overdue_update AFTER UPDATE OF due_date, status ON tasks
+        BEGIN
+            UPDATE tasks SET overdue = CASE WHEN NEW.status IS NOT 'completed'
+                                                 AND NEW.due_date GLOB '[0-9][0-9][0-9][0-9]-[0-9][0-9]-[0-9][0-9]*'
+                                                 AND NEW.due_date < date('now') THEN 1 ELSE 0 END
+            WHERE id = NEW.id;
+        END;
+
+        CREATE TRIGGER IF NOT EXISTS comments_after_insert AFTER INSERT ON comments
+        BEGIN
+            UPDATE tasks SET comment_count = comment_count + (NEW.status = 'active'),
+                             last_activity = datetime('now')
+            WHERE id = NEW.task_id;
+        END;
+
+        CREATE TRIGGER IF NOT EXISTS comments_after_update AFTER UPDATE OF body, status ON comments
+        BEGIN
+            UPDATE tasks SET comment_count = comment_count + (NEW.status = 'active') - (OLD.status = 'active'),
+                             last_activity = datetime('now')
+            WHERE id = NEW.task_id;
+        END;
+
+        CREATE TRIGGER IF NOT EXISTS comments_after_delete AFTER DELETE ON comments
+        WHEN OLD.status = 'active'
+        BEGIN
+            UPDATE tasks SET comment_count = comment_count - 1 WHERE id = OLD.task_id;
+        END;
+    )";
+
+/**
+ * @brief Recomputes tasks.comment_count and tasks.last_activity from the comments table.
+ *
+ * Used when the columns are first added and by bulk loaders that insert comments
+ * before the triggers exist.
+ */
+inline constexpr const char *BACKFILL_COMMENT_STATS_SQL = R"(
+        UPDATE tasks SET comment_count = stats.active, last_activity = stats.last
+        FROM (SELECT task_id, sum(status = 'active') AS active, max(date) AS last
+              FROM comments GROUP BY task_id) AS stats
+        WHERE stats.task_id = tasks.id;
+    )";
+
+/**
+ * @brief PRAGMA user_version of an up-to-date database.
+ *
+ * Version 1 rank keys start with an integer (see Rank.h). Bulk loaders that write
+ * their own ranks set it, so migrateSchema() does not convert those keys again.
+ */
+inline constexpr int SCHEMA_VERSION = 1;
+
+/**
+ * @brief Gives every task a rank that keeps its column in ID order.
+ *
+ * Used when the rank column is first added and by bulk loaders that insert tasks
+ * without ranks. 'j' starts a ten-digit integer key, and ten decimal digits sort like
+ * the numbers, so new cards appended to the column simply count on from there.
+ */
+inline constexpr const char *BACKFILL_RANKS_SQL = R"(
+        UPDATE tasks SET rank = ranked.rank
+        FROM (SELECT id, 'j' || printf('%010d', row_number() OVER (PARTITION BY project_id, status ORDER BY id)) AS rank
+              FROM tasks) AS ranked
+        WHERE ranked.id = tasks.id;
+    )";
+
+/**
+ * @brief Starts the archive clock of completed tasks that have no completed_at.
+ *
+ * Used when the column is first added and by bulk loaders that insert tasks before
+ * the triggers exist. When those tasks were completed is not known, so they count
+ * as completed now.
+ */
+inline constexpr const char *BACKFILL_COMPLETED_AT_SQL = R"(
+        UPDATE tasks SET completed_at = datetime('now') WHERE status = 'completed' AND completed_at IS NULL;
+    )";
+
+/**
+ * @brief Sets tasks.overdue from the due dates, as of today.
+ *
+ * Used when the column is first added and by bulk loaders that insert tasks before the
+ * triggers exist. Only rows whose flag changes are written.
+ */
+inline constexpr const char *BACKFILL_OVERDUE_SQL = R"(
+        UPDATE tasks SET overdue = 1 - overdue
+        WHERE overdue IS NOT (CASE WHEN status IS NOT 'completed'
+                                        AND due_date GLOB '[0-9][0-9][0-9][0-9]-[0-9][0-9]-[0-9][0-9]*'
+                                        AND due_date < date('now') THEN 1 ELSE 0 END);
+    )";
+
+/**
+ * @brief Brings a database created by an older version of the server up to date.
+ *
+ * Adds missing columns and rebuilds tables whose constraints changed. Must run after
+ * SCHEMA_SQL and before SCHEMA_INDEXES_SQL, with foreign keys disabled on the connection.
+ *
+ * @param db The connection to migrate.
+ * @return int SQLITE_OK if successful, or another SQLite error code.
+ */
+int migrateSchema(sqlite3 *db);
+
+#endif // SCHEMA_H
@@ -0,0 +1,331 @@
+/**
+ * @file ShardSet.cpp
+ * @brief Implementation of the ShardSet class.
+ */
+
+#include "ShardSet.h"
+#include "MsgPack.h"
+#include <algorithm>
+#include <iostream>
+#include <mutex>
+
+/**
+ * @brief Names the shard files.
+ *
+ * @param mainPath Path of shard 0.
+ * @param count Number of shards.
+ */
+ShardSet::ShardSet(const std::string &mainPath, int count)
+{
+    count = std::max(1, std::min(count, MAX_SHARDS));
+    shards.resize(count);
+    for (int i = 0; i < count; i++)
+    {
+        shards[i].index = i;
+        shards[i].path = pathOf(mainPath, i);
+    }
+}
+
+/**
+ * @brief Inserts the shard number before the extension of mainPath.
+ *
+ * @param mainPath Path of shard 0.
+ * @param index The shard.
+ * @return std::string The path of the shard file.
+ */
+std::string ShardSet::pathOf(const std::string &mainPath, int index)
+{
+    if (index == 0)
+        return mainPath;
+    size_t dot = mainPath.rfind('.');
+    size_t slash = mainPath.find_last_of("/\\");
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+        return mainPath + "." + std::to_string(index);
+    return mainPath.substr(0, dot) + "." + std::to_string(index) + mainPath.substr(dot);
+}
+
+/**
+ * @brief Seeds the AUTOINCREMENT counters of a shard and checks its ID range.
+ *
+ * @param db A connection to the shard file.
+ * @param index The shard.
+ * @param error Receives the reason on failure.
+ * @return bool true if every ID is in the shard's range.
+ */
+bool ShardSet::prepare(sqlite3 *db, int index, std::string &error)
+{
+    const char *tables[] = {"projects", "tasks", "comments"};
+    long long first = firstId(index);
+    long long end = firstId(index + 1);
+    for (const char *table : tables)
+    {
+        sqlite3_stmt *stmt;
+        std::string sql = std::string("SELECT min(id), max(id) FROM ") + table + ";";
+        if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK)
+        {
+            error = sqlite3_errmsg(db);
+            return false;
+        }
+        bool outside = sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_type(stmt, 0) != SQLITE_NULL &&
+                       (sqlite3_column_int64(stmt, 0) <= first || sqlite3_column_int64(stmt, 1) >= end);
+        sqlite3_finalize(stmt);
+        if (outside)
+        {
+            error = std::string(table) + " has IDs of another shard, " +
+                    (index == 0 ? "start with the --shards it was split for" : "split the database with split_shards");
+            return false;
+        }
+    }
+    if (index == 0)
+        return true;
+
+    std::string seed = "INSERT INTO sqlite_sequence (name, seq) "
+                       "SELECT column1, " + std::to_string(first) + " FROM (VALUES ('projects'), ('tasks'), ('comments')) "
+                       "WHERE column1 NOT IN (SELECT name FROM sqlite_sequence); "
+                       "UPDATE sqlite_sequence SET seq = " + std::to_string(first) +
+                       " WHERE name IN ('projects', 'tasks', 'comments') AND seq < " + std::to_string(first) + ";";
+    char *message = nullptr;
+    if (sqlite3_exec(db, seed.c_str(), nullptr, nullptr, &message) != SQLITE_OK)
+    {
+        error = message ? message : "Can't seed sqlite_sequence";
+        sqlite3_free(message);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Deletes users that are gone from shard 0 and inserts the missing ones.
+ *
+ * Users are only created and deleted, never changed, so comparing IDs is enough. Users
+ * that still wrote comments on this shard are kept, as on shard 0 they could not be
+ * deleted either. With foreign keys on, deleting a user also drops their memberships.
+ *
+ * @param db A connection to the shard file.
+ * @param mainPath Path of shard 0.
+ * @return int SQLITE_OK or the SQLite error code.
+ */
+int ShardSet::copyUsers(sqlite3 *db, const std::string &mainPath)
+{
+    sqlite3_stmt *stmt;
+    int rc = sqlite3_prepare_v2(db, "ATTACH DATABASE ? AS home;", -1, &stmt, nullptr);
+    if (rc != SQLITE_OK)
+        return rc;
+    sqlite3_bind_text(stmt, 1, mainPath.c_str(), -1, SQLITE_TRANSIENT);
+    rc = sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+    if (rc != SQLITE_DONE)
+        return rc;
+
+    rc = sqlite3_exec(db, R"(
+        BEGIN;
+        DELETE FROM main.users WHERE id NOT IN (SELECT id FROM home.users)
+            AND id NOT IN (SELECT user_id FROM main.comments WHERE user_id IS NOT NULL
+                           UNION SELECT user_id FROM main.comments_archive WHERE user_id IS NOT NULL);
+        INSERT OR IGNORE INTO main.users (id, name, email, password)
+            SELECT id, name, email, password FROM home.users;
+        COMMIT;
+    )", nullptr, nullptr, nullptr);
+    if (rc != SQLITE_OK)
+        sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
+    sqlite3_exec(db, "DETACH DATABASE home;", nullptr, nullptr, nullptr);
+    return rc;
+}
+
+/**
+ * @brief Creates the read and write pools of every shard.
+ */
+void ShardSet::open(unsigned readers, size_t readQueue, std::chrono::milliseconds readTimeout,
+                    size_t writeQueue, std::chrono::milliseconds writeTimeout)
+{
+    for (Shard &shard : shards)
+    {
+        shard.readers = std::make_unique<DbExecutor>(shard.path, readers, readQueue, readTimeout);
+        shard.writer = std::make_unique<DbExecutor>(shard.path, 1, writeQueue, writeTimeout);
+    }
+}
+
+/**
+ * @brief Drains and stops the pools of every shard.
+ */
+void ShardSet::close()
+{
+    for (Shard &shard : shards)
+    {
+        shard.readers.reset();
+        shard.writer.reset();
+    }
+}
+
+/**
+ * @brief The shard an ID belongs to, shard 0 for IDs of no configured shard.
+ *
+ * @param id A project, task or comment ID.
+ * @return Shard& The shard.
+ */
+ShardSet::Shard &ShardSet::of(long long id)
+{
+    int index = indexOf(id);
+    return shards[index < count() ? index : 0];
+}
+
+/**
+ * @brief Picks the shards for new projects round-robin.
+ *
+ * @return Shard& The shard.
+ */
+ShardSet::Shard &ShardSet::place()
+{
+    return shards[nextPlacement++ % shards.size()];
+}
+
+/**
+ * @brief Runs a query on every shard and completes res with the merged responses.
+ *
+ * @param res The pending response.
+ * @param pool Which pool runs the query.
+ * @param query The query.
+ * @param merge Combines the responses.
+ */
+void ShardSet::gather(crow::response &res, Pool pool, DbExecutor::Query query, Merge merge)
+{
+    std::vector<int> indexes(shards.size());
+    for (size_t i = 0; i < shards.size(); i++)
+        indexes[i] = (int)i;
+    gather(res, pool, indexes, std::move(query), std::move(merge));
+}
+
+/**
+ * @brief Runs a query on the given shards and completes res with the merged responses.
+ *
+ * @param res The pending response.
+ * @param pool Which pool runs the query.
+ * @param indexes The shards to ask.
+ * @param query The query.
+ * @param merge Combines the responses.
+ */
+void ShardSet::gather(crow::response &res, Pool pool, const std::vector<int> &indexes, DbExecutor::Query query,
+                      Merge merge)
+{
+    auto executor = [pool](Shard &shard) -> DbExecutor &
+    { return pool == Pool::Read ? *shard.readers : *shard.writer; };
+    if (indexes.size() == 1)
+    {
+        executor(shards[indexes[0]]).respond(res, std::move(query));
+        return;
+    }
+
+    struct Gathered
+    {
+        std::mutex mutex;
+        std::vector<crow::response> parts;
+        size_t remaining;
+    };
+    auto gathered = std::make_shared<Gathered>();
+    gathered->parts.resize(indexes.size());
+    gathered->remaining = indexes.size();
+
+    // Runs on the worker of whichever shard finishes last
+    auto store = [gathered, &res, merge](size_t index, crow::response part)
+    {
+        std::unique_lock<std::mutex> lock(gathered->mutex);
+        gathered->parts[index] = std::move(part);
+        if (--gathered->remaining > 0)
+            return;
+        lock.unlock();
+        crow::response merged = merge(gathered->parts);
+        res = std::move(merged);
+        res.end();
+    };
+
+    for (size_t i = 0; i < indexes.size(); i++)
+    {
+        bool queued = executor(shards[indexes[i]]).evaluate(query, [store, i](crow::response part)
+                                                   { store(i, std::move(part)); });
+        if (!queued)
+        {
+            crow::response busy(503, "Server busy, try again later");
+            busy.add_header("Retry-After", "1");
+            store(i, std::move(busy));
+        }
+    }
+}
+
+/**
+ * @brief Posts a job to the write pool of every shard after shard 0.
+ *
+ * A shard whose queue is full is waited for rather than skipped, since its memberships
+ * and comments of the user would fail their foreign key until the next start. Called
+ * from shard 0's writer, which no other shard's writer waits on.
+ *
+ * @param job The write.
+ */
+void ShardSet::replicate(const DbExecutor::Job &job)
+{
+    for (size_t i = 1; i < shards.size(); i++)
+    {
+        if (!shards[i].writer->postWhenRoom(job))
+            std::cerr << "Shard " << i << " is shutting down, a user change is copied on the next start" << std::endl;
+    }
+}
+
+/**
+ * @brief Joins the arrays of every part in shard order.
+ *
+ * The parts are spliced as text or bytes, without parsing the rows.
+ *
+ * @param parts The responses of every shard.
+ * @return crow::response The merged list, or the first failed part.
+ */
+crow::response ShardSet::concatenate(std::vector<crow::response> &parts)
+{
+    for (crow::response &part : parts)
+    {
+        if (part.code != 200)
+            return std::move(part);
+    }
+
+    if (parts[0].get_header_value("Content-Type") == MSGPACK_CONTENT_TYPE)
+    {
+        uint32_t total = 0;
+        std::vector<std::string_view> values;
+        for (crow::response &part : parts)
+        {
+            uint32_t n;
+            size_t header;
+            if (!MsgPackWriter::readArrayHeader(part.body, n, header))
+                return crow::response(500, "Can't merge shard results");
+            total += n;
+            values.push_back(std::string_view(part.body).substr(header));
+        }
+        MsgPackWriter out;
+        out.arrayHeader(total);
+        for (std::string_view value : values)
+            out.raw(value);
+        crow::response merged(200);
+        merged.body = out.take();
+        merged.set_header("Content-Type", MSGPACK_CONTENT_TYPE);
+        merged.set_header("Vary", "Accept");
+        return merged;
+    }
+
+    std::string body = "[";
+    for (crow::response &part : parts)
+    {
+        const std::string &list = part.body;
+        size_t open = list.find_first_not_of(" \t\r\n");
+        size_t close = list.find_last_not_of(" \t\r\n");
+        if (open == std::string::npos || list[open] != '[' || list[close] != ']')
+            return crow::response(500, "Can't merge shard results");
+        size_t first = list.find_first_not_of(" \t\r\n", open + 1);
+        if (first == close)
+            continue;
+        if (body.size() > 1)
+            body += ',';
+        body.append(list, open + 1, close - open - 1);
+    }
+    body += ']';
+    crow::response merged(200, body);
+    merged.set_header("Content-Type", "application/json");
+    return merged;
+}
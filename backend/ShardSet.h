@@ -0,0 +1,210 @@
+/**
+ * @file ShardSet.h
+ * @brief Declaration of the ShardSet class.
+ *
+ * With --shards <n>, projects are spread over n SQLite files: taskmaster.db and
+ * taskmaster.1.db to taskmaster.<n-1>.db. Each file has its own read and write pools, so
+ * writes to projects on different shards commit in parallel instead of queueing for one
+ * write lock.
+ *
+ * A project lives on one shard together with its memberships, tasks and comments, and
+ * every row gets its ID from a range reserved for that shard, so the shard of a project,
+ * task or comment follows from its ID alone. Users are kept on shard 0 and copied to the
+ * other shards, whose memberships and comments refer to them.
+ */
+
+#ifndef SHARDSET_H
+#define SHARDSET_H
+
+#include <sqlite3.h>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "crow.h"
+#include "DbExecutor.h"
+
+/**
+ * @class ShardSet
+ * @brief The shard files, their pools, and routing of IDs and queries to them.
+ */
+class ShardSet
+{
+public:
+    static constexpr int ID_SPAN = 100000000;       /**< IDs reserved for each shard */
+    static constexpr int MAX_SHARDS = 21;           /**< Shards whose IDs fit in an int */
+
+    /**
+     * @brief One database file and its pools.
+     */
+    struct Shard
+    {
+        int index = 0;                              /**< Position in the set, 0 holds the users */
+        std::string path;                           /**< The database file */
+        std::unique_ptr<DbExecutor> readers;        /**< Workers serving reads */
+        std::unique_ptr<DbExecutor> writer;         /**< Single worker serializing writes */
+    };
+
+    /**
+     * @brief Which pool of a shard runs a query.
+     */
+    enum class Pool
+    {
+        Read,
+        Write
+    };
+
+    /**
+     * @brief Combines the responses of every shard into one, in shard order.
+     */
+    using Merge = std::function<crow::response(std::vector<crow::response> &parts)>;
+
+    /**
+     * @brief Names the shard files, call open() to start their pools.
+     *
+     * @param mainPath Path of shard 0, the other files are named after it.
+     * @param count Number of shards, 1 to MAX_SHARDS.
+     */
+    ShardSet(const std::string &mainPath, int count);
+
+    /**
+     * @brief Path of a shard file: mainPath itself for shard 0, "taskmaster.2.db" for shard 2.
+     *
+     * @param mainPath Path of shard 0.
+     * @param index The shard.
+     * @return std::string The path.
+     */
+    static std::string pathOf(const std::string &mainPath, int index);
+
+    /**
+     * @brief Shard of a project, task or comment ID.
+     */
+    static int indexOf(long long id) { return id > 0 ? static_cast<int>(id / ID_SPAN) : 0; }
+
+    /**
+     * @brief First ID reserved for a shard.
+     */
+    static long long firstId(int index) { return static_cast<long long>(index) * ID_SPAN; }
+
+    /**
+     * @brief Makes a shard file allocate IDs from its own range.
+     *
+     * Seeds sqlite_sequence so AUTOINCREMENT continues from the start of the range, and
+     * checks that no project, task or comment already has an ID outside of it.
+     *
+     * @param db A connection to the shard file.
+     * @param index The shard.
+     * @param error Receives the reason on failure.
+     * @return bool false if the file holds rows of another shard.
+     */
+    static bool prepare(sqlite3 *db, int index, std::string &error);
+
+    /**
+     * @brief Makes the users of a shard file match those of shard 0.
+     *
+     * Run at startup, so a user change one shard missed is applied then.
+     *
+     * @param db A connection to the shard file, not shard 0.
+     * @param mainPath Path of shard 0.
+     * @return int SQLITE_OK or the SQLite error code.
+     */
+    static int copyUsers(sqlite3 *db, const std::string &mainPath);
+
+    /**
+     * @brief Starts the pools of every shard.
+     *
+     * @param readers Read workers per shard.
+     * @param readQueue Read queue capacity per shard.
+     * @param readTimeout Default deadline of a read.
+     * @param writeQueue Write queue capacity per shard.
+     * @param writeTimeout Default deadline of a write.
+     */
+    void open(unsigned readers, size_t readQueue, std::chrono::milliseconds readTimeout,
+              size_t writeQueue, std::chrono::milliseconds writeTimeout);
+
+    /**
+     * @brief Stops the pools of every shard.
+     */
+    void close();
+
+    /**
+     * @brief Number of shards.
+     */
+    int count() const { return static_cast<int>(shards.size()); }
+
+    /**
+     * @brief A shard by position.
+     */
+    Shard &operator[](int index) { return shards[index]; }
+
+    /**
+     * @brief The shard holding a project, task or comment.
+     *
+     * IDs beyond the last shard go to shard 0, where they are not found.
+     *
+     * @param id The ID.
+     * @return Shard& The shard.
+     */
+    Shard &of(long long id);
+
+    /**
+     * @brief The shard a new project goes to, in turn.
+     */
+    Shard &place();
+
+    /**
+     * @brief Runs a query on every shard and answers with the merged responses.
+     *
+     * With one shard, this is the same as respond() on its pool. Otherwise the query
+     * runs on every shard in parallel and the last one to finish completes res. If a
+     * shard is too busy, the answer is 503.
+     *
+     * @param res The pending response of the route handler.
+     * @param pool Which pool of each shard runs the query.
+     * @param query The query, run once per shard.
+     * @param merge Combines the responses, concatenate() by default.
+     */
+    void gather(crow::response &res, Pool pool, DbExecutor::Query query, Merge merge = concatenate);
+
+    /**
+     * @brief Runs a query on some of the shards and answers with the merged responses.
+     *
+     * Like gather() on every shard, for queries whose rows are known to live on only a
+     * few shards, e.g. those of a user's projects.
+     *
+     * @param res The pending response of the route handler.
+     * @param pool Which pool of each shard runs the query.
+     * @param indexes The shards to ask, not empty, without duplicates.
+     * @param query The query, run once per shard.
+     * @param merge Combines the responses, concatenate() by default.
+     */
+    void gather(crow::response &res, Pool pool, const std::vector<int> &indexes, DbExecutor::Query query,
+                Merge merge = concatenate);
+
+    /**
+     * @brief Queues a write on every shard but shard 0, e.g. to copy a user change.
+     *
+     * Waits while a shard's write queue is full, so the copy is never dropped.
+     *
+     * @param job The write.
+     */
+    void replicate(const DbExecutor::Job &job);
+
+    /**
+     * @brief Merges list responses: the JSON or MessagePack arrays are joined in order.
+     *
+     * The first response that is not 200 is returned instead.
+     *
+     * @param parts The responses of every shard.
+     * @return crow::response The merged list.
+     */
+    static crow::response concatenate(std::vector<crow::response> &parts);
+
+private:
+    std::vector<Shard> shards;                      /**< The shards, by index */
+    std::atomic<unsigned> nextPlacement{0};         /**< Shard of the next new project */
+};
+
+#endif // SHARDSET_H
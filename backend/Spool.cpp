@@ -0,0 +1,113 @@
+/**
+ * @file Spool.cpp
+ * @brief Implementation of the Spool class.
+ */
+
+#include "Spool.h"
+#include <filesystem>
+
+/**
+ * @brief Creates the spool directory and empties it.
+ *
+ * @param directory The spool directory.
+ * @param maxAge Age after which a file is deleted.
+ * @param maxBytes Most bytes held by the files at once.
+ */
+Spool::Spool(std::string directory, std::chrono::minutes maxAge, uint64_t maxBytes)
+    : directory(std::move(directory)), maxAge(maxAge), maxBytes(maxBytes)
+{
+    std::error_code error;
+    std::filesystem::remove_all(this->directory, error);
+    std::filesystem::create_directories(this->directory, error);
+}
+
+/**
+ * @brief Returns a fresh path in the directory, sweeping at most once a minute.
+ *
+ * @param prefix Start of the file name.
+ * @param extension End of the file name, with the dot.
+ * @return std::string The path.
+ */
+std::string Spool::create(const std::string &prefix, const std::string &extension)
+{
+    sweep(std::chrono::minutes(1));
+    std::string name = prefix + "-" + std::to_string(counter++) + extension;
+    return (std::filesystem::path(directory) / name).string();
+}
+
+/**
+ * @brief Adds bytes to the total if they fit, sweeping at most once a second when full.
+ *
+ * @param bytes The number of bytes.
+ * @return bool false if the spool is full.
+ */
+bool Spool::reserve(uint64_t bytes)
+{
+    for (int attempt = 0; attempt < 2; attempt++)
+    {
+        uint64_t current = used.load();
+        while (current + bytes <= maxBytes)
+        {
+            if (used.compare_exchange_weak(current, current + bytes))
+                return true;
+        }
+        if (attempt == 0)
+            sweep(std::chrono::seconds(1));
+    }
+    return false;
+}
+
+/**
+ * @brief Removes a file and releases its size.
+ *
+ * @param path The file.
+ */
+void Spool::discard(const std::string &path)
+{
+    std::error_code error;
+    uintmax_t size = std::filesystem::file_size(path, error);
+    if (std::filesystem::remove(path, error) && size != static_cast<uintmax_t>(-1))
+        release(size);
+}
+
+/**
+ * @brief Deletes files whose last write is older than maxAge and releases their size.
+ *
+ * @param interval Least time since the last sweep.
+ */
+void Spool::sweep(std::chrono::steady_clock::duration interval)
+{
+    {
+        std::lock_guard<std::mutex> lock(sweepMutex);
+        auto now = std::chrono::steady_clock::now();
+        if (now - lastSweep < interval)
+            return;
+        lastSweep = now;
+    }
+
+    namespace fs = std::filesystem;
+    std::error_code error;
+    fs::file_time_type cutoff = fs::file_time_type::clock::now() - maxAge;
+    for (fs::directory_iterator it(directory, error), end; !error && it != end; it.increment(error))
+    {
+        std::error_code fileError;
+        if (it->last_write_time(fileError) >= cutoff || fileError)
+            continue;
+        uintmax_t size = it->file_size(fileError);
+        if (!fileError && fs::remove(it->path(), fileError))
+            release(size);
+    }
+}
+
+/**
+ * @brief Subtracts bytes from the total, never below zero.
+ *
+ * @param bytes The number of bytes.
+ */
+void Spool::release(uint64_t bytes)
+{
+    uint64_t current = used.load();
+    while (!used.compare_exchange_weak(current, current > bytes ? current - bytes : 0))
+    {
+    }
+}
@@ -0,0 +1,89 @@
+/**
+ * @file Spool.h
+ * @brief Declaration of the Spool class.
+ *
+ * Crow sends a response body either from a string held in memory or from a file, which
+ * it reads and writes in small chunks. Large responses are therefore written to a spool
+ * file first and handed to Crow with set_static_file_info_unsafe().
+ */
+
+#ifndef SPOOL_H
+#define SPOOL_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+/**
+ * @class Spool
+ * @brief A directory of short-lived response files, limited in total size.
+ *
+ * Crow opens a spool file only once the route has finished, so files cannot be deleted
+ * right after use. Instead, files older than the maximum age are deleted whenever a new
+ * one is created, and the directory is emptied when the server starts.
+ *
+ * Every byte written to the directory is reserved first. Once maxBytes are held, the
+ * spool sweeps early and refuses more, so the routes answer 503 instead of filling the
+ * disk while files wait for their age.
+ */
+class Spool
+{
+public:
+    /**
+     * @brief Creates the directory, deleting files left by an earlier run.
+     *
+     * @param directory The spool directory, owned by the server.
+     * @param maxAge Age after which a file is deleted.
+     * @param maxBytes Most bytes held by the files at once.
+     */
+    Spool(std::string directory, std::chrono::minutes maxAge, uint64_t maxBytes);
+
+    /**
+     * @brief Reserves the path of a new spool file, deleting expired ones first.
+     *
+     * @param prefix Start of the file name.
+     * @param extension End of the file name, with the dot.
+     * @return std::string The path, unique within the directory.
+     */
+    std::string create(const std::string &prefix, const std::string &extension);
+
+    /**
+     * @brief Counts bytes about to be written to a spool file.
+     *
+     * @param bytes The number of bytes.
+     * @return bool false if they don't fit, even after deleting expired files.
+     */
+    bool reserve(uint64_t bytes);
+
+    /**
+     * @brief Deletes a spool file and gives its bytes back.
+     *
+     * @param path A path from create() whose bytes were reserved.
+     */
+    void discard(const std::string &path);
+
+private:
+    /**
+     * @brief Deletes files older than maxAge.
+     *
+     * @param interval Least time since the last sweep.
+     */
+    void sweep(std::chrono::steady_clock::duration interval);
+
+    /**
+     * @brief Gives bytes back.
+     */
+    void release(uint64_t bytes);
+
+    std::string directory;                                  /**< Where the files are */
+    std::chrono::minutes maxAge;                            /**< Lifetime of a file */
+    uint64_t maxBytes;                                      /**< Most bytes held at once */
+    std::atomic<uint64_t> used{0};                          /**< Bytes reserved by the files */
+    std::atomic<unsigned long long> counter{0};             /**< Makes file names unique */
+    std::mutex sweepMutex;                                  /**< One sweep at a time */
+    std::chrono::steady_clock::time_point lastSweep{};      /**< When the last sweep ran */
+};
+
+#endif // SPOOL_H
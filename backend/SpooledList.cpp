@@ -0,0 +1,320 @@
+/**
+ * @file SpooledList.cpp
+ * @brief Implementation of the SpooledList class.
+ */
+
+#include "SpooledList.h"
+#include <algorithm>
+#include "MsgPack.h"
+
+namespace {
+
+/**
+ * @brief Content type of a list.
+ */
+const char *contentType(SpooledList::Format format)
+{
+    switch (format)
+    {
+    case SpooledList::Format::MsgPack:
+        return MSGPACK_CONTENT_TYPE;
+    case SpooledList::Format::Lines:
+        return NDJSON_CONTENT_TYPE;
+    default:
+        return "application/json";
+    }
+}
+
+/**
+ * @brief File name extension of a spilled list.
+ */
+const char *extension(SpooledList::Format format)
+{
+    switch (format)
+    {
+    case SpooledList::Format::MsgPack:
+        return ".msgpack";
+    case SpooledList::Format::Lines:
+        return ".ndjson";
+    default:
+        return ".json";
+    }
+}
+
+} // namespace
+
+/**
+ * @brief Opens the array: "[" for JSON, a 32-bit array header for MessagePack, nothing for lines.
+ *
+ * @param format The encoding.
+ * @param spool Where a large list goes.
+ * @param spillBytes Largest list kept in memory.
+ */
+SpooledList::SpooledList(Format format, Spool &spool, size_t spillBytes)
+    : format(format), spool(spool), spillBytes(spillBytes)
+{
+    if (format == Format::Json)
+        buffer = "[";
+    else if (format == Format::MsgPack)
+    {
+        MsgPackWriter header;
+        header.beginArray();
+        buffer = header.take();
+    }
+}
+
+/**
+ * @brief Deletes the spool file unless finish() handed it to a response.
+ */
+SpooledList::~SpooledList()
+{
+    if (path.empty())
+        return;
+    file.close();
+    spool.discard(path);
+}
+
+/**
+ * @brief Appends one element, after a comma in JSON or followed by a newline in lines.
+ *
+ * @param element The encoded element.
+ * @return bool false if the spool file could not be written or the spool is full.
+ */
+bool SpooledList::append(std::string_view element)
+{
+    if (format == Format::Json && count > 0 && !write(","))
+        return false;
+    count++;
+    if (!write(element))
+        return false;
+    return format != Format::Lines || write("\n");
+}
+
+/**
+ * @brief Copies the elements of a finished list, without its brackets or header.
+ *
+ * @param part The list.
+ * @return bool false if the part is not a list of this format or could not be copied.
+ */
+bool SpooledList::splice(crow::response &part)
+{
+    std::ifstream in;
+    std::string head;
+    size_t size;
+    if (part.is_static_type())
+    {
+        in.open(part.file_info.path, std::ios::binary | std::ios::ate);
+        if (!in)
+            return false;
+        size = static_cast<size_t>(in.tellg());
+        in.seekg(0);
+        head.resize(std::min<size_t>(size, 5));
+        in.read(&head[0], head.size());
+    }
+    else
+    {
+        size = part.body.size();
+        head = part.body.substr(0, 5);
+    }
+
+    // Find the elements between the header and the end of the part
+    uint32_t n = 0;
+    size_t begin, end;
+    if (format == Format::MsgPack)
+    {
+        if (!MsgPackWriter::readArrayHeader(head, n, begin))
+            return false;
+        end = size;
+    }
+    else if (format == Format::Lines)
+    {
+        // Lines need no separator, the whole part is copied
+        begin = 0;
+        end = size;
+        n = size > 0 ? 1 : 0;
+    }
+    else
+    {
+        if (head.empty() || head[0] != '[')
+            return false;
+        begin = 1;
+        end = size - 1;
+        if (!in.is_open())
+        {
+            // Lists built by crow::json may be padded with whitespace
+            const std::string &list = part.body;
+            size_t close = list.find_last_not_of(" \t\r\n");
+            if (close == std::string::npos || list[close] != ']')
+                return false;
+            begin = list.find_first_not_of(" \t\r\n", 1);
+            end = close;
+        }
+        // A JSON list only needs to know whether a comma goes before the next element
+        n = begin < end ? 1 : 0;
+    }
+    if (n == 0)
+        return true;
+
+    if (format == Format::Json && count > 0 && !write(","))
+        return false;
+    count += n;
+    if (!in.is_open())
+        return write(std::string_view(part.body).substr(begin, end - begin));
+
+    in.seekg(begin);
+    std::string chunk(FLUSH_BYTES, '\0');
+    for (size_t left = end - begin; left > 0;)
+    {
+        size_t length = std::min(left, chunk.size());
+        if (!in.read(&chunk[0], length) || !write(std::string_view(chunk.data(), length)))
+            return false;
+        left -= length;
+    }
+    return true;
+}
+
+/**
+ * @brief Closes the array and answers from memory or from the spool file.
+ *
+ * @return crow::response The list, 503 if the spool is full, or 500 if the file could not be written.
+ */
+crow::response SpooledList::finish()
+{
+    if (format == Format::Json)
+        write("]");
+
+    if (!failed && path.empty())
+    {
+        if (format == Format::MsgPack)
+        {
+            for (int i = 0; i < 4; i++)
+                buffer[1 + i] = static_cast<char>(count >> (24 - 8 * i));
+        }
+        crow::response list(200);
+        list.body = std::move(buffer);
+        buffer.clear();
+        list.set_header("Content-Type", contentType(format));
+        if (format == Format::MsgPack)
+            list.set_header("Vary", "Accept");
+        return list;
+    }
+
+    if (!failed && flush() && format == Format::MsgPack)
+    {
+        char length[4];
+        for (int i = 0; i < 4; i++)
+            length[i] = static_cast<char>(count >> (24 - 8 * i));
+        file.seekp(1);
+        file.write(length, sizeof(length));
+    }
+    file.close();
+    if (full)
+    {
+        crow::response busy(503, "Server busy, try again later");
+        busy.add_header("Retry-After", "1");
+        return busy;
+    }
+    if (failed || !file)
+        return crow::response(500, "Failed to write the list");
+
+    crow::response list;
+    list.set_static_file_info_unsafe(path);
+    list.set_header("Content-Type", contentType(format));
+    if (format == Format::MsgPack)
+        list.set_header("Vary", "Accept");
+    // The file now belongs to the response, the spool deletes it once it is old
+    path.clear();
+    return list;
+}
+
+/**
+ * @brief Copies the parts into one list, in shard order.
+ *
+ * @param parts The responses of every shard.
+ * @param spool Where the merged list goes if it is large.
+ * @param spillBytes Largest list kept in memory.
+ * @return crow::response The merged list, or the first failed part.
+ */
+crow::response SpooledList::concatenate(std::vector<crow::response> &parts, Spool &spool, size_t spillBytes)
+{
+    auto discard = [&parts, &spool]()
+    {
+        for (crow::response &part : parts)
+        {
+            if (part.is_static_type())
+                spool.discard(part.file_info.path);
+        }
+    };
+
+    for (crow::response &part : parts)
+    {
+        if (part.code != 200)
+        {
+            crow::response failed = std::move(part);
+            discard();
+            return failed;
+        }
+    }
+
+    Format format = parts[0].get_header_value("Content-Type") == MSGPACK_CONTENT_TYPE ? Format::MsgPack : Format::Json;
+    SpooledList merged(format, spool, spillBytes);
+    for (crow::response &part : parts)
+    {
+        if (!merged.splice(part))
+        {
+            discard();
+            return crow::response(500, "Can't merge shard results");
+        }
+    }
+    discard();
+    return merged.finish();
+}
+
+/**
+ * @brief Appends bytes to the buffer and moves to a file past spillBytes.
+ *
+ * @param bytes The bytes.
+ * @return bool false if the file could not be written.
+ */
+bool SpooledList::write(std::string_view bytes)
+{
+    if (failed)
+        return false;
+    buffer.append(bytes);
+    if (path.empty())
+    {
+        if (buffer.size() <= spillBytes)
+            return true;
+        path = spool.create("list", extension(format));
+        file.open(path, std::ios::binary | std::ios::trunc);
+        if (!file)
+            failed = true;
+        if (failed || !flush())
+            return false;
+        // Give back the memory of the list, only the write buffer is needed from now on
+        buffer.shrink_to_fit();
+        buffer.reserve(FLUSH_BYTES);
+        return true;
+    }
+    return buffer.size() < FLUSH_BYTES || flush();
+}
+
+/**
+ * @brief Writes the buffer to the file and empties it, if the spool has room for it.
+ *
+ * @return bool false if the spool is full or the write failed.
+ */
+bool SpooledList::flush()
+{
+    if (!spool.reserve(buffer.size()))
+    {
+        full = true;
+        failed = true;
+        return false;
+    }
+    file.write(buffer.data(), buffer.size());
+    buffer.clear();
+    if (!file)
+        failed = true;
+    return !failed;
+}
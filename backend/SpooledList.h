@@ -0,0 +1,134 @@
+/**
+ * @file SpooledList.h
+ * @brief Declaration of the SpooledList class.
+ *
+ * Crow sends a body either from memory or from a file, and has no way for a route to
+ * write to the socket while it is still reading rows. Long lists are therefore written
+ * row by row as SQLite produces them: to memory while they are small, then to a spool
+ * file, which Crow sends in small chunks as fast as the client reads them.
+ */
+
+#ifndef SPOOLEDLIST_H
+#define SPOOLEDLIST_H
+
+#include "crow.h"
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Spool.h"
+
+/**
+ * @brief Content type of NDJSON bodies, such as project exports.
+ */
+constexpr const char *NDJSON_CONTENT_TYPE = "application/x-ndjson";
+
+/**
+ * @class SpooledList
+ * @brief A JSON or MessagePack array, or NDJSON lines, written one element at a time.
+ *
+ * The array is kept in memory up to spillBytes. Past that, it moves to a file of the
+ * spool and only a write buffer of FLUSH_BYTES stays in memory, so a route holds at most
+ * about spillBytes whatever the number of rows. MessagePack arrays start with a 32-bit
+ * length that is filled in by finish().
+ *
+ * A list that is destroyed without finish() deletes its file, so a route that fails
+ * half way answers with an error instead of a truncated list. A list that would overfill
+ * the spool stops there and finish() answers 503.
+ */
+class SpooledList
+{
+public:
+    /**
+     * @brief Encoding of the array.
+     */
+    enum class Format
+    {
+        Json,
+        MsgPack,
+        Lines       /**< NDJSON, each element followed by a newline */
+    };
+
+    static constexpr size_t FLUSH_BYTES = 64 * 1024;     /**< Write buffer of a spilled list */
+
+    /**
+     * @brief Opens an empty array.
+     *
+     * @param format The encoding.
+     * @param spool Where the file goes if the list grows past spillBytes.
+     * @param spillBytes Largest list kept in memory.
+     */
+    SpooledList(Format format, Spool &spool, size_t spillBytes);
+
+    /**
+     * @brief Deletes the file of a list that was not finished.
+     */
+    ~SpooledList();
+
+    SpooledList(const SpooledList &) = delete;
+    SpooledList &operator=(const SpooledList &) = delete;
+
+    /**
+     * @brief Appends one encoded element.
+     *
+     * @param element A JSON value or a MessagePack value, in the format of the list.
+     *                A line of NDJSON without its newline.
+     * @return bool false if the spool file could not be written or the spool is full.
+     */
+    bool append(std::string_view element);
+
+    /**
+     * @brief Appends the elements of another list of the same format.
+     *
+     * @param part A response built by finish(), from memory or from a file.
+     * @return bool false if the part is not a list or could not be copied.
+     */
+    bool splice(crow::response &part);
+
+    /**
+     * @brief Closes the array and makes the response.
+     *
+     * @return crow::response 200 with the body in memory or sent from the spool file,
+     *         503 if the spool is full, 500 if the file could not be written.
+     */
+    crow::response finish();
+
+    /**
+     * @brief Merges the lists of every shard, like ShardSet::concatenate() but without
+     *        loading spilled parts into memory.
+     *
+     * Parts that are all in memory are handed to ShardSet::concatenate(). Otherwise they
+     * are copied in order into a new list, and their files are deleted.
+     *
+     * @param parts The responses of every shard.
+     * @param spool Where the merged list goes if it is large.
+     * @param spillBytes Largest list kept in memory.
+     * @return crow::response The merged list, or the first failed part.
+     */
+    static crow::response concatenate(std::vector<crow::response> &parts, Spool &spool, size_t spillBytes);
+
+private:
+    /**
+     * @brief Appends bytes, moving the list to a file once it is too large.
+     */
+    bool write(std::string_view bytes);
+
+    /**
+     * @brief Writes the buffer of a spilled list to its file.
+     */
+    bool flush();
+
+    Format format;                  /**< Encoding of the array */
+    Spool &spool;                   /**< Source of the file name and of room on disk */
+    size_t spillBytes;              /**< Largest list kept in memory */
+    std::string buffer;             /**< The whole list, or the bytes not flushed yet */
+    std::string path;               /**< The spool file, empty while in memory */
+    std::ofstream file;             /**< The open spool file */
+    uint32_t count = 0;             /**< Elements written */
+    bool failed = false;            /**< A write failed */
+    bool full = false;              /**< The spool had no room for a write */
+};
+
+#endif // SPOOLEDLIST_H
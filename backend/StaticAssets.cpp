@@ -0,0 +1,233 @@
+/**
+ * @file StaticAssets.cpp
+ * @brief Implementation of the StaticAssets class.
+ */
+
+#include "StaticAssets.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+
+namespace {
+
+/**
+ * @brief Cache-Control of files whose name carries a content hash.
+ */
+const char *IMMUTABLE_CACHE = "public, max-age=31536000, immutable";
+
+/**
+ * @brief Cache-Control of the other files, revalidated with their ETag on every use.
+ */
+const char *REVALIDATE_CACHE = "no-cache";
+
+/**
+ * @brief Content type of a file, from its extension.
+ *
+ * @param extension The extension, with the dot.
+ * @return const char* The MIME type.
+ */
+const char *contentType(const std::string &extension)
+{
+    static const std::unordered_map<std::string, const char *> types = {
+        {".html", "text/html; charset=utf-8"},
+        {".js", "text/javascript; charset=utf-8"},
+        {".css", "text/css; charset=utf-8"},
+        {".json", "application/json"},
+        {".map", "application/json"},
+        {".txt", "text/plain; charset=utf-8"},
+        {".svg", "image/svg+xml"},
+        {".png", "image/png"},
+        {".jpg", "image/jpeg"},
+        {".gif", "image/gif"},
+        {".webp", "image/webp"},
+        {".ico", "image/x-icon"},
+        {".woff", "font/woff"},
+        {".woff2", "font/woff2"},
+    };
+    auto it = types.find(extension);
+    return it == types.end() ? "application/octet-stream" : it->second;
+}
+
+/**
+ * @brief Quoted ETag of a content, its 64-bit FNV-1a hash.
+ *
+ * @param content The uncompressed content.
+ * @return std::string The ETag.
+ */
+std::string etagOf(const std::string &content)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    for (unsigned char c : content)
+        hash = (hash ^ c) * 1099511628211ULL;
+    char buffer[20];
+    std::snprintf(buffer, sizeof(buffer), "\"%016llx\"", static_cast<unsigned long long>(hash));
+    return buffer;
+}
+
+/**
+ * @brief Checks whether an Accept-Encoding header allows an encoding.
+ *
+ * @param header The Accept-Encoding header.
+ * @param name The encoding, "br" or "gzip".
+ * @return bool true if listed without q=0.
+ */
+bool accepts(const std::string &header, const std::string &name)
+{
+    std::istringstream in(header);
+    std::string item;
+    while (std::getline(in, item, ','))
+    {
+        size_t start = item.find_first_not_of(' ');
+        if (start == std::string::npos)
+            continue;
+        size_t semicolon = item.find(';', start);
+        std::string coding = item.substr(start, semicolon == std::string::npos ? std::string::npos : semicolon - start);
+        coding.erase(coding.find_last_not_of(' ') + 1);
+        if (coding != name)
+            continue;
+        if (semicolon == std::string::npos)
+            return true;
+        size_t q = item.find("q=", semicolon);
+        return q == std::string::npos || std::atof(item.c_str() + q + 2) > 0;
+    }
+    return false;
+}
+
+} // namespace
+
+/**
+ * @brief Creates an empty set.
+ *
+ * @param memoryLimit Largest file, in bytes, kept in memory.
+ */
+StaticAssets::StaticAssets(size_t memoryLimit) : memoryLimit(memoryLimit) {}
+
+/**
+ * @brief Indexes every file below root by URL path, with its compressed variants.
+ *
+ * @param root The build directory.
+ * @return size_t Number of files found.
+ */
+size_t StaticAssets::load(const std::string &root)
+{
+    namespace fs = std::filesystem;
+    std::error_code error;
+    if (!fs::is_directory(root, error))
+        return 0;
+
+    for (fs::recursive_directory_iterator it(root, error), end; it != end; it.increment(error))
+    {
+        if (error)
+            break;
+        if (!it->is_regular_file())
+            continue;
+        const fs::path &file = it->path();
+        std::string extension = file.extension().string();
+        if (extension == ".gz" || extension == ".br")
+            continue;
+
+        Asset asset;
+        std::string content;
+        if (!readVariant(file.string(), asset.identity, content))
+            continue;
+        asset.contentType = contentType(extension);
+        asset.etag = etagOf(content);
+
+        std::string unused;
+        asset.gzip.present = fs::exists(file.string() + ".gz") && readVariant(file.string() + ".gz", asset.gzip, unused);
+        asset.brotli.present = fs::exists(file.string() + ".br") && readVariant(file.string() + ".br", asset.brotli, unused);
+
+        std::string url = "/" + fs::relative(file, root).generic_string();
+        asset.immutable = url.rfind("/static/", 0) == 0;
+        assets[url] = std::move(asset);
+    }
+    return assets.size();
+}
+
+/**
+ * @brief Picks the file and encoding for a request and fills the response.
+ *
+ * @param req The request.
+ * @param res The response.
+ * @return bool false if there is no such file.
+ */
+bool StaticAssets::serve(const crow::request &req, crow::response &res) const
+{
+    std::string url = req.url == "/" ? "/index.html" : req.url;
+    auto it = assets.find(url);
+    if (it == assets.end())
+    {
+        // Client-side routes such as /project/3 have no extension and load the app
+        bool route = url.find('.', url.rfind('/')) == std::string::npos;
+        if (!route || req.get_header_value("Accept").find("text/html") == std::string::npos)
+            return false;
+        it = assets.find("/index.html");
+        if (it == assets.end())
+            return false;
+    }
+    const Asset &asset = it->second;
+
+    res.set_header("Cache-Control", asset.immutable ? IMMUTABLE_CACHE : REVALIDATE_CACHE);
+    res.set_header("ETag", asset.etag);
+    res.set_header("Vary", "Accept-Encoding");
+    if (req.get_header_value("If-None-Match") == asset.etag)
+    {
+        res.code = 304;
+        return true;
+    }
+
+    const std::string &acceptEncoding = req.get_header_value("Accept-Encoding");
+    const Variant *variant = &asset.identity;
+    if (asset.brotli.present && accepts(acceptEncoding, "br"))
+    {
+        variant = &asset.brotli;
+        res.set_header("Content-Encoding", "br");
+    }
+    else if (asset.gzip.present && accepts(acceptEncoding, "gzip"))
+    {
+        variant = &asset.gzip;
+        res.set_header("Content-Encoding", "gzip");
+    }
+
+    if (variant->body.empty() && variant->size > 0)
+        res.set_static_file_info_unsafe(variant->path); // Crow streams the file from disk
+    else
+    {
+        res.code = 200;
+        res.body = variant->body;
+    }
+    res.set_header("Content-Type", asset.contentType);
+    return true;
+}
+
+/**
+ * @brief Reads a file, keeping it in memory if it is small enough.
+ *
+ * @param path File on disk.
+ * @param variant Filled from the file.
+ * @param content Receives the whole content.
+ * @return bool false if the file cannot be read.
+ */
+bool StaticAssets::readVariant(const std::string &path, Variant &variant, std::string &content)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+        return false;
+    content.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    if (in.bad())
+        return false;
+
+    variant.present = true;
+    variant.path = path;
+    variant.size = content.size();
+    if (content.size() <= memoryLimit)
+    {
+        variant.body = content;
+        memoryBytes += content.size();
+    }
+    return true;
+}
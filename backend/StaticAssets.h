@@ -0,0 +1,112 @@
+/**
+ * @file StaticAssets.h
+ * @brief Declaration of the StaticAssets class.
+ *
+ * Serves the built frontend (frontend/build) from the same process and origin as the
+ * API, so the browser no longer sends a CORS preflight before every call.
+ */
+
+#ifndef STATICASSETS_H
+#define STATICASSETS_H
+
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include "crow.h"
+
+/**
+ * @class StaticAssets
+ * @brief The files of the frontend build, read once at startup.
+ *
+ * Every file is indexed by its URL path with its content type and an ETag. Files up to
+ * the memory limit are kept in memory; larger ones (source maps) are streamed from disk
+ * by Crow. A "name.gz" or "name.br" file next to "name", written by the frontend's
+ * postbuild step, is served instead of it to clients that accept that encoding.
+ *
+ * Files under /static/ carry a content hash in their name, so they are cached by the
+ * browser for a year without revalidation. The rest (index.html, manifest.json, ...)
+ * are revalidated on every use and answered 304 when the ETag still matches.
+ *
+ * The set is not changed after load(), so serving needs no lock.
+ */
+class StaticAssets
+{
+public:
+    /**
+     * @brief Creates an empty set.
+     *
+     * @param memoryLimit Largest file, in bytes, kept in memory.
+     */
+    explicit StaticAssets(size_t memoryLimit = 1024 * 1024);
+
+    /**
+     * @brief Reads every file below a directory.
+     *
+     * @param root The build directory.
+     * @return size_t Number of files found, 0 if root does not exist.
+     */
+    size_t load(const std::string &root);
+
+    /**
+     * @brief Answers a GET request for a file of the build.
+     *
+     * Paths without a file extension are client-side routes and get index.html, if the
+     * client accepts HTML.
+     *
+     * @param req The request.
+     * @param res The response, filled but not ended.
+     * @return bool false if there is no such file, res is left untouched.
+     */
+    bool serve(const crow::request &req, crow::response &res) const;
+
+    /**
+     * @brief True if no file was loaded.
+     */
+    bool empty() const { return assets.empty(); }
+
+    /**
+     * @brief Bytes held in memory, compressed variants included.
+     */
+    size_t bytes() const { return memoryBytes; }
+
+private:
+    /**
+     * @brief One encoding of a file.
+     */
+    struct Variant
+    {
+        bool present = false;   /**< The encoding exists on disk */
+        std::string path;       /**< File on disk */
+        std::string body;       /**< Content, empty if streamed from path */
+        size_t size = 0;        /**< Content length */
+    };
+
+    /**
+     * @brief A file with its headers and encodings.
+     */
+    struct Asset
+    {
+        std::string contentType;    /**< Content-Type header */
+        std::string etag;           /**< Quoted ETag, a hash of the uncompressed content */
+        bool immutable = false;     /**< Name carries a content hash */
+        Variant identity;           /**< Uncompressed file */
+        Variant gzip;               /**< name.gz */
+        Variant brotli;             /**< name.br */
+    };
+
+    /**
+     * @brief Reads one encoding of a file, keeping it in memory if it is small enough.
+     *
+     * @param path File on disk.
+     * @param variant Filled from the file.
+     * @param content Receives the whole content.
+     * @return bool false if the file cannot be read.
+     */
+    bool readVariant(const std::string &path, Variant &variant, std::string &content);
+
+    size_t memoryLimit;                                  /**< Largest file kept in memory */
+    size_t memoryBytes = 0;                              /**< Bytes kept in memory */
+    std::unordered_map<std::string, Asset> assets;       /**< Files by URL path */
+};
+
+#endif // STATICASSETS_H
@@ -16,7 +16,8 @@
  * @author Robin
  */
 Task::Task(int taskID, std::string taskName, std::string taskDate, std::string taskStatus, std::string taskPriority, std::string taskDesc)
-    : taskID(taskID), taskName(taskName), taskDate(taskDate), taskStatus(taskStatus), taskPriority(taskPriority), taskDesc(taskDesc) {}
+    : taskID(taskID), taskName(std::move(taskName)), taskDate(std::move(taskDate)), taskStatus(std::move(taskStatus)),
+      taskDesc(std::move(taskDesc)), taskPriority(std::move(taskPriority)) {}
 
 /**
  * @brief Get the task's unique ID.
@@ -31,9 +32,9 @@ int Task::getTaskID() const
 /**
  * @brief Get the name of the task.
  * 
- * @return The task name as a string.
+ * @return Reference to the task name.
  */
-std::string Task::getTaskName() const
+const std::string &Task::getTaskName() const
 {
     return taskName;
 }
@@ -41,9 +42,9 @@ std::string Task::getTaskName() const
 /**
  * @brief Get the date associated with the task.
  * 
- * @return The task date as a string.
+ * @return Reference to the task date.
  */
-std::string Task::getTaskDate() const
+const std::string &Task::getTaskDate() const
 {
     return taskDate;
 }
@@ -51,9 +52,9 @@ std::string Task::getTaskDate() const
 /**
  * @brief Get the current status of the task.
  * 
- * @return The task status as a string.
+ * @return Reference to the task status.
  */
-std::string Task::getTaskStatus() const
+const std::string &Task::getTaskStatus() const
 {
     return taskStatus;
 }
@@ -61,9 +62,9 @@ std::string Task::getTaskStatus() const
 /**
  * @brief Get the description of the task.
  * 
- * @return The task description as a string.
+ * @return Reference to the task description.
  */
-std::string Task::getTaskDesc() const
+const std::string &Task::getTaskDesc() const
 {
     return taskDesc;
 }
@@ -71,9 +72,9 @@ std::string Task::getTaskDesc() const
 /**
  * @brief Get the priority level of the task.
  * 
- * @return The task priority as a string.
+ * @return Reference to the task priority.
  */
-std::string Task::getTaskPriority() const
+const std::string &Task::getTaskPriority() const
 {
     return taskPriority;
 }
@@ -83,9 +84,9 @@ std::string Task::getTaskPriority() const
  * 
  * @param newName The new task name.
  */
-void Task::editTaskName(const std::string &newName)
+void Task::editTaskName(std::string newName)
 {
-    taskName = newName;
+    taskName = std::move(newName);
 }
 
 /**
@@ -93,9 +94,9 @@ void Task::editTaskName(const std::string &newName)
  * 
  * @param newDate The new task date.
  */
-void Task::editTaskDate(const std::string &newDate)
+void Task::editTaskDate(std::string newDate)
 {
-    taskDate = newDate;
+    taskDate = std::move(newDate);
 }
 
 /**
@@ -103,9 +104,9 @@ void Task::editTaskDate(const std::string &newDate)
  * 
  * @param newStatus The new task status.
  */
-void Task::editTaskStatus(const std::string &newStatus)
+void Task::editTaskStatus(std::string newStatus)
 {
-    taskStatus = newStatus;
+    taskStatus = std::move(newStatus);
 }
 
 /**
@@ -113,9 +114,9 @@ void Task::editTaskStatus(const std::string &newStatus)
  * 
  * @param newDesc The new task description.
  */
-void Task::editTaskDesc(const std::string &newDesc)
+void Task::editTaskDesc(std::string newDesc)
 {
-    taskDesc = newDesc;
+    taskDesc = std::move(newDesc);
 }
 
 /**
@@ -123,9 +124,9 @@ void Task::editTaskDesc(const std::string &newDesc)
  * 
  * @param newPriority The new task priority.
  */
-void Task::editTaskPriority(const std::string &newPriority)
+void Task::editTaskPriority(std::string newPriority)
 {
-    taskPriority = newPriority;
+    taskPriority = std::move(newPriority);
 }
 
 /**
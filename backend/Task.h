@@ -11,6 +11,8 @@
  *
  * The Task class provides methods to create, edit, view, and convert task information to JSON format.
  * It supports basic getter and setter functionality for all relevant fields.
+ * Getters return references to the stored strings and setters take their argument by
+ * value and move it in, so callers that pass temporaries never copy.
  * 
  * @author Robin
  */
@@ -47,63 +49,63 @@ public:
 
     /**
      * @brief Get the task's name.
-     * @return Task name as a string.
+     * @return Task name, valid as long as the task is not modified.
      */
-    std::string getTaskName() const;
+    const std::string &getTaskName() const;
 
     /**
      * @brief Get the task's date.
-     * @return Task date as a string.
+     * @return Task date, valid as long as the task is not modified.
      */
-    std::string getTaskDate() const;
+    const std::string &getTaskDate() const;
 
     /**
      * @brief Get the task's status.
-     * @return Task status as a string.
+     * @return Task status, valid as long as the task is not modified.
      */
-    std::string getTaskStatus() const;
+    const std::string &getTaskStatus() const;
 
     /**
      * @brief Get the task's description.
-     * @return Task description as a string.
+     * @return Task description, valid as long as the task is not modified.
      */
-    std::string getTaskDesc() const;
+    const std::string &getTaskDesc() const;
 
     /**
      * @brief Get the task's priority.
-     * @return Task priority as a string.
+     * @return Task priority, valid as long as the task is not modified.
      */
-    std::string getTaskPriority() const;
+    const std::string &getTaskPriority() const;
 
     /**
      * @brief Edit the name of the task.
      * @param newName The new task name.
      */
-    void editTaskName(const std::string &newName);
+    void editTaskName(std::string newName);
 
     /**
      * @brief Edit the date of the task.
      * @param newDate The new task date.
      */
-    void editTaskDate(const std::string &newDate);
+    void editTaskDate(std::string newDate);
 
     /**
      * @brief Edit the status of the task.
      * @param newStatus The new task status.
      */
-    void editTaskStatus(const std::string &newStatus);
+    void editTaskStatus(std::string newStatus);
 
     /**
      * @brief Edit the task's description.
      * @param newDesc The new description.
      */
-    void editTaskDesc(const std::string &newDesc);
+    void editTaskDesc(std::string newDesc);
 
     /**
      * @brief Edit the task's priority.
      * @param newPriority The new priority value.
      */
-    void editTaskPriority(const std::string &newPriority);
+    void editTaskPriority(std::string newPriority);
 
     /**
      * @brief Print task details to standard output.
@@ -0,0 +1,384 @@
+/**
+ * @file TaskTable.cpp
+ * @brief Implementation of the TaskTable class and its counting kernels.
+ *
+ * With GCC and Clang on x86 the AVX2 kernels are compiled with a target attribute and
+ * picked at run time, so the build needs no -mavx2 and still runs on older CPUs. Other
+ * x86-64 compilers get the SSE2 kernels, which every x86-64 CPU has, and other
+ * architectures the scalar loops.
+ */
+
+#include "TaskTable.h"
+#include "CivilDate.h"
+#include <algorithm>
+#include <bitset>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TASKTABLE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if TASKTABLE_SSE2 && (defined(__GNUC__) || defined(__clang__))
+#define TASKTABLE_AVX2 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+/**
+ * @brief Number of set bits in a movemask result.
+ */
+inline size_t bitCount(uint32_t mask)
+{
+    return std::bitset<32>(mask).count();
+}
+
+/**
+ * @brief Counts bytes equal to a value, one at a time.
+ */
+size_t countEqualScalar(const uint8_t *data, size_t n, uint8_t value)
+{
+    size_t count = 0;
+    for (size_t i = 0; i < n; i++)
+        count += data[i] == value;
+    return count;
+}
+
+/**
+ * @brief Counts rows due before today whose status is not done, one at a time.
+ */
+size_t countOverdueScalar(const int32_t *due, const uint8_t *status, size_t n, int32_t today, uint8_t done)
+{
+    size_t count = 0;
+    for (size_t i = 0; i < n; i++)
+        count += (due[i] < today) & (status[i] != done);
+    return count;
+}
+
+#if TASKTABLE_SSE2
+/**
+ * @brief Counts bytes equal to a value, 16 at a time.
+ */
+size_t countEqualSSE2(const uint8_t *data, size_t n, uint8_t value)
+{
+    const __m128i wanted = _mm_set1_epi8((char)value);
+    size_t count = 0;
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        __m128i block = _mm_loadu_si128((const __m128i *)(data + i));
+        count += bitCount((uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(block, wanted)));
+    }
+    return count + countEqualScalar(data + i, n - i, value);
+}
+
+/**
+ * @brief Counts overdue rows 4 at a time, widening the status bytes to 32 bits.
+ */
+size_t countOverdueSSE2(const int32_t *due, const uint8_t *status, size_t n, int32_t today, uint8_t done)
+{
+    const __m128i day = _mm_set1_epi32(today);
+    const __m128i doneCode = _mm_set1_epi32(done);
+    const __m128i zero = _mm_setzero_si128();
+    size_t count = 0;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        __m128i dates = _mm_loadu_si128((const __m128i *)(due + i));
+        int32_t packed;
+        std::memcpy(&packed, status + i, 4);
+        __m128i codes = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(packed), zero), zero);
+        __m128i late = _mm_cmplt_epi32(dates, day);
+        __m128i open = _mm_andnot_si128(_mm_cmpeq_epi32(codes, doneCode), late);
+        count += bitCount((uint32_t)_mm_movemask_ps(_mm_castsi128_ps(open)));
+    }
+    return count + countOverdueScalar(due + i, status + i, n - i, today, done);
+}
+#endif
+
+#if TASKTABLE_AVX2
+/**
+ * @brief Counts bytes equal to a value, 32 at a time.
+ */
+__attribute__((target("avx2"))) size_t countEqualAVX2(const uint8_t *data, size_t n, uint8_t value)
+{
+    const __m256i wanted = _mm256_set1_epi8((char)value);
+    size_t count = 0;
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32)
+    {
+        __m256i block = _mm256_loadu_si256((const __m256i *)(data + i));
+        count += bitCount((uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, wanted)));
+    }
+    return count + countEqualSSE2(data + i, n - i, value);
+}
+
+/**
+ * @brief Counts overdue rows 8 at a time.
+ */
+__attribute__((target("avx2"))) size_t countOverdueAVX2(const int32_t *due, const uint8_t *status, size_t n, int32_t today, uint8_t done)
+{
+    const __m256i day = _mm256_set1_epi32(today);
+    const __m256i doneCode = _mm256_set1_epi32(done);
+    size_t count = 0;
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        __m256i dates = _mm256_loadu_si256((const __m256i *)(due + i));
+        __m256i codes = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(status + i)));
+        __m256i late = _mm256_cmpgt_epi32(day, dates);
+        __m256i open = _mm256_andnot_si256(_mm256_cmpeq_epi32(codes, doneCode), late);
+        count += bitCount((uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(open)));
+    }
+    return count + countOverdueSSE2(due + i, status + i, n - i, today, done);
+}
+#endif
+
+/**
+ * @brief Counts bytes equal to a value with the given instruction set.
+ */
+size_t countEqual(TaskTable::InstructionSet isa, const uint8_t *data, size_t n, uint8_t value)
+{
+#if TASKTABLE_AVX2
+    if (isa == TaskTable::InstructionSet::AVX2)
+        return countEqualAVX2(data, n, value);
+#endif
+#if TASKTABLE_SSE2
+    if (isa != TaskTable::InstructionSet::Scalar)
+        return countEqualSSE2(data, n, value);
+#endif
+    (void)isa;
+    return countEqualScalar(data, n, value);
+}
+
+/**
+ * @brief Counts overdue rows with the given instruction set.
+ */
+size_t countOverdue(TaskTable::InstructionSet isa, const int32_t *due, const uint8_t *status, size_t n, int32_t today, uint8_t done)
+{
+#if TASKTABLE_AVX2
+    if (isa == TaskTable::InstructionSet::AVX2)
+        return countOverdueAVX2(due, status, n, today, done);
+#endif
+#if TASKTABLE_SSE2
+    if (isa != TaskTable::InstructionSet::Scalar)
+        return countOverdueSSE2(due, status, n, today, done);
+#endif
+    (void)isa;
+    return countOverdueScalar(due, status, n, today, done);
+}
+
+/**
+ * @brief Parses a fixed number of digits.
+ *
+ * @return int The number, -1 if a character is not a digit.
+ */
+int digits(std::string_view text, size_t from, size_t count)
+{
+    int value = 0;
+    for (size_t i = from; i < from + count; i++)
+    {
+        if (text[i] < '0' || text[i] > '9')
+            return -1;
+        value = value * 10 + (text[i] - '0');
+    }
+    return value;
+}
+
+} // namespace
+
+/**
+ * @brief Creates an empty table.
+ */
+TaskTable::TaskTable() : isa(bestInstructionSet()), titleOffsets{0} {}
+
+/**
+ * @brief Reads every task of the database into a new table.
+ *
+ * @param db The connection.
+ * @return TaskTable The table.
+ */
+TaskTable TaskTable::load(sqlite3 *db)
+{
+    TaskTable table;
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(db, "SELECT id, project_id, status, priority, due_date, title FROM tasks;", -1, &stmt, nullptr) != SQLITE_OK)
+        return table;
+
+    while (sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        auto text = [&](int col)
+        {
+            const char *value = (const char *)sqlite3_column_text(stmt, col);
+            return std::string_view(value ? value : "", sqlite3_column_bytes(stmt, col));
+        };
+        table.append(sqlite3_column_int(stmt, 0), sqlite3_column_int(stmt, 1), statusCode(text(2)),
+                     sqlite3_column_int64(stmt, 3), text(4), text(5));
+    }
+    sqlite3_finalize(stmt);
+    return table;
+}
+
+/**
+ * @brief Appends the tasks of a TodoList.
+ *
+ * @param list The tasks.
+ * @param projectID Project to record for them.
+ */
+void TaskTable::append(const TodoList &list, int projectID)
+{
+    const std::pair<const char *, Status> categories[] = {
+        {"Backlog", BACKLOG}, {"Doing", IN_PROGRESS}, {"Review", REVIEW}, {"Done", COMPLETED}};
+    for (const auto &category : categories)
+    {
+        for (const Task &task : list.getCategory(category.first))
+            append(task.getTaskID(), projectID, category.second, std::atoll(task.getTaskPriority().c_str()),
+                   task.getTaskDate(), task.getTaskName());
+    }
+}
+
+/**
+ * @brief Appends one task.
+ */
+void TaskTable::append(int id, int projectID, Status status, long long priority, std::string_view dueDate, std::string_view title)
+{
+    ids.push_back(id);
+    projectIds.push_back(projectID);
+    statuses.push_back(status);
+    priorities.push_back(priority >= 1 && priority < OTHER_PRIORITY ? (uint8_t)priority : OTHER_PRIORITY);
+    dueDays.push_back(dayNumber(dueDate));
+    titles.append(title);
+    titleOffsets.push_back((uint32_t)titles.size());
+}
+
+/**
+ * @brief Number of tasks.
+ *
+ * @return size_t The row count.
+ */
+size_t TaskTable::size() const
+{
+    return ids.size();
+}
+
+/**
+ * @brief Counts tasks with a status.
+ *
+ * @param status The status code.
+ * @return size_t The count.
+ */
+size_t TaskTable::countStatus(Status status) const
+{
+    return countEqual(isa, statuses.data(), statuses.size(), status);
+}
+
+/**
+ * @brief Counts tasks with a priority.
+ *
+ * @param priority The priority.
+ * @return size_t The count.
+ */
+size_t TaskTable::countPriority(uint8_t priority) const
+{
+    return countEqual(isa, priorities.data(), priorities.size(), priority);
+}
+
+/**
+ * @brief Counts tasks due before a day that are not completed.
+ *
+ * Tasks without a due date are stored as NO_DUE_DATE and are never overdue.
+ *
+ * @param today Day number of the current day.
+ * @return size_t The count.
+ */
+size_t TaskTable::countOverdue(int32_t today) const
+{
+    return ::countOverdue(isa, dueDays.data(), statuses.data(), dueDays.size(), today, COMPLETED);
+}
+
+/**
+ * @brief Title of a row.
+ *
+ * @param row The row.
+ * @return std::string_view The title.
+ */
+std::string_view TaskTable::title(size_t row) const
+{
+    return std::string_view(titles).substr(titleOffsets[row], titleOffsets[row + 1] - titleOffsets[row]);
+}
+
+/**
+ * @brief Status code of a stored status string.
+ *
+ * @param status The status column value.
+ * @return Status The code.
+ */
+TaskTable::Status TaskTable::statusCode(std::string_view status)
+{
+    if (status == "backlog") return BACKLOG;
+    if (status == "inProgress") return IN_PROGRESS;
+    if (status == "review") return REVIEW;
+    if (status == "completed") return COMPLETED;
+    return OTHER_STATUS;
+}
+
+/**
+ * @brief Converts a YYYY-MM-DD date to days since 1970-01-01.
+ *
+ * Uses daysFromCivil(), so no time zone or locale is involved. Days past the end of
+ * their month, such as 2025-02-30, are not dates.
+ *
+ * @param date The date, anything after the tenth character is ignored.
+ * @return int32_t The day number, or NO_DUE_DATE.
+ */
+int32_t TaskTable::dayNumber(std::string_view date)
+{
+    if (date.size() < 10 || date[4] != '-' || date[7] != '-')
+        return NO_DUE_DATE;
+    int year = digits(date, 0, 4);
+    int month = digits(date, 5, 2);
+    int day = digits(date, 8, 2);
+    if (year < 0 || !isValidDate(year, month, day))
+        return NO_DUE_DATE;
+    return static_cast<int32_t>(daysFromCivil(year, month, day));
+}
+
+/**
+ * @brief Best instruction set supported by this CPU and build.
+ *
+ * @return InstructionSet AVX2, SSE2 or Scalar.
+ */
+TaskTable::InstructionSet TaskTable::bestInstructionSet()
+{
+#if TASKTABLE_AVX2
+    if (__builtin_cpu_supports("avx2"))
+        return InstructionSet::AVX2;
+#endif
+#if TASKTABLE_SSE2
+    return InstructionSet::SSE2;
+#else
+    return InstructionSet::Scalar;
+#endif
+}
+
+/**
+ * @brief Forces the counting kernels to an instruction set.
+ *
+ * @param set The instruction set, capped at the best one available.
+ */
+void TaskTable::setInstructionSet(InstructionSet set)
+{
+    isa = std::min(set, bestInstructionSet());
+}
+
+/**
+ * @brief Instruction set the counting kernels use.
+ *
+ * @return InstructionSet The instruction set.
+ */
+TaskTable::InstructionSet TaskTable::instructionSet() const
+{
+    return isa;
+}
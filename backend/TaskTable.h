@@ -0,0 +1,181 @@
+/**
+ * @file TaskTable.h
+ * @brief Declaration of the TaskTable class.
+ *
+ * A column-oriented copy of the tasks table for org-wide reports. Where a TodoList keeps
+ * one Task object with five strings per task, TaskTable keeps one small array per field,
+ * so counting tasks by status, priority or due date reads a few bytes per task and the
+ * counting loops run on SIMD registers.
+ */
+
+#ifndef TASKTABLE_H
+#define TASKTABLE_H
+
+#include <sqlite3.h>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "TodoList.h"
+
+/**
+ * @class TaskTable
+ * @brief Structure-of-arrays task storage with vectorized filter-and-count kernels.
+ *
+ * Rows are appended and never changed, a new table is built to see newer data. Titles
+ * live in one shared string arena. Counting runs on AVX2 when the CPU has it, otherwise
+ * SSE2, otherwise plain loops; setInstructionSet() forces one for benchmarks.
+ */
+class TaskTable
+{
+public:
+    /**
+     * @brief Status codes stored in the status column.
+     */
+    enum Status : uint8_t
+    {
+        BACKLOG = 0,
+        IN_PROGRESS = 1,
+        REVIEW = 2,
+        COMPLETED = 3,
+        OTHER_STATUS = 4
+    };
+
+    /**
+     * @brief Code stored in the priority column for priorities outside 1 to 254.
+     */
+    static constexpr uint8_t OTHER_PRIORITY = 255;
+
+    /**
+     * @brief Value of the due column for tasks without a valid due date.
+     */
+    static constexpr int32_t NO_DUE_DATE = INT32_MAX;
+
+    /**
+     * @brief Instruction sets the counting kernels can use.
+     */
+    enum class InstructionSet
+    {
+        Scalar,
+        SSE2,
+        AVX2
+    };
+
+    /**
+     * @brief Creates an empty table using the best instruction set of this CPU.
+     */
+    TaskTable();
+
+    /**
+     * @brief Reads every task of the database.
+     *
+     * @param db The connection.
+     * @return TaskTable The table, empty if the query failed.
+     */
+    static TaskTable load(sqlite3 *db);
+
+    /**
+     * @brief Appends the tasks of a TodoList.
+     *
+     * Categories map to statuses: Backlog, Doing, Review and Done to backlog,
+     * inProgress, review and completed.
+     *
+     * @param list The tasks.
+     * @param projectID Project to record for them.
+     */
+    void append(const TodoList &list, int projectID);
+
+    /**
+     * @brief Appends one task.
+     *
+     * @param id The task ID.
+     * @param projectID The project ID.
+     * @param status One of the Status codes.
+     * @param priority The priority, stored as OTHER_PRIORITY outside 1 to 254.
+     * @param dueDate Due date as YYYY-MM-DD, anything else is stored as NO_DUE_DATE.
+     * @param title The title, copied into the arena.
+     */
+    void append(int id, int projectID, Status status, long long priority, std::string_view dueDate, std::string_view title);
+
+    /**
+     * @brief Number of tasks.
+     */
+    size_t size() const;
+
+    /**
+     * @brief Counts tasks with a status.
+     *
+     * @param status One of the Status codes.
+     * @return size_t The count.
+     */
+    size_t countStatus(Status status) const;
+
+    /**
+     * @brief Counts tasks with a priority.
+     *
+     * @param priority The priority.
+     * @return size_t The count.
+     */
+    size_t countPriority(uint8_t priority) const;
+
+    /**
+     * @brief Counts tasks due before a day that are not completed.
+     *
+     * @param today Day number, see dayNumber().
+     * @return size_t The count.
+     */
+    size_t countOverdue(int32_t today) const;
+
+    /**
+     * @brief Title of a row.
+     *
+     * @param row The row.
+     * @return std::string_view The title, valid as long as the table.
+     */
+    std::string_view title(size_t row) const;
+
+    /**
+     * @brief Status code of a stored status string.
+     *
+     * @param status The status column value.
+     * @return Status The code, OTHER_STATUS for unknown statuses.
+     */
+    static Status statusCode(std::string_view status);
+
+    /**
+     * @brief Converts a YYYY-MM-DD date to days since 1970-01-01.
+     *
+     * @param date The date.
+     * @return int32_t The day number, NO_DUE_DATE if the date is not valid.
+     */
+    static int32_t dayNumber(std::string_view date);
+
+    /**
+     * @brief Best instruction set supported by this CPU and build.
+     */
+    static InstructionSet bestInstructionSet();
+
+    /**
+     * @brief Forces the counting kernels to an instruction set, for benchmarks.
+     *
+     * @param set The instruction set, ignored if the CPU does not support it.
+     */
+    void setInstructionSet(InstructionSet set);
+
+    /**
+     * @brief Instruction set the counting kernels use.
+     */
+    InstructionSet instructionSet() const;
+
+private:
+    InstructionSet isa;                  /**< Kernels used for counting */
+    std::vector<int32_t> ids;            /**< Task IDs */
+    std::vector<int32_t> projectIds;     /**< Project of each task */
+    std::vector<uint8_t> statuses;       /**< Status codes */
+    std::vector<uint8_t> priorities;     /**< Priority codes */
+    std::vector<int32_t> dueDays;        /**< Due dates as day numbers */
+    std::vector<uint32_t> titleOffsets;  /**< Start of each title in titles */
+    std::string titles;                  /**< Arena holding every title back to back */
+};
+
+#endif // TASKTABLE_H
@@ -0,0 +1,126 @@
+/**
+ * @file TimerWheel.cpp
+ * @brief Implementation of the TimerWheel class.
+ */
+
+#include "TimerWheel.h"
+
+/**
+ * @brief Creates an empty wheel at a tick.
+ *
+ * @param now The current tick.
+ */
+TimerWheel::TimerWheel(int64_t now) : tick(now)
+{
+}
+
+/**
+ * @brief Records the timer of a key and places it.
+ *
+ * @param key The key.
+ * @param due The tick it fires at.
+ */
+void TimerWheel::schedule(Key key, int64_t due)
+{
+    live[key] = due;
+    // The slot of the current tick has fired already, a due timer waits for the next one
+    if (due <= tick)
+        slots[0][(tick + 1) & (SLOTS - 1)].push_back({key, due});
+    else
+        place({key, due});
+}
+
+/**
+ * @brief Forgets the timer of a key, its entry is dropped when its slot is reached.
+ *
+ * @param key The key.
+ */
+void TimerWheel::cancel(Key key)
+{
+    live.erase(key);
+}
+
+/**
+ * @brief Whether an entry is the pending timer of its key.
+ *
+ * @param entry The entry.
+ * @return bool false if the key was cancelled, rescheduled or has fired.
+ */
+bool TimerWheel::valid(const Entry &entry) const
+{
+    auto it = live.find(entry.key);
+    return it != live.end() && it->second == entry.due;
+}
+
+/**
+ * @brief Picks the finest level whose ring spans the distance to the entry's tick.
+ *
+ * A timer moved down at its own tick lands in the level 0 slot that fires next.
+ *
+ * @param entry The entry, not due before the current tick.
+ */
+void TimerWheel::place(const Entry &entry)
+{
+    int64_t distance = entry.due - tick;
+    for (int level = 0; level < LEVELS; level++)
+    {
+        if (distance < (int64_t(1) << (SLOT_BITS * (level + 1))))
+        {
+            slots[level][(entry.due >> (SLOT_BITS * level)) & (SLOTS - 1)].push_back(entry);
+            return;
+        }
+    }
+    overflow.push_back(entry);
+}
+
+/**
+ * @brief Advances one tick at a time up to now.
+ *
+ * At each tick, the slots of the levels whose ring turns are emptied into the finer
+ * levels, coarsest first, then the level 0 slot of the tick fires. The overflow is
+ * placed again whenever the last ring turns.
+ *
+ * @param now The new current tick.
+ * @param expired Receives the keys of the fired timers.
+ */
+void TimerWheel::advance(int64_t now, std::vector<Key> &expired)
+{
+    while (tick < now)
+    {
+        tick++;
+
+        int turned = 0;
+        while (turned + 1 < LEVELS && (tick & ((int64_t(1) << (SLOT_BITS * (turned + 1))) - 1)) == 0)
+            turned++;
+        for (int level = turned; level >= 1; level--)
+        {
+            std::vector<Entry> moving;
+            moving.swap(slots[level][(tick >> (SLOT_BITS * level)) & (SLOTS - 1)]);
+            if (level == LEVELS - 1)
+            {
+                moving.insert(moving.end(), overflow.begin(), overflow.end());
+                overflow.clear();
+            }
+            for (const Entry &entry : moving)
+            {
+                if (valid(entry))
+                    place(entry);
+            }
+        }
+
+        std::vector<Entry> firing;
+        firing.swap(slots[0][tick & (SLOTS - 1)]);
+        for (const Entry &entry : firing)
+        {
+            if (!valid(entry))
+                continue;
+            if (entry.due <= tick)
+            {
+                live.erase(entry.key);
+                expired.push_back(entry.key);
+            }
+            else
+                place(entry);
+        }
+    }
+}
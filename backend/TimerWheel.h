@@ -0,0 +1,106 @@
+/**
+ * @file TimerWheel.h
+ * @brief Declaration of the TimerWheel class.
+ *
+ * A hierarchical timer wheel: LEVELS rings of SLOTS slots, where a slot of level l spans
+ * SLOTS^l ticks. A timer goes into the coarsest level its distance needs and moves one
+ * level down each time the ring above it turns, so scheduling, cancelling and firing a
+ * timer cost O(1) amortized, however many timers are pending.
+ */
+
+#ifndef TIMERWHEEL_H
+#define TIMERWHEEL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @class TimerWheel
+ * @brief Timers keyed by an integer, firing at whole ticks.
+ *
+ * Cancelling only forgets the key; the entry stays in its slot and is dropped when the
+ * slot is reached. Rescheduling a key replaces its previous timer. Not thread-safe.
+ */
+class TimerWheel
+{
+public:
+    using Key = int64_t;
+
+    static constexpr int SLOT_BITS = 6;                 /**< 64 slots per level */
+    static constexpr int SLOTS = 1 << SLOT_BITS;        /**< Slots per level */
+    static constexpr int LEVELS = 4;                    /**< Levels, spanning SLOTS^LEVELS ticks */
+
+    /**
+     * @brief Creates an empty wheel.
+     *
+     * @param now The current tick.
+     */
+    explicit TimerWheel(int64_t now);
+
+    /**
+     * @brief Sets the timer of a key, replacing any earlier one.
+     *
+     * @param key The key.
+     * @param tick When it fires; a tick that has passed fires on the next advance().
+     */
+    void schedule(Key key, int64_t tick);
+
+    /**
+     * @brief Drops the timer of a key, if it has one.
+     *
+     * @param key The key.
+     */
+    void cancel(Key key);
+
+    /**
+     * @brief Moves the wheel to a tick and collects the keys whose timers fired.
+     *
+     * @param now The new current tick; earlier ticks are ignored.
+     * @param expired Receives the keys, in firing order.
+     */
+    void advance(int64_t now, std::vector<Key> &expired);
+
+    /**
+     * @brief The current tick.
+     */
+    int64_t current() const { return tick; }
+
+    /**
+     * @brief True if a key has a pending timer.
+     */
+    bool contains(Key key) const { return live.count(key) > 0; }
+
+    /**
+     * @brief Number of pending timers.
+     */
+    size_t size() const { return live.size(); }
+
+private:
+    /**
+     * @brief A timer in a slot, valid while live holds the same tick for its key.
+     */
+    struct Entry
+    {
+        Key key;                /**< The key */
+        int64_t due;            /**< The tick it fires at */
+    };
+
+    /**
+     * @brief Puts an entry into the slot matching its distance from the current tick.
+     */
+    void place(const Entry &entry);
+
+    /**
+     * @brief True if the entry is still the timer of its key.
+     */
+    bool valid(const Entry &entry) const;
+
+    int64_t tick;                                       /**< The current tick */
+    std::vector<Entry> slots[LEVELS][SLOTS];            /**< The rings */
+    std::vector<Entry> overflow;                        /**< Timers beyond the last ring */
+    std::unordered_map<Key, int64_t> live;              /**< Tick of every pending timer */
+};
+
+#endif // TIMERWHEEL_H
@@ -11,11 +11,15 @@
  *
  * A helper function is also included to retrieve a task by ID from any category.
  *
+ * Every change goes through append() and removeAt(), which keep the slot map and the
+ * secondary indexes used by query() in step with the category vectors.
+ *
  * @author Robin
  */
 
 
 #include "TodoList.h"
+#include <algorithm>
 #include <iostream>
 
 /**
@@ -28,26 +32,192 @@
  */
 Task* TodoList::findTask(int taskID)
 {
-    for (auto& task : backlog)
-        if (task.getTaskID() == taskID) return &task;
-    for (auto& task : doing)
-        if (task.getTaskID() == taskID) return &task;
-    for (auto& task : review)
-        if (task.getTaskID() == taskID) return &task;
-    for (auto& task : done)
-        if (task.getTaskID() == taskID) return &task;
+    auto it = slots.find(taskID);
+    if (it == slots.end()) return nullptr;
+    return &categoryAt(it->second.category)[it->second.index];
+}
+
+/**
+ * @brief Get a task by its ID.
+ *
+ * @param taskID The ID of the task.
+ * @return Pointer to the Task if found, otherwise nullptr.
+ */
+const Task* TodoList::getTask(int taskID) const
+{
+    auto it = slots.find(taskID);
+    if (it == slots.end()) return nullptr;
+    return &categoryAt(it->second.category)[it->second.index];
+}
+
+/**
+ * @brief Get a category's vector by number.
+ *
+ * @param category 0 for Backlog, 1 for Doing, 2 for Review, 3 for Done.
+ * @return Reference to the vector.
+ */
+std::vector<Task>& TodoList::categoryAt(int category)
+{
+    switch (category)
+    {
+    case 1: return doing;
+    case 2: return review;
+    case 3: return done;
+    default: return backlog;
+    }
+}
+
+/**
+ * @brief Get a category's vector by number.
+ *
+ * @param category 0 for Backlog, 1 for Doing, 2 for Review, 3 for Done.
+ * @return Reference to the vector.
+ */
+const std::vector<Task>& TodoList::categoryAt(int category) const
+{
+    return const_cast<TodoList*>(this)->categoryAt(category);
+}
 
-    return nullptr;
+/**
+ * @brief Get the number of a category.
+ *
+ * @param category The category name ("Backlog", "Doing", "Review", "Done").
+ * @return 0 to 3, or -1 if the category is unknown.
+ */
+int TodoList::categoryNumber(std::string_view category)
+{
+    if (category == "Backlog") return 0;
+    else if (category == "Doing") return 1;
+    else if (category == "Review") return 2;
+    else if (category == "Done") return 3;
+    return -1;
+}
+
+/**
+ * @brief Append a task to a category and index it.
+ *
+ * @param category The category number.
+ * @param task The task, moved into the list.
+ */
+void TodoList::append(int category, Task task)
+{
+    std::vector<Task>& tasks = categoryAt(category);
+    indexTask(task);
+    slots[task.getTaskID()] = {category, tasks.size()};
+    tasks.push_back(std::move(task));
+}
+
+/**
+ * @brief Remove the task at a slot and take it out of the indexes.
+ *
+ * The tasks after it move up by one, like the vector erase itself.
+ *
+ * @param slot Where the task is stored.
+ * @return The removed task.
+ */
+Task TodoList::removeAt(Slot slot)
+{
+    std::vector<Task>& tasks = categoryAt(slot.category);
+    Task removed = std::move(tasks[slot.index]);
+    tasks.erase(tasks.begin() + slot.index);
+
+    unindexTask(removed);
+    slots.erase(removed.getTaskID());
+    for (size_t i = slot.index; i < tasks.size(); i++)
+        slots[tasks[i].getTaskID()].index = i;
+    return removed;
+}
+
+/**
+ * @brief Add a task's fields to the secondary indexes.
+ *
+ * @param task The task.
+ */
+void TodoList::indexTask(const Task& task)
+{
+    byPriority[task.getTaskPriority()].insert(task.getTaskID());
+    byDueDate.emplace(task.getTaskDate(), task.getTaskID());
+    byName.emplace(task.getTaskName(), task.getTaskID());
+}
+
+/**
+ * @brief Remove a task's fields from the secondary indexes.
+ *
+ * @param task The task, with the fields it was indexed with.
+ */
+void TodoList::unindexTask(const Task& task)
+{
+    auto priority = byPriority.find(task.getTaskPriority());
+    if (priority != byPriority.end())
+    {
+        priority->second.erase(task.getTaskID());
+        if (priority->second.empty())
+            byPriority.erase(priority);
+    }
+
+    auto eraseFrom = [&](std::multimap<std::string, int>& index, const std::string& key)
+    {
+        auto range = index.equal_range(key);
+        for (auto it = range.first; it != range.second; ++it)
+        {
+            if (it->second == task.getTaskID())
+            {
+                index.erase(it);
+                return;
+            }
+        }
+    };
+    eraseFrom(byDueDate, task.getTaskDate());
+    eraseFrom(byName, task.getTaskName());
 }
 
 /**
  * @brief Create a task and add it to the backlog category.
  *
- * @param task The task to be added.
+ * @param task The task to be added, moved into the backlog.
+ */
+void TodoList::createTask(Task task)
+{
+    append(0, std::move(task));
+}
+
+/**
+ * @brief Add a task to the category matching its status.
+ *
+ * @param task The task to be added, moved into the list.
+ */
+void TodoList::restoreTask(Task task)
+{
+    int category = std::max(0, categoryNumber(task.getTaskStatus()));
+    append(category, std::move(task));
+}
+
+/**
+ * @brief Replace the task with the same ID, or add it if there is none.
+ *
+ * The task keeps its position when its category did not change.
+ *
+ * @param task The new version of the task, moved into the list.
  */
-void TodoList::createTask(const Task& task)
+void TodoList::storeTask(Task task)
 {
-    backlog.push_back(task);
+    int target = std::max(0, categoryNumber(task.getTaskStatus()));
+
+    auto it = slots.find(task.getTaskID());
+    if (it != slots.end())
+    {
+        Slot slot = it->second;
+        if (slot.category == target)
+        {
+            Task& stored = categoryAt(slot.category)[slot.index];
+            unindexTask(stored);
+            indexTask(task);
+            stored = std::move(task);
+            return;
+        }
+        removeAt(slot);
+    }
+    append(target, std::move(task));
 }
 
 /**
@@ -59,16 +229,7 @@ void TodoList::createTask(const Task& task)
  */
 void TodoList::readTask(int taskID) const
 {
-    const Task* task = nullptr;
-
-    for (const auto& t : backlog)
-        if (t.getTaskID() == taskID) task = &t;
-    for (const auto& t : doing)
-        if (t.getTaskID() == taskID) task = &t;
-    for (const auto& t : review)
-        if (t.getTaskID() == taskID) task = &t;
-    for (const auto& t : done)
-        if (t.getTaskID() == taskID) task = &t;
+    const Task* task = getTask(taskID);
 
     if (task)
         task->displayTask();
@@ -87,22 +248,16 @@ void TodoList::readTask(int taskID) const
  */
 bool TodoList::updateStatus(int taskID, const std::string& newStatus)
 {
-    Task* task = findTask(taskID);
-    if (!task) return false;
-
-    // Copy and update the task
-    Task updatedTask = *task;
-    updatedTask.editTaskStatus(newStatus);
+    int target = categoryNumber(newStatus);
+    if (target < 0) return false;
 
-    // Remove from current category
-    deleteTask(taskID);
-
-    // Add to new category
-    if (newStatus == "Backlog") backlog.push_back(updatedTask);
-    else if (newStatus == "Doing") doing.push_back(updatedTask);
-    else if (newStatus == "Review") review.push_back(updatedTask);
-    else if (newStatus == "Done") done.push_back(updatedTask);
+    auto it = slots.find(taskID);
+    if (it == slots.end()) return false;
 
+    // Move the task over instead of copying it
+    Task updatedTask = removeAt(it->second);
+    updatedTask.editTaskStatus(newStatus);
+    append(target, std::move(updatedTask));
     return true;
 }
 
@@ -114,20 +269,11 @@ bool TodoList::updateStatus(int taskID, const std::string& newStatus)
  */
 bool TodoList::deleteTask(int taskID)
 {
-    auto removeTask = [&](std::vector<Task>& tasks)
-    {
-        auto it = std::remove_if(tasks.begin(), tasks.end(),
-            [&](const Task& t) { return t.getTaskID() == taskID; });
-
-        if (it != tasks.end())
-        {
-            tasks.erase(it, tasks.end());
-            return true;
-        }
-        return false;
-    };
+    auto it = slots.find(taskID);
+    if (it == slots.end()) return false;
 
-    return removeTask(backlog) || removeTask(doing) || removeTask(review) || removeTask(done);
+    removeAt(it->second);
+    return true;
 }
 
 /**
@@ -169,3 +315,140 @@ std::vector<Task> TodoList::filterByPriority(const std::string& priority) const
 
     return result;
 }
+
+/**
+ * @brief Find the tasks matching every predicate of a query.
+ *
+ * Each predicate's index can list its matching IDs. The predicate with the fewest
+ * candidates is enumerated and every candidate is checked against the remaining
+ * predicates on the task itself. Range sizes are only counted up to the best
+ * candidate count found so far, so a wide date range or short prefix costs no more
+ * than the predicate that wins.
+ *
+ * @param query The predicates.
+ * @return A view of the matching tasks in ID order.
+ */
+TodoList::View TodoList::query(const TaskQuery& query) const
+{
+    bool anyCategory = query.categories.empty();
+    bool wantedCategory[4] = {anyCategory, anyCategory, anyCategory, anyCategory};
+    for (const auto& name : query.categories)
+    {
+        int number = categoryNumber(name);
+        if (number >= 0) wantedCategory[number] = true;
+    }
+    bool hasDueRange = !query.dueFrom.empty() || !query.dueTo.empty();
+    // An inverted range matches nothing, and its bounds would cross below
+    if (!query.dueFrom.empty() && !query.dueTo.empty() && query.dueFrom > query.dueTo)
+        return View(this, {});
+
+    auto dueBegin = query.dueFrom.empty() ? byDueDate.begin() : byDueDate.lower_bound(query.dueFrom);
+    auto dueEnd = query.dueTo.empty() ? byDueDate.end() : byDueDate.upper_bound(query.dueTo);
+    auto nameBegin = byName.lower_bound(query.namePrefix);
+    auto hasPrefix = [&](const std::string& name)
+    { return name.compare(0, query.namePrefix.size(), query.namePrefix) == 0; };
+
+    auto matches = [&](const Task& task, int category)
+    {
+        if (!wantedCategory[category]) return false;
+        if (!query.priorities.empty() &&
+            std::find(query.priorities.begin(), query.priorities.end(), task.getTaskPriority()) == query.priorities.end())
+            return false;
+        if (hasDueRange)
+        {
+            const std::string& due = task.getTaskDate();
+            if (due.empty()) return false;
+            if (!query.dueFrom.empty() && due < query.dueFrom) return false;
+            if (!query.dueTo.empty() && due > query.dueTo) return false;
+        }
+        return hasPrefix(task.getTaskName());
+    };
+
+    // Pick the predicate with the fewest candidates
+    enum Source { All, Categories, Priorities, DueDates, Names };
+    Source source = All;
+    size_t best = slots.size();
+
+    if (!anyCategory)
+    {
+        size_t count = 0;
+        for (int c = 0; c < 4; c++)
+            if (wantedCategory[c]) count += categoryAt(c).size();
+        if (count < best) { best = count; source = Categories; }
+    }
+    if (!query.priorities.empty())
+    {
+        size_t count = 0;
+        for (const auto& priority : query.priorities)
+        {
+            auto it = byPriority.find(priority);
+            if (it != byPriority.end()) count += it->second.size();
+        }
+        if (count < best) { best = count; source = Priorities; }
+    }
+    if (hasDueRange)
+    {
+        size_t count = 0;
+        for (auto it = dueBegin; it != dueEnd && count < best; ++it) count++;
+        if (count < best) { best = count; source = DueDates; }
+    }
+    if (!query.namePrefix.empty())
+    {
+        size_t count = 0;
+        for (auto it = nameBegin; it != byName.end() && count < best && hasPrefix(it->first); ++it) count++;
+        if (count < best) { best = count; source = Names; }
+    }
+
+    std::vector<int> ids;
+    auto consider = [&](int taskID)
+    {
+        const Slot& slot = slots.at(taskID);
+        if (matches(categoryAt(slot.category)[slot.index], slot.category))
+            ids.push_back(taskID);
+    };
+
+    switch (source)
+    {
+    case All:
+    case Categories:
+        for (int c = 0; c < 4; c++)
+        {
+            if (!wantedCategory[c]) continue;
+            for (const Task& task : categoryAt(c))
+                if (matches(task, c)) ids.push_back(task.getTaskID());
+        }
+        break;
+    case Priorities:
+        for (const auto& priority : query.priorities)
+        {
+            auto it = byPriority.find(priority);
+            if (it == byPriority.end()) continue;
+            for (int taskID : it->second) consider(taskID);
+        }
+        break;
+    case DueDates:
+        for (auto it = dueBegin; it != dueEnd; ++it) consider(it->second);
+        break;
+    case Names:
+        for (auto it = nameBegin; it != byName.end() && hasPrefix(it->first); ++it) consider(it->second);
+        break;
+    }
+
+    // Duplicates only come from a priority listed twice
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+    return View(this, std::move(ids));
+}
+
+/**
+ * @brief Get the tasks of a category without copying them.
+ *
+ * @param category The category name ("Backlog", "Doing", "Review", "Done").
+ * @return Reference to the tasks, or to an empty vector if the category is unknown.
+ */
+const std::vector<Task>& TodoList::getCategory(std::string_view category) const
+{
+    static const std::vector<Task> none;
+    int number = categoryNumber(category);
+    return number < 0 ? none : categoryAt(number);
+}
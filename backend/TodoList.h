@@ -1,10 +1,29 @@
 #ifndef TODOLIST_H
 #define TODOLIST_H
 
+#include <iterator>
+#include <map>
+#include <set>
 #include <vector>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include "Task.h"
 
+/**
+ * @struct TaskQuery
+ * @brief A conjunction of predicates on tasks, used by TodoList::query().
+ *
+ * Every field left empty matches all tasks.
+ */
+struct TaskQuery {
+    std::vector<std::string> categories;  /**< Any of these categories ("Backlog", "Doing", "Review", "Done") */
+    std::vector<std::string> priorities;  /**< Any of these priorities */
+    std::string dueFrom;                  /**< Due on or after this date (YYYY-MM-DD) */
+    std::string dueTo;                    /**< Due on or before this date (YYYY-MM-DD) */
+    std::string namePrefix;               /**< Name starts with this, case-sensitive */
+};
+
 /**
  * @class TodoList
  * @brief Manages a categorized collection of tasks using a Kanban-style system.
@@ -14,6 +33,12 @@
  * Internally, each category is stored as a separate vector of Task objects.
  *
  * This class uses helper methods for task lookup and supports status transitions.
+ * getCategory() and forEachTask() give read access to the stored tasks without copying them.
+ *
+ * The list also keeps secondary indexes on ID, priority, due date and name, updated by
+ * every change. query() uses them to combine predicates at a cost proportional to the
+ * tasks matched by the most selective predicate instead of the size of the board.
+ * Task IDs must be unique within a list.
  *
  * @author Robin
  */
@@ -24,6 +49,19 @@ private:
     std::vector<Task> review;   /**< Tasks awaiting review */
     std::vector<Task> done;     /**< Completed tasks */
 
+    /**
+     * @brief Where a task is stored: category number (0 Backlog to 3 Done) and position.
+     */
+    struct Slot {
+        int category;
+        size_t index;
+    };
+
+    std::unordered_map<int, Slot> slots;                 /**< Position of every task by ID */
+    std::map<std::string, std::set<int>> byPriority;     /**< Task IDs by priority */
+    std::multimap<std::string, int> byDueDate;           /**< Task IDs by due date */
+    std::multimap<std::string, int> byName;              /**< Task IDs by name, for prefix searches */
+
     /**
      * @brief Find a task by ID across all categories.
      *
@@ -32,7 +70,98 @@ private:
      */
     Task* findTask(int taskID);
 
+    /**
+     * @brief Get a category's vector by number, 0 for Backlog to 3 for Done.
+     */
+    std::vector<Task>& categoryAt(int category);
+
+    /**
+     * @brief Get a category's vector by number, 0 for Backlog to 3 for Done.
+     */
+    const std::vector<Task>& categoryAt(int category) const;
+
+    /**
+     * @brief Get the number of a category.
+     *
+     * @param category One of "Backlog", "Doing", "Review", or "Done".
+     * @return The number, 0 for Backlog to 3 for Done, or -1 for an unknown category.
+     */
+    static int categoryNumber(std::string_view category);
+
+    /**
+     * @brief Append a task to a category and index it.
+     */
+    void append(int category, Task task);
+
+    /**
+     * @brief Remove the task at a slot and take it out of the indexes.
+     *
+     * @return The removed task.
+     */
+    Task removeAt(Slot slot);
+
+    /**
+     * @brief Add a task's fields to the secondary indexes.
+     */
+    void indexTask(const Task& task);
+
+    /**
+     * @brief Remove a task's fields from the secondary indexes.
+     */
+    void unindexTask(const Task& task);
+
 public:
+    /**
+     * @class View
+     * @brief Result of query(): the IDs of the matching tasks, resolved while iterating.
+     *
+     * A view is only valid until the list it came from changes.
+     */
+    class View {
+    public:
+        /**
+         * @brief Iterates the matching tasks in ID order.
+         */
+        class const_iterator {
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = Task;
+            using difference_type = std::ptrdiff_t;
+            using pointer = const Task*;
+            using reference = const Task&;
+
+            const_iterator(const TodoList* list, std::vector<int>::const_iterator position)
+                : list(list), position(position) {}
+
+            reference operator*() const { return *list->getTask(*position); }
+            pointer operator->() const { return list->getTask(*position); }
+            const_iterator& operator++() { ++position; return *this; }
+            const_iterator operator++(int) { const_iterator old = *this; ++position; return old; }
+            bool operator==(const const_iterator& other) const { return position == other.position; }
+            bool operator!=(const const_iterator& other) const { return position != other.position; }
+
+        private:
+            const TodoList* list;                        /**< The list the tasks live in */
+            std::vector<int>::const_iterator position;   /**< Current task ID */
+        };
+
+        View(const TodoList* list, std::vector<int> ids) : list(list), ids(std::move(ids)) {}
+
+        const_iterator begin() const { return const_iterator(list, ids.begin()); }
+        const_iterator end() const { return const_iterator(list, ids.end()); }
+        size_t size() const { return ids.size(); }
+        bool empty() const { return ids.empty(); }
+
+        /**
+         * @brief IDs of the matching tasks, in ascending order.
+         */
+        const std::vector<int>& taskIDs() const { return ids; }
+
+    private:
+        const TodoList* list;      /**< The list queried */
+        std::vector<int> ids;      /**< Matching task IDs, sorted */
+    };
+
     /**
      * @brief Default constructor.
      */
@@ -46,9 +175,28 @@ public:
     /**
      * @brief Add a new task to the backlog.
      *
-     * @param task The task to add.
+     * @param task The task to add, moved into the list.
+     */
+    void createTask(Task task);
+
+    /**
+     * @brief Add a task straight into the category named by its status.
+     *
+     * Used when a list is rebuilt from storage. Tasks whose status is not a category
+     * go to the backlog, like tasks added with createTask().
+     *
+     * @param task The task to add, moved into the list.
+     */
+    void restoreTask(Task task);
+
+    /**
+     * @brief Replace the task with the same ID, or add it if there is none.
+     *
+     * The task is filed under the category named by its status, like restoreTask().
+     *
+     * @param task The new version of the task, moved into the list.
      */
-    void createTask(const Task& task);
+    void storeTask(Task task);
 
     /**
      * @brief Display the task with the given ID.
@@ -64,7 +212,7 @@ public:
      *
      * @param taskID The ID of the task to update.
      * @param newStatus The new status/category to move the task to.
-     * @return true if the task was updated successfully, false if not found.
+     * @return true if the task was updated successfully, false if not found or newStatus is not a category.
      */
     bool updateStatus(int taskID, const std::string& newStatus);
 
@@ -91,6 +239,46 @@ public:
      * @return A vector of tasks that match the given priority.
      */
     std::vector<Task> filterByPriority(const std::string& priority) const;
+
+    /**
+     * @brief Get the tasks of a category without copying them.
+     *
+     * @param category One of "Backlog", "Doing", "Review", or "Done".
+     * @return Reference to the tasks in the category, empty for an unknown category.
+     */
+    const std::vector<Task>& getCategory(std::string_view category) const;
+
+    /**
+     * @brief Find the tasks matching every predicate of a query.
+     *
+     * Candidates come from the most selective predicate's index (category, priority,
+     * due date range or name prefix) and are checked against the other predicates.
+     *
+     * @param query The predicates, empty fields match everything.
+     * @return A view of the matching tasks in ID order, valid until the list changes.
+     */
+    View query(const TaskQuery& query) const;
+
+    /**
+     * @brief Get a task by ID.
+     *
+     * @param taskID The ID of the task.
+     * @return Pointer to the task, nullptr if there is none. Valid until the list changes.
+     */
+    const Task* getTask(int taskID) const;
+
+    /**
+     * @brief Call a function on every task, category by category, without copying.
+     *
+     * @param visit Called with a const Task& for each task.
+     */
+    template <typename Visitor>
+    void forEachTask(Visitor&& visit) const
+    {
+        for (const auto* tasks : {&backlog, &doing, &review, &done})
+            for (const Task& task : *tasks)
+                visit(task);
+    }
 };
 
 #endif // TODOLIST_H
@@ -0,0 +1,221 @@
+/**
+ * @file UrgencyIndex.cpp
+ * @brief Implementation of the UrgencyIndex class.
+ */
+
+#include "UrgencyIndex.h"
+#include <mutex>
+#include <queue>
+#include <string>
+#include <string_view>
+#include "TaskTable.h"
+
+namespace {
+
+/**
+ * @brief Reads a text column, mapping NULL to an empty string.
+ */
+std::string_view text(sqlite3_stmt *stmt, int col)
+{
+    const char *value = (const char *)sqlite3_column_text(stmt, col);
+    return std::string_view(value ? value : "", sqlite3_column_bytes(stmt, col));
+}
+
+/**
+ * @brief Columns read for a task: id, project_id, due_date, priority, status.
+ */
+constexpr const char *TASK_SELECT = "SELECT id, project_id, due_date, priority, status FROM tasks ";
+
+} // namespace
+
+/**
+ * @brief Constructs an empty index.
+ *
+ * @param memberships Projects of each user.
+ */
+UrgencyIndex::UrgencyIndex(const MembershipIndex &memberships) : memberships(memberships)
+{
+}
+
+/**
+ * @brief Reads all open tasks.
+ *
+ * @param db The connection.
+ * @param replace false to keep what was loaded from other shards.
+ * @return bool false if a query failed.
+ */
+bool UrgencyIndex::load(sqlite3 *db, bool replace)
+{
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    if (replace)
+    {
+        byProject.clear();
+        locations.clear();
+    }
+
+    sqlite3_stmt *stmt;
+    std::string sql = std::string(TASK_SELECT) + "WHERE status IS NOT 'completed';";
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK)
+        return false;
+    while (sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        int32_t due = TaskTable::dayNumber(text(stmt, 2));
+        if (due != TaskTable::NO_DUE_DATE)
+            put(sqlite3_column_int(stmt, 1), {due, sqlite3_column_int(stmt, 3), sqlite3_column_int(stmt, 0)});
+    }
+    sqlite3_finalize(stmt);
+    return true;
+}
+
+/**
+ * @brief Re-reads a task and updates its entry.
+ *
+ * @param db Connection that committed the change.
+ * @param taskID The task ID.
+ */
+void UrgencyIndex::refreshTask(sqlite3 *db, int taskID)
+{
+    sqlite3_stmt *stmt;
+    std::string sql = std::string(TASK_SELECT) + "WHERE id = ?;";
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK)
+        return;
+    sqlite3_bind_int(stmt, 1, taskID);
+
+    bool indexed = false;
+    int projectID = 0;
+    Entry entry{TaskTable::NO_DUE_DATE, 0, taskID};
+    if (sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        projectID = sqlite3_column_int(stmt, 1);
+        entry.due = TaskTable::dayNumber(text(stmt, 2));
+        entry.priority = sqlite3_column_int(stmt, 3);
+        indexed = entry.due != TaskTable::NO_DUE_DATE && text(stmt, 4) != "completed";
+    }
+    sqlite3_finalize(stmt);
+
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    if (indexed)
+        put(projectID, entry);
+    else
+        erase(taskID);
+}
+
+/**
+ * @brief Drops the tasks of a project.
+ *
+ * @param projectID The project ID.
+ */
+void UrgencyIndex::removeProject(int projectID)
+{
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    auto tasks = byProject.find(projectID);
+    if (tasks != byProject.end())
+    {
+        for (const Entry &entry : tasks->second)
+            locations.erase(entry.taskID);
+        byProject.erase(tasks);
+    }
+}
+
+/**
+ * @brief Drops every task.
+ */
+void UrgencyIndex::clear()
+{
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    byProject.clear();
+    locations.clear();
+}
+
+/**
+ * @brief The first k entries of a project's set.
+ *
+ * @param projectID The project ID.
+ * @param k Maximum number of tasks.
+ * @return std::vector<int> Task IDs, most urgent first.
+ */
+std::vector<int> UrgencyIndex::mostUrgentInProject(int projectID, size_t k) const
+{
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    std::vector<int> ids;
+    auto tasks = byProject.find(projectID);
+    if (tasks == byProject.end())
+        return ids;
+    for (auto it = tasks->second.begin(); it != tasks->second.end() && ids.size() < k; ++it)
+        ids.push_back(it->taskID);
+    return ids;
+}
+
+/**
+ * @brief Merges the sets of a user's projects until k tasks are found.
+ *
+ * A heap holds the next entry of each project, so only the k tasks returned and one
+ * head per project are ever looked at.
+ *
+ * @param userID The user ID.
+ * @param k Maximum number of tasks.
+ * @return std::vector<int> Task IDs, most urgent first.
+ */
+std::vector<int> UrgencyIndex::mostUrgentForUser(int userID, size_t k) const
+{
+    using Cursor = std::pair<std::set<Entry>::const_iterator, std::set<Entry>::const_iterator>;
+    auto later = [](const Cursor &a, const Cursor &b)
+    { return *b.first < *a.first; };
+
+    std::vector<int> projects = memberships.projectsOf(userID);
+    std::vector<int> ids;
+    if (projects.empty())
+        return ids;
+
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    std::priority_queue<Cursor, std::vector<Cursor>, decltype(later)> heads(later);
+    for (int projectID : projects)
+    {
+        auto tasks = byProject.find(projectID);
+        if (tasks != byProject.end() && !tasks->second.empty())
+            heads.push({tasks->second.begin(), tasks->second.end()});
+    }
+
+    while (!heads.empty() && ids.size() < k)
+    {
+        Cursor head = heads.top();
+        heads.pop();
+        ids.push_back(head.first->taskID);
+        if (++head.first != head.second)
+            heads.push(head);
+    }
+    return ids;
+}
+
+/**
+ * @brief Adds or replaces a task's entry.
+ *
+ * @param projectID Project of the task.
+ * @param entry The new entry.
+ */
+void UrgencyIndex::put(int projectID, Entry entry)
+{
+    erase(entry.taskID);
+    byProject[projectID].insert(entry);
+    locations[entry.taskID] = {projectID, entry};
+}
+
+/**
+ * @brief Removes a task's entry if it has one.
+ *
+ * @param taskID The task ID.
+ */
+void UrgencyIndex::erase(int taskID)
+{
+    auto it = locations.find(taskID);
+    if (it == locations.end())
+        return;
+    auto tasks = byProject.find(it->second.projectID);
+    if (tasks != byProject.end())
+    {
+        tasks->second.erase(it->second.entry);
+        if (tasks->second.empty())
+            byProject.erase(tasks);
+    }
+    locations.erase(it);
+}
@@ -0,0 +1,130 @@
+/**
+ * @file UrgencyIndex.h
+ * @brief Declaration of the UrgencyIndex class.
+ *
+ * Keeps every open task with a due date ordered by urgency, so "what's due next" for a
+ * project or a user is a walk over the first few entries instead of a sort of all tasks.
+ */
+
+#ifndef URGENCYINDEX_H
+#define URGENCYINDEX_H
+
+#include <sqlite3.h>
+#include <cstdint>
+#include <set>
+#include <shared_mutex>
+#include <unordered_map>
+#include <vector>
+#include "MembershipIndex.h"
+
+/**
+ * @class UrgencyIndex
+ * @brief Per-project ordered sets of open tasks on (due date, priority, task ID).
+ *
+ * Tasks that are completed or have no valid due date are not indexed. Each project has
+ * its own ordered set, updated in O(log n) when a task is written. A user's most urgent
+ * tasks are a k-way merge of the sets of the projects they belong to, taken from the
+ * MembershipIndex, which costs O((p + k) log p) for p projects, whatever the number of tasks.
+ *
+ * The index is built once with load() and then kept up to date by the write pool, which
+ * calls refreshTask() after each committed task change.
+ */
+class UrgencyIndex
+{
+public:
+    /**
+     * @brief Constructs an empty index.
+     *
+     * @param memberships Projects of each user, for mostUrgentForUser().
+     */
+    explicit UrgencyIndex(const MembershipIndex &memberships);
+
+    /**
+     * @brief Reads all open tasks, replacing the current contents.
+     *
+     * @param db The connection.
+     * @param replace false to add to the current contents, for the second and later shards.
+     * @return bool false if a query failed.
+     */
+    bool load(sqlite3 *db, bool replace = true);
+
+    /**
+     * @brief Re-reads a task after a committed change and moves, adds or drops its entry.
+     *
+     * @param db Connection that committed the change.
+     * @param taskID The task ID.
+     */
+    void refreshTask(sqlite3 *db, int taskID);
+
+    /**
+     * @brief Drops the tasks of a deleted project.
+     */
+    void removeProject(int projectID);
+
+    /**
+     * @brief Drops every task.
+     */
+    void clear();
+
+    /**
+     * @brief The most urgent open tasks of a project.
+     *
+     * @param projectID The project ID.
+     * @param k Maximum number of tasks.
+     * @return std::vector<int> Task IDs, most urgent first.
+     */
+    std::vector<int> mostUrgentInProject(int projectID, size_t k) const;
+
+    /**
+     * @brief The most urgent open tasks over all projects of a user.
+     *
+     * @param userID The user ID.
+     * @param k Maximum number of tasks.
+     * @return std::vector<int> Task IDs, most urgent first.
+     */
+    std::vector<int> mostUrgentForUser(int userID, size_t k) const;
+
+private:
+    /**
+     * @brief Sort key of a task: earliest due date, then highest priority (lowest number).
+     */
+    struct Entry
+    {
+        int32_t due;        /**< Due date as a day number */
+        int priority;       /**< Priority, 1 is High */
+        int taskID;         /**< Task ID, makes the key unique */
+
+        bool operator<(const Entry &other) const
+        {
+            if (due != other.due) return due < other.due;
+            if (priority != other.priority) return priority < other.priority;
+            return taskID < other.taskID;
+        }
+    };
+
+    /**
+     * @brief Where an indexed task is filed.
+     */
+    struct Location
+    {
+        int projectID;      /**< Project whose set holds the entry */
+        Entry entry;        /**< The entry */
+    };
+
+    /**
+     * @brief Adds or replaces a task's entry. Caller holds mutex exclusively.
+     */
+    void put(int projectID, Entry entry);
+
+    /**
+     * @brief Removes a task's entry if it has one. Caller holds mutex exclusively.
+     */
+    void erase(int taskID);
+
+    std::unordered_map<int, std::set<Entry>> byProject;               /**< Ordered open tasks per project */
+    std::unordered_map<int, Location> locations;                      /**< Entry of every indexed task */
+    const MembershipIndex &memberships;                               /**< Projects of each user */
+    mutable std::shared_mutex mutex;                                  /**< Readers share, writers are exclusive */
+};
+
+#endif // URGENCYINDEX_H
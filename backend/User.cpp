@@ -13,8 +13,8 @@
  *
  * @author Robin
  */
-User::User(int userID, const std::string& userName, const std::string& userEmail, const std::string& userPassword)
-    : userID(userID), userName(userName), userEmail(userEmail), userPassword(userPassword) {}
+User::User(int userID, std::string userName, std::string userEmail, std::string userPassword)
+    : userID(userID), userName(std::move(userName)), userEmail(std::move(userEmail)), userPassword(std::move(userPassword)) {}
 
 /**
  * @brief Add a project to the user's list of projects.
@@ -22,9 +22,9 @@ User::User(int userID, const std::string& userName, const std::string& userEmail
  * @param projectID The ID of the project.
  * @param project A shared pointer to the Project object.
  */
-void User::addProject(int projectID, const std::shared_ptr<Project>& project)
+void User::addProject(int projectID, std::shared_ptr<Project> project)
 {
-    userProjects[projectID] = project;
+    userProjects[projectID] = std::move(project);
 }
 
 /**
@@ -36,9 +36,7 @@ void User::addProject(int projectID, const std::shared_ptr<Project>& project)
  */
 void User::removeProject(int projectID)
 {
-    if (userProjects.find(projectID) != userProjects.end()) {
-        userProjects.erase(projectID);
-    }
+    userProjects.erase(projectID);
 }
 
 /**
@@ -49,27 +47,27 @@ int User::getUserID() const { return userID; }
 
 /**
  * @brief Get the user's name.
- * @return The user name as a string.
+ * @return Reference to the user name.
  */
-std::string User::getUserName() const { return userName; }
+const std::string& User::getUserName() const { return userName; }
 
 /**
  * @brief Get the user's email address.
- * @return The user email as a string.
+ * @return Reference to the user email.
  */
-std::string User::getUserEmail() const { return userEmail; }
+const std::string& User::getUserEmail() const { return userEmail; }
 
 /**
  * @brief Get the user's password.
- * @return The user password as a string.
+ * @return Reference to the user password.
  */
-std::string User::getUserPassword() const { return userPassword; }
+const std::string& User::getUserPassword() const { return userPassword; }
 
 /**
  * @brief Get all projects associated with this user.
  *
  * @return A map of project IDs to shared pointers to Project objects.
  */
-std::map<int, std::shared_ptr<Project>> User::getUserProjects() const {
+const std::map<int, std::shared_ptr<Project>>& User::getUserProjects() const {
     return userProjects;
 }
@@ -34,7 +34,7 @@ public:
      * @param userEmail The email address of the user.
      * @param userPassword The password of the user.
      */
-    User(int userID, const std::string& userName, const std::string& userEmail, const std::string& userPassword);
+    User(int userID, std::string userName, std::string userEmail, std::string userPassword);
 
     /**
      * @brief Associate a project with the user.
@@ -42,7 +42,7 @@ public:
      * @param projectID The unique ID of the project.
      * @param project A shared pointer to the Project instance.
      */
-    void addProject(int projectID, const std::shared_ptr<Project>& project);
+    void addProject(int projectID, std::shared_ptr<Project> project);
 
     /**
      * @brief Remove a project from the user's list.
@@ -61,30 +61,33 @@ public:
     /**
      * @brief Get the user's name.
      *
-     * @return The user's name as a string.
+     * @return Reference to the user's name.
      */
-    std::string getUserName() const;
+    const std::string& getUserName() const;
 
     /**
      * @brief Get the user's email.
      *
-     * @return The user's email as a string.
+     * @return Reference to the user's email.
      */
-    std::string getUserEmail() const;
+    const std::string& getUserEmail() const;
 
     /**
      * @brief Get the user's password.
      *
-     * @return The user's password as a string.
+     * @return Reference to the user's password.
      */
-    std::string getUserPassword() const;
+    const std::string& getUserPassword() const;
 
     /**
      * @brief Get the user's associated projects.
      *
+     * Returns a reference so walking the projects neither copies the map nor
+     * touches the shared pointers' reference counts.
+     *
      * @return A map of project IDs to shared Project pointers.
      */
-    std::map<int, std::shared_ptr<Project>> getUserProjects() const;
+    const std::map<int, std::shared_ptr<Project>>& getUserProjects() const;
 };
 
 #endif // USER_H
\ No newline at end of file
@@ -0,0 +1,437 @@
+/**
+ * @file UserDirectory.cpp
+ * @brief Implementation of the UserDirectory class.
+ */
+
+#include "UserDirectory.h"
+#include <algorithm>
+#include <functional>
+#include <mutex>
+#include <unordered_set>
+
+namespace {
+
+/**
+ * @brief Lowercases an ASCII letter, other bytes are unchanged.
+ */
+unsigned char lower(char c)
+{
+    unsigned char u = static_cast<unsigned char>(c);
+    return u >= 'A' && u <= 'Z' ? u + ('a' - 'A') : u;
+}
+
+/**
+ * @brief Compares two strings ignoring ASCII case.
+ *
+ * @return int Negative, zero or positive, like strcmp.
+ */
+int compareFolded(std::string_view a, std::string_view b)
+{
+    size_t n = std::min(a.size(), b.size());
+    for (size_t i = 0; i < n; i++)
+    {
+        if (lower(a[i]) != lower(b[i]))
+            return lower(a[i]) < lower(b[i]) ? -1 : 1;
+    }
+    return a.size() < b.size() ? -1 : a.size() > b.size() ? 1 : 0;
+}
+
+/**
+ * @brief Whether a string starts with a prefix, ignoring ASCII case.
+ */
+bool startsFolded(std::string_view value, std::string_view prefix)
+{
+    return value.size() >= prefix.size() && compareFolded(value.substr(0, prefix.size()), prefix) == 0;
+}
+
+/**
+ * @brief Reads a text column, mapping NULL to an empty string.
+ */
+std::string_view text(sqlite3_stmt *stmt, int col)
+{
+    const char *value = (const char *)sqlite3_column_text(stmt, col);
+    return std::string_view(value ? value : "", sqlite3_column_bytes(stmt, col));
+}
+
+} // namespace
+
+/**
+ * @brief Reads every user in ID order and builds the indexes once.
+ *
+ * @param db A connection to shard 0.
+ * @return bool false if the query failed.
+ */
+bool UserDirectory::load(sqlite3 *db)
+{
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(db, "SELECT id, name, email FROM users ORDER BY id;", -1, &stmt, nullptr) != SQLITE_OK)
+        return false;
+
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    arena.clear();
+    records.clear();
+    while (sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        std::string_view name = text(stmt, 1), email = text(stmt, 2);
+        records.push_back({sqlite3_column_int(stmt, 0), static_cast<uint32_t>(arena.size()),
+                           static_cast<uint32_t>(name.size()), static_cast<uint32_t>(email.size())});
+        arena.append(name).append(email);
+    }
+    sqlite3_finalize(stmt);
+    rebuild();
+    return true;
+}
+
+/**
+ * @brief The name or email of a record, a view into the arena.
+ *
+ * @param record The record.
+ * @param which The field.
+ * @return std::string_view The value, valid until the next change.
+ */
+std::string_view UserDirectory::field(uint32_t record, Field which) const
+{
+    const Record &r = records[record];
+    std::string_view all(arena.data() + r.offset, r.nameLength + r.emailLength);
+    return which == Field::Name ? all.substr(0, r.nameLength) : all.substr(r.nameLength);
+}
+
+/**
+ * @brief Copies a record out of the arena.
+ *
+ * @param record The record.
+ * @return User The user.
+ */
+UserDirectory::User UserDirectory::userOf(uint32_t record) const
+{
+    return {records[record].id, std::string(field(record, Field::Name)), std::string(field(record, Field::Email))};
+}
+
+/**
+ * @brief Adds a user. New users have the highest ID so far and are simply appended; any
+ * other ID replaces its record and repacks the directory to keep the records in ID order.
+ *
+ * @param id The user ID.
+ * @param name The name.
+ * @param email The email.
+ */
+void UserDirectory::put(int id, std::string_view name, std::string_view email)
+{
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    auto it = std::lower_bound(records.begin(), records.end(), id,
+                               [](const Record &r, int value) { return r.id < value; });
+    if (it == records.end())
+    {
+        append(id, name, email);
+        return;
+    }
+    for (; it != records.end() && it->id == id; ++it)
+    {
+        if (it->offset != DEAD)
+            erase(static_cast<uint32_t>(it - records.begin()));
+    }
+    append(id, name, email);
+    rebuild();
+}
+
+/**
+ * @brief Drops a user, repacking the directory once half of the arena is dead.
+ *
+ * @param id The user ID.
+ */
+void UserDirectory::remove(int id)
+{
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    auto it = std::lower_bound(records.begin(), records.end(), id,
+                               [](const Record &r, int value) { return r.id < value; });
+    for (; it != records.end() && it->id == id; ++it)
+    {
+        if (it->offset != DEAD)
+            erase(static_cast<uint32_t>(it - records.begin()));
+    }
+    if (deadBytes > arena.size() / 2)
+        rebuild();
+}
+
+/**
+ * @brief Appends a record and adds it to every index.
+ *
+ * The prefix indexes are sorted arrays, so a new user shifts them by one slot; users
+ * are created far less often than they are looked up.
+ *
+ * @param id The user ID.
+ * @param name The name.
+ * @param email The email.
+ */
+void UserDirectory::append(int id, std::string_view name, std::string_view email)
+{
+    uint32_t record = static_cast<uint32_t>(records.size());
+    records.push_back({id, static_cast<uint32_t>(arena.size()),
+                       static_cast<uint32_t>(name.size()), static_cast<uint32_t>(email.size())});
+    arena.append(name).append(email);
+    live++;
+
+    if (live * 4 > emailHash.size() * 3)
+    {
+        // Both tables hold every live record, so they grow together
+        size_t slots = std::max<size_t>(64, emailHash.size() * 2);
+        emailHash.assign(slots, 0);
+        nameHash.assign(slots, 0);
+        for (uint32_t r = 0; r < records.size(); r++)
+        {
+            if (records[r].offset == DEAD)
+                continue;
+            hashInsert(emailHash, Field::Email, r);
+            hashInsert(nameHash, Field::Name, r);
+        }
+    }
+    else
+    {
+        hashInsert(emailHash, Field::Email, record);
+        hashInsert(nameHash, Field::Name, record);
+    }
+
+    for (auto *order : {&nameOrder, &emailOrder})
+    {
+        Field which = order == &nameOrder ? Field::Name : Field::Email;
+        auto at = std::lower_bound(order->begin(), order->end(), record,
+                                   [this, which](uint32_t a, uint32_t b) { return sortsBefore(a, b, which); });
+        order->insert(at, record);
+    }
+}
+
+/**
+ * @brief Unindexes a record and marks it dead, its arena bytes stay until the next rebuild.
+ *
+ * @param record The record.
+ */
+void UserDirectory::erase(uint32_t record)
+{
+    hashErase(emailHash, Field::Email, record);
+    hashErase(nameHash, Field::Name, record);
+    for (auto *order : {&nameOrder, &emailOrder})
+    {
+        Field which = order == &nameOrder ? Field::Name : Field::Email;
+        auto at = std::lower_bound(order->begin(), order->end(), record,
+                                   [this, which](uint32_t a, uint32_t b) { return sortsBefore(a, b, which); });
+        if (at != order->end() && *at == record)
+            order->erase(at);
+    }
+    deadBytes += records[record].nameLength + records[record].emailLength;
+    records[record].offset = DEAD;
+    live--;
+}
+
+/**
+ * @brief Repacks the live records into a new arena in ID order and rebuilds every index.
+ */
+void UserDirectory::rebuild()
+{
+    std::vector<Record> packed;
+    std::string packedArena;
+    for (const Record &r : records)
+    {
+        if (r.offset == DEAD)
+            continue;
+        packed.push_back({r.id, static_cast<uint32_t>(packedArena.size()), r.nameLength, r.emailLength});
+        packedArena.append(arena, r.offset, r.nameLength + r.emailLength);
+    }
+    std::stable_sort(packed.begin(), packed.end(), [](const Record &a, const Record &b) { return a.id < b.id; });
+    records = std::move(packed);
+    arena = std::move(packedArena);
+    records.shrink_to_fit();
+    arena.shrink_to_fit();
+    live = records.size();
+    deadBytes = 0;
+
+    size_t slots = 64;
+    while (live * 4 > slots * 3)
+        slots *= 2;
+    emailHash.assign(slots, 0);
+    nameHash.assign(slots, 0);
+    nameOrder.resize(live);
+    emailOrder.resize(live);
+    for (uint32_t r = 0; r < live; r++)
+    {
+        hashInsert(emailHash, Field::Email, r);
+        hashInsert(nameHash, Field::Name, r);
+        nameOrder[r] = emailOrder[r] = r;
+    }
+    std::sort(nameOrder.begin(), nameOrder.end(),
+              [this](uint32_t a, uint32_t b) { return sortsBefore(a, b, Field::Name); });
+    std::sort(emailOrder.begin(), emailOrder.end(),
+              [this](uint32_t a, uint32_t b) { return sortsBefore(a, b, Field::Email); });
+}
+
+/**
+ * @brief Linear probing insert, the table must have a free slot.
+ *
+ * @param table The hash table.
+ * @param which The field it is on.
+ * @param record The record.
+ */
+void UserDirectory::hashInsert(std::vector<uint32_t> &table, Field which, uint32_t record)
+{
+    size_t mask = table.size() - 1;
+    size_t slot = std::hash<std::string_view>()(field(record, which)) & mask;
+    while (table[slot] != 0)
+        slot = (slot + 1) & mask;
+    table[slot] = record + 1;
+}
+
+/**
+ * @brief Removes a record with backward shift deletion, so lookups never need tombstones.
+ *
+ * @param table The hash table.
+ * @param which The field it is on.
+ * @param record The record.
+ */
+void UserDirectory::hashErase(std::vector<uint32_t> &table, Field which, uint32_t record)
+{
+    size_t mask = table.size() - 1;
+    size_t hole = std::hash<std::string_view>()(field(record, which)) & mask;
+    while (table[hole] != record + 1)
+    {
+        if (table[hole] == 0)
+            return;
+        hole = (hole + 1) & mask;
+    }
+
+    // Move each later entry of the cluster into the hole if its home slot is not between them
+    for (size_t next = (hole + 1) & mask; table[next] != 0; next = (next + 1) & mask)
+    {
+        size_t home = std::hash<std::string_view>()(field(table[next] - 1, which)) & mask;
+        bool stays = hole <= next ? (hole < home && home <= next) : (hole < home || home <= next);
+        if (!stays)
+        {
+            table[hole] = table[next];
+            hole = next;
+        }
+    }
+    table[hole] = 0;
+}
+
+/**
+ * @brief Walks the probe chain of a value.
+ *
+ * @param table The hash table.
+ * @param which The field it is on.
+ * @param value The value to find.
+ * @return uint32_t The matching record with the lowest ID, DEAD if none.
+ */
+uint32_t UserDirectory::hashFind(const std::vector<uint32_t> &table, Field which, std::string_view value) const
+{
+    if (table.empty())
+        return DEAD;
+    size_t mask = table.size() - 1;
+    uint32_t found = DEAD;
+    for (size_t slot = std::hash<std::string_view>()(value) & mask; table[slot] != 0; slot = (slot + 1) & mask)
+    {
+        uint32_t record = table[slot] - 1;
+        if (field(record, which) == value && (found == DEAD || records[record].id < records[found].id))
+            found = record;
+    }
+    return found;
+}
+
+/**
+ * @brief Order of the prefix indexes: lowercased field, then ID.
+ *
+ * @param a A record.
+ * @param b Another record.
+ * @param which The field.
+ * @return bool true if a comes first.
+ */
+bool UserDirectory::sortsBefore(uint32_t a, uint32_t b, Field which) const
+{
+    int order = compareFolded(field(a, which), field(b, which));
+    return order != 0 ? order < 0 : records[a].id < records[b].id;
+}
+
+/**
+ * @brief Finds a user by email through the email hash index.
+ *
+ * @param email The email.
+ * @param user Receives the user.
+ * @return bool false if there is none.
+ */
+bool UserDirectory::findEmail(std::string_view email, User &user) const
+{
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    uint32_t record = hashFind(emailHash, Field::Email, email);
+    if (record == DEAD)
+        return false;
+    user = userOf(record);
+    return true;
+}
+
+/**
+ * @brief Finds the user of a login, like "WHERE email = ? OR name = ?" did: emails are
+ * unique and win, names are not and the oldest user wins.
+ *
+ * @param login Email or name.
+ * @param user Receives the user.
+ * @return bool false if there is none.
+ */
+bool UserDirectory::findLogin(std::string_view login, User &user) const
+{
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    uint32_t record = hashFind(emailHash, Field::Email, login);
+    if (record == DEAD)
+        record = hashFind(nameHash, Field::Name, login);
+    if (record == DEAD)
+        return false;
+    user = userOf(record);
+    return true;
+}
+
+/**
+ * @brief Binary searches both prefix indexes and walks the matches.
+ *
+ * @param prefix The prefix.
+ * @param limit Maximum number of users.
+ * @return std::vector<User> The users, each once.
+ */
+std::vector<UserDirectory::User> UserDirectory::search(std::string_view prefix, size_t limit) const
+{
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    std::vector<User> users;
+    std::unordered_set<int> seen;
+    for (Field which : {Field::Name, Field::Email})
+    {
+        const std::vector<uint32_t> &order = which == Field::Name ? nameOrder : emailOrder;
+        auto it = std::lower_bound(order.begin(), order.end(), prefix,
+                                   [this, which](uint32_t record, std::string_view value) {
+                                       return compareFolded(field(record, which), value) < 0;
+                                   });
+        for (; it != order.end() && users.size() < limit && startsFolded(field(*it, which), prefix); ++it)
+        {
+            if (seen.insert(records[*it].id).second)
+                users.push_back(userOf(*it));
+        }
+    }
+    return users;
+}
+
+/**
+ * @brief Number of users.
+ *
+ * @return size_t The count.
+ */
+size_t UserDirectory::size() const
+{
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return live;
+}
+
+/**
+ * @brief Bytes allocated for the arena, the records and the four indexes.
+ *
+ * @return size_t The bytes.
+ */
+size_t UserDirectory::memoryBytes() const
+{
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return arena.capacity() + records.capacity() * sizeof(Record) +
+           (emailHash.capacity() + nameHash.capacity() + nameOrder.capacity() + emailOrder.capacity()) * sizeof(uint32_t);
+}
@@ -0,0 +1,189 @@
+/**
+ * @file UserDirectory.h
+ * @brief Declaration of the UserDirectory class.
+ *
+ * Keeps the ID, name and email of every user in memory, so login, the signup duplicate
+ * check and assignee autocomplete are answered without a query on the users table.
+ */
+
+#ifndef USERDIRECTORY_H
+#define USERDIRECTORY_H
+
+#include <sqlite3.h>
+#include <cstddef>
+#include <cstdint>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @class UserDirectory
+ * @brief The users of shard 0, with hash indexes on email and name and sorted prefix indexes.
+ *
+ * Names and emails are packed into one character arena, and each user is a 16 byte
+ * record pointing into it. The hash indexes are open addressing tables of record
+ * numbers, and the prefix indexes are record numbers sorted on the lowercased name and
+ * email, so a user costs about 40 bytes plus their name and email. Removed users leave a
+ * dead record until they make up half of the arena, then everything is rebuilt.
+ *
+ * Passwords are not held; login reads them by primary key once the directory has
+ * found the user. The directory is built once with load() and then kept up to date by
+ * the write pool of shard 0, which calls put() and remove() after each committed change.
+ */
+class UserDirectory
+{
+public:
+    /**
+     * @brief A user as returned by the lookups.
+     */
+    struct User
+    {
+        int id = 0;             /**< User ID */
+        std::string name;       /**< Display name, not unique */
+        std::string email;      /**< Email, unique */
+    };
+
+    /**
+     * @brief Reads every user, replacing the current contents.
+     *
+     * @param db A connection to shard 0.
+     * @return bool false if the query failed.
+     */
+    bool load(sqlite3 *db);
+
+    /**
+     * @brief Adds a user, or replaces the user with the same ID.
+     *
+     * @param id The user ID.
+     * @param name The name.
+     * @param email The email.
+     */
+    void put(int id, std::string_view name, std::string_view email);
+
+    /**
+     * @brief Drops a deleted user.
+     *
+     * @param id The user ID.
+     */
+    void remove(int id);
+
+    /**
+     * @brief Looks a user up by exact email.
+     *
+     * @param email The email, compared byte for byte like the UNIQUE index.
+     * @param user Receives the user.
+     * @return bool false if no user has that email.
+     */
+    bool findEmail(std::string_view email, User &user) const;
+
+    /**
+     * @brief Looks up the user a login names: by email first, else the oldest user with that name.
+     *
+     * @param login Email or name.
+     * @param user Receives the user.
+     * @return bool false if no user matches.
+     */
+    bool findLogin(std::string_view login, User &user) const;
+
+    /**
+     * @brief Users whose name or email starts with a prefix, ignoring ASCII case.
+     *
+     * @param prefix The prefix, empty for the first users by name.
+     * @param limit Maximum number of users.
+     * @return std::vector<User> Name matches in name order, then email matches in email order.
+     */
+    std::vector<User> search(std::string_view prefix, size_t limit) const;
+
+    /**
+     * @brief Number of users.
+     */
+    size_t size() const;
+
+    /**
+     * @brief Bytes allocated for the users and the indexes.
+     */
+    size_t memoryBytes() const;
+
+private:
+    /**
+     * @brief A user in the arena: the name, then the email, starting at offset.
+     */
+    struct Record
+    {
+        int32_t id;             /**< User ID, records are in ID order */
+        uint32_t offset;        /**< Start of the name in the arena, DEAD once removed */
+        uint32_t nameLength;    /**< Bytes of the name */
+        uint32_t emailLength;   /**< Bytes of the email, which follows the name */
+    };
+
+    /**
+     * @brief Which string of a record an index is on.
+     */
+    enum class Field
+    {
+        Name,
+        Email
+    };
+
+    static constexpr uint32_t DEAD = UINT32_MAX;  /**< Offset of a removed record */
+
+    /**
+     * @brief The name or email of a record.
+     */
+    std::string_view field(uint32_t record, Field which) const;
+
+    /**
+     * @brief Builds a User from a record.
+     */
+    User userOf(uint32_t record) const;
+
+    /**
+     * @brief Appends a record and indexes it. Caller holds mutex exclusively.
+     */
+    void append(int id, std::string_view name, std::string_view email);
+
+    /**
+     * @brief Marks a record dead and unindexes it. Caller holds mutex exclusively.
+     */
+    void erase(uint32_t record);
+
+    /**
+     * @brief Repacks the live records in ID order and rebuilds the indexes. Caller holds mutex exclusively.
+     */
+    void rebuild();
+
+    /**
+     * @brief Adds a record to the hash table of a field, which must have a free slot.
+     */
+    void hashInsert(std::vector<uint32_t> &table, Field which, uint32_t record);
+
+    /**
+     * @brief Removes a record from the hash table of a field, shifting its probe chain back.
+     */
+    void hashErase(std::vector<uint32_t> &table, Field which, uint32_t record);
+
+    /**
+     * @brief The record with a value in the hash table of a field, the lowest ID if several.
+     *
+     * @return uint32_t The record, DEAD if there is none.
+     */
+    uint32_t hashFind(const std::vector<uint32_t> &table, Field which, std::string_view value) const;
+
+    /**
+     * @brief Orders records on the lowercased field, then on ID.
+     */
+    bool sortsBefore(uint32_t a, uint32_t b, Field which) const;
+
+    std::string arena;                      /**< Names and emails of every record */
+    std::vector<Record> records;            /**< Users in ID order, removed ones included */
+    std::vector<uint32_t> emailHash;        /**< Open addressing on email, record + 1, 0 is empty */
+    std::vector<uint32_t> nameHash;         /**< Open addressing on name, record + 1, 0 is empty */
+    std::vector<uint32_t> nameOrder;        /**< Live records sorted on the lowercased name */
+    std::vector<uint32_t> emailOrder;       /**< Live records sorted on the lowercased email */
+    size_t live = 0;                        /**< Records not removed */
+    size_t deadBytes = 0;                   /**< Arena bytes of removed records */
+    mutable std::shared_mutex mutex;        /**< Readers share, writers are exclusive */
+};
+
+#endif // USERDIRECTORY_H
@@ -5,26 +5,129 @@
  * This file implements a RESTful backend server using the Crow web framework and SQLite3
  * to manage the app
  *
+ * Route handlers never touch SQLite on Crow's I/O threads. Reads are handed to readPool
+ * and writes to writePool (see DbExecutor), which complete the response asynchronously.
+ *
+ * Started with --board-cache-mb <n>, the server also keeps up to n MB of project boards
+ * in memory (see BoardCache). Task lists of a resident project are then answered from
+ * memory, and every task write is applied to the board once it is committed.
+ *
+ * Every client gets token buckets per route class (see RateLimiter). The limits are set
+ * with --rate-limit <class>=<rate>/<burst>, e.g. --rate-limit bulk=2/5, and
+ * --trust-forwarded-for keys clients on X-Forwarded-For behind a reverse proxy.
+ *
+ * The built frontend is served from the same origin as the API (see StaticAssets), from
+ * ../frontend/build or the directory given with --static-dir <path>.
+ *
+ * Backups are taken online (see Backup) every --backup-interval-hours <n> (24 by default,
+ * 0 for none) into --backup-dir <path>, or on POST /admin/backups. --restore <file>
+ * replaces the database with a checked backup before the server starts.
+ *
+ * With --shards <n>, projects are spread over n database files (see ShardSet), each with
+ * its own read and write pools. Routes on a project, task or comment run on the shard
+ * its ID belongs to; list routes across projects run on every shard and merge the rows.
+ * Users stay on shard 0, which is the only shard with --shards 1, the default.
+ *
+ * Due dates are tracked by DeadlineScheduler, which flags tasks overdue when their due day
+ * ends and queues reminders --reminder-hours <n> before (24 by default, 0 for none) in
+ * the outbox table, read with GET /admin/outbox.
+ *
+ * Large responses are written to the taskmaster.db-spool folder (see Spool), up to
+ * --spool-mb <n> (1024 by default); past that they are answered 503.
+ *
+ * Writes sent with an Idempotency-Key header run once (see IdempotencyStore); repeats
+ * within --idempotency-ttl-hours <n> (24 by default) get the first response back.
+ *
  * @author Ethan, Robin, Luca
  */
 
 #include "crow.h"
 #include <sqlite3.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
 #include <iostream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <sstream>
+#include <thread>
+#include <unordered_map>
 #include "crow/middlewares/cors.h"
+#include "AdmissionController.h"
+#include "Backup.h"
+#include "BoardCache.h"
+#include "Comment.h"
+#include "DbExecutor.h"
+#include "DeadlineScheduler.h"
+#include "DeleteJob.h"
+#include "IdempotencyStore.h"
+#include "Maintenance.h"
+#include "MembershipIndex.h"
+#include "MsgPack.h"
+#include "ProjectTransfer.h"
+#include "Schema.h"
+#include "ShardSet.h"
+#include "Spool.h"
+#include "SpooledList.h"
+#include "StaticAssets.h"
+#include "Rank.h"
+#include "RateLimiter.h"
+#include "RequestKind.h"
+#include "Rows.h"
+#include "TaskTable.h"
+#include "UrgencyIndex.h"
+#include "UserDirectory.h"
+
+const char *DB_PATH = "taskmaster.db";
+
+std::unique_ptr<ShardSet> shards;      /**< Database files of the projects, with their pools */
+DbExecutor *readPool = nullptr;        /**< Read workers of shard 0, which holds the users */
+DbExecutor *writePool = nullptr;       /**< Write worker of shard 0 */
+std::vector<std::unique_ptr<Maintenance>> maintenance; /**< Background purge, vacuum and checkpoints, per shard */
+std::vector<std::unique_ptr<Backup>> backups;          /**< Online backups, scheduled and on request, per shard */
+std::unique_ptr<AdmissionController> admission; /**< Sheds requests when the pools fall behind */
+std::unique_ptr<RateLimiter> rateLimiter; /**< Token buckets per client, answering 429 */
+bool trustForwardedFor = false;           /**< Clients are told apart by X-Forwarded-For, behind a proxy */
+std::unique_ptr<BoardCache> boards;       /**< Resident project boards, null without --board-cache-mb */
+MembershipIndex memberships;              /**< Projects of each user and members of each project */
+UrgencyIndex urgency{memberships};        /**< Open tasks by due date and priority, per project */
+UserDirectory directory;                  /**< IDs, names and emails of the users, for login and search */
+StaticAssets frontend;                    /**< The built frontend, empty if it was not found */
+std::unique_ptr<Spool> spool;             /**< Files of large responses, sent by Crow from disk */
+DeleteJobs deleteJobs;                    /**< Running and recently finished bulk deletes */
+std::unique_ptr<DeadlineScheduler> deadlines; /**< Due date timers of the open tasks */
+std::unique_ptr<IdempotencyStore> idempotency; /**< Responses of writes sent with an Idempotency-Key */
+
+const size_t IMPORT_BATCH_LINES = 1000;                  /**< Lines of a project import per write transaction */
+const std::chrono::milliseconds EXPORT_TIMEOUT(120000);  /**< Deadline of a project export */
+const int DELETE_BATCH_ROWS = 500;                       /**< Rows of a bulk delete per write transaction */
+const size_t LIST_SPILL_BYTES = 256 * 1024;              /**< Largest task list kept in memory, longer ones are spooled */
 
-sqlite3 *db;
+/**
+ * @brief Column copy of the tasks of one database file, for reports.
+ */
+struct TaskTableSnapshot
+{
+    std::shared_ptr<const TaskTable> table;              /**< The copy */
+    std::chrono::steady_clock::time_point built;         /**< When it was read */
+};
+std::unordered_map<std::string, TaskTableSnapshot> taskTables; /**< Snapshots by shard file */
+std::mutex taskTableMutex;                               /**< Guards taskTables, one reader rebuilds each */
+const std::chrono::seconds TASK_TABLE_TTL(30);           /**< Age after which reports rebuild taskTable */
 
 /**
  * @brief Executes a raw SQL command on the SQLite3 database.
  *
  * If an error occurs, it logs the error to stderr.
  *
+ * @param db The connection to run the command on.
  * @param sql The raw SQL query to execute.
  * @return int Returns SQLITE_OK (0) if successful, or another SQLite error code.
  */
-int executeSQL(const char *sql)
+int executeSQL(sqlite3 *db, const char *sql)
 {
     char *errMsg = nullptr;
     int rc = sqlite3_exec(db, sql, nullptr, nullptr, &errMsg);
@@ -36,10 +139,711 @@ int executeSQL(const char *sql)
     return rc;
 }
 
-int main()
+/**
+ * @brief Checks whether a client asked for MessagePack instead of JSON.
+ *
+ * @param req The incoming request.
+ * @return true if the Accept header names application/msgpack or application/x-msgpack.
+ */
+bool wantsMsgPack(const crow::request &req)
+{
+    const std::string &accept = req.get_header_value("Accept");
+    return accept.find("application/msgpack") != std::string::npos ||
+           accept.find("application/x-msgpack") != std::string::npos;
+}
+
+/**
+ * @brief Wraps encoded MessagePack bytes in a response.
+ *
+ * @param code The status code.
+ * @param out The writer holding the document.
+ * @return crow::response The response.
+ */
+crow::response msgpackResponse(int code, MsgPackWriter &out)
+{
+    crow::response res(code);
+    res.body = out.take();
+    res.set_header("Content-Type", MSGPACK_CONTENT_TYPE);
+    res.set_header("Vary", "Accept");
+    return res;
+}
+
+/**
+ * @brief Writes the remaining rows of a statement as a list while they are stepped, then finalizes it.
+ *
+ * Lists longer than LIST_SPILL_BYTES go to a spool file instead of memory. A step that
+ * fails half way, e.g. when the pool interrupts a slow query, answers 500 instead of
+ * sending the rows read so far as if they were all of them; a full spool answers 503.
+ *
+ * @param stmt The prepared statement.
+ * @param msgpack Encode the rows as MessagePack instead of JSON.
+ * @param toJson Converts a row to JSON.
+ * @param fields One MessagePack field per column.
+ * @param count Number of fields.
+ * @return crow::response 200 with the list, 503 or 500.
+ */
+crow::response spoolRows(sqlite3_stmt *stmt, bool msgpack, crow::json::wvalue (*toJson)(sqlite3_stmt *),
+                         const MsgPackWriter::Field *fields, size_t count)
+{
+    SpooledList list(msgpack ? SpooledList::Format::MsgPack : SpooledList::Format::Json, *spool, LIST_SPILL_BYTES);
+    MsgPackWriter row;
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW)
+    {
+        bool written;
+        if (msgpack)
+        {
+            row.clear();
+            row.row(stmt, fields, count);
+            written = list.append(row.data());
+        }
+        else
+            written = list.append(toJson(stmt).dump());
+        if (!written)
+        {
+            sqlite3_finalize(stmt);
+            return list.finish();
+        }
+    }
+    sqlite3_finalize(stmt);
+    if (rc != SQLITE_DONE)
+        return crow::response(500, "Query failed while reading rows");
+    return list.finish();
+}
+
+/**
+ * @brief Merges the spooled lists of every shard without loading them into memory.
+ *
+ * @param parts The responses of every shard.
+ * @return crow::response The merged list.
+ */
+crow::response concatenateSpooled(std::vector<crow::response> &parts)
+{
+    return SpooledList::concatenate(parts, *spool, LIST_SPILL_BYTES);
+}
+
+/**
+ * @brief Loads a single comment by ID.
+ *
+ * @param db The connection.
+ * @param id The comment ID.
+ * @param msgpack Encode the comment as MessagePack instead of JSON.
+ * @return crow::response 200 with the comment, 404 if it does not exist, or 500.
+ */
+crow::response fetchComment(sqlite3 *db, int id, bool msgpack = false)
+{
+    sqlite3_stmt *stmt;
+    std::string sql = std::string("SELECT ") + COMMENT_COLUMNS + " FROM comments WHERE id = ?;";
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK)
+        return crow::response(500, "Database error");
+
+    sqlite3_bind_int(stmt, 1, id);
+    if (sqlite3_step(stmt) != SQLITE_ROW)
+    {
+        sqlite3_finalize(stmt);
+        return crow::response(404, "Comment not found");
+    }
+    if (msgpack)
+    {
+        MsgPackWriter out;
+        out.row(stmt, COMMENT_FIELDS, std::size(COMMENT_FIELDS));
+        sqlite3_finalize(stmt);
+        return msgpackResponse(200, out);
+    }
+    crow::json::wvalue comment = commentFromRow(stmt);
+    sqlite3_finalize(stmt);
+    return crow::response(comment);
+}
+
+/**
+ * @brief Applies a committed task change to the in-memory indexes. Called by the write pool.
+ *
+ * @param db Connection that committed the change.
+ * @param taskId The task ID.
+ * @param previousProject Project of the task before the change, 0 if new or unknown.
+ */
+void taskChanged(sqlite3 *db, int taskId, int previousProject = 0)
+{
+    if (boards)
+        boards->refreshTask(db, taskId, previousProject);
+    urgency.refreshTask(db, taskId);
+    deadlines->refreshTask(db, taskId);
+}
+
+/**
+ * @brief Queues the next batch of a project import on the write pool.
+ *
+ * Every batch is its own job, so writes submitted during a long import run between its
+ * batches. The last batch completes the response.
+ *
+ * @param job The import.
+ * @param res The pending response of the import route.
+ * @param writer Write pool of the shard the project is created on.
+ * @return bool false if the write pool queue is full.
+ */
+bool importBatch(const std::shared_ptr<ProjectImport> &job, crow::response &res, DbExecutor &writer)
 {
-    // Enable CORS
-    crow::App<crow::CORSHandler> app;
+    return writer.post([job, &res, &writer](sqlite3 *db) {
+        // Drops what earlier batches committed, so a failed import leaves nothing behind
+        auto undo = [&job, db]() {
+            job->abandon(db);
+            if (job->projectId())
+            {
+                urgency.removeProject(job->projectId());
+                memberships.removeProject(job->projectId());
+            }
+        };
+
+        try
+        {
+            auto created = [db](int taskId) { taskChanged(db, taskId); };
+            auto joined = [&job](int userId) { memberships.add(userId, job->projectId()); };
+            while (job->step(db, IMPORT_BATCH_LINES, created, joined))
+            {
+                // Queue the rest behind the writes that arrived meanwhile, or go on here if the queue is full
+                if (importBatch(job, res, writer))
+                    return;
+            }
+
+            // Comments of a task can arrive in a later batch than the task, drop any stale board
+            if (boards && job->projectId())
+                boards->forget(job->projectId());
+            if (job->failed())
+            {
+                undo();
+                res = crow::response(400, job->failure());
+            }
+            else
+                res = crow::response(201, job->summary());
+        }
+        catch (const std::exception &e)
+        {
+            // The worker would only log it and the client would wait forever
+            std::cerr << "Import failed: " << e.what() << std::endl;
+            if (!sqlite3_get_autocommit(db))
+                sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
+            undo();
+            if (boards && job->projectId())
+                boards->forget(job->projectId());
+            res = crow::response(500, "Import failed");
+        }
+        res.end(); });
+}
+
+/**
+ * @brief Brings the in-memory indexes in line with a bulk delete.
+ *
+ * Boards are dropped after every batch, so a board never shows a half deleted project
+ * for longer than one batch; the urgency and membership indexes are updated once the job
+ * is over.
+ *
+ * @param job The delete job.
+ */
+void deleteApplied(const DeleteJob &job)
+{
+    bool over = job.finished();
+    switch (job.target())
+    {
+    case DeleteJob::Target::Project:
+        if (boards)
+            boards->forget(job.targetId());
+        if (over) {
+            urgency.removeProject(job.targetId());
+            memberships.removeProject(job.targetId());
+        }
+        break;
+    case DeleteJob::Target::User:
+        // A refused delete removed nothing
+        if (over && !job.failed()) {
+            memberships.removeUser(job.targetId());
+            directory.remove(job.targetId());
+        }
+        break;
+    case DeleteJob::Target::AllTasks:
+    case DeleteJob::Target::AllProjects:
+        if (boards)
+            boards->clear();
+        if (over)
+            urgency.clear();
+        if (over && job.target() == DeleteJob::Target::AllProjects)
+            memberships.clear();
+        break;
+    }
+}
+
+/**
+ * @brief Queues the next batch of a bulk delete on the write pool of its current shard.
+ *
+ * Like importBatch(), every batch is its own job, so writes queued meanwhile run between
+ * the batches. A full queue is not waited for: the worker goes on with the next batch of
+ * the same shard itself, and a job that can't reach its next shard fails.
+ *
+ * @param job The delete job.
+ * @return bool false if the write pool queue is full.
+ */
+bool deleteBatch(const std::shared_ptr<DeleteJob> &job)
+{
+    return (*shards)[job->shard()].writer->post([job](sqlite3 *db) {
+        while (job->step(db, DELETE_BATCH_ROWS))
+        {
+            deleteApplied(*job);
+            if (deleteBatch(job))
+                return;
+        }
+        deleteApplied(*job);
+        if (!job->finished() && !deleteBatch(job))
+        {
+            job->fail("Shard " + std::to_string(job->shard()) + " is too busy, try again later");
+            deleteApplied(*job);
+        } });
+}
+
+/**
+ * @brief Starts a bulk delete and answers 202 with the job, or 503 if the pool is full.
+ *
+ * @param res The pending response.
+ * @param target What to delete.
+ * @param targetId ID of the project or user.
+ * @param visit Shards to visit, in order.
+ */
+void startDelete(crow::response &res, DeleteJob::Target target, int targetId, std::vector<int> visit)
+{
+    std::shared_ptr<DeleteJob> job = deleteJobs.create(target, targetId, std::move(visit));
+    if (deleteBatch(job))
+    {
+        res = crow::response(202, job->status());
+        res.set_header("Location", "/jobs/" + std::to_string(job->id()));
+    }
+    else
+    {
+        deleteJobs.remove(job->id());
+        res = crow::response(503, "Server busy, try again later");
+        res.add_header("Retry-After", "1");
+    }
+    res.end();
+}
+
+/**
+ * @brief Every shard, in order.
+ */
+std::vector<int> allShards()
+{
+    std::vector<int> visit;
+    for (int i = 0; i < shards->count(); i++)
+        visit.push_back(i);
+    return visit;
+}
+
+/**
+ * @brief The shards holding some projects, in order and without duplicates.
+ *
+ * Task and comment IDs come from the range of their project's shard, so they work too.
+ *
+ * @param projects Project IDs, or task IDs.
+ * @return std::vector<int> Shard indexes.
+ */
+std::vector<int> shardsOf(const std::vector<int> &projects)
+{
+    std::vector<int> visit;
+    for (int id : projects)
+        visit.push_back(shards->of(id).index);
+    std::sort(visit.begin(), visit.end());
+    visit.erase(std::unique(visit.begin(), visit.end()), visit.end());
+    return visit;
+}
+
+/**
+ * @brief Writes IDs as the comma separated list of an IN clause.
+ *
+ * @param ids The IDs.
+ * @return std::string The list, e.g. "3, 8, 12".
+ */
+std::string idList(const std::vector<int> &ids)
+{
+    std::ostringstream list;
+    for (size_t i = 0; i < ids.size(); i++)
+        list << (i ? ", " : "") << ids[i];
+    return list.str();
+}
+
+/**
+ * @brief Reads the board column of a task.
+ *
+ * @param db The connection.
+ * @param id The task ID.
+ * @param projectId Receives the project ID.
+ * @param status Receives the status.
+ * @return bool false if the task does not exist.
+ */
+bool taskColumn(sqlite3 *db, int id, int &projectId, std::string &status)
+{
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(db, "SELECT project_id, status FROM tasks WHERE id = ?;", -1, &stmt, nullptr) != SQLITE_OK)
+        return false;
+    sqlite3_bind_int(stmt, 1, id);
+    bool found = sqlite3_step(stmt) == SQLITE_ROW;
+    if (found)
+    {
+        projectId = sqlite3_column_int(stmt, 0);
+        status = columnText(stmt, 1);
+    }
+    sqlite3_finalize(stmt);
+    return found;
+}
+
+/**
+ * @brief Re-ranks a board column and drops its board from the cache. Called by the write pool.
+ *
+ * @param db The connection.
+ * @param projectId The project ID.
+ * @param status The status naming the column.
+ */
+void rebalanceColumn(sqlite3 *db, int projectId, const std::string &status)
+{
+    if (rebalanceRanks(db, projectId, status) > 0 && boards)
+        boards->forget(projectId);
+}
+
+/**
+ * @brief Reads the task a comment belongs to.
+ *
+ * @param db The connection.
+ * @param id The comment ID.
+ * @return int The task ID, 0 if the comment does not exist.
+ */
+int commentTask(sqlite3 *db, int id)
+{
+    sqlite3_stmt *stmt;
+    int task = 0;
+    if (sqlite3_prepare_v2(db, "SELECT task_id FROM comments WHERE id = ?;", -1, &stmt, nullptr) == SQLITE_OK)
+    {
+        sqlite3_bind_int(stmt, 1, id);
+        if (sqlite3_step(stmt) == SQLITE_ROW)
+            task = sqlite3_column_int(stmt, 0);
+        sqlite3_finalize(stmt);
+    }
+    return task;
+}
+
+/**
+ * @brief Returns the column copy of the tasks table, rebuilding it once it is too old.
+ *
+ * Reports may be up to TASK_TABLE_TTL behind the database. Concurrent callers wait for
+ * a single rebuild instead of each scanning the table. Every shard file has its own copy.
+ *
+ * @param db The connection to rebuild from.
+ * @param built Set to the time the snapshot was read.
+ * @return std::shared_ptr<const TaskTable> The snapshot.
+ */
+std::shared_ptr<const TaskTable> currentTaskTable(sqlite3 *db, std::chrono::steady_clock::time_point &built)
+{
+    std::lock_guard<std::mutex> lock(taskTableMutex);
+    TaskTableSnapshot &snapshot = taskTables[sqlite3_db_filename(db, "main")];
+    auto now = std::chrono::steady_clock::now();
+    if (!snapshot.table || now - snapshot.built > TASK_TABLE_TTL)
+    {
+        snapshot.table = std::make_shared<const TaskTable>(TaskTable::load(db));
+        snapshot.built = now;
+    }
+    built = snapshot.built;
+    return snapshot.table;
+}
+
+/**
+ * @brief Adds up the task reports of every shard.
+ *
+ * @param parts The report of each shard.
+ * @return crow::response The org-wide report, or the first failed part.
+ */
+crow::response sumReports(std::vector<crow::response> &parts)
+{
+    const char *statuses[] = {"backlog", "inProgress", "review", "completed", "other"};
+    const char *priorities[] = {"1", "2", "3"};
+    long long total = 0, overdue = 0, oldest = 0;
+    long long byStatus[std::size(statuses)] = {};
+    long long byPriority[std::size(priorities)] = {};
+    for (crow::response &part : parts)
+    {
+        if (part.code != 200)
+            return std::move(part);
+        auto report = crow::json::load(part.body);
+        if (!report)
+            return crow::response(500, "Can't merge shard reports");
+        total += report["total"].i();
+        overdue += report["overdue"].i();
+        oldest = std::max<long long>(oldest, report["as_of_seconds_ago"].i());
+        for (size_t i = 0; i < std::size(statuses); i++)
+            byStatus[i] += report["by_status"][statuses[i]].i();
+        for (size_t i = 0; i < std::size(priorities); i++)
+            byPriority[i] += report["by_priority"][priorities[i]].i();
+    }
+
+    crow::json::wvalue report;
+    report["total"] = total;
+    for (size_t i = 0; i < std::size(statuses); i++)
+        report["by_status"][statuses[i]] = byStatus[i];
+    for (size_t i = 0; i < std::size(priorities); i++)
+        report["by_priority"][priorities[i]] = byPriority[i];
+    report["overdue"] = overdue;
+    report["as_of_seconds_ago"] = oldest;
+    return crow::response(report);
+}
+
+/**
+ * @brief Reads an optional URL parameter.
+ *
+ * @param req The incoming request.
+ * @param name The parameter name.
+ * @return std::string The value, or an empty string if it is missing.
+ */
+std::string urlParam(const crow::request &req, const char *name)
+{
+    const char *value = req.url_params.get(name);
+    return value ? value : "";
+}
+
+/**
+ * @brief Reads the include_archived URL parameter of the list routes.
+ *
+ * @param req The incoming request.
+ * @return bool true if archived rows should be listed too.
+ */
+bool includeArchived(const crow::request &req)
+{
+    std::string value = urlParam(req, "include_archived");
+    return value == "1" || value == "true";
+}
+
+/**
+ * @brief Reads the project_id of a JSON request body, to pick the shard of a write.
+ *
+ * @param req The incoming request.
+ * @return long long The project ID, 0 if the body has none.
+ */
+long long bodyProjectId(const crow::request &req)
+{
+    auto body = crow::json::load(req.body);
+    if (!body || !body.has("project_id") || body["project_id"].t() != crow::json::type::Number)
+        return 0;
+    return body["project_id"].i();
+}
+
+/**
+ * @brief Reads the ?shard= parameter of an admin route.
+ *
+ * @param req The incoming request.
+ * @return int The shard, 0 if not given, -1 if there is no such shard.
+ */
+int shardParam(const crow::request &req)
+{
+    std::string value = urlParam(req, "shard");
+    if (value.empty())
+        return 0;
+    int shard = std::atoi(value.c_str());
+    return shard >= 0 && shard < shards->count() ? shard : -1;
+}
+
+/**
+ * @brief Claims the Idempotency-Key of a write, or answers the request from it.
+ *
+ * The key is scoped to the client, method and path, so the same key from two clients or
+ * on two routes is two keys.
+ *
+ * @param req The incoming request.
+ * @param res The pending response of the route handler.
+ * @param key Receives the claimed key, empty if the request has none.
+ * @return bool true if res is answered, now or by the request that holds the key, and
+ *         the route must return.
+ */
+bool claimIdempotencyKey(const crow::request &req, crow::response &res, IdempotencyStore::Claim &key)
+{
+    const std::string &header = req.get_header_value("Idempotency-Key");
+    if (header.empty())
+        return false;
+    if (header.size() > 255)
+    {
+        res = crow::response(400, "Idempotency-Key is longer than 255 characters");
+        res.end();
+        return true;
+    }
+
+    key.key = requestClient(req, trustForwardedFor) + " " + crow::method_name(req.method) + " " + req.url + " " + header;
+    switch (idempotency->begin(key, req.body, res))
+    {
+    case IdempotencyStore::Outcome::Run:
+        return false;
+    case IdempotencyStore::Outcome::Joined:
+        return true;
+    case IdempotencyStore::Outcome::Replayed:
+    case IdempotencyStore::Outcome::Mismatch:
+        break;
+    }
+    res.end();
+    return true;
+}
+
+/**
+ * @brief Answers a write without a worker, and every request waiting on its key.
+ *
+ * @param key The claim from claimIdempotencyKey(), may be empty.
+ * @param res The pending response.
+ * @param result The answer.
+ */
+void answerOnce(const IdempotencyStore::Claim &key, crow::response &res, crow::response result)
+{
+    if (key.empty())
+    {
+        res = std::move(result);
+        res.end();
+    }
+    else
+        idempotency->complete(key, result);
+}
+
+/**
+ * @brief Runs a write on a pool, like DbExecutor::respond(), and keeps its response for its key.
+ *
+ * @param key The claim from claimIdempotencyKey(), may be empty.
+ * @param res The pending response.
+ * @param pool The pool running the write.
+ * @param query The write.
+ */
+void respondOnce(const IdempotencyStore::Claim &key, crow::response &res, DbExecutor &pool, DbExecutor::Query query)
+{
+    if (key.empty())
+    {
+        pool.respond(res, std::move(query));
+        return;
+    }
+    bool queued = pool.evaluate(std::move(query), [key](crow::response result)
+                                { idempotency->complete(key, result); });
+    if (!queued)
+    {
+        // Not kept, so a retry runs the write
+        crow::response busy(503, "Server busy, try again later");
+        busy.add_header("Retry-After", "1");
+        idempotency->complete(key, busy);
+    }
+}
+
+/**
+ * @brief Opens a shard file and brings its schema, ID range and users up to date.
+ *
+ * @param shard The shard.
+ * @return sqlite3* The connection, or nullptr after printing why it failed.
+ */
+sqlite3 *openShard(const ShardSet::Shard &shard)
+{
+    sqlite3 *conn = nullptr;
+    if (sqlite3_open(shard.path.c_str(), &conn))
+    {
+        std::cerr << "Can't open DB " << shard.path << ": " << sqlite3_errmsg(conn) << std::endl;
+        sqlite3_close(conn);
+        return nullptr;
+    }
+
+    // Free pages are released in small steps by Maintenance instead of full VACUUMs.
+    // The mode only sticks on an empty file, older databases are converted once here,
+    // before the server starts listening.
+    executeSQL(conn, "PRAGMA auto_vacuum = INCREMENTAL;");
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(conn, "PRAGMA auto_vacuum;", -1, &stmt, nullptr) == SQLITE_OK)
+    {
+        if (sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_int(stmt, 0) != 2)
+        {
+            std::cout << "Converting " << shard.path << " to incremental auto_vacuum, this runs once..." << std::endl;
+            executeSQL(conn, "VACUUM;");
+        }
+        sqlite3_finalize(stmt);
+    }
+
+    // WAL lets the read workers run while the write worker commits
+    executeSQL(conn, "PRAGMA journal_mode = WAL;");
+
+    // Create schema if not exists, upgrading databases from older versions on the way
+    executeSQL(conn, SCHEMA_SQL);
+    if (migrateSchema(conn) != SQLITE_OK)
+    {
+        std::cerr << "Can't migrate DB schema of " << shard.path << std::endl;
+        sqlite3_close(conn);
+        return nullptr;
+    }
+    executeSQL(conn, SCHEMA_INDEXES_SQL);
+
+    std::string error;
+    if (!ShardSet::prepare(conn, shard.index, error))
+    {
+        std::cerr << "Can't use " << shard.path << " as shard " << shard.index << ": " << error << std::endl;
+        sqlite3_close(conn);
+        return nullptr;
+    }
+
+    // Enforce foreign key constraints, which also drops the memberships of deleted users below
+    executeSQL(conn, "PRAGMA foreign_keys = ON;");
+    if (shard.index > 0 && ShardSet::copyUsers(conn, (*shards)[0].path) != SQLITE_OK)
+        std::cerr << "Can't copy users to " << shard.path << ": " << sqlite3_errmsg(conn) << std::endl;
+    return conn;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t boardCacheMB = 0;
+    uint64_t spoolMB = 1024;
+    RateLimiter::Settings rateLimits;
+    std::string staticDir = "../frontend/build";
+    Backup::Settings backupSettings;
+    std::map<int, std::string> restores;
+    Maintenance::Settings maintenanceSettings;
+    DeadlineScheduler::Settings deadlineSettings;
+    IdempotencyStore::Settings idempotencySettings;
+    int shardCount = 1;
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--board-cache-mb") == 0 && i + 1 < argc)
+            boardCacheMB = std::strtoul(argv[++i], nullptr, 10);
+        else if (std::strcmp(argv[i], "--rate-limit") == 0 && i + 1 < argc)
+        {
+            if (!RateLimiter::parseLimit(argv[++i], rateLimits))
+            {
+                std::cerr << "Bad --rate-limit " << argv[i] << ", expected <read|write|bulk|login|debug>=<rate>/<burst>" << std::endl;
+                return 1;
+            }
+        }
+        else if (std::strcmp(argv[i], "--trust-forwarded-for") == 0)
+            trustForwardedFor = true;
+        else if (std::strcmp(argv[i], "--static-dir") == 0 && i + 1 < argc)
+            staticDir = argv[++i];
+        else if (std::strcmp(argv[i], "--backup-dir") == 0 && i + 1 < argc)
+            backupSettings.directory = argv[++i];
+        else if (std::strcmp(argv[i], "--backup-interval-hours") == 0 && i + 1 < argc)
+            backupSettings.interval = std::chrono::hours(std::strtol(argv[++i], nullptr, 10));
+        else if (std::strcmp(argv[i], "--restore") == 0 && i + 1 < argc)
+            restores[0] = argv[++i];
+        else if (std::strcmp(argv[i], "--restore-shard") == 0 && i + 2 < argc)
+        {
+            int shard = std::atoi(argv[++i]);
+            restores[shard] = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--shards") == 0 && i + 1 < argc)
+            shardCount = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--archive-after-days") == 0 && i + 1 < argc)
+            maintenanceSettings.archiveAfterDays = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--reminder-hours") == 0 && i + 1 < argc)
+            deadlineSettings.reminderLead = std::chrono::hours(std::strtol(argv[++i], nullptr, 10));
+        else if (std::strcmp(argv[i], "--spool-mb") == 0 && i + 1 < argc)
+            spoolMB = std::strtoull(argv[++i], nullptr, 10);
+        else if (std::strcmp(argv[i], "--idempotency-ttl-hours") == 0 && i + 1 < argc)
+            idempotencySettings.ttl = std::chrono::hours(std::strtol(argv[++i], nullptr, 10));
+    }
+
+    // Enable CORS, then rate limiting per client, then load shedding
+    crow::App<crow::CORSHandler, RateLimitGate, AdmissionGate> app;
+
+    rateLimiter = std::make_unique<RateLimiter>(rateLimits);
+    auto &limits = app.get_middleware<RateLimitGate>();
+    limits.limiter = rateLimiter.get();
+    limits.trustForwardedFor = trustForwardedFor;
+    idempotency = std::make_unique<IdempotencyStore>(idempotencySettings);
 
     // Customize CORS
     auto &cors = app.get_middleware<crow::CORSHandler>();
@@ -50,144 +854,226 @@ int main()
         .prefix("/")
         .origin("*");
 
-    // Open SQLite database
-    if (sqlite3_open("taskmaster.db", &db))
+    if (shardCount < 1 || shardCount > ShardSet::MAX_SHARDS)
     {
-        std::cerr << "Can't open DB: " << sqlite3_errmsg(db) << std::endl;
+        std::cerr << "--shards must be between 1 and " << ShardSet::MAX_SHARDS << std::endl;
         return 1;
     }
+    shards = std::make_unique<ShardSet>(DB_PATH, shardCount);
 
-    // Enforce foreign key constraints
-    executeSQL("PRAGMA foreign_keys = ON;");
-
-    // Create schema if not exists
-    const char *createSchema = R"(
-        CREATE TABLE IF NOT EXISTS users (
-            id INTEGER PRIMARY KEY AUTOINCREMENT,
-            name TEXT NOT NULL,
-            email TEXT UNIQUE NOT NULL,
-            password TEXT NOT NULL
-        );
-
-        CREATE TABLE IF NOT EXISTS projects (
-            id INTEGER PRIMARY KEY AUTOINCREMENT,
-            deadline TEXT NOT NULL,
-            date TEXT,
-            completion_status BOOLEAN DEFAULT 0
-        );
-
-        CREATE TABLE IF NOT EXISTS user_projects (
-            user_id INTEGER,
-            project_id INTEGER,
-            PRIMARY KEY (user_id, project_id),
-            FOREIGN KEY (user_id) REFERENCES users(id) ON DELETE CASCADE,
-            FOREIGN KEY (project_id) REFERENCES projects(id) ON DELETE CASCADE
-        );
-
-        CREATE TABLE IF NOT EXISTS tasks (
-            id INTEGER PRIMARY KEY AUTOINCREMENT,
-            title TEXT NOT NULL,
-            description TEXT,
-            due_date TEXT,
-            priority INTEGER DEFAULT 1,
-            status TEXT DEFAULT 'pending',
-            project_id INTEGER,
-            FOREIGN KEY (project_id) REFERENCES projects(id) ON DELETE CASCADE
-        );
-
-        CREATE TABLE IF NOT EXISTS comments (
-            id INTEGER PRIMARY KEY AUTOINCREMENT,
-            body TEXT NOT NULL,
-            date TEXT,
-            status TEXT DEFAULT 'active',
-            user_id INTEGER,
-            task_id INTEGER,
-            FOREIGN KEY (user_id) REFERENCES users(id),
-            FOREIGN KEY (task_id) REFERENCES tasks(id)
-        );
-    )";
-    executeSQL(createSchema);
-
-    // Basic route to confirm server is running
-    CROW_ROUTE(app, "/")([]
-                         { return "Server is running!"; });
-    CROW_ROUTE(app, "/favicon.ico")([]
-                                    { return crow::response(404); });
+    // Nothing has the databases open yet, so backups can be copied over them
+    for (const auto &restore : restores)
+    {
+        if (restore.first < 0 || restore.first >= shards->count())
+        {
+            std::cerr << "There is no shard " << restore.first << " to restore" << std::endl;
+            return 1;
+        }
+        const std::string &path = (*shards)[restore.first].path;
+        std::string error;
+        if (!Backup::restore(restore.second, path, error))
+        {
+            std::cerr << "Can't restore " << restore.second << ": " << error << std::endl;
+            return 1;
+        }
+        std::cout << "Restored " << path << " from " << restore.second << std::endl;
+    }
+
+    // Next to the database, so it is never a folder of whatever directory the server started in
+    spool = std::make_unique<Spool>(std::string(DB_PATH) + "-spool", std::chrono::minutes(10), spoolMB * 1024 * 1024);
+
+    // Before any pool or background thread starts, their callbacks read it without a lock
+    if (boardCacheMB > 0)
+        boards = std::make_unique<BoardCache>(boardCacheMB * 1024 * 1024);
+
+    // Fired timers are applied on the write pool of the task's shard
+    deadlines = std::make_unique<DeadlineScheduler>(
+        [](int taskId) -> DbExecutor & { return *shards->of(taskId).writer; }, deadlineSettings);
+
+    // Open every shard file once. The membership and urgency indexes and the due date timers
+    // are built from all of them before the server starts listening, afterwards only the
+    // write pools change them.
+    for (int i = 0; i < shards->count(); i++)
+    {
+        sqlite3 *conn = openShard((*shards)[i]);
+        if (!conn)
+            return 1;
+        if (!memberships.load(conn, i == 0))
+            std::cerr << "Can't build membership index: " << sqlite3_errmsg(conn) << std::endl;
+        if (!urgency.load(conn, i == 0))
+            std::cerr << "Can't build urgency index: " << sqlite3_errmsg(conn) << std::endl;
+        if (!deadlines->load(conn))
+            std::cerr << "Can't load due date timers: " << sqlite3_errmsg(conn) << std::endl;
+        if (i == 0 && !directory.load(conn))
+            std::cerr << "Can't build user directory: " << sqlite3_errmsg(conn) << std::endl;
+        sqlite3_close(conn);
+    }
+
+    // Every route runs its SQL on the pools of one shard, or of each shard in turn
+    unsigned readers = std::max(2u, std::thread::hardware_concurrency() / shards->count());
+    shards->open(readers, 1024, std::chrono::milliseconds(5000), 256, std::chrono::milliseconds(10000));
+    readPool = (*shards)[0].readers.get();
+    writePool = (*shards)[0].writer.get();
+    deadlines->start();
+
+    for (int i = 0; i < shards->count(); i++)
+    {
+        ShardSet::Shard &shard = (*shards)[i];
+        auto loop = std::make_unique<Maintenance>(shard.path, *shard.writer, *shard.readers, maintenanceSettings);
+        loop->onRanksRebalanced([](int projectId) {
+            if (boards)
+                boards->forget(projectId); });
+        loop->onTaskArchived([](sqlite3 *db, int taskId, int projectId) {
+            // The task is gone from the hot table, so refreshing drops it from the indexes
+            taskChanged(db, taskId, projectId); });
+        loop->start();
+        maintenance.push_back(std::move(loop));
+
+        // Backups of the other shards go to their own folders, the file names are the same
+        Backup::Settings settings = backupSettings;
+        if (i > 0)
+            settings.directory += "/shard-" + std::to_string(i);
+        backups.push_back(std::make_unique<Backup>(shard.path, *shard.writer, *shard.readers, settings));
+        backups.back()->start();
+    }
+
+    // From here on, requests are shed once the pools of any shard keep them waiting too long
+    std::vector<DbExecutor *> pools;
+    for (int i = 0; i < shards->count(); i++)
+    {
+        pools.push_back((*shards)[i].readers.get());
+        pools.push_back((*shards)[i].writer.get());
+    }
+    admission = std::make_unique<AdmissionController>(pools, AdmissionController::Settings());
+    app.get_middleware<AdmissionGate>().controller = admission.get();
+
+    // Read once, the files do not change while the server runs
+    if (frontend.load(staticDir) == 0)
+        std::cerr << "No frontend build in " << staticDir << ", serving the API only" << std::endl;
+
+    // The app, or a line to confirm server is running when there is no frontend build
+    CROW_ROUTE(app, "/")([](const crow::request &req, crow::response &res) {
+        if (!frontend.serve(req, res))
+            res = crow::response("Server is running!");
+        res.end(); });
+
+    // Files of the frontend build and its client-side routes (/home, /project/3, ...)
+    CROW_CATCHALL_ROUTE(app)([](const crow::request &req, crow::response &res) {
+        if (req.method != crow::HTTPMethod::Get || !frontend.serve(req, res))
+            res = crow::response(404);
+        res.end(); });
 
     // ---------------------- TASKS ROUTES ----------------------
 
-    // Get all tasks with optional filtering by status, project_id, or priority
-    CROW_ROUTE(app, "/tasks").methods(crow::HTTPMethod::Get)([](const crow::request &req)
+    // Get all tasks with optional filtering by status, project_id, or priority, or only the overdue ones with ?overdue=1
+    CROW_ROUTE(app, "/tasks").methods(crow::HTTPMethod::Get)([](const crow::request &req, crow::response &res)
                                                              {
-        std::ostringstream query;
-        std::string status = req.url_params.get("status") ? req.url_params.get("status") : "";
-        std::string project_id = req.url_params.get("project_id") ? req.url_params.get("project_id") : "";
-        std::string priority = req.url_params.get("priority") ? req.url_params.get("priority") : "";
+        std::string status = urlParam(req, "status");
+        std::string project_id = urlParam(req, "project_id");
+        std::string priority = urlParam(req, "priority");
+        bool msgpack = wantsMsgPack(req);
+        bool overdue = urlParam(req, "overdue") == "1";
+        // Archived tasks are completed, so never overdue
+        bool archived = includeArchived(req) && !overdue;
+
+        // A project's tasks come from its board when the cache is on, without a worker if it is resident.
+        // Boards hold only the hot table and do not track overdue tasks.
+        if (boards && !project_id.empty() && !archived && !overdue) {
+            int projectId = std::atoi(project_id.c_str());
+            auto list = [status, priority, msgpack](const std::shared_ptr<Board> &board) {
+                if (msgpack) {
+                    MsgPackWriter out;
+                    if (board)
+                        board->writeTasks(out, status, priority);
+                    else
+                        out.arrayHeader(0);
+                    return msgpackResponse(200, out);
+                }
+                crow::json::wvalue::list tasks;
+                if (board)
+                    tasks = board->listTasks(status, priority);
+                return crow::response(crow::json::wvalue(tasks));
+            };
+            if (auto board = boards->find(projectId)) {
+                res = list(board);
+                res.end();
+                return;
+            }
+            shards->of(projectId).readers->respond(res, [projectId, list](sqlite3 *db) {
+                return list(boards->load(db, projectId)); });
+            return;
+        }
 
-        query << "SELECT * FROM tasks";
-        if (!status.empty() || !project_id.empty() || !priority.empty()) {
-            query << " WHERE ";
+        auto tasks = [status, project_id, priority, msgpack, archived, overdue](sqlite3 *db) {
+        std::ostringstream where;
+        if (!status.empty() || !project_id.empty() || !priority.empty() || overdue) {
+            where << " WHERE ";
             bool hasCond = false;
-            if (!status.empty()) { query << "status='" << status << "'"; hasCond = true; }
-            if (!project_id.empty()) { if (hasCond) query << " AND "; query << "project_id=" << project_id; hasCond = true; }
-            if (!priority.empty()) { if (hasCond) query << " AND "; query << "priority=" << priority; }
+            if (!status.empty()) { where << "status='" << status << "'"; hasCond = true; }
+            if (!project_id.empty()) { if (hasCond) where << " AND "; where << "project_id=" << project_id; hasCond = true; }
+            if (!priority.empty()) { if (hasCond) where << " AND "; where << "priority=" << priority; hasCond = true; }
+            // Overdue tasks are the rows of the partial idx_tasks_overdue
+            if (overdue) { if (hasCond) where << " AND "; where << "overdue = 1"; }
         }
+        std::ostringstream query;
+        query << "SELECT " << TASK_COLUMNS << " FROM tasks" << where.str();
+        // The alias lets TASK_COLUMNS select from the archive as well
+        if (archived)
+            query << " UNION ALL SELECT " << TASK_COLUMNS << " FROM tasks_archive AS tasks" << where.str();
+        // A project's columns come back in card order straight from idx_tasks_column
+        if (!project_id.empty())
+            query << " ORDER BY status, rank, id";
         query << ";";
 
+        // Rows are written out as they are stepped, long lists to a spool file
         sqlite3_stmt* stmt;
-        crow::json::wvalue::list tasks;
+        if (sqlite3_prepare_v2(db, query.str().c_str(), -1, &stmt, nullptr) == SQLITE_OK)
+            return spoolRows(stmt, msgpack, taskFromRow, TASK_FIELDS, std::size(TASK_FIELDS));
+        return crow::response(500, "Failed to query tasks."); };
 
-        if (sqlite3_prepare_v2(db, query.str().c_str(), -1, &stmt, nullptr) == SQLITE_OK) {
-            while (sqlite3_step(stmt) == SQLITE_ROW) {
-                crow::json::wvalue task;
-                task["id"] = sqlite3_column_int(stmt, 0);
-                task["title"] = (const char*)sqlite3_column_text(stmt, 1);
-                task["description"] = (const char*)sqlite3_column_text(stmt, 2);
-                task["due_date"] = (const char*)sqlite3_column_text(stmt, 3);
-                task["priority"] = sqlite3_column_int(stmt, 4);
-                task["status"] = (const char*)sqlite3_column_text(stmt, 5);
-                task["project_id"] = sqlite3_column_int(stmt, 6);
-                tasks.push_back(task);
-            }
-            sqlite3_finalize(stmt);
-            return crow::response(crow::json::wvalue(tasks));
-        }
-        return crow::response(500, "Failed to query tasks."); });
+        // A project lives on one shard, other lists are merged from all of them
+        if (!project_id.empty())
+            shards->of(std::atoll(project_id.c_str())).readers->respond(res, tasks);
+        else
+            shards->gather(res, ShardSet::Pool::Read, tasks, concatenateSpooled); });
 
     // Create a new task
-    CROW_ROUTE(app, "/tasks").methods(crow::HTTPMethod::Post)([](const crow::request &req)
+    CROW_ROUTE(app, "/tasks").methods(crow::HTTPMethod::Post)([](const crow::request &req, crow::response &res)
                                                               {
-        auto body = crow::json::load(req.body);
+        IdempotencyStore::Claim key;
+        if (claimIdempotencyKey(req, res, key))
+            return;
+        // The task goes to the shard of its project
+        respondOnce(key, res, *shards->of(bodyProjectId(req)).writer, [reqBody = req.body](sqlite3 *db) {
+        auto body = crow::json::load(reqBody);
         if (!body) return crow::response(400, "Invalid JSON");
 
+        // New cards go to the bottom of their column
+        std::string rank = rankBetween(lastRank(db, body["project_id"].i(), body["status"].s()), "");
+
         std::ostringstream query;
-        query << "INSERT INTO tasks (title, description, due_date, priority, status, project_id) VALUES ("
+        query << "INSERT INTO tasks (title, description, due_date, priority, status, project_id, rank) VALUES ("
               << "'" << body["title"].s() << "', "
               << "'" << body["description"].s() << "', "
               << "'" << body["due_date"].s() << "', "
               << body["priority"].i() << ", "
               << "'" << body["status"].s() << "', "
-              << body["project_id"].i() << ");";
+              << body["project_id"].i() << ", "
+              << (rank.empty() ? "NULL" : "'" + rank + "'") << ");";
 
-        if (executeSQL(query.str().c_str()) == SQLITE_OK)
+        if (executeSQL(db, query.str().c_str()) == SQLITE_OK)
             {
             // Get the last inserted row and return it
             int last_id = sqlite3_last_insert_rowid(db);
+            taskChanged(db, last_id);
             std::ostringstream getQuery;
-            getQuery << "SELECT * FROM tasks WHERE id = " << last_id << ";";
+            getQuery << "SELECT " << TASK_COLUMNS << " FROM tasks WHERE id = " << last_id << ";";
 
             sqlite3_stmt* stmt;
             if (sqlite3_prepare_v2(db, getQuery.str().c_str(), -1, &stmt, nullptr) == SQLITE_OK) {
                 if (sqlite3_step(stmt) == SQLITE_ROW)
                 {
-                    crow::json::wvalue task;
-                    task["id"] = sqlite3_column_int(stmt, 0);
-                    task["title"] = (const char*)sqlite3_column_text(stmt, 1);
-                    task["description"] = (const char*)sqlite3_column_text(stmt, 2);
-                    task["due_date"] = (const char*)sqlite3_column_text(stmt, 3);
-                    task["priority"] = sqlite3_column_int(stmt, 4);
-                    task["status"] = (const char*)sqlite3_column_text(stmt, 5);
-                    task["project_id"] = sqlite3_column_int(stmt, 6);
+                    crow::json::wvalue task = taskFromRow(stmt);
 
                     sqlite3_finalize(stmt);
                     return crow::response(201, task);
@@ -197,17 +1083,20 @@ int main()
             return crow::response(500, "Task created but failed to fetch it.");
         }
 
-        return crow::response(500, "Failed to insert task."); });
+        return crow::response(500, "Failed to insert task."); }); });
 
     // Update a task
     CROW_ROUTE(app, "/tasks/<int>").methods(crow::HTTPMethod::Put)([](const crow::request &req, crow::response &res, int id)
                                                                    {
-        auto body = crow::json::load(req.body);
-        if (!body) {
-            res.code = 400;
-            res.write("Invalid JSON");
-            return res.end();
-        }
+        IdempotencyStore::Claim key;
+        if (claimIdempotencyKey(req, res, key))
+            return;
+        respondOnce(key, res, *shards->of(id).writer, [reqBody = req.body, id](sqlite3 *db) {
+        auto body = crow::json::load(reqBody);
+        if (!body)
+            return crow::response(400, "Invalid JSON");
+        if (body.has("project_id") && &shards->of(body["project_id"].i()) != &shards->of(id))
+            return crow::response(409, "Can't move a task to a project on another shard");
 
         std::ostringstream query;
         query << "UPDATE tasks SET ";
@@ -219,58 +1108,314 @@ int main()
         if (body.has("status")) query << "status='" << body["status"].s() << "', ";
         if (body.has("project_id")) query << "project_id=" << body["project_id"].i() << ", ";
 
+        // A card that changes column goes to the bottom of the new one
+        int projectId = 0;
+        std::string status;
+        if ((body.has("status") || body.has("project_id")) && taskColumn(db, id, projectId, status)) {
+            int newProject = body.has("project_id") ? (int)body["project_id"].i() : projectId;
+            std::string newStatus = body.has("status") ? std::string(body["status"].s()) : status;
+            if (newProject != projectId || newStatus != status) {
+                std::string rank = rankBetween(lastRank(db, newProject, newStatus), "");
+                query << "rank=" << (rank.empty() ? "NULL" : "'" + rank + "'") << ", ";
+            }
+        }
+
         std::string q = query.str();
         q = q.substr(0, q.size() - 2); // Remove trailing comma
         q += " WHERE id=" + std::to_string(id) + ";";
-        if (executeSQL(q.c_str()) == SQLITE_OK) {
-            res.code = 200;
-            res.write("Task updated successfully");
-        } else {
-            res.code = 500;
-            res.write("Update failed");
+        int previousProject = boards ? BoardCache::projectOf(db, id) : 0;
+        if (executeSQL(db, q.c_str()) == SQLITE_OK) {
+            taskChanged(db, id, previousProject);
+            return crow::response(200, "Task updated successfully");
         }
-        res.end(); });
+        return crow::response(500, "Update failed"); }); });
 
     // Delete a task
-    CROW_ROUTE(app, "/tasks/<int>").methods(crow::HTTPMethod::Delete)([](int id)
+    CROW_ROUTE(app, "/tasks/<int>").methods(crow::HTTPMethod::Delete)([](const crow::request &, crow::response &res, int id)
                                                                       {
+        shards->of(id).writer->respond(res, [id](sqlite3 *db) {
         std::ostringstream query;
         query << "DELETE FROM tasks WHERE id=" << id << ";";
-        if (executeSQL(query.str().c_str()) == SQLITE_OK)
+        int previousProject = boards ? BoardCache::projectOf(db, id) : 0;
+        if (executeSQL(db, query.str().c_str()) == SQLITE_OK) {
+            taskChanged(db, id, previousProject);
             return crow::response(204);
-        return crow::response(500); });
+        }
+        return crow::response(500); }); });
+
+    // Move a card within its column or to another column. The body names the target column
+    // ("status", "project_id", both default to the current one) and the cards it is dropped
+    // between ("after_id", "before_id", either or both, neither for the bottom). Only the
+    // moved row is written.
+    CROW_ROUTE(app, "/tasks/<int>/move").methods(crow::HTTPMethod::Put)([](const crow::request &req, crow::response &res, int id)
+                                                                        {
+        IdempotencyStore::Claim key;
+        if (claimIdempotencyKey(req, res, key))
+            return;
+        respondOnce(key, res, *shards->of(id).writer, [reqBody = req.body, id](sqlite3 *db) {
+        auto body = crow::json::load(reqBody);
+        if (!body)
+            return crow::response(400, "Invalid JSON");
+        if (body.has("project_id") && &shards->of(body["project_id"].i()) != &shards->of(id))
+            return crow::response(409, "Can't move a task to a project on another shard");
+
+        int projectId = 0;
+        std::string status;
+        if (!taskColumn(db, id, projectId, status))
+            return crow::response(404, "Task not found");
+        if (body.has("project_id")) projectId = body["project_id"].i();
+        if (body.has("status")) status = body["status"].s();
+        int afterId = body.has("after_id") ? (int)body["after_id"].i() : 0;
+        int beforeId = body.has("before_id") ? (int)body["before_id"].i() : 0;
+
+        bool valid;
+        std::string rank = rankForPlacement(db, id, projectId, status, afterId, beforeId, valid);
+        if (!valid)
+            return crow::response(409, "after_id and before_id must be adjacent cards of the target column");
+        if (rank.empty()) {
+            // No room between the neighbours, respace the column once and try again
+            rebalanceColumn(db, projectId, status);
+            rank = rankForPlacement(db, id, projectId, status, afterId, beforeId, valid);
+            if (rank.empty())
+                return crow::response(500, "Move failed");
+        }
+
+        int previousProject = boards ? BoardCache::projectOf(db, id) : 0;
+        sqlite3_stmt *stmt;
+        const char *sql = "UPDATE tasks SET project_id = ?, status = ?, rank = ? WHERE id = ?;";
+        if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK)
+            return crow::response(500, "Move failed");
+        sqlite3_bind_int(stmt, 1, projectId);
+        sqlite3_bind_text(stmt, 2, status.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(stmt, 3, rank.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_int(stmt, 4, id);
+        int rc = sqlite3_step(stmt);
+        sqlite3_finalize(stmt);
+        if (rc != SQLITE_DONE)
+            return crow::response(500, "Move failed");
+        taskChanged(db, id, previousProject);
+
+        crow::json::wvalue moved;
+        moved["id"] = id;
+        moved["project_id"] = projectId;
+        moved["status"] = status;
+        moved["rank"] = rank;
+        return crow::response(200, moved); }); });
+
+    // ---------------------- COMMENTS ROUTES ----------------------
+
+    // Get a page of a task's comments, oldest first. Pages are keyed on the last comment ID
+    // seen (?after=<id>&limit=<n>) so every page is a range scan of idx_comments_task.
+    CROW_ROUTE(app, "/tasks/<int>/comments").methods(crow::HTTPMethod::Get)([](const crow::request &req, crow::response &res, int task_id)
+                                                                           {
+        std::string after = urlParam(req, "after");
+        std::string limitParam = urlParam(req, "limit");
+        long long afterId = after.empty() ? 0 : std::atoll(after.c_str());
+        int limit = limitParam.empty() ? 50 : std::atoi(limitParam.c_str());
+        limit = std::max(1, std::min(limit, 200));
+
+        bool msgpack = wantsMsgPack(req);
+        // An archived task has its comments in comments_archive, a task is never in both tables
+        std::string table = "comments";
+        if (includeArchived(req))
+            table = std::string("(SELECT ") + COMMENT_COLUMNS + " FROM comments UNION ALL SELECT " + COMMENT_COLUMNS + " FROM comments_archive)";
+
+        shards->of(task_id).readers->respond(res, [task_id, afterId, limit, msgpack, table](sqlite3 *db) {
+        sqlite3_stmt* stmt;
+        std::string sql = std::string("SELECT ") + COMMENT_COLUMNS + " FROM " + table +
+                          " WHERE task_id = ? AND id > ? ORDER BY id LIMIT ?;";
+        if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK)
+            return crow::response(500, "Failed to query comments");
+
+        sqlite3_bind_int(stmt, 1, task_id);
+        sqlite3_bind_int64(stmt, 2, afterId);
+        sqlite3_bind_int(stmt, 3, limit + 1); // one extra row tells whether there is a next page
+
+        if (msgpack) {
+            MsgPackWriter out;
+            out.mapHeader(2);
+            out.string("comments");
+            size_t array = out.beginArray();
+            int count = 0, lastId = 0;
+            bool hasMore = false;
+            while (sqlite3_step(stmt) == SQLITE_ROW) {
+                if (count == limit) { hasMore = true; break; }
+                lastId = sqlite3_column_int(stmt, 0);
+                out.row(stmt, COMMENT_FIELDS, std::size(COMMENT_FIELDS));
+                count++;
+            }
+            sqlite3_finalize(stmt);
+            out.endArray(array, count);
+            out.string("next_cursor");
+            if (hasMore)
+                out.integer(lastId);
+            else
+                out.nil();
+            return msgpackResponse(200, out);
+        }
+
+        crow::json::wvalue::list comments;
+        int lastId = 0;
+        bool hasMore = false;
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            if ((int)comments.size() == limit) { hasMore = true; break; }
+            lastId = sqlite3_column_int(stmt, 0);
+            comments.push_back(commentFromRow(stmt));
+        }
+        sqlite3_finalize(stmt);
+
+        crow::json::wvalue page;
+        page["comments"] = std::move(comments);
+        if (hasMore)
+            page["next_cursor"] = lastId;
+        else
+            page["next_cursor"] = nullptr;
+        return crow::response(page); }); });
+
+    // Add a comment to a task
+    CROW_ROUTE(app, "/tasks/<int>/comments").methods(crow::HTTPMethod::Post)([](const crow::request &req, crow::response &res, int task_id)
+                                                                            {
+        IdempotencyStore::Claim key;
+        if (claimIdempotencyKey(req, res, key))
+            return;
+        respondOnce(key, res, *shards->of(task_id).writer, [reqBody = req.body, task_id, msgpack = wantsMsgPack(req)](sqlite3 *db) {
+        auto body = crow::json::load(reqBody);
+        if (!body || !body.has("body") || !body.has("user_id"))
+            return crow::response(400, "Invalid JSON");
+
+        sqlite3_stmt* stmt;
+        if (sqlite3_prepare_v2(db, "INSERT INTO comments (body, date, status, user_id, task_id) VALUES (?, datetime('now'), 'active', ?, ?);", -1, &stmt, nullptr) != SQLITE_OK)
+            return crow::response(500, "Failed to insert comment");
+
+        std::string text = body["body"].s();
+        sqlite3_bind_text(stmt, 1, text.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_int64(stmt, 2, body["user_id"].i());
+        sqlite3_bind_int(stmt, 3, task_id);
+        int rc = sqlite3_step(stmt);
+        sqlite3_finalize(stmt);
+
+        if (rc == SQLITE_CONSTRAINT)
+            return crow::response(404, "Task or user not found");
+        if (rc != SQLITE_DONE)
+            return crow::response(500, "Failed to insert comment");
+        taskChanged(db, task_id);
+
+        crow::response created = fetchComment(db, (int)sqlite3_last_insert_rowid(db), msgpack);
+        created.code = 201;
+        return created; }); });
+
+    // Edit the body of a comment
+    CROW_ROUTE(app, "/comments/<int>").methods(crow::HTTPMethod::Put)([](const crow::request &req, crow::response &res, int id)
+                                                                     {
+        IdempotencyStore::Claim key;
+        if (claimIdempotencyKey(req, res, key))
+            return;
+        respondOnce(key, res, *shards->of(id).writer, [reqBody = req.body, id, msgpack = wantsMsgPack(req)](sqlite3 *db) {
+        auto body = crow::json::load(reqBody);
+        if (!body || !body.has("body"))
+            return crow::response(400, "Invalid JSON");
+
+        sqlite3_stmt* stmt;
+        if (sqlite3_prepare_v2(db, "UPDATE comments SET body = ? WHERE id = ? AND status = 'active';", -1, &stmt, nullptr) != SQLITE_OK)
+            return crow::response(500, "Update failed");
+
+        std::string text = body["body"].s();
+        sqlite3_bind_text(stmt, 1, text.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_int(stmt, 2, id);
+        int rc = sqlite3_step(stmt);
+        sqlite3_finalize(stmt);
+
+        if (rc != SQLITE_DONE)
+            return crow::response(500, "Update failed");
+        if (sqlite3_changes(db) == 0)
+            return crow::response(404, "Comment not found");
+        if (boards)
+            taskChanged(db, commentTask(db, id));
+        return fetchComment(db, id, msgpack); }); });
+
+    // Soft delete a comment, the thread keeps a "[Deleted]" placeholder in its place
+    CROW_ROUTE(app, "/comments/<int>").methods(crow::HTTPMethod::Delete)([](const crow::request &, crow::response &res, int id)
+                                                                        {
+        shards->of(id).writer->respond(res, [id](sqlite3 *db) {
+        Comment deleted(id, "", "", "", 0);
+        deleted.deleteComment();
+
+        sqlite3_stmt* stmt;
+        if (sqlite3_prepare_v2(db, "UPDATE comments SET body = ?, status = ?, deleted_at = datetime('now') WHERE id = ? AND status = 'active';", -1, &stmt, nullptr) != SQLITE_OK)
+            return crow::response(500);
+
+        sqlite3_bind_text(stmt, 1, deleted.getCommentBody().c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(stmt, 2, deleted.getCommentStatus().c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_int(stmt, 3, id);
+        int rc = sqlite3_step(stmt);
+        sqlite3_finalize(stmt);
+
+        if (rc != SQLITE_DONE)
+            return crow::response(500);
+        if (sqlite3_changes(db) == 0)
+            return crow::response(404, "Comment not found");
+        if (boards)
+            taskChanged(db, commentTask(db, id));
+        return crow::response(204); }); });
 
     // ---------------------- USERS ROUTES ----------------------
 
     // Create a new user
-    CROW_ROUTE(app, "/users").methods(crow::HTTPMethod::Post)([](const crow::request &req)
+    CROW_ROUTE(app, "/users").methods(crow::HTTPMethod::Post)([](const crow::request &req, crow::response &res)
                                                               {
-        auto body = crow::json::load(req.body);
-        if (!body) return crow::response(400, crow::json::wvalue({{"message", "Invalid JSON format"}}).dump());
+        // A repeated sign up gets its first answer back, not the 409 below
+        IdempotencyStore::Claim key;
+        if (claimIdempotencyKey(req, res, key))
+            return;
+
+        // Taken emails are refused from the directory, without queuing a write
+        UserDirectory::User existing;
+        auto peek = crow::json::load(req.body);
+        if (peek && peek.t() == crow::json::type::Object && peek.has("email") &&
+            peek["email"].t() == crow::json::type::String &&
+            directory.findEmail(std::string(peek["email"].s()), existing)) {
+            answerOnce(key, res, crow::response(409, crow::json::wvalue({{"message", "User account already exists"}}).dump()));
+            return;
+        }
 
-        sqlite3_stmt* stmt;
-        if (sqlite3_prepare_v2(db, "Select id FROM users where email = ?", -1, &stmt, nullptr) == SQLITE_OK) {
-            std::string email = body["email"].s(); // Convert to std::string first
-            sqlite3_bind_text(stmt, 1, email.c_str(), -1, SQLITE_STATIC);
+        respondOnce(key, res, *writePool, [reqBody = req.body](sqlite3 *db) {
+        auto body = crow::json::load(reqBody);
+        if (!body) return crow::response(400, crow::json::wvalue({{"message", "Invalid JSON format"}}).dump());
 
-            if (sqlite3_step(stmt) == SQLITE_ROW) {
-                sqlite3_finalize(stmt);
-                crow::json::wvalue response ({{"message", "User account already exists"}});
-                return crow::response(409, response.dump());
-            }
-            sqlite3_finalize(stmt);
+        // Checked again here, the write pool creates users one at a time
+        UserDirectory::User existing;
+        if (directory.findEmail(std::string(body["email"].s()), existing)) {
+            crow::json::wvalue response ({{"message", "User account already exists"}});
+            return crow::response(409, response.dump());
         }
 
         std::ostringstream query;
         query << "INSERT INTO users (name, email, password) VALUES ('"
               << body["name"].s() << "', '" << body["email"].s() << "', '" << body["password"].s() << "');";
-        if (executeSQL(query.str().c_str()) == SQLITE_OK)
+        if (executeSQL(db, query.str().c_str()) == SQLITE_OK) {
+            directory.put(static_cast<int>(sqlite3_last_insert_rowid(db)), std::string(body["name"].s()),
+                          std::string(body["email"].s()));
+            // The other shards get the user with the same ID, queued before any membership of theirs
+            shards->replicate([id = sqlite3_last_insert_rowid(db), name = std::string(body["name"].s()),
+                               email = std::string(body["email"].s()), password = std::string(body["password"].s())](sqlite3 *shardDb) {
+                sqlite3_stmt *copy;
+                if (sqlite3_prepare_v2(shardDb, "INSERT OR IGNORE INTO users (id, name, email, password) VALUES (?, ?, ?, ?);",
+                                       -1, &copy, nullptr) != SQLITE_OK)
+                    return;
+                sqlite3_bind_int64(copy, 1, id);
+                sqlite3_bind_text(copy, 2, name.c_str(), -1, SQLITE_STATIC);
+                sqlite3_bind_text(copy, 3, email.c_str(), -1, SQLITE_STATIC);
+                sqlite3_bind_text(copy, 4, password.c_str(), -1, SQLITE_STATIC);
+                sqlite3_step(copy);
+                sqlite3_finalize(copy); });
             return crow::response(201, crow::json::wvalue({{"message", "User created successfully"}}));
-        return crow::response(500); });
+        }
+        return crow::response(500); }); });
 
     // Get all users
-    CROW_ROUTE(app, "/users").methods(crow::HTTPMethod::Get)([]
+    CROW_ROUTE(app, "/users").methods(crow::HTTPMethod::Get)([](const crow::request &, crow::response &res)
                                                              {
+        readPool->respond(res, [](sqlite3 *db) {
         sqlite3_stmt* stmt;
         crow::json::wvalue::list users;
         if (sqlite3_prepare_v2(db, "SELECT * FROM users", -1, &stmt, nullptr) == SQLITE_OK) {
@@ -284,68 +1429,77 @@ int main()
             sqlite3_finalize(stmt);
             return crow::response(crow::json::wvalue(users));
         }
-        return crow::response(500); });
+        return crow::response(500); }); });
 
-    // Get a user by email
+    // Get a user by email, from the user directory
     CROW_ROUTE(app, "/users/email/<string>").methods(crow::HTTPMethod::Get)([](const std::string &email)
                                                                             {
-        sqlite3_stmt* stmt;
-        if (sqlite3_prepare_v2(db, "SELECT * FROM users WHERE email = ?", -1, &stmt, nullptr) == SQLITE_OK) {
-            sqlite3_bind_text(stmt, 1, email.c_str(), -1, SQLITE_STATIC);
+        UserDirectory::User user;
+        if (!directory.findEmail(email, user))
+            return crow::response(404, "User not found");
+        crow::json::wvalue u;
+        u["id"] = user.id;
+        u["name"] = user.name;
+        u["email"] = user.email;
+        return crow::response(u); });
+
+    // Users whose name or email starts with ?prefix=, ignoring case, for autocomplete
+    // (?limit=<n>, 10 by default, at most 50). Answered from the user directory.
+    CROW_ROUTE(app, "/users/search").methods(crow::HTTPMethod::Get)([](const crow::request &req)
+                                                                    {
+        std::string limitParam = urlParam(req, "limit");
+        int limit = limitParam.empty() ? 10 : std::atoi(limitParam.c_str());
+        limit = std::max(1, std::min(limit, 50));
 
-            if (sqlite3_step(stmt) == SQLITE_ROW) {
-                crow::json::wvalue u;
-                u["id"] = sqlite3_column_int(stmt, 0);
-                u["name"] = (const char*)sqlite3_column_text(stmt, 1);
-                u["email"] = (const char*)sqlite3_column_text(stmt, 2);
-                
-                sqlite3_finalize(stmt);
-                return crow::response(u);
-            } else {
-                sqlite3_finalize(stmt);
-                return crow::response(404, "User not found");
-            }
+        crow::json::wvalue::list users;
+        for (const UserDirectory::User &user : directory.search(urlParam(req, "prefix"), limit)) {
+            crow::json::wvalue u;
+            u["id"] = user.id;
+            u["name"] = user.name;
+            u["email"] = user.email;
+            users.push_back(std::move(u));
         }
-        return crow::response(500, "Database error"); });
+        return crow::response(crow::json::wvalue(users)); });
 
     // Delete a user
-    CROW_ROUTE(app, "/users/<int>").methods(crow::HTTPMethod::Delete)([](int id)
+    CROW_ROUTE(app, "/users/<int>").methods(crow::HTTPMethod::Delete)([](const crow::request &, crow::response &res, int id)
                                                                       {
-        std::ostringstream query;
-        query << "DELETE FROM users WHERE id=" << id << ";";
-        if (executeSQL(query.str().c_str()) == SQLITE_OK)
-            return crow::response(204);
-        return crow::response(500); });
+        startDelete(res, DeleteJob::Target::User, id, allShards()); });
 
     // ---------------------- LOGIN ROUTE ----------------------
-    CROW_ROUTE(app, "/auth/login").methods(crow::HTTPMethod::Post)([](const crow::request &req)
+    CROW_ROUTE(app, "/auth/login").methods(crow::HTTPMethod::Post)([](const crow::request &req, crow::response &res)
                                                                    {
         auto json = crow::json::load(req.body);
 
         if (!json || !json.has("login") || !json.has("password")) {
-            return crow::response(400, "Invalid request format");
+            res = crow::response(400, "Invalid request format");
+            return res.end();
         }
 
         std::string login = json["login"].s();
         std::string password = json["password"].s();
 
+        // The directory finds the user by email or name; unknown logins never reach a worker
+        UserDirectory::User user;
+        if (!directory.findLogin(login, user)) {
+            res = crow::response(401, "User not found");
+            return res.end();
+        }
+
+        readPool->respond(res, [user, password](sqlite3 *db) {
         sqlite3_stmt* stmt;
 
-        if (sqlite3_prepare_v2(db, "SELECT id, name, email, password FROM users WHERE email = ? OR name = ?", -1, &stmt, nullptr) == SQLITE_OK) {
-            sqlite3_bind_text(stmt, 1, login.c_str(), -1, SQLITE_STATIC);
-            sqlite3_bind_text(stmt, 2, login.c_str(), -1, SQLITE_STATIC);
+        if (sqlite3_prepare_v2(db, "SELECT password FROM users WHERE id = ?", -1, &stmt, nullptr) == SQLITE_OK) {
+            sqlite3_bind_int(stmt, 1, user.id);
 
             if (sqlite3_step(stmt) == SQLITE_ROW) {
-                int id = sqlite3_column_int(stmt, 0);
-                const char* name = (const char*)sqlite3_column_text(stmt, 1);
-                const char* email = (const char*)sqlite3_column_text(stmt, 2);
-                const char* storedPassword = (const char*)sqlite3_column_text(stmt, 3);
+                const char* storedPassword = (const char*)sqlite3_column_text(stmt, 0);
 
                 if (password == std::string(storedPassword)) {
                     crow::json::wvalue result;
-                    result["id"] = id;
-                    result["name"] = name;
-                    result["email"] = email;
+                    result["id"] = user.id;
+                    result["name"] = user.name;
+                    result["email"] = user.email;
 
                     sqlite3_finalize(stmt);
                     return crow::response(result);
@@ -357,16 +1511,21 @@ int main()
                 sqlite3_finalize(stmt);
                 return crow::response(401, "User not found");
             }
-        } 
-    
-        return crow::response(500, "Database error"); });
+        }
+
+        return crow::response(500, "Database error"); }); });
 
     // ---------------------- PROJECTS ROUTES ----------------------
 
     // Create a new project
-    CROW_ROUTE(app, "/projects").methods(crow::HTTPMethod::Post)([](const crow::request &req)
+    CROW_ROUTE(app, "/projects").methods(crow::HTTPMethod::Post)([](const crow::request &req, crow::response &res)
 {
-    auto body = crow::json::load(req.body);
+    IdempotencyStore::Claim key;
+    if (claimIdempotencyKey(req, res, key))
+        return;
+    // New projects go to the shards in turn
+    respondOnce(key, res, *shards->place().writer, [reqBody = req.body](sqlite3 *db) {
+    auto body = crow::json::load(reqBody);
     if (!body) return crow::response(400, "Invalid JSON");
 
     std::ostringstream query;
@@ -374,7 +1533,7 @@ int main()
           << body["deadline"].s() << "', '" << body["date"].s() << "', "
           << (body["completion_status"].b() ? 1 : 0) << ");";
 
-    if (executeSQL(query.str().c_str()) == SQLITE_OK)
+    if (executeSQL(db, query.str().c_str()) == SQLITE_OK)
     {
         int last_id = sqlite3_last_insert_rowid(db);
 
@@ -400,11 +1559,13 @@ int main()
     }
 
     return crow::response(500, "Failed to insert project");
+    });
 });
 
     // Get all projects
-    CROW_ROUTE(app, "/projects").methods(crow::HTTPMethod::Get)([]
+    CROW_ROUTE(app, "/projects").methods(crow::HTTPMethod::Get)([](const crow::request &, crow::response &res)
                                                                 {
+        shards->gather(res, ShardSet::Pool::Read, [](sqlite3 *db) {
         sqlite3_stmt* stmt;
         crow::json::wvalue::list projects;
         if (sqlite3_prepare_v2(db, "SELECT * FROM projects", -1, &stmt, nullptr) == SQLITE_OK) {
@@ -419,17 +1580,18 @@ int main()
             sqlite3_finalize(stmt);
             return crow::response(crow::json::wvalue(projects));
         }
-        return crow::response(500); });
+        return crow::response(500); }); });
 
     // Update a project
     CROW_ROUTE(app, "/projects/<int>").methods(crow::HTTPMethod::Put)([](const crow::request &req, crow::response &res, int id)
                                                                       {
-        auto body = crow::json::load(req.body);
-        if (!body) {
-            res.code = 400;
-            res.write("Invalid JSON");
-            return res.end();
-        }
+        IdempotencyStore::Claim key;
+        if (claimIdempotencyKey(req, res, key))
+            return;
+        respondOnce(key, res, *shards->of(id).writer, [reqBody = req.body, id](sqlite3 *db) {
+        auto body = crow::json::load(reqBody);
+        if (!body)
+            return crow::response(400, "Invalid JSON");
 
         std::ostringstream query;
         if (body.has("deadline")) query << "deadline='" << body["deadline"].s() << "', ";
@@ -440,32 +1602,61 @@ int main()
         q = q.substr(0, q.size() - 2);
         q += " WHERE id=" + std::to_string(id) + ";";
 
-        if (executeSQL(q.c_str()) == SQLITE_OK) {
-            res.code = 200;
-            res.write("Project updated successfully");
-        } else {
-            res.code = 500;
-            res.write("Update failed");
+        if (executeSQL(db, q.c_str()) == SQLITE_OK) {
+            if (boards)
+                boards->forget(id);
+            return crow::response(200, "Project updated successfully");
         }
-        res.end(); });
+        return crow::response(500, "Update failed"); }); });
 
     // Delete a project
-    CROW_ROUTE(app, "/projects/<int>").methods(crow::HTTPMethod::Delete)([](int id)
+    CROW_ROUTE(app, "/projects/<int>").methods(crow::HTTPMethod::Delete)([](const crow::request &, crow::response &res, int id)
                                                                          {
-        std::ostringstream query;
-        query << "DELETE FROM projects WHERE id=" << id << ";";
-        if (executeSQL(query.str().c_str()) == SQLITE_OK)
-            return crow::response(204);
-        return crow::response(500); });
+        startDelete(res, DeleteJob::Target::Project, id, {shards->of(id).index}); });
+
+
+    // Project with its members, tasks and comments as NDJSON, spilled to the spool and sent from disk when large
+    CROW_ROUTE(app, "/projects/<int>/export").methods("GET"_method)([](const crow::request &, crow::response &res, int id) {
+        shards->of(id).readers->respond(res, [id](sqlite3 *db) {
+            SpooledList out(SpooledList::Format::Lines, *spool, LIST_SPILL_BYTES);
+            int rc = exportProject(db, id, out);
+            if (rc == SQLITE_NOTFOUND)
+                return crow::response(404, "Project not found");
+            if (rc != SQLITE_OK && rc != SQLITE_IOERR)
+                return crow::response(500, "Export failed");
+
+            // 503 if the spool filled up part way, the partial file is deleted with out
+            crow::response exported = out.finish();
+            if (exported.code == 200)
+                exported.set_header("Content-Disposition", "attachment; filename=\"project-" + std::to_string(id) + ".ndjson\"");
+            return exported;
+        }, EXPORT_TIMEOUT);
+    });
 
+    // Creates a project from an export, in batches of IMPORT_BATCH_LINES lines with new IDs
+    CROW_ROUTE(app, "/projects/import").methods("POST"_method)([](const crow::request &req, crow::response &res) {
+        if (!importBatch(std::make_shared<ProjectImport>(req.body), res, *shards->place().writer))
+        {
+            res = crow::response(503, "Server busy, try again later");
+            res.add_header("Retry-After", "1");
+            res.end();
+        }
+    });
 
-    // get projects a user is working on
-    CROW_ROUTE(app, "/users/<int>/projects").methods("GET"_method)([](int user_id) {
+    // get projects a user is working on, from the shards that hold them. The project IDs come
+    // from the membership index, so each shard only does primary key lookups.
+    CROW_ROUTE(app, "/users/<int>/projects").methods("GET"_method)([](const crow::request &, crow::response &res, int user_id) {
+    std::vector<int> projectIds = memberships.projectsOf(user_id);
+    if (projectIds.empty()) {
+        res = crow::response(crow::json::wvalue(crow::json::wvalue::list()));
+        res.end();
+        return;
+    }
+    shards->gather(res, ShardSet::Pool::Read, shardsOf(projectIds), [ids = idList(projectIds)](sqlite3 *db) {
     sqlite3_stmt* stmt;
     std::ostringstream query;
-    query << "SELECT projects.id, deadline, date, completion_status FROM projects "
-          << "JOIN user_projects ON projects.id = user_projects.project_id "
-          << "WHERE user_projects.user_id = " << user_id << ";";
+    query << "SELECT id, deadline, date, completion_status FROM projects "
+          << "WHERE id IN (" << ids << ");";
 
     crow::json::wvalue::list projectList;
     if (sqlite3_prepare_v2(db, query.str().c_str(), -1, &stmt, nullptr) == SQLITE_OK) {
@@ -481,42 +1672,141 @@ int main()
         return crow::response(crow::json::wvalue(projectList));
     }
     return crow::response(500, "Database error");
+    });
 });
 
-    // Get all tasks for a user across their projects
-    CROW_ROUTE(app, "/users/<int>/tasks").methods("GET"_method)([](int user_id) {
+    // Get all tasks for a user across their projects, or only the overdue ones with ?overdue=1.
+    // The user's projects come from the membership index, and each is read through the
+    // project_id indexes on the shards that hold them.
+    CROW_ROUTE(app, "/users/<int>/tasks").methods("GET"_method)([](const crow::request &req, crow::response &res, int user_id) {
+        bool overdue = urlParam(req, "overdue") == "1";
+        bool archived = includeArchived(req) && !overdue;
+        bool msgpack = wantsMsgPack(req);
+        std::vector<int> projectIds = memberships.projectsOf(user_id);
+        if (projectIds.empty()) {
+            if (msgpack) {
+                MsgPackWriter out;
+                out.arrayHeader(0);
+                res = msgpackResponse(200, out);
+            }
+            else
+                res = crow::response(crow::json::wvalue(crow::json::wvalue::list()));
+            res.end();
+            return;
+        }
+        shards->gather(res, ShardSet::Pool::Read, shardsOf(projectIds), [ids = idList(projectIds), msgpack, archived, overdue](sqlite3 *db) {
         std::ostringstream query;
         query << R"(
-        SELECT tasks.id, tasks.title, tasks.description, tasks.due_date, tasks.priority, tasks.status, tasks.project_id
+        SELECT )" << TASK_COLUMNS << R"(
         FROM tasks
-        JOIN user_projects ON tasks.project_id = user_projects.project_id
-        WHERE user_projects.user_id = )" << user_id << ";";
+        WHERE project_id IN ()" << ids << ")";
+        if (overdue)
+            query << " AND overdue = 1";
+        if (archived)
+            query << R"(
+        UNION ALL
+        SELECT )" << TASK_COLUMNS << R"(
+        FROM tasks_archive AS tasks
+        WHERE project_id IN ()" << ids << ")";
+        query << ";";
 
         sqlite3_stmt* stmt;
+        if (sqlite3_prepare_v2(db, query.str().c_str(), -1, &stmt, nullptr) == SQLITE_OK)
+            return spoolRows(stmt, msgpack, taskFromRow, TASK_FIELDS, std::size(TASK_FIELDS));
+
+        return crow::response(500, "Failed to fetch tasks for user");
+        }, concatenateSpooled);
+    });
+
+    // The k most urgent open tasks of a user across their projects: earliest due date first,
+    // then highest priority. Tasks without a due date are left out.
+    CROW_ROUTE(app, "/users/<int>/tasks/urgent").methods("GET"_method)([](const crow::request &req, crow::response &res, int user_id) {
+        std::string kParam = urlParam(req, "k");
+        int k = kParam.empty() ? 10 : std::atoi(kParam.c_str());
+        k = std::max(1, std::min(k, 100));
+
+        std::vector<int> ids = urgency.mostUrgentForUser(user_id, k);
         crow::json::wvalue::list taskList;
+        if (ids.empty()) {
+            res = crow::response(crow::json::wvalue(taskList));
+            res.end();
+            return;
+        }
 
-        if (sqlite3_prepare_v2(db, query.str().c_str(), -1, &stmt, nullptr) == SQLITE_OK) {
-            while (sqlite3_step(stmt) == SQLITE_ROW) {
-                crow::json::wvalue task;
-                task["id"] = sqlite3_column_int(stmt, 0);
-                task["title"] = (const char*)sqlite3_column_text(stmt, 1);
-                task["description"] = (const char*)sqlite3_column_text(stmt, 2);
-                task["due_date"] = (const char*)sqlite3_column_text(stmt, 3);
-                task["priority"] = sqlite3_column_int(stmt, 4);
-                task["status"] = (const char*)sqlite3_column_text(stmt, 5);
-                task["project_id"] = sqlite3_column_int(stmt, 6);
-                taskList.push_back(task);
-            }
+        // Task IDs map to their shard, so only the shards holding the tasks are asked
+        std::string sql = std::string("SELECT ") + TASK_COLUMNS + " FROM tasks WHERE id IN (" + idList(ids) + ");";
+        using Rows = std::unordered_map<int64_t, crow::json::wvalue>;
+        auto read = [sql](sqlite3 *db, Rows &rows) {
+            sqlite3_stmt* stmt;
+            if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK)
+                return false;
+            while (sqlite3_step(stmt) == SQLITE_ROW)
+                rows.emplace(sqlite3_column_int64(stmt, 0), taskFromRow(stmt));
             sqlite3_finalize(stmt);
+            return true;
+        };
+        // The rows in urgency order, serialized once
+        auto answer = [ids](Rows &rows) {
+            crow::json::wvalue::list taskList;
+            for (int id : ids) {
+                auto row = rows.find(id);
+                if (row != rows.end())
+                    taskList.push_back(std::move(row->second));
+            }
             return crow::response(crow::json::wvalue(taskList));
+        };
+
+        std::vector<int> owners = shardsOf(ids);
+        if (owners.size() == 1) {
+            (*shards)[owners[0]].readers->respond(res, [read, answer](sqlite3 *db) {
+                Rows rows;
+                if (!read(db, rows))
+                    return crow::response(500, "Failed to fetch tasks for user");
+                return answer(rows);
+            });
+            return;
         }
 
-        return crow::response(500, "Failed to fetch tasks for user");
+        // Each shard adds its rows to one map, the merge answers once all have
+        struct Found {
+            std::mutex mutex;
+            Rows rows;
+        };
+        auto found = std::make_shared<Found>();
+        shards->gather(res, ShardSet::Pool::Read, owners, [read, found](sqlite3 *db) {
+            Rows rows;
+            if (!read(db, rows))
+                return crow::response(500, "Failed to fetch tasks for user");
+            std::lock_guard<std::mutex> lock(found->mutex);
+            for (auto &row : rows)
+                found->rows.emplace(row.first, std::move(row.second));
+            return crow::response(200);
+        }, [found, answer](std::vector<crow::response> &parts) {
+            for (crow::response &part : parts) {
+                if (part.code != 200)
+                    return std::move(part);
+            }
+            return answer(found->rows);
+        });
     });
 
     // get user_projects
-    CROW_ROUTE(app, "/user_projects").methods("POST"_method)([](const crow::request &req) {
-    auto body = crow::json::load(req.body);
+    CROW_ROUTE(app, "/user_projects").methods("POST"_method)([](const crow::request &req, crow::response &res) {
+    // A repeated assignment gets its first answer back, not the 409 below
+    IdempotencyStore::Claim key;
+    if (claimIdempotencyKey(req, res, key))
+        return;
+    // An existing membership is refused from the index, without a worker
+    auto peek = crow::json::load(req.body);
+    if (peek && peek.t() == crow::json::type::Object && peek.has("user_id") && peek.has("project_id") &&
+        peek["user_id"].t() == crow::json::type::Number && peek["project_id"].t() == crow::json::type::Number &&
+        memberships.isMember(peek["user_id"].i(), peek["project_id"].i())) {
+        answerOnce(key, res, crow::response(409, "User already assigned to project"));
+        return;
+    }
+    // The membership goes to the shard of its project
+    respondOnce(key, res, *shards->of(bodyProjectId(req)).writer, [reqBody = req.body](sqlite3 *db) {
+    auto body = crow::json::load(reqBody);
     if (!body || !body.has("user_id") || !body.has("project_id"))
         return crow::response(400, "Invalid JSON");
 
@@ -524,36 +1814,208 @@ int main()
     query << "INSERT INTO user_projects (user_id, project_id) VALUES ("
           << body["user_id"].i() << ", " << body["project_id"].i() << ");";
 
-    if (executeSQL(query.str().c_str()) == SQLITE_OK)
+    if (executeSQL(db, query.str().c_str()) == SQLITE_OK) {
+        memberships.add(body["user_id"].i(), body["project_id"].i());
         return crow::response(201, "User assigned to project");
+    }
 
     return crow::response(500, "Failed to assign user to project");
+    });
 });
 
-    // debug route to delete all projects
+    // debug route to delete all projects, in batches, poll /jobs/<id> for progress
     CROW_ROUTE(app, "/debug/delete_all_projects").methods("GET"_method)
-([] {
-    const char* sql = "DELETE FROM projects;";
-    if (executeSQL(sql) == SQLITE_OK) {
-        return crow::response(200, "All projects deleted (debug route)");
-    } else {
-        return crow::response(500, "Failed to delete projects");
-    }
+([](const crow::request &, crow::response &res) {
+    startDelete(res, DeleteJob::Target::AllProjects, 0, allShards());
 });
-    // debug route to delete all tasks
+    // debug route to delete all tasks, in batches, poll /jobs/<id> for progress
     CROW_ROUTE(app, "/debug/delete_all_tasks").methods("GET"_method)
-([] {
-    const char* sql = "DELETE FROM tasks;";
-    if (executeSQL(sql) == SQLITE_OK) {
-        return crow::response(200, "All projects deleted (debug route)");
-    } else {
-        return crow::response(500, "Failed to delete projects");
-    }
+([](const crow::request &, crow::response &res) {
+    startDelete(res, DeleteJob::Target::AllTasks, 0, allShards());
 });
 
+    // Progress of a bulk delete
+    CROW_ROUTE(app, "/jobs/<int>").methods("GET"_method)([](int id) {
+        std::shared_ptr<DeleteJob> job = deleteJobs.find(id);
+        if (!job)
+            return crow::response(404, "No such job");
+        return crow::response(job->status());
+    });
+
+    // ---------------------- REPORTS ROUTES ----------------------
+
+    // Org-wide task counts by status and priority, and overdue tasks, from the cached column snapshot
+    CROW_ROUTE(app, "/reports/tasks").methods("GET"_method)([](const crow::request &, crow::response &res) {
+        shards->gather(res, ShardSet::Pool::Read, [](sqlite3 *db) {
+            std::chrono::steady_clock::time_point built;
+            std::shared_ptr<const TaskTable> table = currentTaskTable(db, built);
+
+            time_t t = time(0);
+            char today[11];
+            strftime(today, sizeof(today), "%Y-%m-%d", gmtime(&t));
+
+            crow::json::wvalue report;
+            report["total"] = table->size();
+            report["by_status"]["backlog"] = table->countStatus(TaskTable::BACKLOG);
+            report["by_status"]["inProgress"] = table->countStatus(TaskTable::IN_PROGRESS);
+            report["by_status"]["review"] = table->countStatus(TaskTable::REVIEW);
+            report["by_status"]["completed"] = table->countStatus(TaskTable::COMPLETED);
+            report["by_status"]["other"] = table->countStatus(TaskTable::OTHER_STATUS);
+            for (uint8_t priority = 1; priority <= 3; priority++)
+                report["by_priority"][std::to_string(priority)] = table->countPriority(priority);
+            report["overdue"] = table->countOverdue(TaskTable::dayNumber(today));
+            report["as_of_seconds_ago"] = std::chrono::duration_cast<std::chrono::seconds>(
+                std::chrono::steady_clock::now() - built).count();
+            return crow::response(report);
+        }, sumReports);
+    });
+
+    // ---------------------- ADMIN ROUTES ----------------------
+
+    // Database size, free pages, WAL checkpoint lag and what maintenance has done so far,
+    // of shard ?shard=<n> (0 by default)
+    CROW_ROUTE(app, "/admin/maintenance").methods("GET"_method)([](const crow::request &req, crow::response &res) {
+        int shard = shardParam(req);
+        if (shard < 0) {
+            res = crow::response(404, "No such shard");
+            res.end();
+            return;
+        }
+        (*shards)[shard].readers->respond(res, [shard](sqlite3 *db) {
+            return crow::response(maintenance[shard]->report(db));
+        });
+    });
+
+    // Progress of the running backup, the last result and the backups on disk, of shard ?shard=<n>
+    CROW_ROUTE(app, "/admin/backups").methods("GET"_method)([](const crow::request &req) {
+        int shard = shardParam(req);
+        if (shard < 0)
+            return crow::response(404, "No such shard");
+        return crow::response(backups[shard]->status());
+    });
+
+    // Starts an online backup of every shard, poll GET /admin/backups for their progress
+    CROW_ROUTE(app, "/admin/backups").methods("POST"_method)([] {
+        crow::json::wvalue::list started;
+        for (size_t i = 0; i < backups.size(); i++) {
+            if (backups[i]->request())
+                started.push_back(static_cast<int>(i));
+        }
+        if (started.empty())
+            return crow::response(409, "A backup is already running");
+        crow::json::wvalue status = backups[0]->status();
+        status["shards_started"] = std::move(started);
+        return crow::response(202, status);
+    });
+
+    // A page of the reminder and overdue events of shard ?shard=<n>, oldest first, after the
+    // event ID ?after=<id>, with the scheduler counters. Notifiers keep the last ID they sent.
+    CROW_ROUTE(app, "/admin/outbox").methods("GET"_method)([](const crow::request &req, crow::response &res) {
+        int shard = shardParam(req);
+        if (shard < 0) {
+            res = crow::response(404, "No such shard");
+            res.end();
+            return;
+        }
+        std::string after = urlParam(req, "after");
+        std::string limitParam = urlParam(req, "limit");
+        long long afterId = after.empty() ? 0 : std::atoll(after.c_str());
+        int limit = limitParam.empty() ? 100 : std::atoi(limitParam.c_str());
+        limit = std::max(1, std::min(limit, 1000));
+
+        (*shards)[shard].readers->respond(res, [afterId, limit](sqlite3 *db) {
+            sqlite3_stmt *stmt;
+            const char *sql = "SELECT id, event, task_id, project_id, due_date, created_at FROM outbox "
+                              "WHERE id > ? ORDER BY id LIMIT ?;";
+            if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK)
+                return crow::response(500, "Failed to query outbox");
+            sqlite3_bind_int64(stmt, 1, afterId);
+            sqlite3_bind_int(stmt, 2, limit + 1); // one extra row tells whether there is a next page
+
+            crow::json::wvalue::list events;
+            long long lastId = 0;
+            bool hasMore = false;
+            while (sqlite3_step(stmt) == SQLITE_ROW) {
+                if ((int)events.size() == limit) { hasMore = true; break; }
+                crow::json::wvalue event;
+                lastId = sqlite3_column_int64(stmt, 0);
+                event["id"] = lastId;
+                event["event"] = std::string((const char *)sqlite3_column_text(stmt, 1));
+                event["task_id"] = sqlite3_column_int(stmt, 2);
+                if (sqlite3_column_type(stmt, 3) == SQLITE_NULL)
+                    event["project_id"] = nullptr;
+                else
+                    event["project_id"] = sqlite3_column_int(stmt, 3);
+                event["due_date"] = std::string((const char *)sqlite3_column_text(stmt, 4));
+                event["created_at"] = std::string((const char *)sqlite3_column_text(stmt, 5));
+                events.push_back(std::move(event));
+            }
+            sqlite3_finalize(stmt);
+
+            crow::json::wvalue page;
+            page["events"] = std::move(events);
+            if (hasMore)
+                page["next_cursor"] = lastId;
+            else
+                page["next_cursor"] = nullptr;
+            page["scheduler"] = deadlines->stats();
+            return crow::response(page);
+        });
+    });
+
+    // Resident boards, their memory use and hit rate
+    CROW_ROUTE(app, "/admin/boards").methods("GET"_method)([] {
+        if (!boards)
+            return crow::response(404, "Board cache is off, start with --board-cache-mb");
+        return crow::response(boards->stats());
+    });
+
+    // Admission control, rate limiter and database pool counters in the Prometheus text format
+    CROW_ROUTE(app, "/metrics").methods("GET"_method)([] {
+        std::ostringstream out;
+        out << admission->metrics();
+        out << rateLimiter->metrics();
+        out << idempotency->metrics();
+        std::vector<std::pair<std::string, DbExecutor *>> pools;
+        for (int i = 0; i < shards->count(); i++) {
+            std::string shard = "\",shard=\"" + std::to_string(i);
+            pools.emplace_back("read" + shard, (*shards)[i].readers.get());
+            pools.emplace_back("write" + shard, (*shards)[i].writer.get());
+        }
+        out << "# HELP taskmaster_db_queued Jobs waiting for a database worker.\n"
+            << "# TYPE taskmaster_db_queued gauge\n";
+        for (const auto &pool : pools)
+            out << "taskmaster_db_queued{pool=\"" << pool.first << "\"} " << pool.second->queued() << "\n";
+        out << "# HELP taskmaster_db_in_flight Jobs queued or running.\n"
+            << "# TYPE taskmaster_db_in_flight gauge\n";
+        for (const auto &pool : pools)
+            out << "taskmaster_db_in_flight{pool=\"" << pool.first << "\"} " << pool.second->inFlight() << "\n";
+        out << "# HELP taskmaster_db_rejected_total Jobs rejected on a full queue.\n"
+            << "# TYPE taskmaster_db_rejected_total counter\n";
+        for (const auto &pool : pools)
+            out << "taskmaster_db_rejected_total{pool=\"" << pool.first << "\"} " << pool.second->rejected() << "\n";
+        out << "# HELP taskmaster_db_timed_out_total Jobs interrupted at their deadline.\n"
+            << "# TYPE taskmaster_db_timed_out_total counter\n";
+        for (const auto &pool : pools)
+            out << "taskmaster_db_timed_out_total{pool=\"" << pool.first << "\"} " << pool.second->timedOut() << "\n";
+
+        crow::response res(200, out.str());
+        res.set_header("Content-Type", "text/plain; version=0.0.4");
+        return res;
+    });
+
     // ---------------------- SERVER SETUP ----------------------
     app.port(8080).multithreaded().run();
-    sqlite3_close(db);
+    deadlines.reset();
+    admission.reset();
+    rateLimiter.reset();
+    backups.clear();
+    maintenance.clear();
+    readPool = nullptr;
+    writePool = nullptr;
+    shards->close();
+    boards.reset();
+    idempotency.reset();
     return 0;
 
 
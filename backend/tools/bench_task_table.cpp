@@ -0,0 +1,168 @@
+/**
+ * @file bench_task_table.cpp
+ * @brief Benchmark of TaskTable's counting kernels against TodoList::filterByPriority().
+ *
+ * Fills one TodoList per project and a TaskTable with the same synthetic tasks, then
+ * times counting the tasks of one priority with filterByPriority() over every list and
+ * with TaskTable's scalar, SSE2 and AVX2 kernels, plus the status and overdue counts.
+ * Every variant must agree on the counts. The best time of all runs is reported.
+ *
+ * Usage:
+ *   bench_task_table [--tasks N] [--projects N] [--runs N] [--seed N]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "../TaskTable.h"
+#include "../TodoList.h"
+
+namespace {
+
+/**
+ * @brief Benchmark settings, filled from the command line.
+ */
+struct Options
+{
+    long long tasks = 1000000;     /**< Total number of tasks */
+    long long projects = 1000;     /**< Number of TodoLists the tasks are spread over */
+    int runs = 5;                  /**< Timed runs per variant */
+    unsigned long long seed = 42;  /**< Random seed */
+};
+
+/**
+ * @brief Parses the command line into an Options struct.
+ *
+ * @return bool false if an unknown flag was given.
+ */
+bool parseArgs(int argc, char *argv[], Options &opt)
+{
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string flag = argv[i];
+        const char *value = argv[i + 1];
+        if (flag == "--tasks") opt.tasks = std::atoll(value);
+        else if (flag == "--projects") opt.projects = std::atoll(value);
+        else if (flag == "--runs") opt.runs = std::atoi(value);
+        else if (flag == "--seed") opt.seed = std::strtoull(value, nullptr, 10);
+        else return false;
+    }
+    return argc % 2 == 1 && opt.tasks > 0 && opt.projects > 0 && opt.runs > 0;
+}
+
+/**
+ * @brief Runs a variant opt.runs times and prints its best time.
+ *
+ * @param name Label of the variant.
+ * @param runs Number of runs.
+ * @param work The variant, returns the count it computed.
+ * @return size_t The count of the last run.
+ */
+size_t measure(const char *name, int runs, const std::function<size_t()> &work)
+{
+    double best = 1e300;
+    size_t count = 0;
+    for (int run = 0; run < runs; run++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        count = work();
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+    }
+    std::printf("  %-34s %10.3f ms   count %zu\n", name, best, count);
+    return count;
+}
+
+/**
+ * @brief Name of an instruction set.
+ */
+const char *isaName(TaskTable::InstructionSet isa)
+{
+    switch (isa)
+    {
+    case TaskTable::InstructionSet::AVX2: return "AVX2";
+    case TaskTable::InstructionSet::SSE2: return "SSE2";
+    default: return "scalar";
+    }
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    Options opt;
+    if (!parseArgs(argc, argv, opt))
+    {
+        std::cerr << "Usage: bench_task_table [--tasks N] [--projects N] [--runs N] [--seed N]\n";
+        return 1;
+    }
+
+    const char *categories[] = {"Backlog", "Doing", "Review", "Done"};
+    std::mt19937_64 rng(opt.seed);
+    std::vector<TodoList> lists(opt.projects);
+    for (long long id = 1; id <= opt.tasks; id++)
+    {
+        char due[11];
+        std::snprintf(due, sizeof(due), "%04d-%02d-%02d", 2024 + (int)(rng() % 3), 1 + (int)(rng() % 12), 1 + (int)(rng() % 28));
+        Task task((int)id, "Task " + std::to_string(id), due, categories[rng() % 4], std::to_string(1 + rng() % 3));
+        lists[rng() % opt.projects].restoreTask(std::move(task));
+    }
+
+    TaskTable table;
+    for (long long project = 0; project < opt.projects; project++)
+        table.append(lists[project], (int)project + 1);
+
+    int32_t today = TaskTable::dayNumber("2025-06-15");
+    std::cout << opt.tasks << " tasks in " << opt.projects << " projects, best of " << opt.runs
+              << " runs, CPU supports " << isaName(TaskTable::bestInstructionSet()) << "\n\n";
+
+    std::cout << "Tasks with priority 1:\n";
+    size_t expected = measure("TodoList::filterByPriority", opt.runs, [&]
+                              {
+        size_t count = 0;
+        for (const TodoList &list : lists)
+            count += list.filterByPriority("1").size();
+        return count; });
+
+    bool agree = true;
+    for (auto isa : {TaskTable::InstructionSet::Scalar, TaskTable::InstructionSet::SSE2, TaskTable::InstructionSet::AVX2})
+    {
+        if (isa > TaskTable::bestInstructionSet())
+            continue;
+        table.setInstructionSet(isa);
+        std::string label = std::string("TaskTable::countPriority (") + isaName(isa) + ")";
+        agree &= measure(label.c_str(), opt.runs, [&]
+                         { return table.countPriority(1); }) == expected;
+    }
+
+    std::cout << "\nCompleted tasks:\n";
+    table.setInstructionSet(TaskTable::InstructionSet::Scalar);
+    size_t completed = measure("TaskTable::countStatus (scalar)", opt.runs, [&]
+                               { return table.countStatus(TaskTable::COMPLETED); });
+    table.setInstructionSet(TaskTable::bestInstructionSet());
+    std::string label = std::string("TaskTable::countStatus (") + isaName(table.instructionSet()) + ")";
+    agree &= measure(label.c_str(), opt.runs, [&]
+                     { return table.countStatus(TaskTable::COMPLETED); }) == completed;
+
+    std::cout << "\nOverdue tasks:\n";
+    table.setInstructionSet(TaskTable::InstructionSet::Scalar);
+    size_t overdue = measure("TaskTable::countOverdue (scalar)", opt.runs, [&]
+                             { return table.countOverdue(today); });
+    table.setInstructionSet(TaskTable::bestInstructionSet());
+    label = std::string("TaskTable::countOverdue (") + isaName(table.instructionSet()) + ")";
+    agree &= measure(label.c_str(), opt.runs, [&]
+                     { return table.countOverdue(today); }) == overdue;
+
+    if (!agree)
+    {
+        std::cerr << "\nCounts differ between variants" << std::endl;
+        return 1;
+    }
+    return 0;
+}
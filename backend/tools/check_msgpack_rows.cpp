@@ -0,0 +1,355 @@
+/**
+ * @file check_msgpack_rows.cpp
+ * @brief Checks that the MessagePack and JSON forms of task and comment rows agree.
+ *
+ * Fills an in-memory database with tasks and comments chosen to hit every encoding
+ * boundary: NULL columns, integers around 127, 255, 65535 and 2^31, negative integers,
+ * and strings of 31, 32, 255, 256 and 65536 bytes. Each row is encoded with
+ * MsgPackWriter::row() and the TASK_FIELDS or COMMENT_FIELDS the server uses, decoded
+ * again, and compared field by field with taskFromRow() or commentFromRow() on the same
+ * statement. The rows are also written as one array with beginArray() and endArray()
+ * and read back. Any difference is printed and the exit code is 1.
+ *
+ * Usage:
+ *   check_msgpack_rows
+ */
+
+#include <sqlite3.h>
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include "../MsgPack.h"
+#include "../Rows.h"
+#include "../Schema.h"
+
+namespace {
+
+/**
+ * @brief A decoded MessagePack value, limited to what the row encoder writes.
+ */
+struct Value
+{
+    enum class Type
+    {
+        Nil,
+        Boolean,
+        Integer,
+        String,
+        Map,
+        Array
+    };
+
+    Type type = Type::Nil;                               /**< Kind of value */
+    int64_t integer = 0;                                 /**< Integer, or 0/1 for a boolean */
+    std::string text;                                    /**< String */
+    std::vector<std::pair<std::string, Value>> map;      /**< Map entries in order */
+    std::vector<Value> array;                            /**< Array values */
+};
+
+/**
+ * @class Reader
+ * @brief Decodes MessagePack written by MsgPackWriter, throwing on anything else.
+ */
+class Reader
+{
+public:
+    explicit Reader(const std::string &data) : data(data) {}
+
+    /**
+     * @brief Decodes the next value.
+     */
+    Value next()
+    {
+        uint8_t type = byte();
+        Value value;
+        if (type <= 0x7f || type >= 0xe0)
+        {
+            value.type = Value::Type::Integer;
+            value.integer = static_cast<int8_t>(type);
+            if (type <= 0x7f)
+                value.integer = type;
+        }
+        else if ((type & 0xe0) == 0xa0)
+            readString(value, type & 0x1f);
+        else if ((type & 0xf0) == 0x80)
+            readMap(value, type & 0x0f);
+        else if ((type & 0xf0) == 0x90)
+            readArray(value, type & 0x0f);
+        else
+        {
+            switch (type)
+            {
+            case 0xc0: break;
+            case 0xc2:
+            case 0xc3:
+                value.type = Value::Type::Boolean;
+                value.integer = type == 0xc3;
+                break;
+            case 0xcc: readUnsigned(value, 1); break;
+            case 0xcd: readUnsigned(value, 2); break;
+            case 0xce: readUnsigned(value, 4); break;
+            case 0xcf: readUnsigned(value, 8); break;
+            case 0xd0: readSigned(value, 1); break;
+            case 0xd1: readSigned(value, 2); break;
+            case 0xd2: readSigned(value, 4); break;
+            case 0xd3: readSigned(value, 8); break;
+            case 0xd9: readString(value, big(1)); break;
+            case 0xda: readString(value, big(2)); break;
+            case 0xdb: readString(value, big(4)); break;
+            case 0xdc: readArray(value, big(2)); break;
+            case 0xdd: readArray(value, big(4)); break;
+            case 0xde: readMap(value, big(2)); break;
+            case 0xdf: readMap(value, big(4)); break;
+            default: throw std::runtime_error("unexpected type byte " + std::to_string(type));
+            }
+        }
+        return value;
+    }
+
+    /**
+     * @brief True once every byte was read.
+     */
+    bool done() const { return position == data.size(); }
+
+private:
+    uint8_t byte()
+    {
+        if (position >= data.size())
+            throw std::runtime_error("truncated document");
+        return static_cast<uint8_t>(data[position++]);
+    }
+
+    uint64_t big(int bytes)
+    {
+        uint64_t value = 0;
+        for (int i = 0; i < bytes; i++)
+            value = value << 8 | byte();
+        return value;
+    }
+
+    void readUnsigned(Value &value, int bytes)
+    {
+        value.type = Value::Type::Integer;
+        value.integer = static_cast<int64_t>(big(bytes));
+    }
+
+    void readSigned(Value &value, int bytes)
+    {
+        value.type = Value::Type::Integer;
+        uint64_t raw = big(bytes);
+        int shift = 64 - 8 * bytes;
+        value.integer = static_cast<int64_t>(raw << shift) >> shift;
+    }
+
+    void readString(Value &value, uint64_t length)
+    {
+        if (length > data.size() - position)
+            throw std::runtime_error("truncated string");
+        value.type = Value::Type::String;
+        value.text = data.substr(position, length);
+        position += length;
+    }
+
+    void readMap(Value &value, uint64_t n)
+    {
+        value.type = Value::Type::Map;
+        for (uint64_t i = 0; i < n; i++)
+        {
+            Value key = next();
+            if (key.type != Value::Type::String)
+                throw std::runtime_error("map key is not a string");
+            value.map.emplace_back(key.text, next());
+        }
+    }
+
+    void readArray(Value &value, uint64_t n)
+    {
+        value.type = Value::Type::Array;
+        for (uint64_t i = 0; i < n; i++)
+            value.array.push_back(next());
+    }
+
+    const std::string &data;    /**< The document */
+    size_t position = 0;        /**< Next byte to read */
+};
+
+/**
+ * @brief Compares a decoded row with the JSON of the same row.
+ *
+ * @param what Label of the row for messages.
+ * @param row The decoded MessagePack map.
+ * @param json The row as parsed from taskFromRow() or commentFromRow().
+ * @param fields The fields the row was encoded with.
+ * @param count Number of fields.
+ * @return int Number of differences.
+ */
+int compare(const std::string &what, const Value &row, const crow::json::rvalue &json,
+            const MsgPackWriter::Field *fields, size_t count)
+{
+    int differences = 0;
+    auto differ = [&](const std::string &key, const std::string &message)
+    {
+        std::cerr << what << " " << key << ": " << message << "\n";
+        differences++;
+    };
+
+    if (row.type != Value::Type::Map || row.map.size() != count)
+    {
+        differ("row", "is not a map of " + std::to_string(count) + " fields");
+        return differences;
+    }
+    if (json.size() != count)
+        differ("row", "JSON has " + std::to_string(json.size()) + " keys");
+
+    for (size_t i = 0; i < count; i++)
+    {
+        const std::string &key = row.map[i].first;
+        const Value &value = row.map[i].second;
+        if (key != fields[i].name)
+        {
+            differ(key, std::string("is not the expected key ") + fields[i].name);
+            continue;
+        }
+        if (!json.has(key))
+        {
+            differ(key, "is missing from the JSON");
+            continue;
+        }
+
+        const crow::json::rvalue &expected = json[key];
+        switch (value.type)
+        {
+        case Value::Type::Nil:
+            if (expected.t() != crow::json::type::Null)
+                differ(key, "is nil in MessagePack but not null in JSON");
+            break;
+        case Value::Type::Integer:
+            if (expected.t() != crow::json::type::Number || expected.i() != value.integer)
+                differ(key, "is " + std::to_string(value.integer) + " in MessagePack but differs in JSON");
+            break;
+        case Value::Type::String:
+            if (expected.t() != crow::json::type::String || std::string(expected.s()) != value.text)
+                differ(key, "is a " + std::to_string(value.text.size()) + "-byte string in MessagePack but differs in JSON");
+            break;
+        default:
+            differ(key, "has a type the row encoder does not write");
+            break;
+        }
+    }
+    return differences;
+}
+
+/**
+ * @brief Encodes every row of a query both ways and compares them.
+ *
+ * @param db The database.
+ * @param table Label of the rows.
+ * @param sql The query, selecting TASK_COLUMNS or COMMENT_COLUMNS.
+ * @param toJson taskFromRow or commentFromRow.
+ * @param fields TASK_FIELDS or COMMENT_FIELDS.
+ * @param count Number of fields.
+ * @return int Number of differences, or 1 if the query failed.
+ */
+int check(sqlite3 *db, const char *table, const std::string &sql, crow::json::wvalue (*toJson)(sqlite3_stmt *),
+          const MsgPackWriter::Field *fields, size_t count)
+{
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK)
+    {
+        std::cerr << table << ": " << sqlite3_errmsg(db) << "\n";
+        return 1;
+    }
+
+    int differences = 0;
+    uint32_t rows = 0;
+    MsgPackWriter list;
+    size_t header = list.beginArray();
+    while (sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        std::string what = std::string(table) + " " + std::to_string(sqlite3_column_int64(stmt, 0));
+        MsgPackWriter out;
+        out.row(stmt, fields, count);
+        list.raw(out.data());
+        rows++;
+
+        try
+        {
+            Reader reader(out.data());
+            Value row = reader.next();
+            if (!reader.done())
+                throw std::runtime_error("bytes left after the row");
+            differences += compare(what, row, crow::json::load(toJson(stmt).dump()), fields, count);
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << what << ": " << e.what() << "\n";
+            differences++;
+        }
+    }
+    sqlite3_finalize(stmt);
+    list.endArray(header, rows);
+
+    try
+    {
+        Reader reader(list.data());
+        Value all = reader.next();
+        if (all.type != Value::Type::Array || all.array.size() != rows || !reader.done())
+            throw std::runtime_error("does not hold the " + std::to_string(rows) + " rows");
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << table << " list: " << e.what() << "\n";
+        differences++;
+    }
+
+    std::cout << table << ": " << rows << " rows, " << differences << " differences\n";
+    return differences;
+}
+
+} // namespace
+
+int main()
+{
+    sqlite3 *db;
+    if (sqlite3_open(":memory:", &db) != SQLITE_OK || sqlite3_exec(db, SCHEMA_SQL, nullptr, nullptr, nullptr) != SQLITE_OK)
+    {
+        std::cerr << "Can't create the database: " << sqlite3_errmsg(db) << std::endl;
+        return 1;
+    }
+
+    // Lengths on both sides of each string header size
+    std::string s31(31, 'a'), s32(32, 'b'), s255(255, 'c'), s256(256, 'd'), s65536(65536, 'e');
+    std::string rows = R"(
+        INSERT INTO tasks (id, title, description, due_date, priority, status, project_id, comment_count, last_activity, rank) VALUES
+            (1, 't', NULL, NULL, NULL, NULL, NULL, 0, NULL, NULL),
+            (127, ')" + s31 + R"(', '', '2025-06-15', 127, 'pending', 127, 127, '2025-06-15 10:00:00', 'a0'),
+            (128, ')" + s32 + R"(', 'é, ü and ✓', '2025-06-16', 128, 'completed', 128, 128, NULL, 'zz'),
+            (255, ')" + s255 + R"(', ')" + s256 + R"(', '', 255, 'in progress', 255, 255, '', ''),
+            (256, 'x', ')" + s65536 + R"(', NULL, 256, '', 256, 256, NULL, NULL),
+            (65535, 'y', 'z', '2030-01-01', -1, 'pending', 65535, 65535, NULL, 'm'),
+            (65536, 'q', 'q', '2030-01-01', -32, 'pending', 65536, 65536, NULL, NULL),
+            (2147483647, 'max', NULL, NULL, -33, 'pending', 2147483647, 0, NULL, NULL),
+            (2147483646, 'min', NULL, NULL, -2147483647, 'pending', -129, 0, NULL, NULL);
+        INSERT INTO comments (id, body, date, status, user_id, task_id) VALUES
+            (1, '', NULL, NULL, NULL, NULL),
+            (127, ')" + s31 + R"(', '2025-06-15', 'active', 127, 127),
+            (128, ')" + s32 + R"(', '2025-06-15', 'deleted', 128, 128),
+            (255, ')" + s256 + R"(', '', 'active', 65535, 65536),
+            (65536, ')" + s65536 + R"(', '2025-06-15', 'active', 2147483647, 2147483647);
+    )";
+    if (sqlite3_exec(db, rows.c_str(), nullptr, nullptr, nullptr) != SQLITE_OK)
+    {
+        std::cerr << "Can't insert the rows: " << sqlite3_errmsg(db) << std::endl;
+        return 1;
+    }
+
+    int differences = check(db, "task", std::string("SELECT ") + TASK_COLUMNS + " FROM tasks ORDER BY id;",
+                            taskFromRow, TASK_FIELDS, std::size(TASK_FIELDS));
+    differences += check(db, "comment", std::string("SELECT ") + COMMENT_COLUMNS + " FROM comments ORDER BY id;",
+                         commentFromRow, COMMENT_FIELDS, std::size(COMMENT_FIELDS));
+    sqlite3_close(db);
+    return differences == 0 ? 0 : 1;
+}
@@ -0,0 +1,397 @@
+/**
+ * @file generate_dataset.cpp
+ * @brief Synthetic dataset generator for scale testing taskmaster.db.
+ *
+ * Builds a database with the exact schema used by the server (see Schema.h) and fills it
+ * with users, projects, user_projects memberships, tasks and comments. Project sizes follow
+ * a Zipf distribution so a few boards are huge and most are small, which is what production
+ * looks like. Dates are spread around a base day, --today or else the current UTC day,
+ * which is printed; the same seed and base day always produce the same database.
+ *
+ * Rows are inserted with prepared statements inside large transactions, with journaling and
+ * syncing turned off while generating, so tens of millions of rows take minutes. Indexes,
+ * triggers and the denormalized comment stats are built once after loading.
+ *
+ * Usage:
+ *   generate_dataset [--out taskmaster.db] [--users N] [--projects N] [--tasks N]
+ *                    [--members N] [--comments N] [--zipf S] [--seed N] [--batch N]
+ *                    [--today YYYY-MM-DD]
+ */
+
+#include <sqlite3.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "../CivilDate.h"
+#include "../Schema.h"
+
+namespace {
+
+/**
+ * @brief Generator settings, filled from the command line.
+ */
+struct Options
+{
+    std::string out = "taskmaster.db"; /**< Output database file */
+    long long users = 10000;           /**< Number of users */
+    long long projects = 2000;         /**< Number of projects */
+    long long tasks = 1000000;         /**< Total number of tasks over all projects */
+    double members = 5.0;              /**< Average members per project */
+    double comments = 0.5;             /**< Average comments per task */
+    double zipf = 1.1;                 /**< Zipf exponent of the project size distribution */
+    unsigned long long seed = 42;      /**< Random seed */
+    long long batch = 50000;           /**< Rows per transaction */
+    std::string today;                 /**< Base day of the dates, empty for the current UTC day */
+};
+
+sqlite3 *db;
+long long rowsInBatch = 0;
+long long batchSize = 50000;
+long long today = 0;                   // Base day, in days since 1970-01-01
+
+/**
+ * @brief Executes a raw SQL command and exits on failure.
+ *
+ * @param sql The raw SQL to execute.
+ */
+void exec(const char *sql)
+{
+    char *errMsg = nullptr;
+    if (sqlite3_exec(db, sql, nullptr, nullptr, &errMsg) != SQLITE_OK)
+    {
+        std::cerr << "SQL error: " << errMsg << std::endl;
+        sqlite3_free(errMsg);
+        std::exit(1);
+    }
+}
+
+/**
+ * @brief Prepares a statement and exits on failure.
+ *
+ * @param sql The SQL to prepare.
+ * @return sqlite3_stmt* The prepared statement.
+ */
+sqlite3_stmt *prepare(const char *sql)
+{
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK)
+    {
+        std::cerr << "Prepare failed: " << sqlite3_errmsg(db) << std::endl;
+        std::exit(1);
+    }
+    return stmt;
+}
+
+/**
+ * @brief Steps a bound insert statement, resets it, and commits every batchSize rows.
+ *
+ * @param stmt The insert statement with all parameters bound.
+ */
+void insertRow(sqlite3_stmt *stmt)
+{
+    int rc = sqlite3_step(stmt);
+    if (rc != SQLITE_DONE && rc != SQLITE_CONSTRAINT)
+    {
+        std::cerr << "Insert failed: " << sqlite3_errmsg(db) << std::endl;
+        std::exit(1);
+    }
+    sqlite3_reset(stmt);
+
+    if (++rowsInBatch >= batchSize)
+    {
+        exec("COMMIT; BEGIN;");
+        rowsInBatch = 0;
+    }
+}
+
+/**
+ * @brief Formats a day as YYYY-MM-DD.
+ *
+ * @param day Days since 1970-01-01.
+ * @return std::string The formatted date.
+ */
+std::string formatDay(long long day)
+{
+    time_t t = static_cast<time_t>(day) * 86400;
+    tm *date = gmtime(&t);
+    char buffer[11];
+    strftime(buffer, 11, "%Y-%m-%d", date);
+    return std::string(buffer);
+}
+
+/**
+ * @brief Parses a YYYY-MM-DD date.
+ *
+ * @param text The date.
+ * @param day Receives the days since 1970-01-01.
+ * @return bool false if the text is not a valid date.
+ */
+bool parseDay(const std::string &text, long long &day)
+{
+    int y, m, d;
+    if (std::sscanf(text.c_str(), "%4d-%2d-%2d", &y, &m, &d) != 3 || !isValidDate(y, m, d))
+        return false;
+    day = daysFromCivil(y, m, d);
+
+    // Rejects dates not written as YYYY-MM-DD, such as 2025-6-1
+    return formatDay(day) == text;
+}
+
+/**
+ * @brief Formats a day offset from the base day as YYYY-MM-DD.
+ *
+ * @param offsetDays Days relative to the base day (negative is in the past).
+ * @return std::string The formatted date.
+ */
+std::string dateFromToday(int offsetDays)
+{
+    return formatDay(today + offsetDays);
+}
+
+/**
+ * @brief Runs a backfill with the base day in place of SQLite's 'now'.
+ *
+ * @param sql The backfill, from Schema.h.
+ */
+void execOnBaseDay(const char *sql)
+{
+    std::string anchored = sql;
+    std::string day = "'" + formatDay(today) + "'";
+    for (size_t at = anchored.find("'now'"); at != std::string::npos; at = anchored.find("'now'", at + day.size()))
+        anchored.replace(at, 5, day);
+    exec(anchored.c_str());
+}
+
+/**
+ * @brief Splits a total over n buckets following a Zipf distribution.
+ *
+ * Bucket sizes are proportional to 1 / rank^s and then shuffled so the big buckets are
+ * not all at the lowest IDs. The result always sums to exactly total.
+ *
+ * @param n Number of buckets.
+ * @param total Sum of all bucket sizes.
+ * @param s Zipf exponent.
+ * @param rng Random generator.
+ * @return std::vector<long long> The bucket sizes.
+ */
+std::vector<long long> zipfSizes(long long n, long long total, double s, std::mt19937_64 &rng)
+{
+    std::vector<double> weights(n);
+    double sum = 0;
+    for (long long i = 0; i < n; i++)
+    {
+        weights[i] = 1.0 / std::pow(static_cast<double>(i + 1), s);
+        sum += weights[i];
+    }
+
+    std::vector<long long> sizes(n);
+    long long assigned = 0;
+    for (long long i = 0; i < n; i++)
+    {
+        sizes[i] = static_cast<long long>(std::floor(total * weights[i] / sum));
+        assigned += sizes[i];
+    }
+    for (long long i = 0; assigned < total; i = (i + 1) % n, assigned++)
+        sizes[i]++;
+
+    std::shuffle(sizes.begin(), sizes.end(), rng);
+    return sizes;
+}
+
+/**
+ * @brief Parses the command line into an Options struct.
+ *
+ * @return bool false if an unknown flag was given.
+ */
+bool parseArgs(int argc, char *argv[], Options &opt)
+{
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string flag = argv[i];
+        const char *value = argv[i + 1];
+        if (flag == "--out") opt.out = value;
+        else if (flag == "--users") opt.users = std::atoll(value);
+        else if (flag == "--projects") opt.projects = std::atoll(value);
+        else if (flag == "--tasks") opt.tasks = std::atoll(value);
+        else if (flag == "--members") opt.members = std::atof(value);
+        else if (flag == "--comments") opt.comments = std::atof(value);
+        else if (flag == "--zipf") opt.zipf = std::atof(value);
+        else if (flag == "--seed") opt.seed = std::strtoull(value, nullptr, 10);
+        else if (flag == "--batch") opt.batch = std::atoll(value);
+        else if (flag == "--today") opt.today = value;
+        else return false;
+    }
+    if (opt.today.empty())
+        today = static_cast<long long>(time(0) / 86400);
+    else if (!parseDay(opt.today, today))
+        return false;
+    return argc % 2 == 1 && opt.users > 0 && opt.projects > 0 && opt.batch > 0;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    Options opt;
+    if (!parseArgs(argc, argv, opt))
+    {
+        std::cerr << "Usage: generate_dataset [--out file] [--users N] [--projects N] [--tasks N]\n"
+                  << "                        [--members N] [--comments N] [--zipf S] [--seed N] [--batch N]\n"
+                  << "                        [--today YYYY-MM-DD]\n";
+        return 1;
+    }
+    batchSize = opt.batch;
+
+    std::remove(opt.out.c_str());
+    if (sqlite3_open(opt.out.c_str(), &db))
+    {
+        std::cerr << "Can't open DB: " << sqlite3_errmsg(db) << std::endl;
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::mt19937_64 rng(opt.seed);
+
+    // Bulk load settings, the file is thrown away if generation fails anyway
+    exec("PRAGMA journal_mode = OFF;");
+    exec("PRAGMA synchronous = OFF;");
+    exec("PRAGMA cache_size = -262144;");
+    exec("PRAGMA foreign_keys = OFF;");
+    exec(SCHEMA_SQL);
+    exec("BEGIN;");
+
+    // ---------------------- USERS ----------------------
+    sqlite3_stmt *userStmt = prepare("INSERT INTO users (id, name, email, password) VALUES (?, ?, ?, ?);");
+    for (long long id = 1; id <= opt.users; id++)
+    {
+        std::string name = "user" + std::to_string(id);
+        std::string email = name + "@example.com";
+        sqlite3_bind_int64(userStmt, 1, id);
+        sqlite3_bind_text(userStmt, 2, name.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(userStmt, 3, email.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(userStmt, 4, "password", -1, SQLITE_STATIC);
+        insertRow(userStmt);
+    }
+    sqlite3_finalize(userStmt);
+
+    // ---------------------- PROJECTS ----------------------
+    std::uniform_int_distribution<int> deadlineDays(-30, 365);
+    std::uniform_int_distribution<int> createdDays(-720, -1);
+    std::bernoulli_distribution projectDone(0.15);
+    sqlite3_stmt *projectStmt = prepare("INSERT INTO projects (id, deadline, date, completion_status) VALUES (?, ?, ?, ?);");
+    for (long long id = 1; id <= opt.projects; id++)
+    {
+        std::string deadline = dateFromToday(deadlineDays(rng));
+        std::string date = dateFromToday(createdDays(rng));
+        sqlite3_bind_int64(projectStmt, 1, id);
+        sqlite3_bind_text(projectStmt, 2, deadline.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(projectStmt, 3, date.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_int(projectStmt, 4, projectDone(rng) ? 1 : 0);
+        insertRow(projectStmt);
+    }
+    sqlite3_finalize(projectStmt);
+
+    // ---------------------- MEMBERSHIPS ----------------------
+    // Members per project are geometric around the average, and users are drawn with a
+    // Zipf skew so a few power users belong to many projects. Duplicates hit the primary
+    // key and are skipped by INSERT OR IGNORE.
+    std::vector<long long> userWeights = zipfSizes(opt.users, opt.users * 10, 0.8, rng);
+    std::discrete_distribution<long long> pickUser(userWeights.begin(), userWeights.end());
+    std::geometric_distribution<int> extraMembers(1.0 / std::max(1.0, opt.members));
+    std::vector<std::vector<long long>> projectMembers(opt.projects);
+    sqlite3_stmt *memberStmt = prepare("INSERT OR IGNORE INTO user_projects (user_id, project_id) VALUES (?, ?);");
+    for (long long p = 0; p < opt.projects; p++)
+    {
+        int count = 1 + extraMembers(rng);
+        for (int m = 0; m < count; m++)
+        {
+            long long userId = pickUser(rng) + 1;
+            projectMembers[p].push_back(userId);
+            sqlite3_bind_int64(memberStmt, 1, userId);
+            sqlite3_bind_int64(memberStmt, 2, p + 1);
+            insertRow(memberStmt);
+        }
+    }
+    sqlite3_finalize(memberStmt);
+
+    // ---------------------- TASKS & COMMENTS ----------------------
+    static const char *statuses[] = {"backlog", "inProgress", "completed"};
+    std::discrete_distribution<int> pickStatus({45, 20, 35});
+    std::discrete_distribution<int> pickPriority({20, 50, 30});
+    std::normal_distribution<double> dueSpread(14.0, 60.0);
+    std::poisson_distribution<int> commentCount(opt.comments);
+    std::uniform_int_distribution<int> bodyLength(1, 12);
+
+    std::vector<long long> taskCounts = zipfSizes(opt.projects, opt.tasks, opt.zipf, rng);
+    sqlite3_stmt *taskStmt = prepare(
+        "INSERT INTO tasks (id, title, description, due_date, priority, status, project_id) VALUES (?, ?, ?, ?, ?, ?, ?);");
+    sqlite3_stmt *commentStmt = prepare(
+        "INSERT INTO comments (body, date, status, user_id, task_id) VALUES (?, ?, 'active', ?, ?);");
+
+    long long taskId = 0;
+    long long commentTotal = 0;
+    for (long long p = 0; p < opt.projects; p++)
+    {
+        const std::vector<long long> &members = projectMembers[p];
+        std::uniform_int_distribution<size_t> pickMember(0, members.size() - 1);
+
+        for (long long t = 0; t < taskCounts[p]; t++)
+        {
+            taskId++;
+            std::string title = "Task " + std::to_string(taskId);
+            std::string description = "Generated task " + std::to_string(t + 1) + " of project " + std::to_string(p + 1);
+            std::string dueDate = dateFromToday(static_cast<int>(dueSpread(rng)));
+
+            sqlite3_bind_int64(taskStmt, 1, taskId);
+            sqlite3_bind_text(taskStmt, 2, title.c_str(), -1, SQLITE_TRANSIENT);
+            sqlite3_bind_text(taskStmt, 3, description.c_str(), -1, SQLITE_TRANSIENT);
+            sqlite3_bind_text(taskStmt, 4, dueDate.c_str(), -1, SQLITE_TRANSIENT);
+            sqlite3_bind_int(taskStmt, 5, pickPriority(rng) + 1);
+            sqlite3_bind_text(taskStmt, 6, statuses[pickStatus(rng)], -1, SQLITE_STATIC);
+            sqlite3_bind_int64(taskStmt, 7, p + 1);
+            insertRow(taskStmt);
+
+            int comments = commentCount(rng);
+            for (int c = 0; c < comments; c++)
+            {
+                std::string body(static_cast<size_t>(bodyLength(rng)) * 8, 'x');
+                std::string date = dateFromToday(-static_cast<int>(c));
+                sqlite3_bind_text(commentStmt, 1, body.c_str(), -1, SQLITE_TRANSIENT);
+                sqlite3_bind_text(commentStmt, 2, date.c_str(), -1, SQLITE_TRANSIENT);
+                sqlite3_bind_int64(commentStmt, 3, members[pickMember(rng)]);
+                sqlite3_bind_int64(commentStmt, 4, taskId);
+                insertRow(commentStmt);
+                commentTotal++;
+            }
+        }
+    }
+    sqlite3_finalize(taskStmt);
+    sqlite3_finalize(commentStmt);
+
+    exec("COMMIT;");
+
+    // Indexes and triggers are cheaper to build once over the loaded tables
+    exec(SCHEMA_INDEXES_SQL);
+    exec(BACKFILL_COMMENT_STATS_SQL);
+    exec(BACKFILL_RANKS_SQL);
+    exec(("PRAGMA user_version = " + std::to_string(SCHEMA_VERSION) + ";").c_str());
+    // Completion times and overdue flags are taken on the base day too, so they repeat
+    execOnBaseDay(BACKFILL_COMPLETED_AT_SQL);
+    execOnBaseDay(BACKFILL_OVERDUE_SQL);
+    exec("ANALYZE;");
+    sqlite3_close(db);
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Generated " << opt.out << " in " << seconds << "s: "
+              << opt.users << " users, " << opt.projects << " projects, "
+              << taskId << " tasks, " << commentTotal << " comments (seed " << opt.seed
+              << ", today " << formatDay(today) << ")" << std::endl;
+    return 0;
+}
@@ -0,0 +1,305 @@
+/**
+ * @file split_shards.cpp
+ * @brief Offline tool that splits taskmaster.db into the shard files of --shards N.
+ *
+ * Projects are placed greedily, largest first, on the shard with the fewest tasks so far,
+ * and move there with their memberships, tasks, comments, outbox events and archived
+ * rows. Tasks of no project stay on shard 0. Every user is copied to every shard.
+ *
+ * A row on shard k gets its old ID plus k * ShardSet::ID_SPAN, so the server finds its
+ * shard from the ID alone. Projects left on shard 0 keep their IDs; the IDs of the others
+ * change, which clients holding old IDs have to be told about. The mapping of every moved
+ * project is printed.
+ *
+ * Run it with the server stopped, then move the files next to the server and start it
+ * with the same --shards.
+ *
+ * Usage:
+ *   split_shards --shards N [--in taskmaster.db] [--out-dir split]
+ */
+
+#include <sqlite3.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "../Schema.h"
+#include "../ShardSet.h"
+
+namespace {
+
+/**
+ * @brief Split settings, filled from the command line.
+ */
+struct Options
+{
+    std::string in = "taskmaster.db";  /**< Database to split, left unchanged */
+    std::string outDir = "split";      /**< Directory receiving the shard files */
+    int shards = 0;                    /**< Number of shards */
+};
+
+/**
+ * @brief Executes a raw SQL command and exits on failure.
+ *
+ * @param db The connection.
+ * @param sql The raw SQL to execute.
+ */
+void exec(sqlite3 *db, const std::string &sql)
+{
+    char *errMsg = nullptr;
+    if (sqlite3_exec(db, sql.c_str(), nullptr, nullptr, &errMsg) != SQLITE_OK)
+    {
+        std::cerr << "SQL error: " << errMsg << std::endl;
+        sqlite3_free(errMsg);
+        std::exit(1);
+    }
+}
+
+/**
+ * @brief Runs a query returning one integer and exits on failure.
+ *
+ * @param db The connection.
+ * @param sql The query.
+ * @return long long The value of the first column, 0 if it is NULL.
+ */
+long long queryInt(sqlite3 *db, const char *sql)
+{
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK)
+    {
+        std::cerr << "Prepare failed: " << sqlite3_errmsg(db) << std::endl;
+        std::exit(1);
+    }
+    long long value = sqlite3_step(stmt) == SQLITE_ROW ? sqlite3_column_int64(stmt, 0) : 0;
+    sqlite3_finalize(stmt);
+    return value;
+}
+
+/**
+ * @brief Assigns every project to a shard, largest first to the least loaded shard.
+ *
+ * @param db The connection to the input database.
+ * @param shards Number of shards.
+ * @return std::vector<std::pair<long long, int>> Project ID and shard of every project.
+ */
+std::vector<std::pair<long long, int>> placeProjects(sqlite3 *db, int shards)
+{
+    sqlite3_stmt *stmt;
+    const char *sql = R"(
+        SELECT p.id, (SELECT count(*) FROM tasks WHERE project_id = p.id)
+                     + (SELECT count(*) FROM tasks_archive WHERE project_id = p.id) AS size
+        FROM projects p ORDER BY size DESC, p.id;
+    )";
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK)
+    {
+        std::cerr << "Prepare failed: " << sqlite3_errmsg(db) << std::endl;
+        std::exit(1);
+    }
+
+    std::vector<long long> load(shards, 0);
+    std::vector<std::pair<long long, int>> placement;
+    while (sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        int shard = static_cast<int>(std::min_element(load.begin(), load.end()) - load.begin());
+        load[shard] += sqlite3_column_int64(stmt, 1);
+        placement.emplace_back(sqlite3_column_int64(stmt, 0), shard);
+    }
+    sqlite3_finalize(stmt);
+
+    for (int i = 0; i < shards; i++)
+        std::cout << "Shard " << i << ": " << load[i] << " tasks" << std::endl;
+    return placement;
+}
+
+/**
+ * @brief Writes the rows of one shard into a new file.
+ *
+ * The rows are copied before the indexes and triggers are created, so the triggers do
+ * not recompute completed_at or the comment counts of copied rows.
+ *
+ * @param inPath The input database.
+ * @param outPath The shard file, replaced if it exists.
+ * @param index The shard.
+ * @param placement Shard of every project.
+ */
+void writeShard(const std::string &inPath, const std::string &outPath, int index,
+                const std::vector<std::pair<long long, int>> &placement)
+{
+    std::remove(outPath.c_str());
+    sqlite3 *db;
+    if (sqlite3_open(outPath.c_str(), &db))
+    {
+        std::cerr << "Can't open " << outPath << ": " << sqlite3_errmsg(db) << std::endl;
+        std::exit(1);
+    }
+
+    // Bulk load settings, the file is thrown away if the split fails anyway
+    exec(db, "PRAGMA auto_vacuum = INCREMENTAL;");
+    exec(db, "PRAGMA journal_mode = OFF;");
+    exec(db, "PRAGMA synchronous = OFF;");
+    exec(db, "PRAGMA foreign_keys = OFF;");
+    exec(db, SCHEMA_SQL);
+
+    sqlite3_stmt *attach;
+    sqlite3_prepare_v2(db, "ATTACH DATABASE ? AS src;", -1, &attach, nullptr);
+    sqlite3_bind_text(attach, 1, inPath.c_str(), -1, SQLITE_TRANSIENT);
+    if (sqlite3_step(attach) != SQLITE_DONE)
+    {
+        std::cerr << "Can't attach " << inPath << ": " << sqlite3_errmsg(db) << std::endl;
+        std::exit(1);
+    }
+    sqlite3_finalize(attach);
+
+    exec(db, "CREATE TEMP TABLE here (project_id INTEGER PRIMARY KEY);");
+    exec(db, "BEGIN;");
+    sqlite3_stmt *here;
+    sqlite3_prepare_v2(db, "INSERT INTO temp.here (project_id) VALUES (?);", -1, &here, nullptr);
+    for (const auto &project : placement)
+    {
+        if (project.second != index)
+            continue;
+        sqlite3_bind_int64(here, 1, project.first);
+        sqlite3_step(here);
+        sqlite3_reset(here);
+    }
+    sqlite3_finalize(here);
+
+    // Tasks of no project, or of a project that no longer exists, stay on shard 0
+    std::string offset = std::to_string(ShardSet::firstId(index));
+    std::string tasksHere = "project_id IN (SELECT project_id FROM temp.here)";
+    if (index == 0)
+        tasksHere = "(" + tasksHere + " OR project_id IS NULL OR project_id NOT IN (SELECT id FROM src.projects))";
+    std::string projectId = "CASE WHEN project_id IN (SELECT project_id FROM temp.here) THEN project_id + " +
+                            offset + " ELSE project_id END";
+
+    exec(db, "INSERT INTO users (id, name, email, password) SELECT id, name, email, password FROM src.users;");
+    exec(db, "INSERT INTO projects (id, deadline, date, completion_status) "
+             "SELECT id + " + offset + ", deadline, date, completion_status FROM src.projects "
+             "WHERE id IN (SELECT project_id FROM temp.here);");
+    exec(db, "INSERT INTO user_projects (user_id, project_id) "
+             "SELECT user_id, project_id + " + offset + " FROM src.user_projects "
+             "WHERE project_id IN (SELECT project_id FROM temp.here);");
+    for (const char *table : {"tasks", "tasks_archive"})
+    {
+        std::string archived = std::string(table) == "tasks_archive" ? ", archived_at" : ", overdue";
+        exec(db, std::string("INSERT INTO ") + table + " (id, title, description, due_date, priority, status, project_id, "
+                 "comment_count, last_activity, rank, completed_at" + archived + ") "
+                 "SELECT id + " + offset + ", title, description, due_date, priority, status, " + projectId + ", "
+                 "comment_count, last_activity, rank, completed_at" + archived + " FROM src." + table +
+                 " WHERE " + tasksHere + ";");
+    }
+    const std::pair<const char *, const char *> comments[] = {{"comments", "tasks"}, {"comments_archive", "tasks_archive"}};
+    for (const auto &table : comments)
+    {
+        exec(db, std::string("INSERT INTO ") + table.first + " (id, body, date, status, user_id, task_id, deleted_at) "
+                 "SELECT id + " + offset + ", body, date, status, user_id, task_id + " + offset + ", deleted_at "
+                 "FROM src." + table.first + " WHERE task_id IN (SELECT id FROM src." + table.second +
+                 " WHERE " + tasksHere + ");");
+    }
+    exec(db, "INSERT INTO outbox (event, task_id, project_id, due_date, created_at) "
+             "SELECT event, task_id + " + offset + ", " + projectId + ", due_date, created_at FROM src.outbox "
+             "WHERE task_id IN (SELECT id FROM src.tasks WHERE " + tasksHere +
+             " UNION ALL SELECT id FROM src.tasks_archive WHERE " + tasksHere + ") ORDER BY id;");
+    exec(db, "COMMIT;");
+
+    // The shard holds the source's rank keys, so it is at the source's schema version
+    sqlite3_stmt *version;
+    sqlite3_prepare_v2(db, "PRAGMA src.user_version;", -1, &version, nullptr);
+    if (sqlite3_step(version) == SQLITE_ROW)
+        exec(db, "PRAGMA user_version = " + std::to_string(sqlite3_column_int(version, 0)) + ";");
+    sqlite3_finalize(version);
+    exec(db, "DETACH DATABASE src;");
+
+    exec(db, SCHEMA_INDEXES_SQL);
+    std::string error;
+    if (!ShardSet::prepare(db, index, error))
+    {
+        std::cerr << "Shard " << index << " is inconsistent: " << error << std::endl;
+        std::exit(1);
+    }
+    exec(db, "ANALYZE;");
+    exec(db, "PRAGMA journal_mode = WAL;");
+
+    std::cout << "Wrote " << outPath << ": "
+              << queryInt(db, "SELECT count(*) FROM projects;") << " projects, "
+              << queryInt(db, "SELECT count(*) FROM tasks;") << " tasks, "
+              << queryInt(db, "SELECT count(*) FROM comments;") << " comments" << std::endl;
+    sqlite3_close(db);
+}
+
+/**
+ * @brief Parses the command line into an Options struct.
+ *
+ * @return bool false if an unknown flag was given.
+ */
+bool parseArgs(int argc, char *argv[], Options &opt)
+{
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string flag = argv[i];
+        const char *value = argv[i + 1];
+        if (flag == "--in") opt.in = value;
+        else if (flag == "--out-dir") opt.outDir = value;
+        else if (flag == "--shards") opt.shards = std::atoi(value);
+        else return false;
+    }
+    return argc % 2 == 1 && opt.shards >= 1 && opt.shards <= ShardSet::MAX_SHARDS;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    Options opt;
+    if (!parseArgs(argc, argv, opt))
+    {
+        std::cerr << "Usage: split_shards --shards N [--in file] [--out-dir dir]\n"
+                  << "       N is 1 to " << ShardSet::MAX_SHARDS << std::endl;
+        return 1;
+    }
+
+    sqlite3 *db;
+    if (sqlite3_open_v2(opt.in.c_str(), &db, SQLITE_OPEN_READONLY, nullptr))
+    {
+        std::cerr << "Can't open " << opt.in << ": " << sqlite3_errmsg(db) << std::endl;
+        return 1;
+    }
+    std::string error;
+    if (!ShardSet::prepare(db, 0, error))
+    {
+        std::cerr << opt.in << " is already split: " << error << std::endl;
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::pair<long long, int>> placement = placeProjects(db, opt.shards);
+    sqlite3_close(db);
+
+    std::error_code dirError;
+    std::filesystem::create_directories(opt.outDir, dirError);
+    if (dirError)
+    {
+        std::cerr << "Can't create " << opt.outDir << ": " << dirError.message() << std::endl;
+        return 1;
+    }
+    std::string mainPath = (std::filesystem::path(opt.outDir) /
+                            std::filesystem::path(opt.in).filename()).string();
+    for (int i = 0; i < opt.shards; i++)
+        writeShard(opt.in, ShardSet::pathOf(mainPath, i), i, placement);
+
+    for (const auto &project : placement)
+    {
+        if (project.second > 0)
+            std::cout << "Project " << project.first << " is now "
+                      << project.first + ShardSet::firstId(project.second) << std::endl;
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Split " << opt.in << " into " << opt.shards << " shards in " << seconds << "s" << std::endl;
+    return 0;
+}
@@ -0,0 +1,184 @@
+/**
+ * @file stress_concurrent_todo_list.cpp
+ * @brief ThreadSanitizer stress test of ConcurrentTodoList.
+ *
+ * Readers walk snapshots while writers move, replace and re-prioritize tasks. Every
+ * write keeps the same set of task IDs, so every snapshot a reader sees must hold each
+ * ID exactly once, whichever version it is. A snapshot kept across other reads must
+ * not change. Built with -fsanitize=thread, any data race between the
+ * readers' cached snapshots and the writers is reported by the sanitizer.
+ *
+ * Usage:
+ *   stress_concurrent_todo_list [--tasks N] [--readers N] [--writers N] [--seconds N] [--seed N]
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../ConcurrentTodoList.h"
+
+namespace {
+
+/**
+ * @brief Test settings, filled from the command line.
+ */
+struct Options
+{
+    int tasks = 2000;              /**< Tasks on the board, IDs 1 to tasks */
+    int readers = 4;               /**< Reading threads */
+    int writers = 2;               /**< Writing threads */
+    int seconds = 5;               /**< Length of the run */
+    unsigned long long seed = 42;  /**< Random seed */
+};
+
+/**
+ * @brief Parses the command line into an Options struct.
+ *
+ * @return bool false if an unknown flag was given.
+ */
+bool parseArgs(int argc, char *argv[], Options &opt)
+{
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string flag = argv[i];
+        const char *value = argv[i + 1];
+        if (flag == "--tasks") opt.tasks = std::atoi(value);
+        else if (flag == "--readers") opt.readers = std::atoi(value);
+        else if (flag == "--writers") opt.writers = std::atoi(value);
+        else if (flag == "--seconds") opt.seconds = std::atoi(value);
+        else if (flag == "--seed") opt.seed = std::strtoull(value, nullptr, 10);
+        else return false;
+    }
+    return argc % 2 == 1 && opt.tasks > 0 && opt.readers > 0 && opt.writers > 0 && opt.seconds > 0;
+}
+
+const char *CATEGORIES[] = {"Backlog", "Doing", "Review", "Done"};
+const char *PRIORITIES[] = {"1", "2", "3"};
+
+/**
+ * @brief Checks that a snapshot holds every task ID exactly once.
+ *
+ * @param list The snapshot.
+ * @param tasks Number of tasks on the board.
+ * @return bool true if the snapshot is whole.
+ */
+bool whole(const TodoList &list, int tasks)
+{
+    std::vector<char> seen(tasks + 1, 0);
+    size_t count = 0;
+    for (const char *category : CATEGORIES)
+    {
+        for (const Task &task : list.getCategory(category))
+        {
+            int id = task.getTaskID();
+            if (id < 1 || id > tasks || seen[id]++)
+                return false;
+            count++;
+        }
+    }
+    size_t prioritized = 0;
+    for (const char *priority : PRIORITIES)
+        prioritized += list.filterByPriority(priority).size();
+    return count == static_cast<size_t>(tasks) && prioritized == count;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    Options opt;
+    if (!parseArgs(argc, argv, opt))
+    {
+        std::cerr << "Usage: stress_concurrent_todo_list [--tasks N] [--readers N] [--writers N] [--seconds N] [--seed N]\n";
+        return 1;
+    }
+
+    TodoList initial;
+    for (int id = 1; id <= opt.tasks; id++)
+        initial.restoreTask(Task(id, "Task " + std::to_string(id), "2025-06-15", CATEGORIES[id % 4], PRIORITIES[id % 3]));
+    ConcurrentTodoList board(std::move(initial));
+    // Read in between, so each thread's cache keeps switching lists
+    ConcurrentTodoList other;
+
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> broken{0};
+    std::vector<std::thread> threads;
+
+    for (int r = 0; r < opt.readers; r++)
+    {
+        threads.emplace_back([&, r]
+                             {
+            std::mt19937_64 rng(opt.seed + 1000 + r);
+            while (!stop.load(std::memory_order_relaxed))
+            {
+                if (!whole(*board.snapshot(), opt.tasks))
+                    broken++;
+
+                // A held snapshot stays the same while this thread reads newer versions
+                ConcurrentTodoList::Snapshot held = board.snapshot();
+                size_t backlog = held->getCategory("Backlog").size();
+                board.filterTask(CATEGORIES[rng() % 4]);
+                other.filterTask("Backlog");
+                board.snapshot()->getTask(1 + static_cast<int>(rng() % opt.tasks));
+                if (held->getCategory("Backlog").size() != backlog || !whole(*held, opt.tasks))
+                    broken++;
+            } });
+    }
+
+    for (int w = 0; w < opt.writers; w++)
+    {
+        threads.emplace_back([&, w]
+                             {
+            std::mt19937_64 rng(opt.seed + w);
+            while (!stop.load(std::memory_order_relaxed))
+            {
+                int id = 1 + static_cast<int>(rng() % opt.tasks);
+                switch (rng() % 3)
+                {
+                case 0:
+                    board.updateStatus(id, CATEGORIES[rng() % 4]);
+                    break;
+                case 1:
+                    // Delete and create in one publish, so readers never see the gap
+                    board.modify([&](TodoList &list)
+                                 {
+                        if (!list.deleteTask(id))
+                            return false;
+                        list.restoreTask(Task(id, "Task " + std::to_string(id), "2025-06-16", CATEGORIES[rng() % 4], PRIORITIES[rng() % 3]));
+                        return true; });
+                    break;
+                default:
+                    board.modify([&](TodoList &list)
+                                 {
+                        const Task *task = list.getTask(id);
+                        if (task == nullptr)
+                            return false;
+                        Task changed = *task;
+                        changed.editTaskPriority(PRIORITIES[rng() % 3]);
+                        list.storeTask(std::move(changed));
+                        return true; });
+                    break;
+                }
+            } });
+    }
+
+    std::this_thread::sleep_for(std::chrono::seconds(opt.seconds));
+    stop = true;
+    for (std::thread &thread : threads)
+        thread.join();
+
+    ConcurrentTodoList::Stats stats = board.stats();
+    std::cout << stats.reads << " reads (" << stats.snapshotLoads << " snapshot loads), "
+              << stats.writes << " writes (" << stats.contendedWrites << " contended)\n";
+    if (broken > 0 || !whole(*board.snapshot(), opt.tasks))
+    {
+        std::cerr << broken.load() << " inconsistent snapshots" << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,36 @@
+// Writes name.gz and name.br next to every compressible file of the build, so the
+// backend can serve them as they are instead of compressing on each request.
+const fs = require("fs");
+const path = require("path");
+const zlib = require("zlib");
+
+const BUILD_DIR = path.join(__dirname, "..", "build");
+const COMPRESSIBLE = new Set([".html", ".js", ".css", ".json", ".map", ".txt", ".svg", ".ico"]);
+const MIN_SIZE = 1024;
+
+function walk(dir) {
+  for (const entry of fs.readdirSync(dir, { withFileTypes: true })) {
+    const file = path.join(dir, entry.name);
+    if (entry.isDirectory()) {
+      walk(file);
+      continue;
+    }
+    if (!COMPRESSIBLE.has(path.extname(file))) continue;
+
+    const content = fs.readFileSync(file);
+    if (content.length < MIN_SIZE) continue;
+
+    const gzip = zlib.gzipSync(content, { level: 9 });
+    const brotli = zlib.brotliCompressSync(content, {
+      params: {
+        [zlib.constants.BROTLI_PARAM_QUALITY]: zlib.constants.BROTLI_MAX_QUALITY,
+        [zlib.constants.BROTLI_PARAM_SIZE_HINT]: content.length,
+      },
+    });
+    // A variant that does not save anything is not worth a Content-Encoding
+    if (gzip.length < content.length) fs.writeFileSync(file + ".gz", gzip);
+    if (brotli.length < content.length) fs.writeFileSync(file + ".br", brotli);
+  }
+}
+
+walk(BUILD_DIR);
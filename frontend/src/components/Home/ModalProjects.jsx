@@ -69,13 +69,24 @@ const ModalProjects = ({
 
     try {
       const response = await fetch(
-        `http://localhost:8080/projects/${projectId}`,
+        `/projects/${projectId}`,
         {
           method: "DELETE",
         }
       );
 
-      if (response.ok || response.status === 204) {
+      if (response.status === 202) {
+        // Large projects are deleted in the background, wait for the job to finish
+        let job = await response.json();
+        while (job.state === "queued" || job.state === "running") {
+          await new Promise((resolve) => setTimeout(resolve, 500));
+          job = await (await fetch(`/jobs/${job.id}`)).json();
+        }
+        if (job.state === "done") alert("Project deleted.");
+        else alert("Failed to delete project: " + job.error);
+        refreshProjects();
+        refreshTasks();
+      } else if (response.ok) {
         alert("Project deleted.");
         refreshProjects();
         refreshTasks();
@@ -100,7 +111,7 @@ const ModalProjects = ({
     }
 
     try {
-      const response = await fetch("http://localhost:8080/projects", {
+      const response = await fetch("/projects", {
         method: "POST",
         headers: {
           "Content-Type": "application/json",
@@ -115,7 +126,7 @@ const ModalProjects = ({
       if (response.ok) {
         const createdProject = await response.json();
 
-        const assignRes = await fetch("http://localhost:8080/user_projects", {
+        const assignRes = await fetch("/user_projects", {
           method: "POST",
           headers: {
             "Content-Type": "application/json",
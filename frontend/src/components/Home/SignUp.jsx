@@ -45,7 +45,7 @@ const SignUp = ({ onSave, onCancel }) => {
     try {
       // Check if user with this email already exists
       const response = await fetch(
-        `http://localhost:8080/users/email/${encodeURIComponent(email)}`,
+        `/users/email/${encodeURIComponent(email)}`,
         {
           method: "GET",
           headers: {
@@ -51,7 +51,7 @@ const Calendar = () => {
   const fetchTasks = async () => {
     try {
       const res = await fetch(
-        `http://localhost:8080/users/${userData.id}/tasks`
+        `/users/${userData.id}/tasks`
       );
       if (res.ok) {
         const data = await res.json();
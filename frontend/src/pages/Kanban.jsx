@@ -38,20 +38,36 @@ const Kanban = () => {
     const [activeTask, setActiveTask] = useState(null);
     const [users, setUsers] = useState([]);
     const [selectedUserId, setSelectedUserId] = useState("");
+    const [userQuery, setUserQuery] = useState("");
 
-    // Fetch users for project association
+    // Suggest users for project association as the name or email is typed
     useEffect(() => {
-        fetch("http://localhost:8080/users")
-            .then(res => res.json())
-            .then(data => setUsers(data))
-            .catch(err => console.error("Failed to fetch users", err));
-    }, []);
+        const prefix = userQuery.trim();
+        if (!prefix) {
+            setUsers([]);
+            return;
+        }
+        const controller = new AbortController();
+        const timer = setTimeout(() => {
+            fetch(`/users/search?prefix=${encodeURIComponent(prefix)}&limit=10`, { signal: controller.signal })
+                .then(res => res.json())
+                .then(data => setUsers(data))
+                .catch(err => {
+                    if (err.name !== "AbortError")
+                        console.error("Failed to search users", err);
+                });
+        }, 200);
+        return () => {
+            clearTimeout(timer);
+            controller.abort();
+        };
+    }, [userQuery]);
 
     // Fetch tasks associated with the project
     useEffect(() => {
         if (!projectId) return;
 
-        fetch(`http://localhost:8080/tasks?project_id=${projectId}`)
+        fetch(`/tasks?project_id=${projectId}`)
             .then(res => res.json())
             .then(data => setTasks(data))
             .catch(err => console.error("Failed to fetch tasks", err));
@@ -83,7 +99,7 @@ const Kanban = () => {
         if (!selectedUserId || !projectId) return;
 
         try {
-            const res = await fetch("http://localhost:8080/user_projects", {
+            const res = await fetch("/user_projects", {
                 method: "POST",
                 headers: { "Content-Type": "application/json" },
                 body: JSON.stringify({
@@ -115,7 +131,7 @@ const Kanban = () => {
      */
     const addTask = async (title, description, priority, due_date) => {
         try {
-            const response = await fetch("http://localhost:8080/tasks", {
+            const response = await fetch("/tasks", {
                 method: "POST",
                 headers: {
                     "Content-Type": "application/json"
@@ -134,7 +150,7 @@ const Kanban = () => {
                 const newTask = await response.json();
                 setTasks(prev => [...prev, newTask]);
             } else if (response.status === 204) {
-                const refreshed = await fetch(`http://localhost:8080/tasks?project_id=${projectId}`);
+                const refreshed = await fetch(`/tasks?project_id=${projectId}`);
                 const data = await refreshed.json();
                 setTasks(data);
             } else {
@@ -174,14 +190,14 @@ const Kanban = () => {
         const newStatus = over.id;
 
         if (newStatus === 'delete') {
-            await fetch(`http://localhost:8080/tasks/${taskId}`, { method: "DELETE" });
+            await fetch(`/tasks/${taskId}`, { method: "DELETE" });
             setTasks(tasks.filter(task => task.id.toString() !== taskId));
         } else {
             const updatedTasks = tasks.map(task =>
                 task.id.toString() === taskId ? { ...task, status: newStatus } : task
             );
             setTasks(updatedTasks);
-            await fetch(`http://localhost:8080/tasks/${taskId}`, {
+            await fetch(`/tasks/${taskId}`, {
                 method: "PUT",
                 headers: { "Content-Type": "application/json" },
                 body: JSON.stringify({ status: newStatus })
@@ -217,6 +233,15 @@ const Kanban = () => {
                     <button onClick={handleSortByPriority}>Sort by Priority</button>
                     <button onClick={handleSortByDueDate}>Sort by Due Date</button>
                     <button onClick={handleAddUserToProject}>Add User</button>
+                    <input
+                        type="search"
+                        placeholder="Find user by name or email"
+                        value={userQuery}
+                        onChange={(e) => {
+                            setUserQuery(e.target.value);
+                            setSelectedUserId("");
+                        }}
+                    />
                     <select
                         value={selectedUserId}
                         onChange={(e) => setSelectedUserId(e.target.value)}
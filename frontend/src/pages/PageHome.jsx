@@ -61,7 +61,7 @@ const PageHome = () => {
     try {
       /// API call.
       const response = await fetch(
-        `http://localhost:8080/users/${userData.id}/tasks`
+        `/users/${userData.id}/tasks`
       );
 
       /// If valid response, set the state variables.
@@ -91,7 +91,7 @@ const PageHome = () => {
     try {
       /// API call.
       const res = await fetch(
-        `http://localhost:8080/users/${userData.id}/projects`
+        `/users/${userData.id}/projects`
       );
 
       /// If valid response, set the state variable.
@@ -61,7 +61,7 @@ const PageLogin = () => {
     /// Call the API and process response for login.
     try {
       /// API call.
-      const response = await fetch("http://localhost:8080/auth/login", {
+      const response = await fetch("/auth/login", {
         method: "POST",
         headers: {
           "Content-Type": "application/json",
@@ -113,7 +113,7 @@ const PageLogin = () => {
   const handleSignUp = async (userData) => {
     try {
       /// API Call.
-      const response = await fetch("http://localhost:8080/users", {
+      const response = await fetch("/users", {
         method: "POST",
         headers: {
           "Content-Type": "application/json",